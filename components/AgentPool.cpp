@@ -0,0 +1,364 @@
+/**
+ * @file AgentPool.cpp
+ * @brief Accepts nanoCronAgent connections and dispatches runs to them
+ */
+
+#include "AgentPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+AgentPool::AgentPool(Logger& loggerRef) : logger(loggerRef) {}
+
+AgentPool::~AgentPool() {
+    stop();
+}
+
+int64_t AgentPool::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool AgentPool::start(const std::string& endpoint, std::string& error) {
+    listen_fd = AgentProtocol::listenEndpoint(endpoint, error);
+    if (listen_fd < 0) {
+        return false;
+    }
+    if (pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        error = std::string("pipe failed: ") + std::strerror(errno);
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    if (endpoint.compare(0, 5, "unix:") == 0) {
+        unix_path = endpoint.substr(5);
+    }
+    running.store(true);
+    pool_thread = std::thread(&AgentPool::poolLoop, this);
+    logger.info("AgentPool: listening for agents on " + endpoint);
+    return true;
+}
+
+void AgentPool::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    wake();
+    if (pool_thread.joinable()) {
+        pool_thread.join();
+    }
+
+    // Ask agents to kill what is still running, then fail those runs locally
+    std::unordered_map<uint64_t, PendingRun> orphans;
+    std::vector<std::shared_ptr<Connection>> open;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        orphans.swap(pending);
+        open.swap(connections);
+    }
+    for (const auto& entry : orphans) {
+        std::lock_guard<std::mutex> send_lock(entry.second.connection->send_mutex);
+        AgentProtocol::sendFrame(entry.second.connection->fd, AgentProtocol::encode(AgentCancel{entry.first}));
+    }
+    for (const auto& connection : open) {
+        std::lock_guard<std::mutex> send_lock(connection->send_mutex);
+        close(connection->fd);
+        connection->fd = -1;
+    }
+    for (auto& entry : orphans) {
+        ExecResult result;
+        result.cancelled = true;
+        result.error = "scheduler shutting down";
+        entry.second.done(result, entry.second.connection->hello.agent_id);
+    }
+
+    close(listen_fd);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    listen_fd = wake_pipe[0] = wake_pipe[1] = -1;
+    if (!unix_path.empty()) {
+        unlink(unix_path.c_str());
+    }
+}
+
+uint64_t AgentPool::submit(const std::string& job_id, const ExecRequest& request, AgentCompletion done, std::string& error) {
+    std::shared_ptr<Connection> target;
+    uint64_t run_id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t best_free = 0;
+        for (const auto& connection : connections) {
+            if (!connection->ready || connection->running >= connection->hello.capacity) continue;
+            uint32_t free_slots = connection->hello.capacity - connection->running;
+            if (free_slots > best_free) {
+                best_free = free_slots;
+                target = connection;
+            }
+        }
+        if (!target) {
+            error = connections.empty() ? "no agent connected" : "all agents at capacity";
+            return 0;
+        }
+        run_id = next_run_id++;
+        target->running++;
+        pending[run_id] = PendingRun{target, std::move(done)};
+    }
+
+    AgentRun message;
+    message.run_id = run_id;
+    message.job_id = job_id;
+    message.request = request;
+    bool sent;
+    {
+        std::lock_guard<std::mutex> send_lock(target->send_mutex);
+        sent = AgentProtocol::sendFrame(target->fd, AgentProtocol::encode(message));
+    }
+    if (!sent) {
+        // The pool thread will notice the broken connection; undo this run only
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.erase(run_id) && target->running > 0) {
+            target->running--;
+        }
+        error = "send to agent " + target->hello.agent_id + " failed";
+        return 0;
+    }
+    return run_id;
+}
+
+bool AgentPool::cancel(uint64_t run_id) {
+    std::shared_ptr<Connection> connection;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(run_id);
+        if (it == pending.end()) {
+            return false;
+        }
+        connection = it->second.connection;
+    }
+    std::lock_guard<std::mutex> send_lock(connection->send_mutex);
+    return AgentProtocol::sendFrame(connection->fd, AgentProtocol::encode(AgentCancel{run_id}));
+}
+
+std::vector<AgentInfo> AgentPool::agents() const {
+    std::vector<AgentInfo> list;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& connection : connections) {
+        if (connection->ready) {
+            list.push_back({connection->hello.agent_id, connection->hello.hostname,
+                            connection->hello.capacity, connection->running});
+        }
+    }
+    return list;
+}
+
+size_t AgentPool::inFlight() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending.size();
+}
+
+void AgentPool::wake() {
+    char byte = 1;
+    ssize_t ignored = write(wake_pipe[1], &byte, 1);
+    (void)ignored;
+}
+
+/**
+ * Pool thread: accept agents, read frames, send heartbeats, expire silent agents
+ */
+void AgentPool::poolLoop() {
+    int64_t next_heartbeat = nowMs() + HEARTBEAT_MS;
+    std::vector<struct pollfd> fds;
+    std::vector<std::shared_ptr<Connection>> polled;
+
+    while (running.load()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            polled = connections;
+        }
+        fds.clear();
+        fds.push_back({wake_pipe[0], POLLIN, 0});
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& connection : polled) {
+            fds.push_back({connection->fd, POLLIN, 0});
+        }
+
+        int timeout = static_cast<int>(std::max<int64_t>(0, next_heartbeat - nowMs()));
+        if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+            logger.error(std::string("AgentPool: poll failed: ") + std::strerror(errno));
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {}
+        }
+        if (fds[1].revents & POLLIN) {
+            acceptAgent();
+        }
+        for (size_t i = 0; i < polled.size(); ++i) {
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+                if (!readFrom(polled[i])) {
+                    dropConnection(polled[i], "connection closed");
+                }
+            }
+        }
+
+        int64_t now = nowMs();
+        if (now >= next_heartbeat) {
+            next_heartbeat = now + HEARTBEAT_MS;
+            for (const auto& connection : polled) {
+                if (now - connection->last_seen_ms > 3 * HEARTBEAT_MS) {
+                    dropConnection(connection, "heartbeat timeout");
+                    continue;
+                }
+                std::lock_guard<std::mutex> send_lock(connection->send_mutex);
+                AgentProtocol::sendFrame(connection->fd, AgentProtocol::encode(AgentHeartbeat{0, 0}));
+            }
+        }
+    }
+}
+
+void AgentPool::acceptAgent() {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    auto connection = std::make_shared<Connection>();
+    connection->fd = fd;
+    connection->last_seen_ms = nowMs();
+    std::lock_guard<std::mutex> lock(mutex);
+    connections.push_back(connection);
+}
+
+bool AgentPool::readFrom(const std::shared_ptr<Connection>& connection) {
+    char data[16384];
+    ssize_t n = recv(connection->fd, data, sizeof(data), MSG_DONTWAIT);
+    if (n == 0) {
+        return false;
+    }
+    if (n < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    connection->buffer.append(data, static_cast<size_t>(n));
+    connection->last_seen_ms = nowMs();
+
+    AgentMessageType type;
+    std::string payload;
+    std::string error;
+    while (AgentProtocol::nextFrame(connection->buffer, type, payload, error)) {
+        if (!handleFrame(connection, type, payload)) {
+            return false;
+        }
+    }
+    if (!error.empty()) {
+        logger.error("AgentPool: " + error);
+        return false;
+    }
+    return true;
+}
+
+bool AgentPool::handleFrame(const std::shared_ptr<Connection>& connection, AgentMessageType type, const std::string& payload) {
+    if (!connection->ready && type != AgentMessageType::HELLO) {
+        logger.error("AgentPool: agent sent a frame before HELLO");
+        return false;
+    }
+
+    switch (type) {
+    case AgentMessageType::HELLO: {
+        AgentHello hello;
+        if (!AgentProtocol::decode(payload, hello) || hello.version != NANOCRON_AGENT_PROTOCOL_VERSION) {
+            logger.error("AgentPool: rejected agent with unsupported HELLO");
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connection->hello = hello;
+            connection->hello.capacity = std::max<uint32_t>(1, hello.capacity);
+            connection->ready = true;
+        }
+        logger.info("AgentPool: agent " + hello.agent_id + "@" + hello.hostname + " connected, capacity " +
+                    std::to_string(hello.capacity));
+        return true;
+    }
+    case AgentMessageType::HEARTBEAT: {
+        AgentHeartbeat heartbeat;
+        return AgentProtocol::decode(payload, heartbeat);
+    }
+    case AgentMessageType::STARTED: {
+        AgentStarted started;
+        return AgentProtocol::decode(payload, started);
+    }
+    case AgentMessageType::FINISHED: {
+        AgentFinished finished;
+        if (!AgentProtocol::decode(payload, finished)) return false;
+        complete(finished.run_id, finished.result);
+        return true;
+    }
+    case AgentMessageType::REJECTED: {
+        AgentRejected rejected;
+        if (!AgentProtocol::decode(payload, rejected)) return false;
+        ExecResult result;
+        result.error = "rejected by agent " + connection->hello.agent_id + ": " + rejected.reason;
+        complete(rejected.run_id, result);
+        return true;
+    }
+    default:
+        logger.error("AgentPool: unexpected frame type " + std::to_string(static_cast<int>(type)));
+        return false;
+    }
+}
+
+void AgentPool::complete(uint64_t run_id, const ExecResult& result) {
+    PendingRun run;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(run_id);
+        if (it == pending.end()) {
+            return;   // Unknown or already failed
+        }
+        run = std::move(it->second);
+        pending.erase(it);
+        if (run.connection->running > 0) {
+            run.connection->running--;
+        }
+    }
+    run.done(result, run.connection->hello.agent_id);
+}
+
+void AgentPool::dropConnection(const std::shared_ptr<Connection>& connection, const std::string& reason) {
+    std::vector<std::pair<uint64_t, PendingRun>> lost;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find(connections.begin(), connections.end(), connection);
+        if (it == connections.end()) {
+            return;
+        }
+        connections.erase(it);
+        for (auto run = pending.begin(); run != pending.end();) {
+            if (run->second.connection == connection) {
+                lost.emplace_back(run->first, std::move(run->second));
+                run = pending.erase(run);
+            } else {
+                ++run;
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> send_lock(connection->send_mutex);
+        close(connection->fd);
+        connection->fd = -1;   // Late senders fail with EBADF instead of hitting a reused fd
+    }
+
+    std::string name = connection->ready ? connection->hello.agent_id : "(no HELLO)";
+    logger.warning("AgentPool: agent " + name + " dropped: " + reason +
+                   (lost.empty() ? "" : ", " + std::to_string(lost.size()) + " runs lost"));
+    for (auto& entry : lost) {
+        ExecResult result;
+        result.error = "agent " + name + " lost (" + reason + ")";
+        entry.second.done(result, name);
+    }
+}
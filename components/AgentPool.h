@@ -0,0 +1,125 @@
+#ifndef AGENT_POOL_H
+#define AGENT_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "AgentProtocol.h"
+#include "Logger.h"
+
+/**
+ * Called once per submitted run with its outcome and the agent that ran it.
+ * Runs on the pool thread: keep it short.
+ */
+using AgentCompletion = std::function<void(const ExecResult& result, const std::string& agent_id)>;
+
+/**
+ * STRUCT: Snapshot of one connected agent
+ */
+struct AgentInfo {
+    std::string agent_id;
+    std::string hostname;
+    uint32_t capacity = 0;
+    uint32_t running = 0;
+};
+
+/**
+ * AgentPool Class - Scheduler side of the nanoCronAgent protocol
+ *
+ * Listens on a Unix or TCP endpoint, accepts agents, and hands each run to
+ * the connected agent with the most free slots. One thread multiplexes
+ * every connection with poll(); submit() and cancel() may be called from
+ * any thread.
+ *
+ * Both sides send a HEARTBEAT every HEARTBEAT_MS. An agent that closes its
+ * connection or stays silent for three intervals is dropped and its
+ * in-flight runs complete with an error, so no run is ever left pending.
+ */
+class AgentPool {
+public:
+    static const int HEARTBEAT_MS = 2000;
+
+    explicit AgentPool(Logger& logger);
+    ~AgentPool();
+
+    AgentPool(const AgentPool&) = delete;
+    AgentPool& operator=(const AgentPool&) = delete;
+
+    /**
+     * Listen on an endpoint ("unix:/path" or "tcp:host:port") and start the pool thread
+     */
+    bool start(const std::string& endpoint, std::string& error);
+
+    /**
+     * Cancel in-flight runs, close every connection and stop the thread.
+     * Pending completions are invoked with an error.
+     */
+    void stop();
+
+    /**
+     * Send a run to the least loaded agent
+     *
+     * @param job_id Job ID, for agent-side logs
+     * @param request Process to start
+     * @param done Completion callback (not called if submit fails)
+     * @param error Output error when no agent has a free slot
+     * @return Run ID (> 0), or 0 if the run was not sent
+     */
+    uint64_t submit(const std::string& job_id, const ExecRequest& request, AgentCompletion done, std::string& error);
+
+    /**
+     * Ask the agent running `run_id` to kill it
+     * @return false if the run is unknown (already finished)
+     */
+    bool cancel(uint64_t run_id);
+
+    std::vector<AgentInfo> agents() const;
+    size_t inFlight() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string buffer;             // Received bytes not yet framed
+        bool ready = false;             // HELLO received
+        AgentHello hello;
+        uint32_t running = 0;           // Runs sent and not finished
+        int64_t last_seen_ms = 0;
+        std::mutex send_mutex;
+    };
+
+    struct PendingRun {
+        std::shared_ptr<Connection> connection;
+        AgentCompletion done;
+    };
+
+    void poolLoop();
+    void acceptAgent();
+    bool readFrom(const std::shared_ptr<Connection>& connection);
+    bool handleFrame(const std::shared_ptr<Connection>& connection, AgentMessageType type, const std::string& payload);
+    void dropConnection(const std::shared_ptr<Connection>& connection, const std::string& reason);
+    void complete(uint64_t run_id, const ExecResult& result);
+    void wake();
+
+    static int64_t nowMs();
+
+    Logger& logger;
+    int listen_fd = -1;
+    int wake_pipe[2] = {-1, -1};
+    std::string unix_path;              // Removed on stop()
+
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::unordered_map<uint64_t, PendingRun> pending;
+    uint64_t next_run_id = 1;
+
+    std::atomic<bool> running{false};
+    std::thread pool_thread;
+};
+
+#endif // AGENT_POOL_H
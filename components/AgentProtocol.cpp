@@ -0,0 +1,418 @@
+/**
+ * @file AgentProtocol.cpp
+ * @brief Encoding, framing and socket helpers for the agent protocol
+ */
+
+#include "AgentProtocol.h"
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Appends big-endian fields to a payload
+ */
+class Writer {
+public:
+    void u8(uint8_t value) { data.push_back(static_cast<char>(value)); }
+    void u32(uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) u8(static_cast<uint8_t>(value >> shift));
+    }
+    void u64(uint64_t value) {
+        for (int shift = 56; shift >= 0; shift -= 8) u8(static_cast<uint8_t>(value >> shift));
+    }
+    void i64(int64_t value) { u64(static_cast<uint64_t>(value)); }
+    void str(const std::string& value) {
+        u32(static_cast<uint32_t>(value.size()));
+        data.append(value);
+    }
+    void list(const std::vector<std::string>& values) {
+        u32(static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) str(value);
+    }
+
+    /**
+     * Prefix the payload with its frame header
+     */
+    std::string frame(AgentMessageType type) const {
+        Writer header;
+        header.u32(static_cast<uint32_t>(data.size()));
+        header.u8(static_cast<uint8_t>(type));
+        return header.data + data;
+    }
+
+    std::string data;
+};
+
+/**
+ * Reads big-endian fields; any overrun turns ok() false
+ */
+class Reader {
+public:
+    explicit Reader(const std::string& payload) : data(payload) {}
+
+    uint8_t u8() {
+        if (!need(1)) return 0;
+        return static_cast<uint8_t>(data[pos++]);
+    }
+    uint32_t u32() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value = (value << 8) | u8();
+        return value;
+    }
+    uint64_t u64() {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) value = (value << 8) | u8();
+        return value;
+    }
+    int64_t i64() { return static_cast<int64_t>(u64()); }
+    std::string str() {
+        uint32_t size = u32();
+        if (!need(size)) return "";
+        std::string value = data.substr(pos, size);
+        pos += size;
+        return value;
+    }
+    std::vector<std::string> list() {
+        uint32_t count = u32();
+        std::vector<std::string> values;
+        for (uint32_t i = 0; i < count && valid; ++i) values.push_back(str());
+        return values;
+    }
+
+    bool ok() const { return valid && pos == data.size(); }
+
+private:
+    bool need(size_t size) {
+        if (!valid || data.size() - pos < size) {
+            valid = false;
+            return false;
+        }
+        return true;
+    }
+
+    const std::string& data;
+    size_t pos = 0;
+    bool valid = true;
+};
+
+/**
+ * Split "tcp:host:port" into host and port
+ */
+bool splitHostPort(const std::string& spec, std::string& host, std::string& port) {
+    size_t colon = spec.rfind(':');
+    if (colon == std::string::npos) return false;
+    host = spec.substr(0, colon);
+    port = spec.substr(colon + 1);
+    if (host == "*") host.clear();
+    return !port.empty();
+}
+
+} // namespace
+
+std::string AgentProtocol::encode(const AgentHello& message) {
+    Writer w;
+    w.u32(message.version);
+    w.str(message.agent_id);
+    w.str(message.hostname);
+    w.u32(message.capacity);
+    return w.frame(AgentMessageType::HELLO);
+}
+
+std::string AgentProtocol::encode(const AgentHeartbeat& message) {
+    Writer w;
+    w.u32(message.running);
+    w.u32(message.capacity);
+    return w.frame(AgentMessageType::HEARTBEAT);
+}
+
+std::string AgentProtocol::encode(const AgentRun& message) {
+    Writer w;
+    w.u64(message.run_id);
+    w.str(message.job_id);
+    w.list(message.request.argv);
+    w.list(message.request.env);
+    w.str(message.request.cwd);
+    w.u32(static_cast<uint32_t>(message.request.timeout_seconds));
+    w.u32(static_cast<uint32_t>(message.request.cpu_limit_seconds));
+    w.u32(static_cast<uint32_t>(message.request.memory_limit_mb));
+    w.u32(static_cast<uint32_t>(message.request.max_output));
+    w.str(message.request.user);
+    w.u32(static_cast<uint32_t>(message.request.idle_timeout_seconds));
+    w.str(message.request.heartbeat_file);
+    w.u32(static_cast<uint32_t>(message.request.nice));
+    return w.frame(AgentMessageType::RUN);
+}
+
+std::string AgentProtocol::encode(const AgentStarted& message) {
+    Writer w;
+    w.u64(message.run_id);
+    w.i64(message.pid);
+    return w.frame(AgentMessageType::STARTED);
+}
+
+std::string AgentProtocol::encode(const AgentFinished& message) {
+    const ExecResult& r = message.result;
+    Writer w;
+    w.u64(message.run_id);
+    w.i64(r.exit_code);
+    w.u32(static_cast<uint32_t>(r.term_signal));
+    w.u8(static_cast<uint8_t>((r.timed_out ? 1 : 0) | (r.cancelled ? 2 : 0) | (r.hung ? 4 : 0)));
+    w.i64(r.duration_ms);
+    w.i64(r.user_ms);
+    w.i64(r.sys_ms);
+    w.i64(r.max_rss_kb);
+    w.str(r.output);
+    w.str(r.error);
+    return w.frame(AgentMessageType::FINISHED);
+}
+
+std::string AgentProtocol::encode(const AgentCancel& message) {
+    Writer w;
+    w.u64(message.run_id);
+    return w.frame(AgentMessageType::CANCEL);
+}
+
+std::string AgentProtocol::encode(const AgentRejected& message) {
+    Writer w;
+    w.u64(message.run_id);
+    w.str(message.reason);
+    return w.frame(AgentMessageType::REJECTED);
+}
+
+bool AgentProtocol::decode(const std::string& payload, AgentHello& message) {
+    Reader r(payload);
+    message.version = r.u32();
+    message.agent_id = r.str();
+    message.hostname = r.str();
+    message.capacity = r.u32();
+    return r.ok();
+}
+
+bool AgentProtocol::decode(const std::string& payload, AgentHeartbeat& message) {
+    Reader r(payload);
+    message.running = r.u32();
+    message.capacity = r.u32();
+    return r.ok();
+}
+
+bool AgentProtocol::decode(const std::string& payload, AgentRun& message) {
+    Reader r(payload);
+    message.run_id = r.u64();
+    message.job_id = r.str();
+    message.request.argv = r.list();
+    message.request.env = r.list();
+    message.request.cwd = r.str();
+    message.request.timeout_seconds = static_cast<int>(r.u32());
+    message.request.cpu_limit_seconds = static_cast<int>(r.u32());
+    message.request.memory_limit_mb = static_cast<int>(r.u32());
+    message.request.max_output = r.u32();
+    message.request.user = r.str();
+    message.request.idle_timeout_seconds = static_cast<int>(r.u32());
+    message.request.heartbeat_file = r.str();
+    message.request.nice = static_cast<int>(r.u32());
+    return r.ok();
+}
+
+bool AgentProtocol::decode(const std::string& payload, AgentStarted& message) {
+    Reader r(payload);
+    message.run_id = r.u64();
+    message.pid = r.i64();
+    return r.ok();
+}
+
+bool AgentProtocol::decode(const std::string& payload, AgentFinished& message) {
+    ExecResult& result = message.result;
+    Reader r(payload);
+    message.run_id = r.u64();
+    result.exit_code = static_cast<int>(r.i64());
+    result.term_signal = static_cast<int>(r.u32());
+    uint8_t flags = r.u8();
+    result.timed_out = flags & 1;
+    result.cancelled = flags & 2;
+    result.hung = flags & 4;
+    result.duration_ms = r.i64();
+    result.user_ms = r.i64();
+    result.sys_ms = r.i64();
+    result.max_rss_kb = r.i64();
+    result.output = r.str();
+    result.error = r.str();
+    return r.ok();
+}
+
+bool AgentProtocol::decode(const std::string& payload, AgentCancel& message) {
+    Reader r(payload);
+    message.run_id = r.u64();
+    return r.ok();
+}
+
+bool AgentProtocol::decode(const std::string& payload, AgentRejected& message) {
+    Reader r(payload);
+    message.run_id = r.u64();
+    message.reason = r.str();
+    return r.ok();
+}
+
+bool AgentProtocol::nextFrame(std::string& buffer, AgentMessageType& type, std::string& payload, std::string& error) {
+    if (buffer.size() < 5) {
+        return false;
+    }
+    uint32_t length = 0;
+    for (int i = 0; i < 4; ++i) {
+        length = (length << 8) | static_cast<uint8_t>(buffer[i]);
+    }
+    if (length > MAX_FRAME) {
+        error = "frame of " + std::to_string(length) + " bytes exceeds limit";
+        return false;
+    }
+    if (buffer.size() < 5 + static_cast<size_t>(length)) {
+        return false;
+    }
+    type = static_cast<AgentMessageType>(static_cast<uint8_t>(buffer[4]));
+    payload.assign(buffer, 5, length);
+    buffer.erase(0, 5 + static_cast<size_t>(length));
+    return true;
+}
+
+bool AgentProtocol::sendFrame(int fd, const std::string& frame) {
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t n = send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+int AgentProtocol::listenEndpoint(const std::string& endpoint, std::string& error) {
+    if (endpoint.compare(0, 5, "unix:") == 0) {
+        std::string path = endpoint.substr(5);
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            error = "invalid unix socket path: " + path;
+            return -1;
+        }
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            error = std::string("socket failed: ") + std::strerror(errno);
+            return -1;
+        }
+        unlink(path.c_str());   // Stale socket from a previous run
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+            error = "cannot listen on " + path + ": " + std::strerror(errno);
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    if (endpoint.compare(0, 4, "tcp:") == 0) {
+        std::string host, port;
+        if (!splitHostPort(endpoint.substr(4), host, port)) {
+            error = "invalid tcp endpoint: " + endpoint;
+            return -1;
+        }
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        struct addrinfo* list = nullptr;
+        int rc = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &list);
+        if (rc != 0) {
+            error = "cannot resolve " + endpoint + ": " + gai_strerror(rc);
+            return -1;
+        }
+        int fd = -1;
+        for (struct addrinfo* ai = list; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 64) == 0) break;
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(list);
+        if (fd < 0) {
+            error = "cannot listen on " + endpoint + ": " + std::strerror(errno);
+        }
+        return fd;
+    }
+
+    error = "unknown endpoint (expected unix:/path or tcp:host:port): " + endpoint;
+    return -1;
+}
+
+int AgentProtocol::connectEndpoint(const std::string& endpoint, std::string& error) {
+    if (endpoint.compare(0, 5, "unix:") == 0) {
+        std::string path = endpoint.substr(5);
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            error = "invalid unix socket path: " + path;
+            return -1;
+        }
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            error = "cannot connect to " + path + ": " + std::strerror(errno);
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    if (endpoint.compare(0, 4, "tcp:") == 0) {
+        std::string host, port;
+        if (!splitHostPort(endpoint.substr(4), host, port) || host.empty()) {
+            error = "invalid tcp endpoint: " + endpoint;
+            return -1;
+        }
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* list = nullptr;
+        int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &list);
+        if (rc != 0) {
+            error = "cannot resolve " + endpoint + ": " + gai_strerror(rc);
+            return -1;
+        }
+        int fd = -1;
+        for (struct addrinfo* ai = list; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                break;
+            }
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(list);
+        if (fd < 0) {
+            error = "cannot connect to " + endpoint + ": " + std::strerror(errno);
+        }
+        return fd;
+    }
+
+    error = "unknown endpoint (expected unix:/path or tcp:host:port): " + endpoint;
+    return -1;
+}
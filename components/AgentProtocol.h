@@ -0,0 +1,124 @@
+#ifndef AGENT_PROTOCOL_H
+#define AGENT_PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include "ProcessRunner.h"
+
+/**
+ * Protocol version announced in HELLO; peers with another version are refused
+ */
+#define NANOCRON_AGENT_PROTOCOL_VERSION 4u   // 2: RUN carries the user to run as, 3: idle timeout and hung flag, 4: nice
+
+/**
+ * ENUM: Frame types exchanged between the scheduler and nanoCronAgent
+ */
+enum class AgentMessageType : uint8_t {
+    HELLO = 1,       // agent -> scheduler: identity and capacity (first frame)
+    HEARTBEAT = 2,   // both directions: liveness, agent load
+    RUN = 3,         // scheduler -> agent: start a process
+    STARTED = 4,     // agent -> scheduler: process forked
+    FINISHED = 5,    // agent -> scheduler: exit status and rusage
+    CANCEL = 6,      // scheduler -> agent: kill a running process
+    REJECTED = 7     // agent -> scheduler: run refused (at capacity, bad request)
+};
+
+struct AgentHello {
+    uint32_t version = NANOCRON_AGENT_PROTOCOL_VERSION;
+    std::string agent_id;
+    std::string hostname;
+    uint32_t capacity = 1;     // Maximum concurrent runs
+};
+
+struct AgentHeartbeat {
+    uint32_t running = 0;      // Runs in progress on the sender
+    uint32_t capacity = 0;
+};
+
+struct AgentRun {
+    uint64_t run_id = 0;       // Scheduler-assigned, unique per connection
+    std::string job_id;
+    ExecRequest request;
+};
+
+struct AgentStarted {
+    uint64_t run_id = 0;
+    int64_t pid = 0;
+};
+
+struct AgentFinished {
+    uint64_t run_id = 0;
+    ExecResult result;
+};
+
+struct AgentCancel {
+    uint64_t run_id = 0;
+};
+
+struct AgentRejected {
+    uint64_t run_id = 0;
+    std::string reason;
+};
+
+/**
+ * AgentProtocol Class - Framed binary protocol for remote job execution
+ *
+ * Frame layout (integers big-endian):
+ *
+ *   u32 payload length | u8 type | payload
+ *
+ * Payload fields are fixed-width integers and length-prefixed byte
+ * strings (u32 length + bytes), in the order of the struct members.
+ * Frames above MAX_FRAME bytes are a protocol error. The same framing
+ * works over Unix and TCP stream sockets.
+ */
+class AgentProtocol {
+public:
+    static const uint32_t MAX_FRAME = 1024 * 1024;
+
+    static std::string encode(const AgentHello& message);
+    static std::string encode(const AgentHeartbeat& message);
+    static std::string encode(const AgentRun& message);
+    static std::string encode(const AgentStarted& message);
+    static std::string encode(const AgentFinished& message);
+    static std::string encode(const AgentCancel& message);
+    static std::string encode(const AgentRejected& message);
+
+    static bool decode(const std::string& payload, AgentHello& message);
+    static bool decode(const std::string& payload, AgentHeartbeat& message);
+    static bool decode(const std::string& payload, AgentRun& message);
+    static bool decode(const std::string& payload, AgentStarted& message);
+    static bool decode(const std::string& payload, AgentFinished& message);
+    static bool decode(const std::string& payload, AgentCancel& message);
+    static bool decode(const std::string& payload, AgentRejected& message);
+
+    /**
+     * Extract the next complete frame from a receive buffer
+     *
+     * @param buffer Bytes received so far (consumed frames are erased)
+     * @param type Output frame type
+     * @param payload Output frame payload
+     * @param error Output error for oversized frames
+     * @return true if a frame was extracted
+     */
+    static bool nextFrame(std::string& buffer, AgentMessageType& type, std::string& payload, std::string& error);
+
+    /**
+     * Write a whole frame to a blocking socket
+     */
+    static bool sendFrame(int fd, const std::string& frame);
+
+    /**
+     * Listen on "unix:/path" or "tcp:host:port" (host may be empty or "*")
+     * @return Listening socket or -1 (error filled)
+     */
+    static int listenEndpoint(const std::string& endpoint, std::string& error);
+
+    /**
+     * Connect to "unix:/path" or "tcp:host:port"
+     * @return Connected socket or -1 (error filled)
+     */
+    static int connectEndpoint(const std::string& endpoint, std::string& error);
+};
+
+#endif // AGENT_PROTOCOL_H
@@ -0,0 +1,193 @@
+/**
+ * @file AllocTracker.cpp
+ * @brief Per-subsystem allocation accounting via replaceable operator new/delete
+ *
+ * Only active when compiled with -DNANOCRON_ALLOC_TRACKING. Each block gets a
+ * small header in front of the user pointer recording its size, alignment
+ * offset and subsystem tag, so deallocation can credit the right counters
+ * without any lookup table. All counters are lock-free atomics and the
+ * per-thread tag is a trivially initialised thread_local, which keeps the
+ * replacement safe to call before static initialisation has finished.
+ */
+
+#include "AllocTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+namespace {
+
+struct TagCounters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> freed_bytes{0};
+};
+
+constexpr size_t TAG_COUNT = static_cast<size_t>(AllocTag::COUNT);
+
+TagCounters g_counters[TAG_COUNT];
+thread_local AllocTag t_currentTag = AllocTag::OTHER;
+
+} // namespace
+
+bool AllocTracker::enabled() {
+#ifdef NANOCRON_ALLOC_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocCounters AllocTracker::counters(AllocTag tag) {
+    AllocCounters out;
+    size_t idx = static_cast<size_t>(tag);
+    if (idx >= TAG_COUNT) return out;
+
+    const TagCounters& c = g_counters[idx];
+    out.allocations = c.allocations.load(std::memory_order_relaxed);
+    out.frees = c.frees.load(std::memory_order_relaxed);
+    out.bytes = c.bytes.load(std::memory_order_relaxed);
+    out.live_bytes = static_cast<int64_t>(out.bytes) -
+                     static_cast<int64_t>(c.freed_bytes.load(std::memory_order_relaxed));
+    out.live_blocks = static_cast<int64_t>(out.allocations) - static_cast<int64_t>(out.frees);
+    return out;
+}
+
+AllocCounters AllocTracker::total() {
+    AllocCounters sum;
+    for (size_t i = 0; i < TAG_COUNT; ++i) {
+        AllocCounters c = counters(static_cast<AllocTag>(i));
+        sum.allocations += c.allocations;
+        sum.frees += c.frees;
+        sum.bytes += c.bytes;
+        sum.live_bytes += c.live_bytes;
+        sum.live_blocks += c.live_blocks;
+    }
+    return sum;
+}
+
+const char* AllocTracker::tagName(AllocTag tag) {
+    switch (tag) {
+        case AllocTag::OTHER:     return "other";
+        case AllocTag::CONFIG:    return "config";
+        case AllocTag::SCHEDULER: return "scheduler";
+        case AllocTag::LOGGER:    return "logger";
+        case AllocTag::EXECUTOR:  return "executor";
+        default:                  return "unknown";
+    }
+}
+
+std::string AllocTracker::report() {
+    if (!enabled()) {
+        return "Allocation tracking disabled (build with -DNANOCRON_ALLOC_TRACKING)";
+    }
+    std::ostringstream ss;
+    ss << "Heap by subsystem:";
+    for (size_t i = 0; i < TAG_COUNT; ++i) {
+        AllocCounters c = counters(static_cast<AllocTag>(i));
+        ss << " " << tagName(static_cast<AllocTag>(i)) << "=" << c.live_bytes << "B/"
+           << c.live_blocks << "blk (" << c.allocations << " allocs)";
+    }
+    return ss.str();
+}
+
+AllocTag AllocTracker::currentTag() {
+    return t_currentTag;
+}
+
+AllocTag AllocTracker::exchangeTag(AllocTag tag) {
+    AllocTag previous = t_currentTag;
+    t_currentTag = tag;
+    return previous;
+}
+
+#ifdef NANOCRON_ALLOC_TRACKING
+
+namespace {
+
+/**
+ * Block header stored immediately before the pointer handed to the caller.
+ * It is 16 bytes so plain allocations keep the default new alignment.
+ */
+struct alignas(16) BlockHeader {
+    uint64_t size;      // User-requested size
+    uint32_t offset;    // Distance from the malloc'd base to the user pointer
+    uint8_t tag;        // AllocTag charged for this block
+};
+
+static_assert(sizeof(BlockHeader) == 16, "BlockHeader must keep 16-byte alignment");
+
+void* trackedAlloc(size_t size, size_t alignment) {
+    if (alignment < alignof(BlockHeader)) alignment = alignof(BlockHeader);
+    // Room for the header, rounded up so the user pointer stays aligned
+    size_t offset = ((sizeof(BlockHeader) + alignment - 1) / alignment) * alignment;
+
+    void* base = nullptr;
+    if (alignment <= alignof(std::max_align_t) && alignment <= 16) {
+        base = std::malloc(size + offset);
+    } else if (posix_memalign(&base, alignment, size + offset) != 0) {
+        base = nullptr;
+    }
+    if (!base) return nullptr;
+
+    char* user = static_cast<char*>(base) + offset;
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(user) - 1;
+    header->size = size;
+    header->offset = static_cast<uint32_t>(offset);
+    header->tag = static_cast<uint8_t>(t_currentTag);
+
+    TagCounters& c = g_counters[header->tag];
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(size, std::memory_order_relaxed);
+    return user;
+}
+
+void trackedFree(void* ptr) noexcept {
+    if (!ptr) return;
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    size_t idx = header->tag < TAG_COUNT ? header->tag : 0;
+
+    TagCounters& c = g_counters[idx];
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+    c.freed_bytes.fetch_add(header->size, std::memory_order_relaxed);
+    std::free(static_cast<char*>(ptr) - header->offset);
+}
+
+void* allocOrThrow(size_t size, size_t alignment) {
+    if (size == 0) size = 1;
+    while (true) {
+        void* p = trackedAlloc(size, alignment);
+        if (p) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+} // namespace
+
+void* operator new(size_t size) { return allocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size) { return allocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return allocOrThrow(size, alignof(std::max_align_t)); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return allocOrThrow(size, alignof(std::max_align_t)); } catch (...) { return nullptr; }
+}
+void* operator new(size_t size, std::align_val_t al) { return allocOrThrow(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return allocOrThrow(size, static_cast<size_t>(al)); }
+
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+
+#endif // NANOCRON_ALLOC_TRACKING
@@ -0,0 +1,105 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * ENUM: Subsystems that heap allocations are attributed to
+ */
+enum class AllocTag : uint8_t {
+    OTHER,       // Anything outside a tagged scope
+    CONFIG,      // Config parsing and published job snapshots
+    SCHEDULER,   // Scheduling state and per-tick work
+    LOGGER,      // Log formatting and stream buffers
+    EXECUTOR,    // Job execution records
+    COUNT
+};
+
+/**
+ * STRUCT: Allocation counters of one subsystem
+ */
+struct AllocCounters {
+    uint64_t allocations = 0;   // Total number of allocations
+    uint64_t frees = 0;         // Total number of deallocations
+    uint64_t bytes = 0;         // Total bytes ever allocated
+    int64_t live_bytes = 0;     // Bytes currently allocated
+    int64_t live_blocks = 0;    // Blocks currently allocated
+};
+
+/**
+ * AllocTracker Class - Per-subsystem heap accounting
+ *
+ * When the daemon (or a benchmark) is built with -DNANOCRON_ALLOC_TRACKING,
+ * AllocTracker.cpp replaces the global operator new/delete and attributes
+ * every block to the tag of the innermost AllocScope active on the calling
+ * thread. Frees are charged to the tag recorded at allocation time, so live
+ * byte counts stay exact even when memory crosses subsystem boundaries.
+ *
+ * Without the flag AllocScope compiles to nothing and all counters read zero.
+ */
+class AllocTracker {
+public:
+    /**
+     * @return true if the binary was built with allocation tracking
+     */
+    static bool enabled();
+
+    /**
+     * Counters of one subsystem
+     */
+    static AllocCounters counters(AllocTag tag);
+
+    /**
+     * Sum of the counters of all subsystems
+     */
+    static AllocCounters total();
+
+    /**
+     * Human readable tag name ("config", "scheduler", ...)
+     */
+    static const char* tagName(AllocTag tag);
+
+    /**
+     * One-line summary of live bytes and allocation counts per subsystem
+     */
+    static std::string report();
+
+    /**
+     * Tag used for allocations made by the calling thread
+     */
+    static AllocTag currentTag();
+
+    /**
+     * Set the calling thread's tag
+     * @return Previous tag
+     */
+    static AllocTag exchangeTag(AllocTag tag);
+};
+
+/**
+ * AllocScope - RAII guard attributing allocations to a subsystem
+ *
+ * Scopes nest: the innermost one wins and the previous tag is restored on
+ * destruction.
+ */
+class AllocScope {
+public:
+#ifdef NANOCRON_ALLOC_TRACKING
+    explicit AllocScope(AllocTag tag) : previous(AllocTracker::exchangeTag(tag)) {}
+    ~AllocScope() { AllocTracker::exchangeTag(previous); }
+#else
+    explicit AllocScope(AllocTag) {}
+#endif
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+private:
+#ifdef NANOCRON_ALLOC_TRACKING
+    AllocTag previous;
+#endif
+};
+
+#endif // ALLOC_TRACKER_H
@@ -0,0 +1,344 @@
+/**
+ * @file BundleRunner.cpp
+ * @brief Bundled command execution in long-lived worker shells
+ */
+
+#include "BundleRunner.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+int64_t monotonicMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Worker shell and the command it is running
+ */
+struct Worker {
+    pid_t pid = -1;
+    int input_fd = -1;          // Write end of the shell's stdin
+    int output_fd = -1;         // Read end of its stdout/stderr (-1 once closed)
+    std::string token;          // Sentinel prefix of this shell
+    long job = -1;              // Index of the running command (-1 = idle)
+    int64_t started_ms = 0;
+    int64_t deadline_ms = 0;
+    int64_t kill_at_ms = -1;    // SIGKILL time once SIGTERM was sent (-1 = not sent)
+    bool timed_out = false;
+    bool cancelled = false;
+    std::string pending;        // Output not attributed yet (may end in a partial sentinel)
+};
+
+std::string randomToken() {
+    std::random_device device;
+    uint64_t value = (static_cast<uint64_t>(device()) << 32) | device();
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(value));
+    return std::string("nanocron-bundle-") + hex;
+}
+
+std::string shellQuote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+void appendTail(std::string& output, const char* data, size_t size) {
+    output.append(data, size);
+    if (output.size() > BundleRunner::MAX_OUTPUT) {
+        output.erase(0, output.size() - BundleRunner::MAX_OUTPUT);
+    }
+}
+
+/**
+ * Write a whole buffer to a pipe whose reader may be gone: SIGPIPE is
+ * blocked meanwhile and a pending one consumed, so only EPIPE reports it
+ */
+bool writeAll(int fd, const std::string& data) {
+    sigset_t pipe_set;
+    sigset_t previous;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &previous);
+
+    bool ok = true;
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    if (!ok && errno == EPIPE) {
+        struct timespec zero = {0, 0};
+        while (sigtimedwait(&pipe_set, nullptr, &zero) < 0 && errno == EINTR) {}
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    return ok;
+}
+
+/**
+ * Start a worker shell reading commands from a pipe, in its own process group
+ */
+bool spawn(Worker& worker, std::string& error) {
+    int input_pipe[2];
+    int output_pipe[2];
+    if (pipe2(input_pipe, O_CLOEXEC) != 0) {
+        error = std::string("pipe failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (pipe2(output_pipe, O_CLOEXEC) != 0) {
+        error = std::string("pipe failed: ") + std::strerror(errno);
+        close(input_pipe[0]);
+        close(input_pipe[1]);
+        return false;
+    }
+
+    static char shell[] = "/bin/sh";
+    static char read_stdin[] = "-s";
+    char* argv[] = {shell, read_stdin, nullptr};
+    pid_t pid = fork();
+    if (pid < 0) {
+        error = std::string("fork failed: ") + std::strerror(errno);
+        close(input_pipe[0]); close(input_pipe[1]);
+        close(output_pipe[0]); close(output_pipe[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // Same child setup as ProcessRunner, stdin being the command pipe
+        setpgid(0, 0);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+        dup2(input_pipe[0], STDIN_FILENO);
+        dup2(output_pipe[1], STDOUT_FILENO);
+        dup2(output_pipe[1], STDERR_FILENO);
+        execv(shell, argv);
+        _exit(127);
+    }
+
+    setpgid(pid, pid);
+    close(input_pipe[0]);
+    close(output_pipe[1]);
+    worker.pid = pid;
+    worker.input_fd = input_pipe[1];
+    worker.output_fd = output_pipe[0];
+    worker.token = randomToken();
+    worker.pending.clear();
+    return true;
+}
+
+/**
+ * Move finished output to the running command; on a complete sentinel
+ * line fill in its exit code and mark the worker idle
+ * @return Index of the finished command, or -1
+ */
+long consumeOutput(Worker& worker, std::vector<ExecResult>& results) {
+    if (worker.job < 0) {
+        worker.pending.clear();   // Written by background children between commands
+        return -1;
+    }
+    ExecResult& result = results[worker.job];
+    std::string marker = "\n" + worker.token + " ";
+    size_t at = worker.pending.find(marker);
+    size_t eol = at == std::string::npos ? std::string::npos : worker.pending.find('\n', at + marker.size());
+    if (eol == std::string::npos) {
+        // Keep only what may still turn out to be the start of the sentinel
+        size_t keep = std::min(worker.pending.size(), marker.size() + 4);
+        size_t flush = at == std::string::npos ? worker.pending.size() - keep : at;
+        appendTail(result.output, worker.pending.data(), flush);
+        worker.pending.erase(0, flush);
+        return -1;
+    }
+    appendTail(result.output, worker.pending.data(), at);
+    result.exit_code = std::atoi(worker.pending.c_str() + at + marker.size());
+    result.duration_ms = monotonicMs() - worker.started_ms;
+    worker.pending.erase(0, eol + 1);
+    long finished = worker.job;
+    worker.job = -1;
+    return finished;
+}
+
+/**
+ * Read what the shell wrote without blocking
+ * @return false once the output pipe is closed
+ */
+bool readOutput(Worker& worker) {
+    char buffer[4096];
+    while (true) {
+        ssize_t n = read(worker.output_fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            worker.pending.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return true;
+        close(worker.output_fd);
+        worker.output_fd = -1;
+        return false;
+    }
+}
+
+/**
+ * The worker shell exited: its running command (if any) ends with the
+ * shell's status, and the worker slot is free for a new shell
+ * @return Index of the command that finished with it, or -1
+ */
+long reap(Worker& worker, int status, std::vector<ExecResult>& results) {
+    if (worker.output_fd >= 0) {
+        readOutput(worker);
+        if (worker.output_fd >= 0) {
+            close(worker.output_fd);   // Background children may keep it open
+            worker.output_fd = -1;
+        }
+    }
+    long finished = consumeOutput(worker, results);
+    if (worker.job >= 0) {
+        ExecResult& result = results[worker.job];
+        appendTail(result.output, worker.pending.data(), worker.pending.size());
+        result.timed_out = worker.timed_out;
+        result.cancelled = worker.cancelled;
+        result.duration_ms = monotonicMs() - worker.started_ms;
+        if (WIFEXITED(status)) {
+            result.exit_code = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            result.term_signal = WTERMSIG(status);
+        }
+        finished = worker.job;
+    }
+    close(worker.input_fd);
+    worker = Worker();
+    return finished;
+}
+
+} // namespace
+
+size_t BundleRunner::run(const std::vector<BundledCommand>& commands, std::vector<ExecResult>& results,
+                         size_t workers, const std::function<void(size_t)>& on_finish) {
+    results.assign(commands.size(), ExecResult());
+    std::vector<Worker> pool(std::max<size_t>(1, std::min({workers, commands.size(), MAX_WORKERS})));
+    std::error_code ec;
+    std::string cwd = std::filesystem::current_path(ec).string();
+    size_t next = 0;
+    size_t finished = 0;
+    size_t spawned = 0;
+    auto finish = [&](long index) {
+        if (index < 0) return;
+        ++finished;
+        if (on_finish) on_finish(static_cast<size_t>(index));
+    };
+
+    while (finished < commands.size()) {
+        bool stop = ProcessRunner::cancelRequested();
+        if (stop) {
+            for (; next < commands.size(); ++next) {
+                results[next].cancelled = true;
+                finish(static_cast<long>(next));
+            }
+        }
+
+        // Hand the next commands to idle shells, starting shells as needed
+        for (Worker& worker : pool) {
+            if (next >= commands.size()) break;
+            if (worker.job >= 0) continue;
+            if (worker.pid < 0) {
+                if (!spawn(worker, results[next].error)) {
+                    finish(static_cast<long>(next++));
+                    continue;
+                }
+                fcntl(worker.output_fd, F_SETFL, O_NONBLOCK);
+                ++spawned;
+            }
+            const BundledCommand& command = commands[next];
+            worker.job = static_cast<long>(next++);
+            worker.pending.clear();
+            worker.started_ms = monotonicMs();
+            worker.deadline_ms = worker.started_ms + static_cast<int64_t>(command.timeout_seconds) * 1000;
+            // A shell that is gone fails the write; its status ends the command when reaped
+            writeAll(worker.input_fd, "cd " + shellQuote(cwd) + "; { " + command.command +
+                                      "\n} </dev/null; printf '\\n" + worker.token + " %d\\n' \"$?\"\n");
+        }
+
+        struct pollfd fds[MAX_WORKERS];
+        size_t polled[MAX_WORKERS];
+        nfds_t count = 0;
+        for (size_t i = 0; i < pool.size(); ++i) {
+            if (pool[i].output_fd >= 0) {
+                polled[count] = i;
+                fds[count++] = {pool[i].output_fd, POLLIN, 0};
+            }
+        }
+        if (poll(count ? fds : nullptr, count, count ? 100 : 10) > 0) {
+            for (nfds_t f = 0; f < count; ++f) {
+                if (fds[f].revents) {
+                    Worker& worker = pool[polled[f]];
+                    readOutput(worker);
+                    finish(consumeOutput(worker, results));
+                }
+            }
+        }
+
+        int64_t now = monotonicMs();
+        for (Worker& worker : pool) {
+            if (worker.pid < 0) continue;
+            int status = 0;
+            pid_t done = waitpid(worker.pid, &status, WNOHANG);
+            if (done == worker.pid || (done < 0 && errno == ECHILD)) {
+                finish(reap(worker, status, results));
+                continue;
+            }
+            if (worker.job < 0) continue;
+            if (worker.kill_at_ms < 0) {
+                bool expired = now >= worker.deadline_ms;
+                if (expired || stop) {
+                    worker.timed_out = expired;
+                    worker.cancelled = !expired;
+                    kill(-worker.pid, SIGTERM);
+                    worker.kill_at_ms = now + ProcessRunner::KILL_GRACE_MS;
+                }
+            } else if (now >= worker.kill_at_ms) {
+                kill(-worker.pid, SIGKILL);
+                worker.kill_at_ms = INT64_MAX;
+            }
+        }
+    }
+
+    // Idle shells exit at the end of their input
+    for (Worker& worker : pool) {
+        if (worker.pid < 0) continue;
+        close(worker.input_fd);
+        while (waitpid(worker.pid, nullptr, 0) < 0 && errno == EINTR) {}
+        if (worker.output_fd >= 0) {
+            close(worker.output_fd);
+        }
+    }
+    return spawned;
+}
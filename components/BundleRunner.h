@@ -0,0 +1,62 @@
+#ifndef BUNDLE_RUNNER_H
+#define BUNDLE_RUNNER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "ProcessRunner.h"
+
+/**
+ * STRUCT: One shell command run inside a bundle worker
+ */
+struct BundledCommand {
+    std::string command;        // Shell command line
+    int timeout_seconds = 300;  // Wall-clock limit; the worker is killed and replaced after it
+};
+
+/**
+ * BundleRunner Class - Many short shell commands in a few long-lived shells
+ *
+ * Instead of one fork/exec of /bin/sh per command, up to `workers`
+ * shells are started in their own process group, with stdin on a pipe
+ * the commands are written to, one at a time per shell:
+ *
+ *   cd '<daemon cwd>'; { <command>
+ *   } </dev/null; printf '\n<token> %d\n' "$?"
+ *
+ * Everything a shell writes until the sentinel line is the output of its
+ * current command, and the sentinel carries its exit code. The token is
+ * random per shell, so command output cannot end a run by accident.
+ *
+ * Commands share their shell: variables and functions they define stay
+ * visible to later commands (the working directory is reset). A command
+ * that ends its shell (`exit`, a syntax error, a signal) gets the shell's
+ * exit status and the remaining commands continue in a new one. On
+ * timeout or daemon shutdown the shell's process group is terminated
+ * like a job of ProcessRunner.
+ */
+class BundleRunner {
+public:
+    /**
+     * Run commands in order over at most `workers` shells
+     *
+     * @param commands Commands to run
+     * @param results One outcome per command (duration, exit code, output
+     *                tail, timeout/cancel flags; no resource usage)
+     * @param workers Shells running commands in parallel (at least 1)
+     * @param on_finish Optional callback invoked with the index of each
+     *                  command as soon as its result is final
+     * @return Number of shell processes started
+     */
+    static size_t run(const std::vector<BundledCommand>& commands, std::vector<ExecResult>& results,
+                      size_t workers = 1, const std::function<void(size_t)>& on_finish = nullptr);
+
+    /** Output tail kept per command, as ExecRequest::max_output */
+    static constexpr size_t MAX_OUTPUT = 4096;
+
+    /** Upper bound of the shells of one run */
+    static constexpr size_t MAX_WORKERS = 64;
+};
+
+#endif // BUNDLE_RUNNER_H
@@ -0,0 +1,158 @@
+/**
+ * @file ClusterMembership.cpp
+ * @brief Coordinator-free membership through heartbeat files
+ */
+
+#include "ClusterMembership.h"
+#include "LeaderLease.h"
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace {
+
+const std::string MEMBER_SUFFIX = ".member";
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() > suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+ClusterMembership::ClusterMembership(const std::string& dir, const std::string& node_id, int ttl_seconds, Logger& loggerRef)
+    : directory(dir), node(node_id), ttlMs(static_cast<int64_t>(ttl_seconds > 0 ? ttl_seconds : 1) * 1000),
+      logger(loggerRef) {}
+
+ClusterMembership::~ClusterMembership() {
+    stop();
+}
+
+bool ClusterMembership::start() {
+    if (!writeHeartbeat()) {
+        logger.error("ClusterMembership: cannot write heartbeat in " + directory);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        stopping = false;
+    }
+    scan();
+    loopThread = std::thread(&ClusterMembership::heartbeatLoop, this);
+    return true;
+}
+
+void ClusterMembership::stop() {
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        if (stopping && !loopThread.joinable()) {
+            return;
+        }
+        stopping = true;
+    }
+    loopCv.notify_all();
+    if (loopThread.joinable()) {
+        loopThread.join();
+        std::remove((directory + "/" + node + MEMBER_SUFFIX).c_str());
+        logger.info("ClusterMembership: " + node + " left the cluster");
+    }
+}
+
+std::vector<std::string> ClusterMembership::members() const {
+    std::lock_guard<std::mutex> lock(membersMutex);
+    return liveMembers;
+}
+
+/**
+ * Atomically replace our heartbeat file with a fresh expiry
+ */
+bool ClusterMembership::writeHeartbeat() {
+    std::string path = directory + "/" + node + MEMBER_SUFFIX;
+    std::string tmpPath = directory + "/." + node + MEMBER_SUFFIX + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << "expires_ms=" << (LeaderLease::nowMs() + ttlMs) << "\n";
+        if (!out.good()) {
+            return false;
+        }
+    }
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * Rebuild the live member list from the heartbeat files
+ */
+void ClusterMembership::scan() {
+    std::vector<std::string> alive;
+    int64_t now = LeaderLease::nowMs();
+
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        logger.error("ClusterMembership: cannot read " + directory);
+        return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name[0] == '.' || !endsWith(name, MEMBER_SUFFIX)) {
+            continue;
+        }
+        std::ifstream in(directory + "/" + name);
+        std::string line;
+        int64_t expires = 0;
+        if (std::getline(in, line) && line.compare(0, 11, "expires_ms=") == 0) {
+            try {
+                expires = std::stoll(line.substr(11));
+            } catch (const std::exception&) {
+                expires = 0;
+            }
+        }
+        if (expires > now) {
+            alive.push_back(name.substr(0, name.size() - MEMBER_SUFFIX.size()));
+        }
+    }
+    closedir(dir);
+
+    // Our own heartbeat may be late (slow storage): never drop ourselves
+    if (std::find(alive.begin(), alive.end(), node) == alive.end()) {
+        alive.push_back(node);
+    }
+    std::sort(alive.begin(), alive.end());
+
+    std::lock_guard<std::mutex> lock(membersMutex);
+    if (alive != liveMembers) {
+        for (const auto& member : alive) {
+            if (!std::binary_search(liveMembers.begin(), liveMembers.end(), member)) {
+                logger.info("ClusterMembership: member joined: " + member);
+            }
+        }
+        for (const auto& member : liveMembers) {
+            if (!std::binary_search(alive.begin(), alive.end(), member)) {
+                logger.info("ClusterMembership: member left: " + member);
+            }
+        }
+        liveMembers.swap(alive);
+        memberGeneration.fetch_add(1);
+    }
+}
+
+void ClusterMembership::heartbeatLoop() {
+    std::unique_lock<std::mutex> lock(loopMutex);
+    while (!stopping) {
+        loopCv.wait_for(lock, std::chrono::milliseconds(ttlMs / 3));
+        if (stopping) {
+            break;
+        }
+        lock.unlock();
+        if (!writeHeartbeat()) {
+            logger.error("ClusterMembership: heartbeat write failed in " + directory);
+        }
+        scan();
+        lock.lock();
+    }
+}
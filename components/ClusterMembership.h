@@ -0,0 +1,84 @@
+#ifndef CLUSTER_MEMBERSHIP_H
+#define CLUSTER_MEMBERSHIP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Logger.h"
+
+/**
+ * ClusterMembership Class - Heartbeat-file membership for cluster mode
+ *
+ * Every node owns the file <dir>/<node_id>.member and rewrites it (temp
+ * file + rename) every ttl/3 with its heartbeat expiry. The same thread
+ * scans the directory and considers alive every member whose expiry is
+ * still in the future. There is no coordinator: nodes agree on the member
+ * list because they read the same directory, and converge within one scan
+ * period after a change.
+ *
+ * The directory can live on a shared filesystem (multi-host) or on a local
+ * path (several daemons on one machine, tests).
+ */
+class ClusterMembership {
+public:
+    /**
+     * @param dir Membership directory shared by all nodes
+     * @param node_id Unique name of this node (used as file name)
+     * @param ttl_seconds Heartbeat lifetime; a crashed node leaves after this
+     * @param logger Logger for join/leave events
+     */
+    ClusterMembership(const std::string& dir, const std::string& node_id, int ttl_seconds, Logger& logger);
+    ~ClusterMembership();
+
+    ClusterMembership(const ClusterMembership&) = delete;
+    ClusterMembership& operator=(const ClusterMembership&) = delete;
+
+    /**
+     * Write the first heartbeat, scan once and start the heartbeat thread
+     * @return false if the directory is not writable
+     */
+    bool start();
+
+    /**
+     * Stop the thread and remove our heartbeat file, so the other nodes
+     * take over our shard at their next scan
+     */
+    void stop();
+
+    /**
+     * Sorted list of live members (always includes this node once started)
+     */
+    std::vector<std::string> members() const;
+
+    /**
+     * Incremented every time the live member list changes
+     */
+    uint64_t generation() const { return memberGeneration.load(); }
+
+    const std::string& nodeId() const { return node; }
+
+private:
+    bool writeHeartbeat();
+    void scan();
+    void heartbeatLoop();
+
+    std::string directory;
+    std::string node;
+    int64_t ttlMs;
+    Logger& logger;
+
+    mutable std::mutex membersMutex;
+    std::vector<std::string> liveMembers;
+    std::atomic<uint64_t> memberGeneration{0};
+
+    std::mutex loopMutex;
+    std::condition_variable loopCv;
+    bool stopping = false;
+    std::thread loopThread;
+};
+
+#endif // CLUSTER_MEMBERSHIP_H
@@ -0,0 +1,219 @@
+/**
+ * @file ConfigPersister.cpp
+ * @brief Coalesced, atomic write-back of live job mutations
+ */
+
+#include "ConfigPersister.h"
+#include "AllocTracker.h"
+#include "JobConfig.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+
+const int RETRY_MS = 5000;
+
+bool readFile(const std::string& path, std::string& content, struct stat& st, std::string& error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            content.clear();
+            st.st_mode = S_IFREG | 0644;
+            st.st_uid = geteuid();
+            st.st_gid = getegid();
+            return true;
+        }
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    content.clear();
+    bool ok = fstat(fd, &st) == 0;
+    char buffer[65536];
+    ssize_t n;
+    while (ok && (n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            ok = errno == EINTR;
+            continue;
+        }
+        content.append(buffer, static_cast<size_t>(n));
+    }
+    if (!ok) {
+        error = "cannot read " + path + ": " + std::strerror(errno);
+    }
+    close(fd);
+    return ok;
+}
+
+} // namespace
+
+ConfigPersister::ConfigPersister(const std::string& jobsPath, Logger& loggerRef)
+    : path(jobsPath), logger(loggerRef) {}
+
+ConfigPersister::~ConfigPersister() {
+    stop();
+}
+
+void ConfigPersister::setHook(PersistHook newHook) {
+    hook = std::move(newHook);
+}
+
+void ConfigPersister::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (writer_thread.joinable()) {
+        return;
+    }
+    stopping = false;
+    writer_thread = std::thread(&ConfigPersister::writerLoop, this);
+}
+
+void ConfigPersister::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (writer_thread.joinable()) {
+        writer_thread.join();
+    }
+}
+
+void ConfigPersister::enqueue(const std::string& id, nlohmann::json entry, uint64_t tag) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(Change{id, std::move(entry), tag});
+    }
+    cv.notify_all();
+}
+
+size_t ConfigPersister::pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queued.size();
+}
+
+/**
+ * Writer thread: wait for a change, let the burst settle, write once
+ */
+void ConfigPersister::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !queued.empty(); });
+        if (queued.empty()) {
+            break;   // Stopping with nothing left to write
+        }
+        if (!stopping) {
+            cv.wait_for(lock, std::chrono::milliseconds(COALESCE_MS), [this] { return stopping; });
+        }
+
+        std::vector<Change> changes;
+        changes.swap(queued);
+        lock.unlock();
+        bool written = flush(changes);
+        lock.lock();
+
+        if (!written) {
+            // Keep the changes (older first) and retry later
+            changes.insert(changes.end(), std::make_move_iterator(queued.begin()), std::make_move_iterator(queued.end()));
+            queued.swap(changes);
+            if (stopping) {
+                logger.error("ConfigPersister: " + std::to_string(queued.size()) +
+                             " job changes were not written to " + path);
+                break;
+            }
+            cv.wait_for(lock, std::chrono::milliseconds(RETRY_MS), [this] { return stopping; });
+        }
+    }
+}
+
+/**
+ * Patch the current file with a batch of changes and replace it atomically
+ */
+bool ConfigPersister::flush(const std::vector<Change>& changes) {
+    AllocScope scope(AllocTag::CONFIG);
+    std::string previous;
+    std::string error;
+    struct stat st;
+    if (!readFile(path, previous, st, error)) {
+        logger.error("ConfigPersister: " + error);
+        return false;
+    }
+
+    nlohmann::json doc;
+    try {
+        doc = previous.empty() ? nlohmann::json{{"jobs", nlohmann::json::array()}} : nlohmann::json::parse(previous);
+    } catch (const std::exception& e) {
+        logger.error("ConfigPersister: " + path + " is not valid JSON, changes kept until it is fixed: " + e.what());
+        return false;
+    }
+    if (!doc.is_object() || !doc.contains("jobs") || !doc["jobs"].is_array()) {
+        logger.error("ConfigPersister: " + path + " has no \"jobs\" array, changes kept until it is fixed");
+        return false;
+    }
+
+    // Position of every entry by ID, as the daemon resolves them
+    std::vector<std::string> ids = JobConfig::entryIds(doc);
+    std::unordered_map<std::string, size_t> position;
+    position.reserve(ids.size() + changes.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (!ids[i].empty()) {
+            position.emplace(ids[i], i);
+        }
+    }
+
+    nlohmann::json& entries = doc["jobs"];
+    uint64_t oldest_tag = UINT64_MAX;
+    size_t removed = 0;
+    for (const auto& change : changes) {
+        oldest_tag = std::min(oldest_tag, change.tag);
+        auto it = position.find(change.id);
+        if (it != position.end()) {
+            if (change.entry.is_null() && !entries[it->second].is_null()) {
+                removed++;
+            }
+            entries[it->second] = change.entry;   // Null marks a deleted entry
+        } else if (!change.entry.is_null()) {
+            position.emplace(change.id, entries.size());
+            entries.push_back(change.entry);
+        }
+    }
+    if (removed > 0) {
+        auto& array = entries.get_ref<nlohmann::json::array_t&>();
+        array.erase(std::remove_if(array.begin(), array.end(),
+                                   [](const nlohmann::json& entry) { return entry.is_null(); }), array.end());
+    }
+    std::string content = doc.dump(2) + "\n";
+
+    std::string tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        logger.error("ConfigPersister: cannot write " + tmpPath + ": " + std::strerror(errno));
+        return false;
+    }
+    // Keep the permissions and owner of the file being replaced
+    bool ok = fchmod(fd, st.st_mode & 07777) == 0;
+    if (ok && geteuid() == 0) {
+        ok = fchown(fd, st.st_uid, st.st_gid) == 0;
+    }
+    ok = ok && write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()) && fsync(fd) == 0;
+    int saved_errno = errno;
+    close(fd);
+    if (ok && hook) {
+        hook(previous, content, oldest_tag);
+    }
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        logger.error("ConfigPersister: cannot replace " + path + ": " + std::strerror(ok ? errno : saved_errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    write_count.fetch_add(1);
+    logger.info("ConfigPersister: wrote " + std::to_string(changes.size()) + " job changes to " + path);
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef CONFIG_PERSISTER_H
+#define CONFIG_PERSISTER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Logger.h"
+#include "json.hpp"
+
+/**
+ * Called right before the new file is renamed into place
+ *
+ * @param previous File content the changes were applied to
+ * @param content New file content
+ * @param tag Oldest tag of the changes included in this write
+ */
+using PersistHook = std::function<void(const std::string& previous, const std::string& content, uint64_t tag)>;
+
+/**
+ * ConfigPersister Class - Writes job mutations back to jobs.json
+ *
+ * Mutations applied live through the control socket are queued here and
+ * written by a background thread, so the caller never waits for disk I/O.
+ * Changes arriving within COALESCE_MS of each other end up in one write.
+ *
+ * Each write reads the current file, patches the listed entries by job ID
+ * (entries keep their position and every other entry is copied as is,
+ * including jobs whose conditions kept them from loading) and replaces the
+ * file with a temporary file + fsync + rename, so readers only ever see a
+ * complete configuration.
+ */
+class ConfigPersister {
+public:
+    static constexpr int COALESCE_MS = 200;
+
+    ConfigPersister(const std::string& path, Logger& logger);
+    ~ConfigPersister();
+
+    ConfigPersister(const ConfigPersister&) = delete;
+    ConfigPersister& operator=(const ConfigPersister&) = delete;
+
+    /**
+     * Hook run before each rename (set before start())
+     */
+    void setHook(PersistHook hook);
+
+    /**
+     * Start the writer thread
+     */
+    void start();
+
+    /**
+     * Write what is still queued and stop the writer thread
+     */
+    void stop();
+
+    /**
+     * Queue a change of one entry
+     *
+     * @param id Job ID
+     * @param entry New jobs.json object, or null to delete the entry
+     * @param tag Caller-defined value handed to the hook (e.g. config generation)
+     */
+    void enqueue(const std::string& id, nlohmann::json entry, uint64_t tag);
+
+    /**
+     * Number of files written so far
+     */
+    uint64_t writes() const { return write_count.load(); }
+
+    /**
+     * Number of changes not written yet (after stop(): the ones that failed)
+     */
+    size_t pending() const;
+
+private:
+    struct Change {
+        std::string id;
+        nlohmann::json entry;
+        uint64_t tag;
+    };
+
+    void writerLoop();
+    bool flush(const std::vector<Change>& changes);
+
+    std::string path;
+    Logger& logger;
+    PersistHook hook;
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Change> queued;
+    bool stopping = false;
+    std::thread writer_thread;
+    std::atomic<uint64_t> write_count{0};
+};
+
+#endif // CONFIG_PERSISTER_H
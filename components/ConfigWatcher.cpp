@@ -9,12 +9,15 @@
 
 #include "ConfigWatcher.h"
 #include "JobConfig.h"
+#include "EventBus.h"
+#include "AllocTracker.h"
 #include <iostream>
 #include <fstream>
 #include <chrono>
 #include <cstring>
 #include <cerrno>
 #include <limits.h>
+#include <sys/select.h>
 
 /**
  * Constructor - Initializes watcher and loads initial configuration
@@ -25,7 +28,11 @@ ConfigWatcher::ConfigWatcher(const std::string& jobsPath, Logger& loggerRef)
     : configPath(jobsPath), logger(loggerRef), inotifyFd(-1), watchDescriptor(-1) {
     
     // Bootstrap initial configuration loading
-    currentJobs = loadJobsFromFile();
+    std::string content;
+    if (readConfigFile(content)) {
+        currentJobs = loadJobsFromContent(content);
+        loadedHash.store(contentHash(content));
+    }
     if (!currentJobs) {
         // Fallback: create empty container to avoid null pointers
         currentJobs = std::make_shared<std::vector<CronJob>>();
@@ -33,6 +40,7 @@ ConfigWatcher::ConfigWatcher(const std::string& jobsPath, Logger& loggerRef)
     } else {
         logger.info("ConfigWatcher: Loaded " + std::to_string(currentJobs->size()) + " jobs from " + configPath);
     }
+    snapshotGeneration.store(1);
 }
 
 /**
@@ -114,6 +122,18 @@ bool ConfigWatcher::isConfigValid() const {
     return currentJobs && !currentJobs->empty();
 }
 
+/**
+ * Reload counters snapshot
+ * @return Published generation, reload attempts and rejected reloads
+ */
+ReloadStats ConfigWatcher::getReloadStats() const {
+    ReloadStats stats;
+    stats.generation = snapshotGeneration.load();
+    stats.attempts = reloadAttempts.load();
+    stats.failures = reloadFailures.load();
+    return stats;
+}
+
 /**
  * Forces immediate configuration reload (bypasses file watching)
  * @return true if reload successful
@@ -122,6 +142,37 @@ bool ConfigWatcher::forceReload() {
     return validateAndLoadConfig();
 }
 
+/**
+ * Announces a write of the configuration file by the daemon itself
+ * @param previous File content the write was derived from
+ * @param content New file content
+ * @param generation Snapshot generation the written changes were applied to
+ * @note The reload of `content` is skipped only if the live state already
+ *       matches it: `previous` is what the current snapshot was loaded from
+ *       and no snapshot was published since the changes were applied.
+ *       Otherwise the file holds edits the daemon has not seen and the
+ *       reload goes ahead as usual.
+ */
+void ConfigWatcher::expectOwnWrite(const std::string& previous, const std::string& content, uint64_t generation) {
+    if (generation == snapshotGeneration.load() && contentHash(previous) == loadedHash.load()) {
+        ownWriteHash.store(contentHash(content));
+    } else {
+        ownWriteHash.store(0);
+    }
+}
+
+/**
+ * FNV-1a hash of file content
+ */
+uint64_t ConfigWatcher::contentHash(const std::string& content) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : content) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash == 0 ? 1 : hash;   // 0 means "no hash"
+}
+
 /**
  * Initializes Linux inotify file watching system
  * @return true if inotify setup successful
@@ -135,12 +186,19 @@ bool ConfigWatcher::initializeInotify() {
         return false;
     }
     
+    // Watch the parent directory rather than the file: an atomic save
+    // (write a temporary file, rename it over jobs.json) replaces the inode,
+    // which would silently end a watch placed on the file itself
+    size_t slash = configPath.find_last_of('/');
+    std::string watchDir = slash == std::string::npos ? "." : (slash == 0 ? "/" : configPath.substr(0, slash));
+    watchName = slash == std::string::npos ? configPath : configPath.substr(slash + 1);
+    
     // Monitor file modifications, writes, and moves (editor save patterns)
-    watchDescriptor = inotify_add_watch(inotifyFd, configPath.c_str(), 
+    watchDescriptor = inotify_add_watch(inotifyFd, watchDir.c_str(), 
                                        IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO);
     
     if (watchDescriptor == -1) {
-        logger.error("ConfigWatcher: Failed to add watch for " + configPath);
+        logger.error("ConfigWatcher: Failed to add watch for " + watchDir);
         close(inotifyFd);
         inotifyFd = -1;
         return false;
@@ -175,7 +233,7 @@ void ConfigWatcher::watcherLoop() {
     
     // Fixed buffer size for inotify event reading (standard size)
     const size_t bufferSize = 4096;
-    char buffer[bufferSize];
+    alignas(struct inotify_event) char buffer[bufferSize];
     
     while (!shouldStop.load()) {
         // Setup file descriptor set for select()
@@ -215,16 +273,25 @@ void ConfigWatcher::watcherLoop() {
                 continue;
             }
             
-            if (bytesRead > 0) {
-                logger.info("ConfigWatcher: Configuration file changed, reloading...");
-                
+            // Other files of the directory are ignored
+            bool configChanged = false;
+            for (char* p = buffer; p < buffer + bytesRead;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(p);
+                if (event->len > 0 && watchName == event->name) {
+                    configChanged = true;
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+            
+            if (configChanged) {
                 // Brief delay to ensure file write completion (editor save patterns)
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
                 
-                if (validateAndLoadConfig()) {
-                    logger.success("ConfigWatcher: Configuration reloaded successfully");
-                } else {
+                uint64_t generation = snapshotGeneration.load();
+                if (!validateAndLoadConfig()) {
                     logger.error("ConfigWatcher: Failed to reload configuration - keeping old version");
+                } else if (snapshotGeneration.load() != generation) {
+                    logger.success("ConfigWatcher: Configuration reloaded successfully");
                 }
             }
         }
@@ -239,27 +306,48 @@ void ConfigWatcher::watcherLoop() {
  * @note Performs validation before replacing current config to ensure stability
  */
 bool ConfigWatcher::validateAndLoadConfig() {
+    reloadAttempts.fetch_add(1);
+    auto fail = [this](const std::string& message) {
+        logger.error("ConfigWatcher: " + message);
+        reloadFailures.fetch_add(1);
+        if (EventBus::active()) {
+            EventBus::publish("reload", "", {{"source", "config"}, {"ok", false}, {"error", message}});
+        }
+        return false;
+    };
     try {
+        // Read once: the same bytes are hashed, validated and parsed
+        std::string content;
+        if (!readConfigFile(content)) {
+            return fail("Configuration file does not exist or is not readable: " + configPath);
+        }
+        
+        // The daemon's own write of mutations it already applied live
+        uint64_t hash = contentHash(content);
+        if (hash == ownWriteHash.load()) {
+            loadedHash.store(hash);
+            logger.debug("ConfigWatcher: Change is our own write, reload skipped");
+            return true;
+        }
+        logger.info("ConfigWatcher: Configuration file changed, reloading...");
+        
         // Pre-validation to catch syntax errors before loading
         std::string errorMsg;
-        if (!JobConfig::validateJobsFile(configPath, errorMsg)) {
-            logger.error("ConfigWatcher: Configuration validation failed: " + errorMsg);
-            return false;
+        if (!JobConfig::validateJobsJson(content, errorMsg)) {
+            return fail("Configuration validation failed: " + errorMsg);
         }
         
         // Attempt to load new configuration
-        auto newJobs = loadJobsFromFile();
+        auto newJobs = loadJobsFromContent(content);
         
         if (!newJobs) {
-            logger.error("ConfigWatcher: Failed to load new configuration");
-            return false;
+            return fail("Failed to load new configuration");
         }
         
         // Additional semantic validation for loaded jobs
         for (const auto& job : *newJobs) {
             if (job.command.empty()) {
-                logger.error("ConfigWatcher: Invalid job found - empty command");
-                return false;
+                return fail("Invalid job found - empty command");
             }
             
             if (job.description.empty()) {
@@ -272,33 +360,43 @@ bool ConfigWatcher::validateAndLoadConfig() {
             std::lock_guard<std::mutex> lock(cacheMutex);
             currentJobs = newJobs;
         }
+        loadedHash.store(hash);
+        ownWriteHash.store(0);
+        snapshotGeneration.fetch_add(1);
         
         logger.info("ConfigWatcher: Successfully reloaded " + std::to_string(newJobs->size()) + " jobs");
         return true;
         
     } catch (const std::exception& e) {
-        logger.error("ConfigWatcher: Exception during config reload: " + std::string(e.what()));
+        return fail("Exception during config reload: " + std::string(e.what()));
+    }
+}
+
+/**
+ * Reads the whole configuration file
+ * @param content Output file content
+ * @return false if the file does not exist or is not readable
+ */
+bool ConfigWatcher::readConfigFile(std::string& content) {
+    std::ifstream file(configPath, std::ios::binary);
+    if (!file.is_open()) {
         return false;
     }
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
 }
 
 /**
- * Loads jobs from configuration file using JobConfig infrastructure
+ * Parses jobs using JobConfig infrastructure
+ * @param content Configuration file content
  * @return Shared pointer to job vector, nullptr on failure
- * @note Performs file existence check before attempting load
  */
-std::shared_ptr<std::vector<CronJob>> ConfigWatcher::loadJobsFromFile() {
+std::shared_ptr<std::vector<CronJob>> ConfigWatcher::loadJobsFromContent(const std::string& content) {
+    // Published snapshots are charged to the config subsystem
+    AllocScope scope(AllocTag::CONFIG);
     try {
-        // Verify file accessibility before processing
-        std::ifstream testFile(configPath);
-        if (!testFile.is_open()) {
-            logger.error("ConfigWatcher: Configuration file does not exist or is not readable: " + configPath);
-            return nullptr;
-        }
-        testFile.close();
-        
         // Delegate to existing JobConfig parsing infrastructure
-        std::vector<CronJob> jobs = JobConfig::loadJobs(configPath);
+        std::vector<CronJob> jobs = JobConfig::parseJobsFromJson(content);
         
         // Handle empty configuration case
         if (jobs.empty()) {
@@ -7,6 +7,7 @@
 #include <atomic>
 #include <thread>
 #include <string>
+#include <cstdint>
 #include <sys/inotify.h>
 #include <unistd.h>
 #include <limits.h>
@@ -18,6 +19,15 @@
 #define NAME_MAX 255
 #endif
 
+/**
+ * STRUCT: Reload counters exposed for monitoring and benchmarks
+ */
+struct ReloadStats {
+    uint64_t generation = 0;   // Number of snapshots published (initial load = 1)
+    uint64_t attempts = 0;     // Reloads triggered (inotify events or forced)
+    uint64_t failures = 0;     // Reloads rejected, old snapshot kept
+};
+
 class ConfigWatcher {
 private:
     std::shared_ptr<std::vector<CronJob>> currentJobs;
@@ -25,19 +35,31 @@ private:
     std::string configPath;
     Logger& logger;
     
-    // inotify variables
+    // inotify variables (the watch is on the parent directory, see initializeInotify)
     int inotifyFd;
     int watchDescriptor;
+    std::string watchName;
     std::atomic<bool> isWatching{false};
     std::atomic<bool> shouldStop{false};
     std::thread watcherThread;
     
+    // Reload accounting
+    std::atomic<uint64_t> snapshotGeneration{0};
+    std::atomic<uint64_t> reloadAttempts{0};
+    std::atomic<uint64_t> reloadFailures{0};
+    
+    // Content hashes used to skip reloads of our own writes
+    std::atomic<uint64_t> loadedHash{0};     // File content behind the current snapshot
+    std::atomic<uint64_t> ownWriteHash{0};   // Content written by the daemon itself (0 = none)
+    
     // Internal methods
     bool initializeInotify();
     void cleanupInotify();
     void watcherLoop();
     bool validateAndLoadConfig();
-    std::shared_ptr<std::vector<CronJob>> loadJobsFromFile();
+    bool readConfigFile(std::string& content);
+    std::shared_ptr<std::vector<CronJob>> loadJobsFromContent(const std::string& content);
+    static uint64_t contentHash(const std::string& content);
     
 public:
     ConfigWatcher(const std::string& jobsPath, Logger& loggerRef);
@@ -48,9 +70,13 @@ public:
     void stopWatching();
     std::shared_ptr<std::vector<CronJob>> getJobs();
     bool isConfigValid() const;
+    ReloadStats getReloadStats() const;
     
     // Force reload (useful for testing)
     bool forceReload();
+    
+    // Announce a file the daemon is about to write (live job mutations)
+    void expectOwnWrite(const std::string& previous, const std::string& content, uint64_t generation);
 };
 
 #endif // CONFIG_WATCHER_H
\ No newline at end of file
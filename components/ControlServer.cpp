@@ -0,0 +1,373 @@
+/**
+ * @file ControlServer.cpp
+ * @brief Line-delimited JSON control socket
+ */
+
+#include "ControlServer.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+bool makeAddress(const std::string& path, struct sockaddr_un& addr, std::string& error) {
+    std::memset(&addr, 0, sizeof(addr));
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        error = "invalid unix socket path: " + path;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    return true;
+}
+
+/**
+ * Write a whole buffer to a non-blocking socket, waiting at most timeout_ms
+ */
+bool sendAll(int fd, const std::string& data, int timeout_ms) {
+    size_t sent = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return false;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        struct pollfd pfd = {fd, POLLOUT, 0};
+        if (left.count() <= 0 || poll(&pfd, 1, static_cast<int>(left.count())) <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ControlServer::ControlServer(Logger& loggerRef) : logger(loggerRef) {}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+void ControlServer::handle(const std::string& cmd, ControlHandler handler) {
+    handlers[cmd] = std::move(handler);
+}
+
+void ControlServer::handleStream(const std::string& cmd, ControlStreamHandler handler) {
+    stream_handlers[cmd] = std::move(handler);
+}
+
+bool ControlServer::start(const std::string& path, std::string& error) {
+    struct sockaddr_un addr;
+    if (!makeAddress(path, addr, error)) {
+        return false;
+    }
+
+    // A socket that still accepts connections belongs to a running daemon
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        bool live = connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        close(probe);
+        if (live) {
+            error = path + " is in use by another daemon";
+            return false;
+        }
+    }
+    unlink(path.c_str());
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd < 0) {
+        error = std::string("socket failed: ") + std::strerror(errno);
+        return false;
+    }
+    // Restrict the node before listen(): nobody can connect in between
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        chmod(path.c_str(), 0600) != 0 || listen(listen_fd, 64) != 0) {
+        error = "cannot listen on " + path + ": " + std::strerror(errno);
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    socket_path = path;
+    if (!startThread(error)) {
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(path.c_str());
+        return false;
+    }
+    logger.info("ControlServer: listening on " + path);
+    return true;
+}
+
+bool ControlServer::adopt(int fd, const std::string& path, std::string& error) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) != 0) {
+        error = "inherited control socket " + std::to_string(fd) + " is not usable: " + std::strerror(errno);
+        return false;
+    }
+    listen_fd = fd;
+    socket_path = path;
+    if (!startThread(error)) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    logger.info("ControlServer: serving inherited socket " + path);
+    return true;
+}
+
+bool ControlServer::startThread(std::string& error) {
+    if (pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        error = std::string("pipe failed: ") + std::strerror(errno);
+        return false;
+    }
+    running.store(true);
+    server_thread = std::thread(&ControlServer::serverLoop, this);
+    return true;
+}
+
+void ControlServer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    wake();
+    if (server_thread.joinable()) {
+        server_thread.join();
+    }
+    for (auto& client : clients) {
+        close(client.fd);
+    }
+    clients.clear();
+    close(listen_fd);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    listen_fd = wake_pipe[0] = wake_pipe[1] = -1;
+    unlink(socket_path.c_str());
+}
+
+int ControlServer::detach() {
+    if (!running.exchange(false)) {
+        return -1;
+    }
+    wake();
+    if (server_thread.joinable()) {
+        server_thread.join();
+    }
+    for (auto& client : clients) {
+        close(client.fd);
+    }
+    clients.clear();
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+
+    int fd = listen_fd;
+    listen_fd = -1;
+    fcntl(fd, F_SETFD, 0);   // Survives execve()
+    return fd;
+}
+
+void ControlServer::wake() {
+    char byte = 1;
+    ssize_t ignored = write(wake_pipe[1], &byte, 1);
+    (void)ignored;
+}
+
+/**
+ * Server thread: accept clients, read requests, answer them in order
+ */
+void ControlServer::serverLoop() {
+    std::vector<struct pollfd> fds;
+
+    while (running.load()) {
+        fds.clear();
+        fds.push_back({wake_pipe[0], POLLIN, 0});
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& client : clients) {
+            fds.push_back({client.fd, POLLIN, 0});
+        }
+
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            logger.error(std::string("ControlServer: poll failed: ") + std::strerror(errno));
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {}
+        }
+
+        // Serve existing clients first: acceptClients() may grow the vector
+        size_t polled = fds.size() - 2;
+        std::vector<bool> keep(polled, true);
+        for (size_t i = 0; i < polled; ++i) {
+            if (fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+                keep[i] = readClient(clients[i]);
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < clients.size(); ++i) {
+            if (i < polled && !keep[i]) {
+                if (clients[i].fd >= 0) {
+                    close(clients[i].fd);   // -1: taken over by a stream handler
+                }
+                continue;
+            }
+            if (kept != i) {
+                clients[kept] = std::move(clients[i]);
+            }
+            kept++;
+        }
+        clients.resize(kept);
+
+        if (fds[1].revents & POLLIN) {
+            acceptClients();
+        }
+    }
+}
+
+void ControlServer::acceptClients() {
+    int fd;
+    while ((fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+        Client client;
+        client.fd = fd;
+        clients.push_back(std::move(client));
+    }
+}
+
+/**
+ * Read what a client sent and answer every complete line
+ * @return false when the client is gone or misbehaved
+ */
+bool ControlServer::readClient(Client& client) {
+    char data[65536];
+    ssize_t n;
+    while ((n = recv(client.fd, data, sizeof(data), 0)) > 0) {
+        client.input.append(data, static_cast<size_t>(n));
+        if (client.input.size() > MAX_REQUEST_BYTES) {
+            break;   // Answer what is complete before reading more
+        }
+    }
+    bool closed = n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+
+    size_t start = 0;
+    size_t end;
+    while ((end = client.input.find('\n', start)) != std::string::npos) {
+        std::string reply = dispatch(client.input.substr(start, end - start), client);
+        start = end + 1;
+        if (client.fd < 0) {
+            return false;   // Now a stream, no longer served here
+        }
+        if (!sendAll(client.fd, reply, 1000)) {
+            return false;
+        }
+    }
+    client.input.erase(0, start);
+
+    if (client.input.size() > MAX_REQUEST_BYTES) {
+        sendAll(client.fd, "{\"ok\":false,\"error\":\"request too large\"}\n", 1000);
+        return false;
+    }
+    return !closed;
+}
+
+/**
+ * Run the handler of one request line and format its reply; a stream
+ * handler that takes the connection sets client.fd to -1 (no reply here)
+ */
+std::string ControlServer::dispatch(const std::string& line, Client& client) {
+    nlohmann::json reply;
+    std::string error;
+    try {
+        nlohmann::json request = nlohmann::json::parse(line);
+        std::string cmd = request.is_object() ? request.value("cmd", "") : "";
+        auto it = handlers.find(cmd);
+        auto stream = stream_handlers.find(cmd);
+        if (cmd.empty()) {
+            error = "missing \"cmd\"";
+        } else if (stream != stream_handlers.end()) {
+            if (stream->second(request, client.fd, error)) {
+                client.fd = -1;
+                return std::string();
+            }
+            if (error.empty()) {
+                error = cmd + " failed";
+            }
+        } else if (it == handlers.end()) {
+            error = "unknown command: " + cmd;
+        } else if (it->second(request, reply, error)) {
+            reply["ok"] = true;
+        } else if (error.empty()) {
+            error = cmd + " failed";
+        }
+    } catch (const std::exception& e) {
+        error = std::string("invalid request: ") + e.what();
+    }
+    if (!error.empty()) {
+        reply = {{"ok", false}, {"error", error}};
+    }
+    return reply.dump() + "\n";
+}
+
+bool ControlServer::call(const std::string& path, const nlohmann::json& request, nlohmann::json& response,
+                         std::string& error, int timeout_ms) {
+    struct sockaddr_un addr;
+    if (!makeAddress(path, addr, error)) {
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("socket failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        error = "cannot connect to " + path + ": " + std::strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    std::string input;
+    bool ok = sendAll(fd, request.dump() + "\n", timeout_ms);
+    if (!ok) {
+        error = "send failed";
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (ok && input.find('\n') == std::string::npos) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (left.count() <= 0 || poll(&pfd, 1, static_cast<int>(left.count())) <= 0) {
+            error = "no reply from daemon";
+            ok = false;
+            break;
+        }
+        char data[65536];
+        ssize_t n = recv(fd, data, sizeof(data), 0);
+        if (n <= 0) {
+            error = "connection closed by daemon";
+            ok = false;
+            break;
+        }
+        input.append(data, static_cast<size_t>(n));
+    }
+    close(fd);
+    if (!ok) {
+        return false;
+    }
+
+    try {
+        response = nlohmann::json::parse(input.substr(0, input.find('\n')));
+    } catch (const std::exception& e) {
+        error = std::string("malformed reply: ") + e.what();
+        return false;
+    }
+    return true;
+}
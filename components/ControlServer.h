@@ -0,0 +1,136 @@
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Logger.h"
+#include "json.hpp"
+
+/**
+ * Handles one control command
+ *
+ * @param request Whole request object ({"cmd": ..., arguments})
+ * @param response Output fields added to the reply (besides "ok")
+ * @param error Output error message when the command fails
+ * @return true on success
+ */
+using ControlHandler = std::function<bool(const nlohmann::json& request, nlohmann::json& response, std::string& error)>;
+
+/**
+ * Takes over a connection for a streaming command
+ *
+ * @param request Whole request object
+ * @param fd Client socket (non-blocking); owned by the handler on success,
+ *           which then also sends the reply
+ * @param error Output error message; the client stays a normal connection
+ * @return true if the handler took the connection
+ */
+using ControlStreamHandler = std::function<bool(const nlohmann::json& request, int fd, std::string& error)>;
+
+/**
+ * ControlServer Class - Local administration socket of the daemon
+ *
+ * Listens on a Unix socket (mode 0600, so only root and the daemon user
+ * can connect) and speaks line-delimited JSON: each request is one object
+ * with a "cmd" field, each reply one object with "ok": true plus the
+ * handler's fields, or "ok": false and "error". A connection may send any
+ * number of requests; they are answered in order.
+ *
+ * One thread multiplexes every client with poll() and runs the handlers,
+ * so handlers never run concurrently with each other and must not block.
+ * Handlers are registered before start().
+ *
+ * A streaming command (handleStream) hands its connection over to the
+ * handler, for example to push events; further input on it is ignored.
+ */
+class ControlServer {
+public:
+    static const size_t MAX_REQUEST_BYTES = 16 * 1024 * 1024;
+
+    explicit ControlServer(Logger& logger);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    /**
+     * Register the handler of a command (replaces an existing one)
+     */
+    void handle(const std::string& cmd, ControlHandler handler);
+
+    /**
+     * Register a command that takes over its connection
+     */
+    void handleStream(const std::string& cmd, ControlStreamHandler handler);
+
+    /**
+     * Listen on a Unix socket path and start the server thread
+     * @return false if the path is in use by a live daemon or cannot be bound
+     */
+    bool start(const std::string& path, std::string& error);
+
+    /**
+     * Serve a socket inherited from the previous daemon image
+     *
+     * @param fd Listening socket, already bound to `path`
+     * @param path Socket path (removed on stop())
+     */
+    bool adopt(int fd, const std::string& path, std::string& error);
+
+    /**
+     * Close every connection, stop the thread and remove the socket
+     */
+    void stop();
+
+    /**
+     * Stop serving but keep the socket bound, for the next daemon image
+     *
+     * Clients connecting meanwhile wait in the listen backlog. The socket
+     * is left without close-on-exec.
+     *
+     * @return Listening socket (-1 if not running), owned by the caller
+     */
+    int detach();
+
+    /**
+     * Send one request to a control socket and wait for the reply
+     *
+     * @param path Socket path
+     * @param request Request object
+     * @param response Output reply object
+     * @param error Output error on connection or protocol failure
+     * @param timeout_ms Reply timeout
+     * @return true if a reply was received (check response["ok"])
+     */
+    static bool call(const std::string& path, const nlohmann::json& request, nlohmann::json& response,
+                     std::string& error, int timeout_ms = 10000);
+
+private:
+    struct Client {
+        int fd = -1;
+        std::string input;
+    };
+
+    bool startThread(std::string& error);
+    void serverLoop();
+    void acceptClients();
+    bool readClient(Client& client);
+    std::string dispatch(const std::string& line, Client& client);
+    void wake();
+
+    Logger& logger;
+    std::map<std::string, ControlHandler> handlers;
+    std::map<std::string, ControlStreamHandler> stream_handlers;
+    std::vector<Client> clients;
+    std::string socket_path;
+    int listen_fd = -1;
+    int wake_pipe[2] = {-1, -1};
+    std::atomic<bool> running{false};
+    std::thread server_thread;
+};
+
+#endif // CONTROL_SERVER_H
@@ -1,4 +1,6 @@
 #include "CronEngine.h"
+#include "AllocTracker.h"
+#include "CronExpression.h"
 #include <sstream>
 #include <iomanip>
 
@@ -6,17 +8,25 @@ bool CronEngine::shouldRunJob(const CronJob& job,
                              const std::tm& local_time, 
                              const std::map<std::string, std::pair<int, int>>& last_exec) {
     
-    // Handle special minute/hour values from JSON
-    bool minute_match = (job.minute == -1) || // "*" = any minute
-                       (job.minute == -2) || // "*/X" = interval (simplified)
-                       (job.minute == local_time.tm_min);
-    
-    bool hour_match = (job.hour == -1) || // "*" = any hour
-                     (job.hour == local_time.tm_hour);
-    
-    // Check if it's the right time
-    if (!minute_match || !hour_match) {
-        return false;
+    // Compiled schedule (every job loaded through JobConfig has one)
+    bool compiled = job.mask.minutes != 0;
+    if (compiled) {
+        if (!CronExpression::matches(job.mask, local_time)) {
+            return false;
+        }
+    } else {
+        // Legacy fallback for hand-built jobs: handle special minute/hour values
+        bool minute_match = (job.minute == -1) || // "*" = any minute
+                           (job.minute == -2) || // "*/X" = interval (simplified)
+                           (job.minute == local_time.tm_min);
+        
+        bool hour_match = (job.hour == -1) || // "*" = any hour
+                         (job.hour == local_time.tm_hour);
+        
+        // Check if it's the right time
+        if (!minute_match || !hour_match) {
+            return false;
+        }
     }
     
     // Check if job was already executed this minute
@@ -27,6 +37,10 @@ bool CronEngine::shouldRunJob(const CronJob& job,
         return false;
     }
     
+    if (compiled) {
+        return true;   // Day fields already checked by the mask
+    }
+    
     // Check frequency-specific conditions
     switch (job.frequency) {
         case CronFrequency::DAILY:
@@ -53,6 +67,19 @@ bool CronEngine::shouldRunJob(const CronJob& job,
     }
 }
 
+void CronEngine::collectDueJobs(const std::vector<CronJob>& jobs,
+                                const std::tm& local_time,
+                                const std::map<std::string, std::pair<int, int>>& last_exec,
+                                std::vector<const CronJob*>& due) {
+    AllocScope scope(AllocTag::SCHEDULER);
+    due.clear();
+    for (const auto& job : jobs) {
+        if (shouldRunJob(job, local_time, last_exec)) {
+            due.push_back(&job);
+        }
+    }
+}
+
 void CronEngine::printJobSchedule(const CronJob& job, Logger& logger) {
     std::stringstream ss;
     ss << "Job: " << job.command << " (" << job.description << ")\n";
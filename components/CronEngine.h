@@ -3,6 +3,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <ctime>
 #include "CronTypes.h"
 #include "Logger.h"
@@ -27,6 +28,23 @@ public:
                            const std::tm& local_time, 
                            const std::map<std::string, std::pair<int, int>>& last_exec);
     
+    /**
+     * One scheduler tick: collect every job that should run now
+     * 
+     * Reuses the capacity of the output vector, so a caller that reserves
+     * it once per configuration snapshot performs no heap allocation in
+     * steady state.
+     * 
+     * @param jobs Current job snapshot
+     * @param local_time Current system time
+     * @param last_exec Map of last executions to prevent duplicates
+     * @param due Output: pointers into jobs for the jobs due now (cleared first)
+     */
+    static void collectDueJobs(const std::vector<CronJob>& jobs,
+                               const std::tm& local_time,
+                               const std::map<std::string, std::pair<int, int>>& last_exec,
+                               std::vector<const CronJob*>& due);
+    
     /**
      * Print job schedule information in human-readable format
      * 
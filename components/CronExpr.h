@@ -0,0 +1,199 @@
+#ifndef CRON_EXPR_H
+#define CRON_EXPR_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include "CronTypes.h"
+
+/**
+ * CronExpr Class - Cron expressions compiled by the C++ compiler
+ *
+ * Same five-field syntax and the same CronMask as CronExpression::parse(),
+ * but constexpr, so a schedule written in the source is checked and
+ * compiled at build time:
+ *
+ *   constexpr CronMask WEEKDAY_MORNINGS = CronExpr::compile("0 9 * * mon-fri");
+ *   scheduler.addJob("report", WEEKDAY_MORNINGS, callback);
+ *
+ * An invalid expression in a constant expression does not compile (the
+ * error points at the throw below that was reached). Called at run time
+ * it throws std::invalid_argument instead; schedules read from input
+ * belong to CronExpression::parse(), which reports errors as text.
+ * Matching and next-fire search are CronExpression's, on the same mask.
+ */
+class CronExpr {
+public:
+    /**
+     * Compile a five-field expression ("0 9 * * 1-5")
+     */
+    static constexpr CronMask compile(std::string_view expression) {
+        Compiled result = tryCompile(expression);
+        if (result.error) {
+            throw std::invalid_argument(result.error);
+        }
+        return result.mask;
+    }
+
+    /**
+     * Whether an expression compiles (usable in static_assert)
+     */
+    static constexpr bool valid(std::string_view expression) {
+        return tryCompile(expression).error == nullptr;
+    }
+
+private:
+    struct Compiled {
+        CronMask mask;
+        const char* error = nullptr;
+    };
+
+    static constexpr std::string_view MONTH_NAMES[] = {
+        "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"
+    };
+    static constexpr std::string_view WEEKDAY_NAMES[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+    static constexpr Compiled tryCompile(std::string_view expression) {
+        Compiled result;
+        std::string_view fields[5];
+        size_t count = 0;
+        size_t pos = 0;
+        while (true) {
+            while (pos < expression.size() && (expression[pos] == ' ' || expression[pos] == '\t')) ++pos;
+            if (pos == expression.size()) break;
+            size_t start = pos;
+            while (pos < expression.size() && expression[pos] != ' ' && expression[pos] != '\t') ++pos;
+            if (count == 5) {
+                result.error = "unexpected extra field";
+                return result;
+            }
+            fields[count++] = expression.substr(start, pos - start);
+        }
+        if (count != 5) {
+            result.error = "expected 5 fields";
+            return result;
+        }
+
+        uint64_t bits = 0;
+        if ((result.error = parseField(fields[0], 0, 59, nullptr, 0, bits))) return result;
+        result.mask.minutes = bits;
+        if ((result.error = parseField(fields[1], 0, 23, nullptr, 0, bits))) return result;
+        result.mask.hours = static_cast<uint32_t>(bits);
+        if ((result.error = parseField(fields[2], 1, 31, nullptr, 0, bits))) return result;
+        result.mask.days_of_month = static_cast<uint32_t>(bits);
+        if ((result.error = parseField(fields[3], 1, 12, MONTH_NAMES, 12, bits))) return result;
+        result.mask.months = static_cast<uint16_t>(bits);
+        if ((result.error = parseField(fields[4], 0, 7, WEEKDAY_NAMES, 7, bits))) return result;
+        if (bits & (1ULL << 7)) {
+            bits = (bits & ~(1ULL << 7)) | 1ULL;   // Both 0 and 7 mean Sunday
+        }
+        result.mask.days_of_week = static_cast<uint8_t>(bits);
+
+        // Vixie cron semantics: a field starting with '*' does not restrict days
+        result.mask.dom_restricted = fields[2][0] != '*';
+        result.mask.dow_restricted = fields[4][0] != '*';
+        return result;
+    }
+
+    /**
+     * One comma separated field; returns an error or nullptr
+     */
+    static constexpr const char* parseField(std::string_view field, int min_value, int max_value,
+                                            const std::string_view* names, int name_count, uint64_t& bits) {
+        bits = 0;
+        while (true) {
+            size_t comma = field.find(',');
+            std::string_view item = field.substr(0, comma);
+            if (item.empty()) {
+                return "empty list element";
+            }
+
+            int step = 1;
+            std::string_view range = item;
+            size_t slash = item.find('/');
+            if (slash != std::string_view::npos) {
+                range = item.substr(0, slash);
+                if (!parseValue(item.substr(slash + 1), 1, max_value - min_value + 1, nullptr, 0, step)) {
+                    return "invalid step";
+                }
+            }
+
+            int low = min_value;
+            int high = max_value;
+            if (range != "*") {
+                size_t dash = range.find('-');
+                if (dash != std::string_view::npos) {
+                    if (!parseValue(range.substr(0, dash), min_value, max_value, names, name_count, low) ||
+                        !parseValue(range.substr(dash + 1), min_value, max_value, names, name_count, high)) {
+                        return "invalid range";
+                    }
+                    if (low > high) {
+                        return "reversed range";
+                    }
+                } else {
+                    if (!parseValue(range, min_value, max_value, names, name_count, low)) {
+                        return "invalid value";
+                    }
+                    // "A/S" runs from A to the maximum, plain "A" is a single value
+                    high = (slash != std::string_view::npos) ? max_value : low;
+                }
+            }
+
+            for (int v = low; v <= high; v += step) {
+                bits |= (1ULL << v);
+            }
+            if (comma == std::string_view::npos) {
+                return nullptr;
+            }
+            field.remove_prefix(comma + 1);
+        }
+    }
+
+    static constexpr bool parseValue(std::string_view token, int min_value, int max_value,
+                                     const std::string_view* names, int name_count, int& value) {
+        if (token.empty()) return false;
+
+        if (token[0] >= '0' && token[0] <= '9') {
+            int result = 0;
+            for (char c : token) {
+                if (c < '0' || c > '9') return false;
+                result = result * 10 + (c - '0');
+                if (result > max_value) return false;
+            }
+            if (result < min_value) return false;
+            value = result;
+            return true;
+        }
+
+        if (!names || token.size() != 3) return false;
+        // Month names start at 1, weekday names at 0
+        int base = (min_value == 1) ? 1 : 0;
+        for (int i = 0; i < name_count; ++i) {
+            bool same = true;
+            for (size_t k = 0; k < 3; ++k) {
+                char c = token[k];
+                if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+                same = same && c == names[i][k];
+            }
+            if (same) {
+                value = i + base;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Spot checks of the compiler itself, evaluated by every build that includes it
+static_assert(CronExpr::compile("0 */4 * * *").hours == 0x111111u, "CronExpr: hour step");
+static_assert(CronExpr::compile("*/15 9-17 * * mon-fri").minutes ==
+              ((1ULL << 0) | (1ULL << 15) | (1ULL << 30) | (1ULL << 45)), "CronExpr: minute step");
+static_assert(CronExpr::compile("*/15 9-17 * * mon-fri").days_of_week == 0x3Eu, "CronExpr: weekday names");
+static_assert(CronExpr::compile("0 0 1 jan,jul 7").days_of_week == 0x1u, "CronExpr: 7 is Sunday");
+static_assert(CronExpr::compile("0 0 1 jan,jul 7").months == ((1u << 1) | (1u << 7)), "CronExpr: month names");
+static_assert(CronExpr::compile("0 0 1 * 1").dom_restricted && CronExpr::compile("0 0 1 * 1").dow_restricted,
+              "CronExpr: day restriction");
+static_assert(!CronExpr::valid("0 24 * * *") && !CronExpr::valid("* * * *") && !CronExpr::valid("5-1 * * * *"),
+              "CronExpr: invalid expressions");
+
+#endif // CRON_EXPR_H
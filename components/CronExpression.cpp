@@ -0,0 +1,369 @@
+/**
+ * @file CronExpression.cpp
+ * @brief Cron field compiler, matcher and next-fire search
+ */
+
+#include "CronExpression.h"
+#include <cctype>
+#include <sstream>
+
+namespace {
+
+const char* const MONTH_NAMES[] = {
+    "jan", "feb", "mar", "apr", "may", "jun",
+    "jul", "aug", "sep", "oct", "nov", "dec", nullptr
+};
+
+const char* const WEEKDAY_NAMES[] = {
+    "sun", "mon", "tue", "wed", "thu", "fri", "sat", nullptr
+};
+
+// Days per month (1-12) in a common year
+const int MONTH_DAYS[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+int daysInMonth(int year, int month) {
+    return (month == 2 && isLeapYear(year)) ? 29 : MONTH_DAYS[month];
+}
+
+/**
+ * Days since 1970-01-01 of a proleptic Gregorian date (month 1-12)
+ */
+long daysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long year_of_era = year - era * 400;
+    long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+} // namespace
+
+/**
+ * Compile structured schedule fields into a CronMask
+ */
+bool CronExpression::compile(const CronSchedule& schedule, CronMask& mask, std::string& error) {
+    CronMask result;
+    uint64_t bits = 0;
+
+    if (!parseField(schedule.minute, 0, 59, nullptr, bits, error)) {
+        error = "minute: " + error;
+        return false;
+    }
+    result.minutes = bits;
+
+    if (!parseField(schedule.hour, 0, 23, nullptr, bits, error)) {
+        error = "hour: " + error;
+        return false;
+    }
+    result.hours = static_cast<uint32_t>(bits);
+
+    if (!parseField(schedule.day_of_month, 1, 31, nullptr, bits, error)) {
+        error = "day_of_month: " + error;
+        return false;
+    }
+    result.days_of_month = static_cast<uint32_t>(bits);
+
+    if (!parseField(schedule.month, 1, 12, MONTH_NAMES, bits, error)) {
+        error = "month: " + error;
+        return false;
+    }
+    result.months = static_cast<uint16_t>(bits);
+
+    if (!parseField(schedule.day_of_week, 0, 7, WEEKDAY_NAMES, bits, error)) {
+        error = "day_of_week: " + error;
+        return false;
+    }
+    // Both 0 and 7 mean Sunday
+    if (bits & (1ULL << 7)) {
+        bits = (bits & ~(1ULL << 7)) | 1ULL;
+    }
+    result.days_of_week = static_cast<uint8_t>(bits);
+
+    // Vixie cron semantics: a field starting with '*' does not restrict days
+    result.dom_restricted = schedule.day_of_month.empty() || schedule.day_of_month[0] != '*';
+    result.dow_restricted = schedule.day_of_week.empty() || schedule.day_of_week[0] != '*';
+
+    mask = result;
+    return true;
+}
+
+/**
+ * Compile a classic five-field expression
+ */
+bool CronExpression::parse(const std::string& expression, CronMask& mask, std::string& error) {
+    std::istringstream iss(expression);
+    CronSchedule schedule;
+    std::string extra;
+
+    if (!(iss >> schedule.minute >> schedule.hour >> schedule.day_of_month
+              >> schedule.month >> schedule.day_of_week)) {
+        error = "expected 5 fields in '" + expression + "'";
+        return false;
+    }
+    if (iss >> extra) {
+        error = "unexpected extra field '" + extra + "' in '" + expression + "'";
+        return false;
+    }
+    return compile(schedule, mask, error);
+}
+
+/**
+ * Check whether a mask matches the given local minute
+ */
+bool CronExpression::matches(const CronMask& mask, const std::tm& local_time) {
+    return ((mask.minutes >> local_time.tm_min) & 1ULL) &&
+           ((mask.hours >> local_time.tm_hour) & 1U) &&
+           dayMatches(mask, local_time);
+}
+
+/**
+ * Next matching minute strictly after `after`
+ *
+ * Calendar dates are walked with plain arithmetic: months absent from the
+ * mask are skipped with one test each, and the matching days of a month
+ * come from matchingDays() as a bit set, so a schedule that (almost) never
+ * fires costs at most one step per month of the horizon. Hours and minutes
+ * of a matching day are visited the same way; only candidate minutes go
+ * through mktime(), which handles DST transitions.
+ */
+std::time_t CronExpression::nextFireTime(const CronMask& mask, std::time_t after) {
+    if (reach(mask) == ScheduleReach::NEVER) {
+        return -1;
+    }
+
+    std::tm start;
+    localtime_r(&after, &start);
+    int year = start.tm_year + 1900;
+    int month = start.tm_mon + 1;
+    int first_day = start.tm_mday;
+    long start_date = daysFromCivil(year, month, first_day);
+    long end_date = start_date + MAX_SEARCH_DAYS;   // Exclusive
+
+    while (daysFromCivil(year, month, first_day) < end_date) {
+        uint32_t days = ((mask.months >> month) & 1U) ? matchingDays(mask, year, month) : 0;
+        days &= ~((1U << first_day) - 1);
+
+        for (; days != 0; days &= days - 1) {
+            int day = __builtin_ctz(days);
+            long date = daysFromCivil(year, month, day);
+            if (date >= end_date) {
+                return -1;
+            }
+            uint32_t hours = mask.hours;
+            if (date == start_date) {
+                hours &= ~((1U << start.tm_hour) - 1);
+            }
+            for (; hours != 0; hours &= hours - 1) {
+                int h = __builtin_ctz(hours);
+                uint64_t minutes = mask.minutes;
+                if (date == start_date && h == start.tm_hour) {
+                    minutes &= ~((2ULL << start.tm_min) - 1);   // Strictly after the current minute
+                }
+                for (; minutes != 0; minutes &= minutes - 1) {
+                    std::tm candidate = {};
+                    candidate.tm_year = year - 1900;
+                    candidate.tm_mon = month - 1;
+                    candidate.tm_mday = day;
+                    candidate.tm_hour = h;
+                    candidate.tm_min = __builtin_ctzll(minutes);
+                    candidate.tm_isdst = -1;
+                    std::time_t t = mktime(&candidate);
+                    if (t > after) {
+                        return t;
+                    }
+                }
+            }
+        }
+
+        // First day of the following month
+        first_day = 1;
+        if (++month > 12) {
+            month = 1;
+            ++year;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Classify a mask by the month/day pairs it can ever match
+ *
+ * With both day fields restricted (cron OR rule) any weekday bit matches
+ * in every month. Otherwise a day of month has to exist in one of the
+ * months: with the day of week also in play, each date falls on every
+ * weekday over the years, so only the day of month decides.
+ */
+ScheduleReach CronExpression::reach(const CronMask& mask) {
+    if (mask.minutes == 0 || mask.hours == 0 || mask.months == 0 ||
+        mask.days_of_month == 0 || mask.days_of_week == 0) {
+        return ScheduleReach::NEVER;
+    }
+    if (mask.dom_restricted && mask.dow_restricted) {
+        return ScheduleReach::REGULAR;
+    }
+    bool leap_day = false;
+    for (int month = 1; month <= 12; ++month) {
+        if (!((mask.months >> month) & 1U)) continue;
+        uint32_t month_days = (2U << MONTH_DAYS[month]) - 2;   // Bits 1..length
+        if (mask.days_of_month & month_days) {
+            return ScheduleReach::REGULAR;
+        }
+        leap_day = leap_day || (month == 2 && ((mask.days_of_month >> 29) & 1U));
+    }
+    return leap_day ? ScheduleReach::LEAP_YEARS : ScheduleReach::NEVER;
+}
+
+std::string CronExpression::describeReach(ScheduleReach reach) {
+    switch (reach) {
+        case ScheduleReach::NEVER:
+            return "never fires (no selected month has a selected day)";
+        case ScheduleReach::LEAP_YEARS:
+            return "fires only on February 29th, in leap years";
+        case ScheduleReach::REGULAR:
+            break;
+    }
+    return "fires every year";
+}
+
+/**
+ * Parse one cron field into a bit set
+ */
+bool CronExpression::parseField(const std::string& field, int min_value, int max_value,
+                                const char* const* names, uint64_t& bits, std::string& error) {
+    bits = 0;
+    if (field.empty()) {
+        error = "empty field";
+        return false;
+    }
+
+    std::stringstream ss(field);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) {
+            error = "empty list element in '" + field + "'";
+            return false;
+        }
+
+        // Split optional step
+        int step = 1;
+        std::string range = item;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            range = item.substr(0, slash);
+            std::string step_str = item.substr(slash + 1);
+            if (!parseValue(step_str, 1, max_value - min_value + 1, nullptr, step)) {
+                error = "invalid step '" + step_str + "' in '" + field + "'";
+                return false;
+            }
+        }
+
+        int low = min_value;
+        int high = max_value;
+        if (range == "*") {
+            // Full range
+        } else {
+            size_t dash = range.find('-');
+            if (dash != std::string::npos) {
+                if (!parseValue(range.substr(0, dash), min_value, max_value, names, low) ||
+                    !parseValue(range.substr(dash + 1), min_value, max_value, names, high)) {
+                    error = "invalid range '" + range + "' (allowed " + std::to_string(min_value) +
+                            "-" + std::to_string(max_value) + ")";
+                    return false;
+                }
+                if (low > high) {
+                    error = "range '" + range + "' is reversed";
+                    return false;
+                }
+            } else {
+                if (!parseValue(range, min_value, max_value, names, low)) {
+                    error = "invalid value '" + range + "' (allowed " + std::to_string(min_value) +
+                            "-" + std::to_string(max_value) + ")";
+                    return false;
+                }
+                // "A/S" runs from A to the maximum, plain "A" is a single value
+                high = (slash != std::string::npos) ? max_value : low;
+            }
+        }
+
+        for (int v = low; v <= high; v += step) {
+            bits |= (1ULL << v);
+        }
+    }
+    return true;
+}
+
+/**
+ * Parse a decimal value or a three-letter name within bounds
+ */
+bool CronExpression::parseValue(const std::string& token, int min_value, int max_value,
+                                const char* const* names, int& value) {
+    if (token.empty()) return false;
+
+    if (std::isdigit(static_cast<unsigned char>(token[0]))) {
+        int result = 0;
+        for (char c : token) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+            result = result * 10 + (c - '0');
+            if (result > max_value) return false;
+        }
+        if (result < min_value) return false;
+        value = result;
+        return true;
+    }
+
+    if (!names || token.size() != 3) return false;
+    std::string lower;
+    for (char c : token) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    // Month names start at 1, weekday names at 0
+    int base = (min_value == 1) ? 1 : 0;
+    for (int i = 0; names[i] != nullptr; ++i) {
+        if (lower == names[i]) {
+            value = i + base;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Month plus day-of-month/day-of-week check with the cron OR rule:
+ * when both day fields are restricted a day matches if either matches.
+ */
+bool CronExpression::dayMatches(const CronMask& mask, const std::tm& local_time) {
+    if (!((mask.months >> (local_time.tm_mon + 1)) & 1U)) {
+        return false;
+    }
+    bool dom = (mask.days_of_month >> local_time.tm_mday) & 1U;
+    bool dow = (mask.days_of_week >> local_time.tm_wday) & 1U;
+    if (mask.dom_restricted && mask.dow_restricted) {
+        return dom || dow;
+    }
+    return dom && dow;
+}
+
+/**
+ * Same rule as dayMatches() for a whole month at once: the weekday bits
+ * are spread over the days falling on them, then combined with the
+ * day-of-month bits and cut to the length of the month.
+ */
+uint32_t CronExpression::matchingDays(const CronMask& mask, int year, int month) {
+    int first_weekday = static_cast<int>((daysFromCivil(year, month, 1) % 7 + 11) % 7);   // 1970-01-01 was a Thursday
+    uint32_t weekdays = 0;
+    for (int w = 0; w < 7; ++w) {
+        if (!((mask.days_of_week >> w) & 1U)) continue;
+        for (int day = 1 + (w - first_weekday + 7) % 7; day <= 31; day += 7) {
+            weekdays |= 1U << day;
+        }
+    }
+    uint32_t days = (mask.dom_restricted && mask.dow_restricted)
+        ? (mask.days_of_month | weekdays)
+        : (mask.days_of_month & weekdays);
+    return days & ((2U << daysInMonth(year, month)) - 2);
+}
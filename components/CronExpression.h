@@ -0,0 +1,115 @@
+#ifndef CRON_EXPRESSION_H
+#define CRON_EXPRESSION_H
+
+#include <ctime>
+#include <string>
+#include "CronTypes.h"
+
+/**
+ * CronExpression Class - Cron syntax compiler and matcher
+ *
+ * Compiles the five textual cron fields into a CronMask and answers the
+ * two questions a scheduler needs: "does this mask match this minute?" and
+ * "when is the next minute it matches?".
+ *
+ * Supported field syntax (per field, comma separated lists allowed):
+ *   *        any value
+ *   N        single value
+ *   A-B      inclusive range
+ *   * /S     every S values (written without the space)
+ *   A-B/S    every S values inside a range
+ *   A/S      every S values from A to the field maximum
+ * Month (jan-dec) and weekday (sun-sat) names are accepted, 7 means Sunday.
+ */
+class CronExpression {
+public:
+    /**
+     * Upper bound of the next-fire search, in days. Eight years covers the
+     * longest gap between two February 29ths (across a non-leap century year).
+     */
+    static constexpr int MAX_SEARCH_DAYS = 8 * 366;
+
+    /**
+     * Compile a structured schedule into a mask
+     *
+     * @param schedule Textual schedule fields
+     * @param mask Output compiled mask
+     * @param error Output error message if compilation fails
+     * @return true if every field is valid
+     */
+    static bool compile(const CronSchedule& schedule, CronMask& mask, std::string& error);
+
+    /**
+     * Compile a classic five-field expression ("0 9 * * 1-5")
+     *
+     * @param expression Cron expression string
+     * @param mask Output compiled mask
+     * @param error Output error message if parsing fails
+     * @return true if the expression is valid
+     */
+    static bool parse(const std::string& expression, CronMask& mask, std::string& error);
+
+    /**
+     * Check whether a mask matches a point in local time (minute resolution)
+     *
+     * @param mask Compiled schedule
+     * @param local_time Broken-down local time
+     * @return true if the schedule fires in that minute
+     */
+    static bool matches(const CronMask& mask, const std::tm& local_time);
+
+    /**
+     * Compute the next fire time strictly after a given instant
+     *
+     * Jumps from one matching month to the next and to the matching days
+     * inside it with bit scans, so the search takes at most one step per
+     * month of the horizon (about a hundred), whatever the schedule.
+     *
+     * @param mask Compiled schedule
+     * @param after Reference instant (seconds since epoch)
+     * @return Start of the next matching local minute, or -1 if none was
+     *         found within the search horizon
+     */
+    static std::time_t nextFireTime(const CronMask& mask, std::time_t after);
+
+    /**
+     * Whether a mask can fire at all, decided from the masks alone
+     *
+     * Used by config validation to reject schedules such as "0 0 30 2 *"
+     * that would never run, and to flag those firing on February 29th only.
+     *
+     * @param mask Compiled schedule
+     * @return NEVER, LEAP_YEARS or REGULAR
+     */
+    static ScheduleReach reach(const CronMask& mask);
+
+    /**
+     * Human readable reason for a schedule that is not REGULAR
+     */
+    static std::string describeReach(ScheduleReach reach);
+
+private:
+    /**
+     * Parse one field into a bit set
+     */
+    static bool parseField(const std::string& field, int min_value, int max_value,
+                           const char* const* names, uint64_t& bits, std::string& error);
+
+    /**
+     * Parse a number or a three-letter name
+     */
+    static bool parseValue(const std::string& token, int min_value, int max_value,
+                           const char* const* names, int& value);
+
+    /**
+     * Day-level part of the match (month, day of month, day of week)
+     */
+    static bool dayMatches(const CronMask& mask, const std::tm& local_time);
+
+    /**
+     * Days of a month matching the day fields, as bits 1-31
+     */
+    static uint32_t matchingDays(const CronMask& mask, int year, int month);
+};
+
+#endif // CRON_EXPRESSION_H
@@ -0,0 +1,1232 @@
+/**
+ * @file CronScheduler.cpp
+ * @brief Heap-based in-process cron scheduler
+ *
+ * Jobs live in a slot vector indexed by ID. The heap only stores
+ * (fire time, slot, version) triples; replacing or removing a job bumps
+ * the slot version, which turns its old heap entries into tombstones that
+ * are discarded when they reach the top (or by a periodic compaction).
+ *
+ * A heap entry is due when its run must be dispatched: the fire time, or
+ * the prestart lead time earlier for jobs that prespawn their process.
+ *
+ * All of that lives in a Shard. By default there is one; with useShards()
+ * each job ID hashes to one of several, which share nothing on the
+ * dispatch path but the dispatch filter.
+ *
+ * A template job (CronJob::matrix) occupies one slot per instance; all of
+ * them point to the template's definition and live in its shard.
+ */
+
+#include "CronScheduler.h"
+#include "AllocTracker.h"
+#include "CronExpression.h"
+#include "EventBus.h"
+#include "JobExecutor.h"
+#include "JobMatrix.h"
+#include "MaskBatch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <pthread.h>
+#include <sched.h>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+/** Configurations at least this large are synced on one thread per shard */
+const size_t PARALLEL_SYNC_JOBS = 20000;
+
+/** upsertLocked() hint: compute the next fire time */
+const std::time_t NEXT_FIRE_UNKNOWN = -2;
+
+/**
+ * 64-bit FNV-1a of a job ID (stable shard assignment)
+ *
+ * Stops at '[' so that matrix instances ("backup[db=orders]") land in the
+ * shard of their template ("backup").
+ */
+uint64_t shardHash(const std::string& id) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : id) {
+        if (c == '[') break;
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Finished run reported back to the shard that owns its job
+ */
+struct Completion {
+    uint32_t slot;
+    uint32_t incarnation;
+    Completion* next;
+};
+
+/**
+ * Lock-free multi-producer list of completions: workers push, the shard
+ * takes the whole list at once (order does not matter)
+ */
+class CompletionQueue {
+public:
+    ~CompletionQueue() {
+        Completion* node = takeAll();
+        while (node) {
+            Completion* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    void push(Completion* node) {
+        node->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
+    }
+
+    Completion* takeAll() {
+        return head.load(std::memory_order_relaxed) ? head.exchange(nullptr, std::memory_order_acquire) : nullptr;
+    }
+
+private:
+    std::atomic<Completion*> head{nullptr};
+};
+
+} // namespace
+
+/**
+ * One partition of the jobs with everything needed to schedule them
+ */
+struct CronScheduler::Shard {
+    struct Slot {
+        std::shared_ptr<const ScheduledTask> task;
+        std::time_t next_fire = -1;
+        uint32_t version = 0;
+        bool live = false;
+        std::time_t prewarmed_fire = -1;   // Fire time already returned by collectPrewarm()
+        uint32_t running = 0;              // Dispatched runs not completed yet
+        uint32_t incarnation = 0;          // Bumped when the slot is freed (stale completions)
+    };
+
+    struct HeapEntry {
+        std::time_t when;       // Dispatch time (fire time minus the prestart lead)
+        uint32_t slot;
+        uint32_t version;
+    };
+
+    struct HeapLater {
+        bool operator()(const HeapEntry& a, const HeapEntry& b) const { return a.when > b.when; }
+    };
+
+    enum class Upsert { ADDED, RESCHEDULED, UPDATED };
+
+    /**
+     * Insert or replace a task. An existing entry with an identical mask
+     * keeps its next fire time.
+     */
+    Upsert upsertLocked(std::shared_ptr<const ScheduledTask> task, std::time_t now,
+                        std::time_t next_fire = NEXT_FIRE_UNKNOWN);
+    static bool sameSchedule(const Slot& slot, const CronJob& job);
+    void removeSlotLocked(uint32_t slot);
+    bool ownsInstance(uint32_t slot, const std::string& template_id) const;
+    void trackPrewarmLocked(uint32_t slot);
+    static std::time_t leadOf(const ScheduledTask& task);   // Dispatch this early (prestart) or late (stagger)
+    static std::time_t leadOf(const Slot& slot) { return leadOf(*slot.task); }
+    void scheduleLocked(uint32_t slot, std::time_t after);
+    void queueLocked(uint32_t slot, std::time_t next_fire);
+    void pruneLocked();
+    size_t collectDueLocked(std::time_t now, std::vector<ScheduledRun>& due);   // Appends
+    void drainCompletionsLocked();
+
+    mutable std::mutex mutex;
+    std::condition_variable wake_cv;
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<HeapEntry> heap;
+    std::unordered_map<std::string, std::vector<uint32_t>> config_groups;   // syncJobs() group -> slots
+    std::unordered_map<std::string, std::vector<uint32_t>> matrix_slots;    // Template ID -> instance slots
+    std::unordered_set<uint32_t> prewarm_slots;   // Command jobs with a prewarm lead time
+
+    std::vector<ScheduledRun> pending_runs;   // runPending() buffer
+    CronExecutor executor;
+    std::unique_ptr<WorkerPool> pool;
+    CompletionQueue completions;
+
+    std::thread thread;
+    bool ticking = false;
+};
+
+CronScheduler::CronScheduler() {
+    shards.push_back(std::make_shared<Shard>());
+}
+
+CronScheduler::~CronScheduler() {
+    stop();
+}
+
+CronScheduler::Shard& CronScheduler::shardFor(const std::string& id) const {
+    return shards.size() == 1 ? *shards[0] : *shards[shardHash(id) % shards.size()];
+}
+
+bool CronScheduler::addJob(const std::string& id, const std::string& expression,
+                           CronCallback callback, std::string& error) {
+    CronMask mask;
+    if (!CronExpression::parse(expression, mask, error)) {
+        return false;
+    }
+    if (CronExpression::reach(mask) == ScheduleReach::NEVER) {
+        error = "'" + expression + "' " + CronExpression::describeReach(ScheduleReach::NEVER);
+        return false;
+    }
+    return addJob(id, mask, std::move(callback));
+}
+
+bool CronScheduler::addJob(const std::string& id, const CronMask& mask, CronCallback callback) {
+    if (id.empty() || !callback) {
+        return false;
+    }
+    auto task = std::make_shared<ScheduledTask>();
+    task->id = id;
+    task->mask = mask;
+    task->callback = std::move(callback);
+
+    Shard& shard = shardFor(id);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.upsertLocked(std::move(task), std::time(nullptr));
+    }
+    shard.wake_cv.notify_all();
+    return true;
+}
+
+bool CronScheduler::addCommandJob(const CronJob& job, Logger& logger) {
+    if (job.id.empty() || job.mask.minutes == 0) {
+        return false;
+    }
+    Shard& shard = shardFor(job.id);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        SchedulerSyncStats stats;
+        std::vector<uint32_t> slots;
+        upsertCommandLocked(shard, std::make_shared<const CronJob>(job), logger, nullptr,
+                            std::time(nullptr), NEXT_FIRE_UNKNOWN, stats, slots);
+    }
+    shard.wake_cv.notify_all();
+    return true;
+}
+
+bool CronScheduler::removeJob(const std::string& id) {
+    Shard& shard = shardFor(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    bool removed = false;
+    auto it = shard.index.find(id);
+    if (it != shard.index.end()) {
+        shard.removeSlotLocked(it->second);
+        removed = true;
+    }
+    auto instances = shard.matrix_slots.find(id);
+    if (instances != shard.matrix_slots.end()) {
+        for (uint32_t slot : instances->second) {
+            if (shard.ownsInstance(slot, id)) {
+                shard.removeSlotLocked(slot);
+                removed = true;
+            }
+        }
+        shard.matrix_slots.erase(instances);
+    }
+    shard.pruneLocked();
+    return removed;
+}
+
+/**
+ * Diff a configuration snapshot against the registered command jobs
+ */
+SchedulerSyncStats CronScheduler::syncJobs(std::shared_ptr<const std::vector<CronJob>> jobs, Logger& logger,
+                                           const std::string& group) {
+    AllocScope scope(AllocTag::SCHEDULER);
+    SchedulerSyncStats stats;
+    if (!jobs) {
+        return stats;
+    }
+    std::time_t now = std::time(nullptr);
+
+    // Split the snapshot by shard; large ones are diffed on one thread per shard
+    std::vector<std::vector<const CronJob*>> parts(shards.size());
+    if (shards.size() > 1) {
+        for (auto& part : parts) {
+            part.reserve(jobs->size() / shards.size() + 16);
+        }
+    }
+    for (const auto& job : *jobs) {
+        parts[shards.size() == 1 ? 0 : shardHash(job.id) % shards.size()].push_back(&job);
+    }
+
+    std::vector<SchedulerSyncStats> shard_stats(shards.size());
+    if (shards.size() > 1 && jobs->size() >= PARALLEL_SYNC_JOBS) {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < shards.size(); ++i) {
+            workers.emplace_back([&, i] {
+                AllocScope worker_scope(AllocTag::SCHEDULER);
+                shard_stats[i] = syncShard(*shards[i], jobs, parts[i], logger, group, now);
+            });
+        }
+        shard_stats[0] = syncShard(*shards[0], jobs, parts[0], logger, group, now);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    } else {
+        for (size_t i = 0; i < shards.size(); ++i) {
+            shard_stats[i] = syncShard(*shards[i], jobs, parts[i], logger, group, now);
+        }
+    }
+
+    for (const auto& s : shard_stats) {
+        stats.added += s.added;
+        stats.rescheduled += s.rescheduled;
+        stats.updated += s.updated;
+        stats.removed += s.removed;
+    }
+    return stats;
+}
+
+SchedulerSyncStats CronScheduler::syncShard(Shard& shard, const std::shared_ptr<const std::vector<CronJob>>& jobs,
+                                            const std::vector<const CronJob*>& part, Logger& logger,
+                                            const std::string& group, std::time_t now) {
+    SchedulerSyncStats stats;
+
+    // First fire times of new and changed schedules, matched as one batch
+    // outside the lock
+    std::vector<std::time_t> next_fires;
+    if (part.size() >= MaskBatch::MIN_BATCH) {
+        std::vector<size_t> changed;
+        std::vector<const CronMask*> masks;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (size_t i = 0; i < part.size(); ++i) {
+                const CronJob& job = *part[i];
+                auto it = shard.index.find(job.id);
+                if (!job.id.empty() && job.mask.minutes != 0 &&
+                    (it == shard.index.end() || !Shard::sameSchedule(shard.slots[it->second], job))) {
+                    changed.push_back(i);
+                    masks.push_back(&job.mask);
+                }
+            }
+        }
+        if (masks.size() >= MaskBatch::MIN_BATCH) {
+            std::vector<std::time_t> batch = MaskBatch::nextFireTimes(masks, now);
+            next_fires.assign(part.size(), NEXT_FIRE_UNKNOWN);
+            for (size_t k = 0; k < changed.size(); ++k) {
+                next_fires[changed[k]] = batch[k];
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::vector<uint32_t>& group_slots = shard.config_groups[group];
+        std::vector<uint32_t> previous;
+        previous.swap(group_slots);
+        group_slots.reserve(part.size());
+
+        for (size_t i = 0; i < part.size(); ++i) {
+            const CronJob* job = part[i];
+            if (job->id.empty() || job->mask.minutes == 0) {
+                continue;
+            }
+            // Aliasing pointer: shares ownership of the whole snapshot
+            std::shared_ptr<const CronJob> definition(jobs, job);
+            std::time_t next_fire = next_fires.empty() ? NEXT_FIRE_UNKNOWN : next_fires[i];
+            upsertCommandLocked(shard, std::move(definition), logger, &group, now, next_fire, stats, group_slots);
+        }
+
+        // Only this group's previous slots are candidates for removal, so
+        // syncing one group costs O(group size), not O(all jobs)
+        std::sort(group_slots.begin(), group_slots.end());
+        for (uint32_t slot : previous) {
+            const Shard::Slot& s = shard.slots[slot];
+            if (s.live && s.task->from_config && s.task->group == group &&
+                !std::binary_search(group_slots.begin(), group_slots.end(), slot)) {
+                shard.removeSlotLocked(slot);
+                ++stats.removed;
+            }
+        }
+        if (group_slots.empty()) {
+            shard.config_groups.erase(group);
+        }
+        // Forget templates whose instances are all gone
+        for (auto it = shard.matrix_slots.begin(); it != shard.matrix_slots.end();) {
+            bool owned = std::any_of(it->second.begin(), it->second.end(), [&](uint32_t slot) {
+                return shard.ownsInstance(slot, it->first);
+            });
+            it = owned ? std::next(it) : shard.matrix_slots.erase(it);
+        }
+        shard.pruneLocked();
+    }
+
+    shard.wake_cv.notify_all();
+    return stats;
+}
+
+/**
+ * Apply an incremental batch to one configuration group
+ */
+SchedulerSyncStats CronScheduler::applyJobs(const std::vector<std::shared_ptr<const CronJob>>& upserts,
+                                            const std::vector<std::string>& removals, Logger& logger,
+                                            const std::string& group) {
+    AllocScope scope(AllocTag::SCHEDULER);
+    SchedulerSyncStats stats;
+    std::time_t now = std::time(nullptr);
+
+    for (const auto& id : removals) {
+        Shard& shard = shardFor(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(id);
+        if (it != shard.index.end()) {
+            const ScheduledTask& task = *shard.slots[it->second].task;
+            if (task.from_config && task.group == group) {
+                shard.removeSlotLocked(it->second);
+                ++stats.removed;
+            }
+        }
+        auto instances = shard.matrix_slots.find(id);
+        if (instances != shard.matrix_slots.end()) {
+            for (uint32_t slot : instances->second) {
+                if (shard.ownsInstance(slot, id) && shard.slots[slot].task->from_config &&
+                    shard.slots[slot].task->group == group) {
+                    shard.removeSlotLocked(slot);
+                    ++stats.removed;
+                }
+            }
+            shard.matrix_slots.erase(instances);
+        }
+    }
+
+    for (const auto& job : upserts) {
+        if (!job || job->id.empty() || job->mask.minutes == 0) {
+            continue;
+        }
+        Shard& shard = shardFor(job->id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        upsertCommandLocked(shard, job, logger, &group, now, NEXT_FIRE_UNKNOWN, stats, shard.config_groups[group]);
+    }
+
+    for (const auto& shard_ptr : shards) {
+        Shard& shard = *shard_ptr;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.config_groups.find(group);
+            if (it != shard.config_groups.end()) {
+                // Slots of removed jobs stay listed until the next compaction;
+                // syncJobs() checks ownership before trusting an entry
+                std::vector<uint32_t>& group_slots = it->second;
+                if (group_slots.size() > 2 * shard.index.size() + 64) {
+                    group_slots.erase(std::remove_if(group_slots.begin(), group_slots.end(), [&](uint32_t slot) {
+                        const Shard::Slot& s = shard.slots[slot];
+                        return !s.live || !s.task->from_config || s.task->group != group;
+                    }), group_slots.end());
+                    std::sort(group_slots.begin(), group_slots.end());
+                    group_slots.erase(std::unique(group_slots.begin(), group_slots.end()), group_slots.end());
+                }
+                if (group_slots.empty()) {
+                    shard.config_groups.erase(it);
+                }
+            }
+            shard.pruneLocked();
+        }
+        shard.wake_cv.notify_all();
+    }
+    return stats;
+}
+
+std::time_t CronScheduler::nextFireTime(const std::string& id) const {
+    Shard& shard = shardFor(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(id);
+    return it == shard.index.end() ? -1 : shard.slots[it->second].next_fire;
+}
+
+std::vector<std::pair<std::string, std::time_t>> CronScheduler::nextFireTimes() const {
+    std::vector<std::pair<std::string, std::time_t>> times;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        times.reserve(times.size() + shard->index.size());
+        for (const auto& entry : shard->index) {
+            times.emplace_back(entry.first, shard->slots[entry.second].next_fire);
+        }
+    }
+    return times;
+}
+
+bool CronScheduler::setNextFireTime(const std::string& id, std::time_t when) {
+    Shard& shard = shardFor(id);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(id);
+        if (it == shard.index.end() || when < 60) {
+            return false;
+        }
+        Shard::Slot& slot = shard.slots[it->second];
+        if (CronExpression::nextFireTime(slot.task->mask, when - 60) != when) {
+            return false;   // Not a fire time of this schedule (it changed meanwhile)
+        }
+        if (slot.next_fire != when) {
+            ++slot.version;
+            slot.next_fire = when;
+            shard.heap.push_back({when - Shard::leadOf(slot), it->second, slot.version});
+            std::push_heap(shard.heap.begin(), shard.heap.end(), Shard::HeapLater());
+            shard.pruneLocked();
+        }
+    }
+    shard.wake_cv.notify_all();
+    return true;
+}
+
+bool CronScheduler::deferRun(const std::string& id, std::time_t when) {
+    Shard& shard = shardFor(id);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(id);
+        if (it == shard.index.end()) {
+            return false;
+        }
+        Shard::Slot& slot = shard.slots[it->second];
+        if (slot.next_fire >= 0 && slot.next_fire <= when) {
+            return false;   // The schedule runs it again first
+        }
+        shard.queueLocked(it->second, when);
+        shard.pruneLocked();
+    }
+    shard.wake_cv.notify_all();
+    return true;
+}
+
+bool CronScheduler::submit(const std::string& id, std::function<void()> work) {
+    std::shared_ptr<Shard> shard = shards.size() == 1 ? shards[0] : shards[shardHash(id) % shards.size()];
+    // Held while handing over, so stop() cannot shut the pool down meanwhile
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    if (!shard->pool) {
+        return false;
+    }
+    Completion* done = nullptr;
+    auto it = shard->index.find(id);
+    if (it != shard->index.end()) {
+        Shard::Slot& slot = shard->slots[it->second];
+        slot.running++;
+        done = new Completion{it->second, slot.incarnation, nullptr};
+    }
+    bool queued = shard->pool->submit([work = std::move(work), shard, done] {
+        try {
+            work();
+        } catch (...) {
+            if (done) shard->completions.push(done);
+            throw;
+        }
+        if (done) shard->completions.push(done);
+    });
+    if (!queued && done) {
+        shard->completions.push(done);
+    }
+    return queued;
+}
+
+std::time_t CronScheduler::nextWakeTime() const {
+    std::time_t earliest = -1;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (!shard->heap.empty() && (earliest < 0 || shard->heap.front().when < earliest)) {
+            earliest = shard->heap.front().when;
+        }
+    }
+    return earliest;
+}
+
+size_t CronScheduler::collectPrewarm(std::time_t now, std::vector<ScheduledRun>& runs) {
+    runs.clear();
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (uint32_t slot_index : shard->prewarm_slots) {
+            Shard::Slot& slot = shard->slots[slot_index];
+            if (slot.next_fire < 0 || slot.prewarmed_fire == slot.next_fire ||
+                now < slot.next_fire - slot.task->job->prewarm_seconds) {
+                continue;
+            }
+            slot.prewarmed_fire = slot.next_fire;
+            runs.push_back(ScheduledRun{slot.task, slot.next_fire});
+        }
+    }
+    return runs.size();
+}
+
+std::time_t CronScheduler::nextPrewarmTime() const {
+    std::time_t earliest = -1;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (uint32_t slot_index : shard->prewarm_slots) {
+            const Shard::Slot& slot = shard->slots[slot_index];
+            if (slot.next_fire < 0 || slot.prewarmed_fire == slot.next_fire) {
+                continue;
+            }
+            std::time_t when = slot.next_fire - slot.task->job->prewarm_seconds;
+            if (earliest < 0 || when < earliest) {
+                earliest = when;
+            }
+        }
+    }
+    return earliest;
+}
+
+bool CronScheduler::hasJob(const std::string& id) const {
+    Shard& shard = shardFor(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.index.count(id) != 0;
+}
+
+size_t CronScheduler::size() const {
+    size_t count = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        count += shard->index.size();
+    }
+    return count;
+}
+
+size_t CronScheduler::inFlight() const {
+    size_t count = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        count += shard->pool ? shard->pool->pending() + shard->pool->active() : 0;
+    }
+    return count;
+}
+
+size_t CronScheduler::runningCount(const std::string& id) const {
+    Shard& shard = shardFor(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.drainCompletionsLocked();
+    auto it = shard.index.find(id);
+    return it == shard.index.end() ? 0 : shard.slots[it->second].running;
+}
+
+size_t CronScheduler::collectDue(std::time_t now, std::vector<ScheduledRun>& due) {
+    AllocScope scope(AllocTag::SCHEDULER);
+    due.clear();
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->collectDueLocked(now, due);
+    }
+    return due.size();
+}
+
+size_t CronScheduler::runPending(std::time_t now) {
+    size_t count = 0;
+    for (const auto& shard : shards) {
+        std::vector<ScheduledRun>& runs = shard->pending_runs;
+        {
+            AllocScope scope(AllocTag::SCHEDULER);
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->collectDueLocked(now, runs);
+        }
+        if (!runs.empty()) {
+            filterRuns(runs);
+            count += execute(shard, runs);
+            runs.clear();   // Release task references, keep capacity
+        }
+    }
+    return count;
+}
+
+size_t CronScheduler::collectMissed(const std::function<std::time_t(const std::string&)>& last_fire,
+                                    std::time_t now, std::time_t window, std::vector<ScheduledRun>& runs) {
+    runs.clear();
+    std::vector<std::shared_ptr<const ScheduledTask>> tasks;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        tasks.reserve(tasks.size() + shard->index.size());
+        for (const auto& entry : shard->index) {
+            tasks.push_back(shard->slots[entry.second].task);
+        }
+    }
+
+    // last_fire is caller code: run it without the scheduler lock
+    for (const auto& task : tasks) {
+        std::time_t from = std::max(now - window, last_fire(task->id));
+        std::time_t latest = -1;
+        for (std::time_t t = CronExpression::nextFireTime(task->mask, from);
+             t >= 0 && t <= now;
+             t = CronExpression::nextFireTime(task->mask, t)) {
+            latest = t;
+        }
+        if (latest >= 0) {
+            runs.push_back({task, latest});
+        }
+    }
+    return runs.size();
+}
+
+void CronScheduler::setExecutor(CronExecutor new_executor) {
+    std::lock_guard<std::mutex> lock(mutex);
+    shared_executor = new_executor;
+    pool_threads = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> shard_lock(shard->mutex);
+        shard->executor = new_executor;
+    }
+}
+
+void CronScheduler::setDispatchFilter(CronDispatchFilter filter) {
+    std::lock_guard<std::mutex> lock(mutex);
+    dispatch_filter = std::move(filter);
+}
+
+/**
+ * One pool per shard, the threads divided between them (at least one each)
+ */
+void CronScheduler::useWorkerPool(size_t threads) {
+    std::vector<std::unique_ptr<WorkerPool>> old_pools;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pool_threads = std::max<size_t>(threads, 1);
+        size_t per_shard = std::max<size_t>(1, (pool_threads + shards.size() - 1) / shards.size());
+        for (const auto& shard : shards) {
+            auto new_pool = std::make_unique<WorkerPool>(per_shard);
+            WorkerPool* raw = new_pool.get();
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            old_pools.push_back(std::move(shard->pool));
+            shard->pool = std::move(new_pool);
+            shard->executor = [raw](std::function<void()> work) { raw->submit(std::move(work)); };
+        }
+    }
+    // Old pools (if any) drain their queues here, outside the locks
+}
+
+bool CronScheduler::useShards(size_t count, bool pin) {
+    count = std::max<size_t>(count, 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) {
+            return false;
+        }
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            if (!shard->index.empty()) {
+                return false;
+            }
+        }
+        std::vector<std::shared_ptr<Shard>> fresh;
+        for (size_t i = 0; i < count; ++i) {
+            fresh.push_back(std::make_shared<Shard>());
+            fresh.back()->executor = shared_executor;
+        }
+        shards.swap(fresh);
+        pin_shards = pin;
+    }
+    if (pool_threads > 0) {
+        useWorkerPool(pool_threads);
+    }
+    return true;
+}
+
+size_t CronScheduler::shardCount() const {
+    return shards.size();
+}
+
+bool CronScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) {
+        return false;
+    }
+    running = true;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        {
+            std::lock_guard<std::mutex> shard_lock(shards[i]->mutex);
+            shards[i]->ticking = true;
+        }
+        shards[i]->thread = std::thread(&CronScheduler::threadLoop, this, shards[i], i);
+    }
+    return true;
+}
+
+void CronScheduler::stopThreads() {
+    // Joined without the settings lock: shard threads take it in filterRuns()
+    for (const auto& shard : shards) {
+        {
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            shard->ticking = false;
+        }
+        shard->wake_cv.notify_all();
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+}
+
+void CronScheduler::stop() {
+    stopThreads();
+
+    std::vector<std::unique_ptr<WorkerPool>> old_pools;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            old_pools.push_back(std::move(shard->pool));
+            shard->executor = nullptr;
+        }
+        shared_executor = nullptr;
+        pool_threads = 0;
+    }
+    for (auto& old_pool : old_pools) {
+        if (old_pool) {
+            old_pool->shutdown();
+        }
+    }
+}
+
+/**
+ * Insert a new task or replace the task of an existing ID
+ */
+CronScheduler::Shard::Upsert CronScheduler::Shard::upsertLocked(std::shared_ptr<const ScheduledTask> task,
+                                                                std::time_t now, std::time_t next_fire) {
+    auto it = index.find(task->id);
+    if (it != index.end()) {
+        Slot& slot = slots[it->second];
+        bool same_schedule = slot.task->mask == task->mask && leadOf(slot) == leadOf(*task);
+        slot.task = std::move(task);
+        trackPrewarmLocked(it->second);
+        if (same_schedule) {
+            return Upsert::UPDATED;   // Heap entry stays valid
+        }
+        if (next_fire != NEXT_FIRE_UNKNOWN) {
+            queueLocked(it->second, next_fire);
+        } else {
+            scheduleLocked(it->second, now);
+        }
+        return Upsert::RESCHEDULED;
+    }
+
+    uint32_t slot_index;
+    if (!free_slots.empty()) {
+        slot_index = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot_index = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+    Slot& slot = slots[slot_index];
+    index.emplace(task->id, slot_index);
+    slot.task = std::move(task);
+    slot.live = true;
+    trackPrewarmLocked(slot_index);
+    if (next_fire != NEXT_FIRE_UNKNOWN) {
+        queueLocked(slot_index, next_fire);
+    } else {
+        scheduleLocked(slot_index, now);
+    }
+    return Upsert::ADDED;
+}
+
+/**
+ * Whether replacing a slot's task with this job keeps its heap entry
+ */
+bool CronScheduler::Shard::sameSchedule(const Slot& slot, const CronJob& job) {
+    return slot.task->mask == job.mask && leadOf(slot) == job.prestart_seconds;
+}
+
+void CronScheduler::Shard::removeSlotLocked(uint32_t slot_index) {
+    Slot& slot = slots[slot_index];
+    index.erase(slot.task->id);
+    slot.task.reset();
+    slot.live = false;
+    slot.next_fire = -1;
+    slot.prewarmed_fire = -1;
+    slot.running = 0;
+    ++slot.version;       // Invalidate queued heap entries
+    ++slot.incarnation;   // and completions of runs still in flight
+    prewarm_slots.erase(slot_index);
+    free_slots.push_back(slot_index);
+}
+
+/**
+ * Whether a slot holds an instance of a template (slots are reused)
+ */
+bool CronScheduler::Shard::ownsInstance(uint32_t slot_index, const std::string& template_id) const {
+    const Slot& slot = slots[slot_index];
+    return slot.live && slot.task->job && slot.task->job->matrix && slot.task->job->id == template_id;
+}
+
+void CronScheduler::Shard::trackPrewarmLocked(uint32_t slot_index) {
+    const auto& job = slots[slot_index].task->job;
+    if (job && job->prewarm_seconds > 0) {
+        prewarm_slots.insert(slot_index);
+    } else {
+        prewarm_slots.erase(slot_index);
+    }
+}
+
+/**
+ * Compute the next fire time of a slot and queue it
+ */
+void CronScheduler::Shard::scheduleLocked(uint32_t slot_index, std::time_t after) {
+    queueLocked(slot_index, CronExpression::nextFireTime(slots[slot_index].task->mask, after));
+}
+
+/**
+ * Queue a slot at a known next fire time (-1: never)
+ */
+void CronScheduler::Shard::queueLocked(uint32_t slot_index, std::time_t next_fire) {
+    Slot& slot = slots[slot_index];
+    ++slot.version;
+    slot.next_fire = next_fire;
+    if (slot.next_fire < 0) {
+        return;   // Never fires within the search horizon
+    }
+    heap.push_back({slot.next_fire - leadOf(slot), slot_index, slot.version});
+    std::push_heap(heap.begin(), heap.end(), HeapLater());
+}
+
+std::time_t CronScheduler::Shard::leadOf(const ScheduledTask& task) {
+    return (task.job ? task.job->prestart_seconds : 0) - task.delay_seconds;
+}
+
+/**
+ * Drop tombstones from the top of the heap and compact it when stale
+ * entries dominate, so nextWakeTime() always reports a live job
+ */
+void CronScheduler::Shard::pruneLocked() {
+    if (heap.size() > 2 * index.size() + 64) {
+        heap.erase(std::remove_if(heap.begin(), heap.end(), [this](const HeapEntry& e) {
+            const Slot& s = slots[e.slot];
+            return !s.live || s.version != e.version;
+        }), heap.end());
+        std::make_heap(heap.begin(), heap.end(), HeapLater());
+    }
+    while (!heap.empty()) {
+        const HeapEntry& top = heap.front();
+        const Slot& s = slots[top.slot];
+        if (s.live && s.version == top.version) {
+            break;
+        }
+        std::pop_heap(heap.begin(), heap.end(), HeapLater());
+        heap.pop_back();
+    }
+}
+
+size_t CronScheduler::Shard::collectDueLocked(std::time_t now, std::vector<ScheduledRun>& due) {
+    drainCompletionsLocked();
+    size_t before = due.size();
+    while (!heap.empty() && heap.front().when <= now) {
+        HeapEntry entry = heap.front();
+        std::pop_heap(heap.begin(), heap.end(), HeapLater());
+        heap.pop_back();
+
+        Slot& slot = slots[entry.slot];
+        if (!slot.live || slot.version != entry.version) {
+            continue;   // Tombstone
+        }
+
+        due.push_back({slot.task, slot.next_fire});
+        // Missed fires (e.g. after a suspend) are coalesced into this one run
+        scheduleLocked(entry.slot, std::max(now, slot.next_fire));
+        if (EventBus::active()) {
+            EventBus::publish("scheduled", slot.task->id, {{"next_fire", slot.next_fire}});
+        }
+    }
+    pruneLocked();
+    return due.size() - before;
+}
+
+/**
+ * Account the runs that finished since the last call
+ */
+void CronScheduler::Shard::drainCompletionsLocked() {
+    Completion* node = completions.takeAll();
+    while (node) {
+        if (node->slot < slots.size()) {
+            Slot& slot = slots[node->slot];
+            if (slot.incarnation == node->incarnation && slot.running > 0) {
+                slot.running--;
+            }
+        }
+        Completion* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+/**
+ * Run the dispatch filter; shard threads take turns
+ */
+void CronScheduler::filterRuns(std::vector<ScheduledRun>& runs) {
+    CronDispatchFilter filter;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        filter = dispatch_filter;
+    }
+    if (filter) {
+        std::lock_guard<std::mutex> lock(filter_mutex);
+        filter(runs);
+    }
+}
+
+size_t CronScheduler::dispatch(std::vector<ScheduledRun>& runs) {
+    filterRuns(runs);
+    if (shards.size() == 1) {
+        return execute(shards[0], runs);
+    }
+    std::vector<std::vector<ScheduledRun>> by_shard(shards.size());
+    for (auto& run : runs) {
+        by_shard[shardHash(run.id()) % shards.size()].push_back(run);
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (!by_shard[i].empty()) {
+            count += execute(shards[i], by_shard[i]);
+        }
+    }
+    return count;
+}
+
+/**
+ * Hand runs of one shard to its executor; each run reports its completion
+ * back to the shard when the job body returns. Runs of one bundle due at
+ * the same time share a work item, so they occupy a single worker.
+ */
+size_t CronScheduler::execute(const std::shared_ptr<Shard>& shard, std::vector<ScheduledRun>& runs) {
+    CronExecutor exec;
+    std::vector<std::pair<uint32_t, uint32_t>> tickets;   // (slot, incarnation) per run
+    tickets.reserve(runs.size());
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        exec = shard->executor;
+        for (const auto& run : runs) {
+            auto it = shard->index.find(run.id());
+            if (it == shard->index.end()) {
+                tickets.emplace_back(UINT32_MAX, 0);   // Removed meanwhile
+                continue;
+            }
+            Shard::Slot& slot = shard->slots[it->second];
+            slot.running++;
+            tickets.emplace_back(it->second, slot.incarnation);
+        }
+    }
+    if (EventBus::active()) {
+        for (const auto& run : runs) {
+            EventBus::publish("dispatched", run.id(), {{"scheduled_time", run.scheduled_time}});
+        }
+    }
+
+    std::vector<size_t> bundled;   // Allocated only when a bundle is due
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const std::shared_ptr<const CronJob>& job = runs[i].task->job;
+        // Bundle shells run as the daemon: a job with a user always runs on its own
+        if (job && !job->bundle.empty() && job->user.empty() && runs[i].task->logger) {
+            bundled.push_back(i);
+        }
+    }
+
+    size_t next_bundled = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (next_bundled < bundled.size() && bundled[next_bundled] == i) {
+            ++next_bundled;
+            continue;
+        }
+        auto work = [run = runs[i], shard, ticket = tickets[i]] {
+            Completion* done = ticket.first == UINT32_MAX ? nullptr
+                                                          : new Completion{ticket.first, ticket.second, nullptr};
+            try {
+                run.task->callback(run);
+            } catch (...) {
+                if (done) shard->completions.push(done);
+                throw;
+            }
+            if (done) shard->completions.push(done);
+        };
+        if (exec) {
+            exec(std::move(work));
+        } else {
+            work();
+        }
+    }
+
+    auto effective = [&runs](size_t i) { return runs[i].scheduled_time + runs[i].task->delay_seconds; };
+    std::sort(bundled.begin(), bundled.end(), [&](size_t a, size_t b) {
+        int order = runs[a].task->job->bundle.compare(runs[b].task->job->bundle);
+        return order != 0 ? order < 0 : (effective(a) != effective(b) ? effective(a) < effective(b) : a < b);
+    });
+    for (size_t begin = 0; begin < bundled.size();) {
+        size_t end = begin + 1;
+        while (end < bundled.size() &&
+               runs[bundled[end]].task->job->bundle == runs[bundled[begin]].task->job->bundle &&
+               effective(bundled[end]) == effective(bundled[begin])) {
+            ++end;
+        }
+        std::vector<ScheduledRun> group;
+        std::vector<std::pair<uint32_t, uint32_t>> group_tickets;
+        for (size_t k = begin; k < end; ++k) {
+            group.push_back(runs[bundled[k]]);
+            group_tickets.push_back(tickets[bundled[k]]);
+        }
+        begin = end;
+
+        auto work = [group = std::move(group), shard, group_tickets = std::move(group_tickets)] {
+            auto complete = [&] {
+                for (const auto& ticket : group_tickets) {
+                    if (ticket.first != UINT32_MAX) {
+                        shard->completions.push(new Completion{ticket.first, ticket.second, nullptr});
+                    }
+                }
+            };
+            std::vector<CronJob> jobs;
+            jobs.reserve(group.size());
+            for (const auto& run : group) {
+                const ScheduledTask& task = *run.task;
+                jobs.push_back(task.job->matrix ? task.job->matrix->materialize(*task.job, task.instance)
+                                                : *task.job);
+            }
+            try {
+                JobExecutor::executeBundle(jobs.front().bundle, jobs, *group.front().task->logger);
+            } catch (...) {
+                complete();
+                throw;
+            }
+            complete();
+        };
+        if (exec) {
+            exec(std::move(work));
+        } else {
+            work();
+        }
+    }
+    return runs.size();
+}
+
+/**
+ * Internal thread of one shard: sleep until its earliest fire time (or a
+ * change notification), then collect and dispatch its due runs
+ */
+void CronScheduler::threadLoop(std::shared_ptr<Shard> shard, size_t number) {
+    if (pin_shards && shards.size() > 1) {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(number % cores, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);   // Best effort (cpusets may refuse)
+    }
+
+    std::vector<ScheduledRun> runs;
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    while (shard->ticking) {
+        if (shard->heap.empty()) {
+            shard->wake_cv.wait(lock);
+        } else {
+            auto deadline = std::chrono::system_clock::from_time_t(shard->heap.front().when);
+            shard->wake_cv.wait_until(lock, deadline);
+        }
+        if (!shard->ticking) {
+            break;
+        }
+
+        std::time_t now = std::time(nullptr);
+        if (shard->heap.empty() || shard->heap.front().when > now) {
+            continue;
+        }
+        shard->collectDueLocked(now, runs);
+        lock.unlock();
+        filterRuns(runs);
+        execute(shard, runs);
+        runs.clear();
+        lock.lock();
+    }
+}
+
+std::shared_ptr<const ScheduledTask> CronScheduler::makeCommandTask(std::shared_ptr<const CronJob> definition,
+                                                                   Logger& logger, const std::string* group,
+                                                                   size_t instance) {
+    auto task = std::make_shared<ScheduledTask>();
+    Logger* log = &logger;
+    task->mask = definition->mask;
+    task->job = definition;
+    task->logger = log;
+    task->from_config = group != nullptr;
+    if (group) {
+        task->group = *group;
+    }
+    if (definition->matrix) {
+        // The instance's command line exists only while it runs
+        int delay = definition->matrix_stagger ? definition->matrix->staggerSeconds(instance) : 0;
+        task->id = definition->matrix->instanceId(definition->id, instance);
+        task->instance = instance;
+        task->delay_seconds = delay;
+        task->callback = [definition, log, instance, delay](const ScheduledRun& run) {
+            CronJob job = definition->matrix->materialize(*definition, instance);
+            JobExecutor::executeJob(job, *log, run.scheduled_time + delay);
+        };
+        return task;
+    }
+    task->id = definition->id;
+    task->callback = [definition, log](const ScheduledRun& run) {
+        JobExecutor::executeJob(*definition, *log, run.scheduled_time);
+    };
+    return task;
+}
+
+void CronScheduler::upsertCommandLocked(Shard& shard, std::shared_ptr<const CronJob> definition, Logger& logger,
+                                        const std::string* group, std::time_t now, std::time_t next_fire,
+                                        SchedulerSyncStats& stats, std::vector<uint32_t>& slots) {
+    auto count = [&stats](Shard::Upsert result) {
+        switch (result) {
+            case Shard::Upsert::ADDED:       ++stats.added; break;
+            case Shard::Upsert::RESCHEDULED: ++stats.rescheduled; break;
+            case Shard::Upsert::UPDATED:     ++stats.updated; break;
+        }
+    };
+    const std::string id = definition->id;
+    std::vector<uint32_t> previous;   // Instances registered for this ID so far
+    auto templ = shard.matrix_slots.find(id);
+    if (templ != shard.matrix_slots.end()) {
+        previous.swap(templ->second);
+        shard.matrix_slots.erase(templ);
+    }
+
+    std::vector<uint32_t> instances;
+    if (!definition->matrix) {
+        count(shard.upsertLocked(makeCommandTask(std::move(definition), logger, group), now, next_fire));
+        slots.push_back(shard.index[id]);
+    } else {
+        auto plain = shard.index.find(id);
+        if (plain != shard.index.end()) {
+            shard.removeSlotLocked(plain->second);   // Was a plain job until now
+            ++stats.removed;
+        }
+        if (next_fire == NEXT_FIRE_UNKNOWN) {
+            next_fire = CronExpression::nextFireTime(definition->mask, now);   // Same schedule for every instance
+        }
+        size_t count_instances = definition->matrix->size();
+        instances.reserve(count_instances);
+        for (size_t instance = 0; instance < count_instances; ++instance) {
+            auto task = makeCommandTask(definition, logger, group, instance);
+            const std::string& instance_id = task->id;
+            count(shard.upsertLocked(task, now, next_fire));
+            instances.push_back(shard.index[instance_id]);
+        }
+        slots.insert(slots.end(), instances.begin(), instances.end());
+        std::sort(instances.begin(), instances.end());
+    }
+
+    for (uint32_t slot : previous) {
+        if (shard.ownsInstance(slot, id) && !std::binary_search(instances.begin(), instances.end(), slot)) {
+            shard.removeSlotLocked(slot);
+            ++stats.removed;
+        }
+    }
+    if (!instances.empty()) {
+        shard.matrix_slots.emplace(id, std::move(instances));
+    }
+}
@@ -0,0 +1,402 @@
+#ifndef CRON_SCHEDULER_H
+#define CRON_SCHEDULER_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CronTypes.h"
+#include "Logger.h"
+#include "WorkerPool.h"
+
+struct ScheduledRun;
+
+/**
+ * Job body invoked when a schedule fires
+ */
+using CronCallback = std::function<void(const ScheduledRun&)>;
+
+/**
+ * Executor that runs a dispatched job body (thread pool, event loop, ...)
+ */
+using CronExecutor = std::function<void(std::function<void()>)>;
+
+/**
+ * Hook run on every batch of due runs before execution; may drop runs by
+ * erasing them from the vector (leader election, deduplication, ...)
+ */
+using CronDispatchFilter = std::function<void(std::vector<ScheduledRun>&)>;
+
+/**
+ * STRUCT: Registered job (immutable once published)
+ */
+struct ScheduledTask {
+    std::string id;                        // Unique job ID
+    CronMask mask;                         // Compiled schedule
+    CronCallback callback;                 // Job body
+    std::shared_ptr<const CronJob> job;    // Source definition for command jobs, null for callbacks
+    bool from_config = false;              // Owned by syncJobs() (daemon configuration)
+    std::string group;                     // syncJobs() group that owns it ("" = main config)
+    size_t instance = 0;                   // Matrix instance of a template job (job->matrix)
+    int delay_seconds = 0;                 // Dispatched this long after each fire time (staggered instance)
+    Logger* logger = nullptr;              // Executor logger of command jobs
+};
+
+/**
+ * STRUCT: One due execution handed to a callback
+ */
+struct ScheduledRun {
+    std::shared_ptr<const ScheduledTask> task;  // Job that fired
+    std::time_t scheduled_time = 0;             // Minute the run was due for
+
+    const std::string& id() const { return task->id; }
+};
+
+/**
+ * STRUCT: Outcome of a configuration sync
+ */
+struct SchedulerSyncStats {
+    size_t added = 0;          // New job IDs
+    size_t rescheduled = 0;    // Existing IDs whose schedule changed
+    size_t updated = 0;        // Existing IDs with same schedule (next fire kept)
+    size_t removed = 0;        // IDs no longer in the configuration
+};
+
+/**
+ * CronScheduler Class - Embeddable in-process cron scheduler
+ *
+ * Keeps every job in a min-heap ordered by next fire time, so a tick costs
+ * O(due jobs * log n) instead of a scan of the whole job list, and the next
+ * wake-up time is known without polling. Jobs are either shell commands
+ * (executed through JobExecutor) or arbitrary callbacks.
+ *
+ * Due jobs run on the configured executor: inline on the ticking thread by
+ * default, on an internal WorkerPool (useWorkerPool) or on any caller
+ * supplied executor (setExecutor). The scheduler can be driven manually
+ * with runPending()/collectDue() or by its own thread with start().
+ *
+ * Command jobs with a CronJob::bundle that are due at the same time in
+ * the same shard are handed to the executor as one work item, which runs
+ * them through JobExecutor::executeBundle.
+ *
+ * For very large configurations useShards() partitions the jobs so that
+ * a top-of-the-hour burst is collected and dispatched by one thread per
+ * core instead of a single one.
+ *
+ * All public methods are thread-safe. Callbacks are invoked without the
+ * scheduler lock held, so they may add or remove jobs.
+ */
+class CronScheduler {
+public:
+    CronScheduler();
+    ~CronScheduler();
+
+    CronScheduler(const CronScheduler&) = delete;
+    CronScheduler& operator=(const CronScheduler&) = delete;
+
+    /**
+     * Register (or replace) a callback job from a cron expression
+     *
+     * @param id Unique job ID
+     * @param expression Five-field cron expression ("0 9 * * 1-5")
+     * @param callback Job body
+     * @param error Output error message if the expression is invalid or
+     *              can never fire ("0 0 30 2 *")
+     * @return true if the job was registered
+     */
+    bool addJob(const std::string& id, const std::string& expression,
+                CronCallback callback, std::string& error);
+
+    /**
+     * Register (or replace) a callback job from a compiled mask
+     */
+    bool addJob(const std::string& id, const CronMask& mask, CronCallback callback);
+
+    /**
+     * Register (or replace) a shell command job; runs JobExecutor::executeJob
+     *
+     * A template (CronJob::matrix) registers one job per instance, with the
+     * IDs of JobMatrix::instanceId(); its own ID only removes them all.
+     *
+     * @param job Job definition with compiled mask and ID
+     * @param logger Logger used by the executor (must outlive the scheduler)
+     * @return false if the job has no ID or no valid schedule
+     */
+    bool addCommandJob(const CronJob& job, Logger& logger);
+
+    /**
+     * Unregister a job (every instance, given the ID of a template)
+     * @return true if the job existed
+     */
+    bool removeJob(const std::string& id);
+
+    /**
+     * Replace the configuration-owned command jobs of one group with a new snapshot
+     *
+     * Jobs are matched by ID: unchanged schedules keep their next fire time,
+     * changed schedules are recomputed, IDs of this group missing from the
+     * snapshot are removed. Other groups and jobs added through addJob()
+     * are left alone, so independent job files (the main jobs.json, one
+     * spool file per user) can be synced separately.
+     *
+     * Tasks point into the snapshot instead of copying each CronJob, so the
+     * snapshot stays alive until the next sync replaces them. The instances
+     * of a template share its definition and are materialized
+     * (JobMatrix::materialize) only when they run.
+     *
+     * @param jobs New configuration snapshot (empty removes the whole group)
+     * @param logger Logger used by the executor (must outlive the scheduler)
+     * @param group Owner of the snapshot ("" = main configuration)
+     * @return Counts of added/rescheduled/updated/removed jobs
+     */
+    SchedulerSyncStats syncJobs(std::shared_ptr<const std::vector<CronJob>> jobs, Logger& logger,
+                                const std::string& group = "");
+    
+    /**
+     * Apply a batch of changes to the configuration-owned jobs of one group
+     *
+     * Unlike syncJobs() only the listed IDs are touched, so the cost is
+     * O(batch) whatever the size of the group. Upserts keep their next
+     * fire time when the schedule is unchanged; removals ignore IDs that
+     * are unknown or belong to another group.
+     *
+     * @param upserts Jobs to add or replace
+     * @param removals IDs to unregister
+     * @param logger Logger used by the executor (must outlive the scheduler)
+     * @param group Owner of the jobs ("" = main configuration)
+     * @return Counts of added/rescheduled/updated/removed jobs
+     */
+    SchedulerSyncStats applyJobs(const std::vector<std::shared_ptr<const CronJob>>& upserts,
+                                 const std::vector<std::string>& removals, Logger& logger,
+                                 const std::string& group = "");
+
+    /**
+     * Next fire time of a job
+     * @return Seconds since epoch, or -1 for unknown IDs and never-firing schedules
+     */
+    std::time_t nextFireTime(const std::string& id) const;
+
+    /**
+     * Next fire time of every registered job (handed to the new image on upgrade)
+     */
+    std::vector<std::pair<std::string, std::time_t>> nextFireTimes() const;
+
+    /**
+     * Move the next fire of a job to an earlier or later fire time of its schedule
+     *
+     * Used to resume a schedule saved by nextFireTimes(): a time already in
+     * the past makes the run due at once instead of skipping it.
+     *
+     * @return false if the ID is unknown or `when` does not match its schedule
+     */
+    bool setNextFireTime(const std::string& id, std::time_t when);
+
+    /**
+     * Fire a job once more at `when`, outside its schedule
+     *
+     * Used to retry a run refused by a "defer" quota. The schedule resumes
+     * after that run; nothing changes if a regular fire comes first.
+     *
+     * @return false if the ID is unknown or its next fire is not later than `when`
+     */
+    bool deferRun(const std::string& id, std::time_t when);
+
+    /**
+     * Run more work of a job on its shard's worker pool, counted like a
+     * dispatched run of it
+     *
+     * Used to supervise a prestart run once released, so no worker waits
+     * through its lead time.
+     *
+     * @return false without a pool (useWorkerPool() not called, or stopped)
+     */
+    bool submit(const std::string& id, std::function<void()> work);
+
+    /**
+     * Earliest next dispatch time over all jobs (a prestart job is
+     * dispatched its lead time before it fires)
+     * @return Seconds since epoch, or -1 if nothing is scheduled
+     */
+    std::time_t nextWakeTime() const;
+
+    /**
+     * Command jobs with a prewarm lead time whose next fire is now within it
+     *
+     * Each fire time is returned once. Only jobs with CronJob::prewarm_seconds
+     * are looked at, so the cost does not depend on the size of the schedule.
+     *
+     * @param now Current time (seconds since epoch)
+     * @param runs Output runs with the fire time they prepare (cleared first)
+     * @return Number of runs
+     */
+    size_t collectPrewarm(std::time_t now, std::vector<ScheduledRun>& runs);
+
+    /**
+     * Earliest time collectPrewarm() has something to return
+     * @return Seconds since epoch, or -1 if no job asks for prewarming
+     */
+    std::time_t nextPrewarmTime() const;
+
+    /**
+     * @return true if a job with this ID is registered
+     */
+    bool hasJob(const std::string& id) const;
+
+    /**
+     * Number of registered jobs
+     */
+    size_t size() const;
+
+    /**
+     * Runs queued on or executing in the internal worker pool (0 without one)
+     */
+    size_t inFlight() const;
+
+    /**
+     * Pop every run due at or before `now` and reschedule its job
+     *
+     * Does not execute anything. Reuses the capacity of `due`, so steady
+     * state ticks do not allocate.
+     *
+     * @param now Current time (seconds since epoch)
+     * @param due Output runs (cleared first)
+     * @return Number of due runs
+     */
+    size_t collectDue(std::time_t now, std::vector<ScheduledRun>& due);
+
+    /**
+     * Collect and dispatch every run due at or before `now`
+     *
+     * Must not be called concurrently with itself or with start().
+     *
+     * @param now Current time (seconds since epoch)
+     * @return Number of dispatched runs
+     */
+    size_t runPending(std::time_t now);
+
+    /**
+     * Find runs that were due in a past window but never dispatched
+     *
+     * For each job, only the latest fire time in
+     * (max(now - window, last_fire(id)), now] is returned, so a long outage
+     * costs one catch-up run per job. Does not touch the schedule.
+     *
+     * @param last_fire Latest already dispatched time of a job (-1 if none)
+     * @param now Current time (seconds since epoch)
+     * @param window Maximum age of a catch-up run in seconds
+     * @param runs Output runs (cleared first)
+     * @return Number of missed runs
+     */
+    size_t collectMissed(const std::function<std::time_t(const std::string&)>& last_fire,
+                         std::time_t now, std::time_t window, std::vector<ScheduledRun>& runs);
+
+    /**
+     * Pass runs through the dispatch filter and execute the remaining ones
+     * on the configured executor
+     *
+     * @param runs Runs to execute (filtered in place)
+     * @return Number of executed runs
+     */
+    size_t dispatch(std::vector<ScheduledRun>& runs);
+
+    /**
+     * Run due jobs on a caller-provided executor (empty = inline)
+     */
+    void setExecutor(CronExecutor executor);
+
+    /**
+     * Run due jobs on an internal pool of `threads` workers
+     */
+    void useWorkerPool(size_t threads);
+
+    /**
+     * Install a filter applied to every batch before execution (empty = none)
+     */
+    void setDispatchFilter(CronDispatchFilter filter);
+
+    /**
+     * Split the jobs over `count` shards by a hash of their ID
+     *
+     * Each shard has its own lock, heap, job slots, worker pool (the
+     * useWorkerPool() threads divided between the shards) and, after
+     * start(), its own scheduling thread, pinned to a core if `pin` is
+     * set. Completions come back to the owning shard through a lock-free
+     * queue. Must be called before any job is added.
+     *
+     * @return false if jobs are registered or the scheduler is running
+     */
+    bool useShards(size_t count, bool pin = true);
+
+    /**
+     * Number of shards (1 unless useShards() was called)
+     */
+    size_t shardCount() const;
+
+    /**
+     * Runs of a job dispatched and not completed yet
+     */
+    size_t runningCount(const std::string& id) const;
+
+    /**
+     * Start the internal scheduling thread (one per shard)
+     * @return false if already running
+     */
+    bool start();
+
+    /**
+     * Stop the scheduling threads only: nothing new is dispatched, runs
+     * already dispatched continue (daemon drain, upgrade)
+     */
+    void stopThreads();
+
+    /**
+     * Stop the internal threads and the internal worker pools (if any)
+     */
+    void stop();
+
+private:
+    struct Shard;   // Jobs, heap, lock, pool and thread of one partition (CronScheduler.cpp)
+
+    Shard& shardFor(const std::string& id) const;
+    void filterRuns(std::vector<ScheduledRun>& runs);
+    size_t execute(const std::shared_ptr<Shard>& shard, std::vector<ScheduledRun>& runs);
+    SchedulerSyncStats syncShard(Shard& shard, const std::shared_ptr<const std::vector<CronJob>>& jobs,
+                                 const std::vector<const CronJob*>& part, Logger& logger,
+                                 const std::string& group, std::time_t now);
+    void threadLoop(std::shared_ptr<Shard> shard, size_t number);
+
+    /**
+     * @param group syncJobs() group, or null for jobs added with addCommandJob()
+     * @param instance Matrix instance when the job is a template
+     */
+    static std::shared_ptr<const ScheduledTask> makeCommandTask(std::shared_ptr<const CronJob> job,
+                                                                Logger& logger, const std::string* group,
+                                                                size_t instance = 0);
+
+    /**
+     * Register a command job, or every instance of a template, in its shard
+     * and remove the instances a template no longer has
+     *
+     * @param next_fire First fire time if known (shared by all instances)
+     * @param slots Receives the slots of the registered jobs
+     */
+    static void upsertCommandLocked(Shard& shard, std::shared_ptr<const CronJob> job, Logger& logger,
+                                    const std::string* group, std::time_t now, std::time_t next_fire,
+                                    SchedulerSyncStats& stats, std::vector<uint32_t>& slots);
+
+    std::vector<std::shared_ptr<Shard>> shards;   // At least one; fixed while jobs are registered
+    bool pin_shards = false;
+
+    mutable std::mutex mutex;             // Guards the settings below, not the jobs
+    CronExecutor shared_executor;         // setExecutor() value, applied to every shard
+    size_t pool_threads = 0;              // useWorkerPool() size (0 = not used)
+    CronDispatchFilter dispatch_filter;
+    std::mutex filter_mutex;              // Shard threads run the filter one at a time
+    bool running = false;
+};
+
+#endif // CRON_SCHEDULER_H
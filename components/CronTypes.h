@@ -3,6 +3,11 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+class JobMatrix;
 
 /**
  * ENUM: Supported execution frequencies
@@ -27,6 +32,42 @@ enum class LogLevel {
     SUCCESS     // Operations completed successfully
 };
 
+/**
+ * ENUM: How a job is executed
+ */
+enum class JobType {
+    COMMAND,    // Shell command run in a child process
+    PLUGIN,     // Shared object called in-process (see nanocron_plugin.h)
+    PIPELINE    // Stages run together, each stage's stdout piped to the next
+};
+
+/**
+ * ENUM: When a pipeline job counts as failed
+ */
+enum class PipelineFailure {
+    ANY,        // Any stage failed (like pipefail); the others run to their end
+    LAST,       // Only the last stage counts (like a plain shell pipeline)
+    ABORT       // Any stage failed, and the first failure stops every stage
+};
+
+/**
+ * ENUM: What happens to a run once its quota is exhausted
+ */
+enum class QuotaAction {
+    SKIP,       // Not run (the next fire checks again)
+    DEFER,      // Run as soon as the window has room again
+    DOWNGRADE   // Run at the lowest CPU priority
+};
+
+/**
+ * ENUM: Whether a compiled schedule can fire at all (CronExpression::reach)
+ */
+enum class ScheduleReach {
+    NEVER,          // No month has a matching day (e.g. February 30th)
+    LEAP_YEARS,     // Only February 29th matches, once every four years
+    REGULAR         // Matches in every year
+};
+
 /**
  * STRUCT: System Conditions for Job Execution
  */
@@ -40,6 +81,28 @@ struct JobConditions {
     JobConditions() = default;
 };
 
+/**
+ * STRUCT: One stage of a pipeline job
+ */
+struct PipelineStage {
+    std::string command;        // Shell command of the stage
+    int timeout_seconds = 0;    // Stage timeout (0 = the job's)
+    int cpu_limit_seconds = 0;  // RLIMIT_CPU (0 = the job's)
+    int memory_limit_mb = 0;    // RLIMIT_AS (0 = the job's)
+};
+
+/**
+ * STRUCT: Rolling-window quota of a job ("quota" in JSON)
+ */
+struct JobQuota {
+    int window_seconds = 0;     // 3600 ("hour") or 86400 ("day"); 0 = no quota
+    int runs = 0;               // Runs started per window (0 = unlimited)
+    int64_t cpu_seconds = 0;    // User + system CPU time per window (0 = unlimited)
+    int64_t wall_seconds = 0;   // Wall-clock run time per window (0 = unlimited)
+    std::string group;          // Counters shared by every job naming the group ("" = the job's own)
+    QuotaAction action = QuotaAction::SKIP;
+};
+
 /**
  * STRUCT: Cron Schedule (supports cron-like syntax)
  */
@@ -51,14 +114,62 @@ struct CronSchedule {
     std::string day_of_week;   // Day of week (0-7, *, etc.)
 };
 
+/**
+ * STRUCT: Compiled cron schedule (one bit per allowed value)
+ * 
+ * Produced once from the textual CronSchedule at load time so that matching
+ * a job against a point in time is a handful of bit tests.
+ */
+struct CronMask {
+    uint64_t minutes = 0;          // Bits 0-59
+    uint32_t hours = 0;            // Bits 0-23
+    uint32_t days_of_month = 0;    // Bits 1-31
+    uint16_t months = 0;           // Bits 1-12
+    uint8_t days_of_week = 0;      // Bits 0-6 (Sunday = 0, 7 is folded to 0)
+    bool dom_restricted = false;   // day_of_month was not "*" (cron OR rule)
+    bool dow_restricted = false;   // day_of_week was not "*" (cron OR rule)
+    
+    constexpr bool operator==(const CronMask& other) const {
+        return minutes == other.minutes && hours == other.hours &&
+               days_of_month == other.days_of_month && months == other.months &&
+               days_of_week == other.days_of_week &&
+               dom_restricted == other.dom_restricted && dow_restricted == other.dow_restricted;
+    }
+    constexpr bool operator!=(const CronMask& other) const { return !(*this == other); }
+};
+
 /**
  * STRUCT: Enhanced Cron Job Definition with JSON support
  */
 struct CronJob {
+    std::string id;             // Stable job ID ("id" in JSON, derived if absent)
     std::string description;    // Job description
     CronSchedule schedule;      // Cron-like schedule
-    std::string command;        // Command to execute
+    CronMask mask;              // Compiled form of schedule
+    std::string command;        // Command to execute (pipelines: the stages joined with " | ")
     JobConditions conditions;   // Optional execution conditions
+    JobType type = JobType::COMMAND;  // Execution method ("type" in JSON)
+    std::string plugin_path;    // Shared object for plugin jobs
+    std::string plugin_arg;     // Argument string passed to the plugin
+    bool plugin_isolate = false; // Run the plugin in a forked child process
+    int timeout_seconds = 300;  // Maximum execution time
+    int idle_timeout_seconds = 0;   // Killed as hung after this long without output or heartbeat (0 = off)
+    std::string heartbeat_file; // File the job touches to show progress ("heartbeat", "" = output only)
+    bool remote = false;        // Run on a nanoCronAgent ("executor": "agent")
+    std::string user;           // Account the job runs as ("" = the daemon's, spool jobs = file owner)
+    std::vector<std::string> env;   // Extra environment, "KEY=value" ("env" object in JSON)
+    int cpu_limit_seconds = 0;  // RLIMIT_CPU of the job process (0 = unlimited)
+    int memory_limit_mb = 0;    // RLIMIT_AS of the job process (0 = unlimited)
+    int prewarm_seconds = 0;    // Warm the job's files this long before each fire (0 = off)
+    std::vector<std::string> prewarm_paths; // Data files or directories warmed with the program
+    int prestart_seconds = 0;   // Fork this long before each fire, exec exactly on time (0 = off)
+    std::shared_ptr<const JobMatrix> matrix;   // Template: one instance per parameter combination (null = plain job)
+    bool matrix_stagger = false;    // Spread the instances of a template over the fire minute
+    std::string bundle;         // Runs of the same fire time share one worker shell ("" = own process)
+    std::vector<PipelineStage> stages;  // Pipeline jobs: stages in data flow order
+    PipelineFailure pipeline_failure = PipelineFailure::ANY;   // "failure" in JSON
+    bool pipeline_relay = false;        // Connect the stages through the daemon (splice), counting bytes
+    JobQuota quota;             // Rolling-window limits (quota.window_seconds 0 = none)
     
     // Legacy fields for backward compatibility
     int hour;               // Will be parsed from schedule.hour
@@ -0,0 +1,319 @@
+/**
+ * @file EventBus.cpp
+ * @brief Job lifecycle events pushed to control socket subscribers
+ */
+
+#include "EventBus.h"
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const EVENT_NAMES[] = {"scheduled", "dispatched", "skipped", "deferred", "started", "finished", "reload"};
+constexpr size_t EVENT_COUNT = sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]);
+
+struct Subscriber {
+    int fd = -1;
+    unsigned events = 0;            // Bit per EVENT_NAMES entry
+    std::vector<std::string> jobs;  // Job or template IDs (empty = every job)
+    bool output = false;            // Keep the output tail in finished events
+    std::string pending;            // Lines not written yet
+    bool dropped = false;           // Queue overflowed
+    bool closed = false;            // Peer gone or write failed
+};
+
+std::mutex g_mutex;
+std::vector<std::unique_ptr<Subscriber>> g_subscribers;   // Removed by the sender thread only
+std::atomic<size_t> g_count{0};
+std::atomic<bool> g_running{false};
+std::thread g_thread;
+int g_wake[2] = {-1, -1};
+Logger* g_logger = nullptr;
+
+int eventIndex(const std::string& name) {
+    for (size_t i = 0; i < EVENT_COUNT; ++i) {
+        if (name == EVENT_NAMES[i]) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool wantsJob(const Subscriber& subscriber, const std::string& id) {
+    if (subscriber.jobs.empty() || id.empty()) {
+        return true;
+    }
+    for (const std::string& job : subscriber.jobs) {
+        if (id == job || (id.size() > job.size() && id[job.size()] == '[' && id.compare(0, job.size(), job) == 0)) {
+            return true;   // The job itself or an instance of the template
+        }
+    }
+    return false;
+}
+
+void wake() {
+    char byte = 1;
+    ssize_t ignored = write(g_wake[1], &byte, 1);
+    (void)ignored;
+}
+
+std::string formatLine(const nlohmann::json& event) {
+    return event.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n";
+}
+
+/**
+ * Write as much of the queue as the socket takes without blocking
+ */
+void flush(Subscriber& subscriber) {
+    size_t sent = 0;
+    while (sent < subscriber.pending.size()) {
+        ssize_t n = send(subscriber.fd, subscriber.pending.data() + sent, subscriber.pending.size() - sent,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            subscriber.closed = true;
+        }
+        break;
+    }
+    subscriber.pending.erase(0, sent);
+}
+
+/**
+ * Close subscribers that overflowed or went away
+ */
+void removeGoneLocked() {
+    size_t kept = 0;
+    for (size_t i = 0; i < g_subscribers.size(); ++i) {
+        Subscriber& subscriber = *g_subscribers[i];
+        if (subscriber.dropped && !subscriber.closed) {
+            const char notice[] = "{\"event\":\"dropped\",\"reason\":\"queue full\"}\n";
+            ssize_t ignored = send(subscriber.fd, notice, sizeof(notice) - 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+            (void)ignored;
+            g_logger->warning("EventBus: subscriber dropped, more than " + std::to_string(EventBus::MAX_QUEUE_BYTES) +
+                              " bytes of events queued");
+        }
+        if (subscriber.dropped || subscriber.closed) {
+            close(subscriber.fd);
+            continue;
+        }
+        if (kept != i) {
+            g_subscribers[kept] = std::move(g_subscribers[i]);
+        }
+        kept++;
+    }
+    g_subscribers.resize(kept);
+    g_count.store(kept);
+}
+
+/**
+ * Sender thread: write queued events, notice subscribers that hang up
+ */
+void senderLoop() {
+    std::vector<struct pollfd> fds;
+    std::vector<Subscriber*> polled;
+    char discard[4096];
+
+    while (g_running.load()) {
+        fds.clear();
+        polled.clear();
+        fds.push_back({g_wake[0], POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            removeGoneLocked();
+            for (const auto& subscriber : g_subscribers) {
+                short wanted = subscriber->pending.empty() ? POLLIN : POLLIN | POLLOUT;
+                fds.push_back({subscriber->fd, wanted, 0});
+                polled.push_back(subscriber.get());
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            g_logger->error(std::string("EventBus: poll failed: ") + std::strerror(errno));
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            while (read(g_wake[0], discard, sizeof(discard)) > 0) {}
+        }
+
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (size_t i = 0; i < polled.size(); ++i) {
+            Subscriber& subscriber = *polled[i];
+            short revents = fds[i + 1].revents;
+            if (revents & POLLIN) {
+                // Subscribers have nothing more to say; read only to notice EOF
+                ssize_t n = recv(subscriber.fd, discard, sizeof(discard), MSG_DONTWAIT);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    subscriber.closed = true;
+                }
+            } else if (revents & (POLLHUP | POLLERR)) {
+                subscriber.closed = true;
+            }
+            if (!subscriber.closed && !subscriber.dropped && !subscriber.pending.empty()) {
+                flush(subscriber);
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool EventBus::start(Logger& logger, std::string& error) {
+    if (g_running.load()) {
+        return true;
+    }
+    if (pipe2(g_wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+        error = std::string("pipe failed: ") + std::strerror(errno);
+        return false;
+    }
+    g_logger = &logger;
+    g_running.store(true);
+    g_thread = std::thread(senderLoop);
+    return true;
+}
+
+void EventBus::stop() {
+    if (!g_running.exchange(false)) {
+        return;
+    }
+    wake();
+    if (g_thread.joinable()) {
+        g_thread.join();
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (const auto& subscriber : g_subscribers) {
+        close(subscriber->fd);
+    }
+    g_subscribers.clear();
+    g_count.store(0);
+    close(g_wake[0]);
+    close(g_wake[1]);
+    g_wake[0] = g_wake[1] = -1;
+}
+
+bool EventBus::active() {
+    return g_count.load(std::memory_order_relaxed) > 0;
+}
+
+bool EventBus::subscribe(int fd, const nlohmann::json& request, std::string& error) {
+    auto subscriber = std::make_unique<Subscriber>();
+    subscriber->fd = fd;
+    nlohmann::json names = nlohmann::json::array();
+    if (request.contains("events")) {
+        bool valid = request["events"].is_array() && !request["events"].empty();
+        for (const auto& name : valid ? request["events"] : nlohmann::json::array()) {
+            int index = name.is_string() ? eventIndex(name.get<std::string>()) : -1;
+            valid = valid && index >= 0;
+            if (valid) {
+                subscriber->events |= 1u << index;
+            }
+        }
+        if (!valid) {
+            error = "\"events\" must list event names (scheduled, dispatched, skipped, deferred, started, finished, reload)";
+            return false;
+        }
+    } else {
+        subscriber->events = (1u << EVENT_COUNT) - 1;
+    }
+    for (size_t i = 0; i < EVENT_COUNT; ++i) {
+        if (subscriber->events & (1u << i)) {
+            names.push_back(EVENT_NAMES[i]);
+        }
+    }
+    if (request.contains("jobs")) {
+        bool valid = request["jobs"].is_array();
+        for (const auto& id : valid ? request["jobs"] : nlohmann::json::array()) {
+            valid = valid && id.is_string() && !id.get<std::string>().empty();
+            if (valid) {
+                subscriber->jobs.push_back(id.get<std::string>());
+            }
+        }
+        if (!valid) {
+            error = "\"jobs\" must be an array of job IDs";
+            return false;
+        }
+    }
+    if (request.contains("output")) {
+        if (!request["output"].is_boolean()) {
+            error = "\"output\" must be true or false";
+            return false;
+        }
+        subscriber->output = request["output"].get<bool>();
+    }
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_running.load()) {
+        error = "event stream is not running";
+        return false;
+    }
+    if (g_subscribers.size() >= MAX_SUBSCRIBERS) {
+        error = "too many subscribers (" + std::to_string(MAX_SUBSCRIBERS) + ")";
+        return false;
+    }
+    subscriber->pending = formatLine({{"ok", true}, {"events", names}});
+    g_subscribers.push_back(std::move(subscriber));
+    g_count.store(g_subscribers.size());
+    wake();
+    return true;
+}
+
+void EventBus::publish(const char* type, const std::string& job_id, nlohmann::json fields) {
+    if (!active()) {
+        return;
+    }
+    int index = eventIndex(type);
+    if (index < 0) {
+        return;
+    }
+    fields["event"] = type;
+    fields["time_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!job_id.empty()) {
+        fields["job"] = job_id;
+    }
+    std::string full = formatLine(fields);
+    std::string brief;
+    if (fields.contains("output")) {
+        fields.erase("output");
+        brief = formatLine(fields);
+    } else {
+        brief = full;
+    }
+
+    bool queued = false;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (const auto& subscriber : g_subscribers) {
+        if (subscriber->dropped || subscriber->closed || !(subscriber->events & (1u << index)) ||
+            !wantsJob(*subscriber, job_id)) {
+            continue;
+        }
+        const std::string& line = subscriber->output ? full : brief;
+        if (subscriber->pending.size() + line.size() > MAX_QUEUE_BYTES) {
+            subscriber->dropped = true;   // Closed by the sender thread
+            subscriber->pending.clear();
+        } else {
+            subscriber->pending += line;
+        }
+        queued = true;
+    }
+    if (queued) {
+        wake();
+    }
+}
+
+size_t EventBus::subscriberCount() {
+    return g_count.load();
+}
@@ -0,0 +1,79 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <cstddef>
+#include <string>
+#include "Logger.h"
+#include "json.hpp"
+
+/**
+ * EventBus Class - Push stream of job lifecycle events
+ *
+ * A control socket client that sends `events.subscribe` stops being a
+ * request/reply connection and receives one JSON object per line for
+ * every event it asked for:
+ *
+ *   scheduled   next fire time of a job after it fired
+ *   dispatched  run handed to the executor
+ *   skipped     run dropped before it started (user concurrency limit, quota)
+ *   deferred    run postponed until its quota window frees up
+ *   started     process forked, pipeline or plugin started, or sent to an agent
+ *   finished    outcome (success, failed, signal, timeout, hung, cancelled,
+ *               not_started) with duration and rusage
+ *   reload      result of a jobs.json, spool or control socket change
+ *
+ * Publishers never wait for subscribers: an event is formatted once and
+ * appended to each subscriber's queue, which a single sender thread
+ * writes out. A subscriber whose queue exceeds MAX_QUEUE_BYTES is sent a
+ * final "dropped" event (best effort) and disconnected. Without
+ * subscribers publishing costs one atomic load, so callers check
+ * active() before building an event.
+ */
+class EventBus {
+public:
+    static constexpr size_t MAX_SUBSCRIBERS = 64;
+    static constexpr size_t MAX_QUEUE_BYTES = 1024 * 1024;
+
+    /**
+     * Start the sender thread
+     */
+    static bool start(Logger& logger, std::string& error);
+
+    /**
+     * Disconnect every subscriber and stop the sender thread
+     */
+    static void stop();
+
+    /**
+     * @return true while at least one subscriber is connected
+     */
+    static bool active();
+
+    /**
+     * Turn a control connection into a subscriber
+     *
+     * Request fields: "events" (names, default all), "jobs" (IDs; a
+     * template ID also matches its instances), "output" (include the
+     * output tail in finished events). On success the bus owns fd and
+     * sends the reply; on failure fd is left to the caller.
+     *
+     * @return false with error if the request is invalid or the bus is full
+     */
+    static bool subscribe(int fd, const nlohmann::json& request, std::string& error);
+
+    /**
+     * Queue an event for every interested subscriber
+     *
+     * @param type Event name (see the class comment)
+     * @param job_id Job the event is about ("" for reload events)
+     * @param fields Event fields; "event", "time_ms" and "job" are added
+     */
+    static void publish(const char* type, const std::string& job_id, nlohmann::json fields);
+
+    /**
+     * Number of connected subscribers
+     */
+    static size_t subscriberCount();
+};
+
+#endif // EVENT_BUS_H
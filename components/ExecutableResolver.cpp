@@ -0,0 +1,356 @@
+/**
+ * @file ExecutableResolver.cpp
+ * @brief Cached PATH lookup of job executables with inotify invalidation
+ */
+
+#include "ExecutableResolver.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/** What /bin/sh searches when PATH is unset */
+const char* DEFAULT_PATH = "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin";
+
+const uint32_t DIR_EVENTS = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+                            IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_MASK_ADD;
+const uint32_t PARENT_EVENTS = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR | IN_MASK_ADD;
+
+/**
+ * Characters that give a command line a meaning only the shell knows
+ */
+bool isShellSyntax(char c) {
+    return std::strchr("|&;<>()$`\\\"'*?[]{}\n", c) != nullptr;
+}
+
+/**
+ * Keywords and builtins without an equivalent program (state of the shell itself)
+ */
+bool isShellBuiltin(const std::string& word) {
+    static const std::unordered_set<std::string> builtins = {
+        "!", "case", "do", "done", "elif", "else", "esac", "fi", "for", "if", "in", "then", "until", "while",
+        ".", ":", "alias", "bg", "break", "cd", "command", "continue", "eval", "exec", "exit", "export",
+        "fc", "fg", "getopts", "hash", "jobs", "local", "read", "readonly", "return", "set", "shift",
+        "source", "times", "trap", "type", "ulimit", "umask", "unalias", "unset", "wait"
+    };
+    return builtins.count(word) > 0;
+}
+
+/**
+ * Split a command into words if /bin/sh would do nothing but that
+ */
+bool splitSimpleCommand(const std::string& command, std::vector<std::string>& words) {
+    words.clear();
+    std::string word;
+    for (char c : command) {
+        if (isShellSyntax(c)) {
+            return false;
+        }
+        if (c == ' ' || c == '\t') {
+            if (!word.empty()) {
+                words.push_back(std::move(word));
+                word.clear();
+            }
+        } else {
+            if (word.empty() && (c == '#' || c == '~')) {
+                return false;   // Comment, home directory expansion
+            }
+            word += c;
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return !words.empty() && words[0].find('=') == std::string::npos && !isShellBuiltin(words[0]);
+}
+
+/**
+ * Program a shell command line starts with ("" if it is not a plain word)
+ */
+std::string firstProgram(const std::string& command) {
+    size_t start = command.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = command.find_first_of(" \t\n|&;<>()", start);
+    std::string word = command.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    for (char c : word) {
+        if (isShellSyntax(c) || c == '=') {
+            return "";
+        }
+    }
+    if (word[0] == '#' || word[0] == '~' || isShellBuiltin(word)) {
+        return "";
+    }
+    return word;
+}
+
+bool isExecutableFile(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(path.c_str(), X_OK) == 0;
+}
+
+std::string parentOf(const std::string& dir) {
+    size_t slash = dir.find_last_of('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : dir.substr(0, slash);
+}
+
+} // namespace
+
+ExecutableResolver::ExecutableResolver(Logger& loggerRef) : logger(loggerRef) {}
+
+ExecutableResolver::~ExecutableResolver() {
+    stop();
+}
+
+bool ExecutableResolver::start() {
+    const char* path = std::getenv("PATH");
+    std::string list = path ? path : DEFAULT_PATH;
+    path_dirs.clear();
+    size_t begin = 0;
+    while (true) {
+        size_t colon = list.find(':', begin);
+        std::string dir = list.substr(begin, colon == std::string::npos ? std::string::npos : colon - begin);
+        path_dirs.push_back(dir.empty() ? "." : dir);
+        if (colon == std::string::npos) {
+            break;
+        }
+        begin = colon + 1;
+    }
+    char buffer[4096];
+    cwd = getcwd(buffer, sizeof(buffer)) ? buffer : "";
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        logger.error("ExecutableResolver: inotify_init1 failed: " + std::string(std::strerror(errno)) +
+                     ", executables are looked up on every run");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        addWatches();
+        caching = true;
+        logger.info("ExecutableResolver: watching " + std::to_string(watched.size()) + " of " +
+                    std::to_string(path_dirs.size()) + " PATH directories");
+    }
+
+    shouldStop.store(false);
+    watcherThread = std::thread(&ExecutableResolver::watchLoop, this);
+    return true;
+}
+
+void ExecutableResolver::stop() {
+    shouldStop.store(true);
+    if (watcherThread.joinable()) {
+        watcherThread.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    caching = false;
+    cache.clear();
+    watched.clear();
+    watch_dirs.clear();
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+}
+
+bool ExecutableResolver::resolvable(const CronJob& job) const {
+    if (job.type != JobType::COMMAND || job.remote || !job.user.empty()) {
+        return false;
+    }
+    for (const auto& var : job.env) {
+        if (var.compare(0, 5, "PATH=") == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ExecutableResolver::argvFor(const CronJob& job, std::vector<std::string>& argv) {
+    std::vector<std::string> words;
+    if (!resolvable(job) || !splitSimpleCommand(job.command, words)) {
+        return false;
+    }
+    std::string& program = words[0];
+    if (program.find('/') == std::string::npos) {
+        std::string path = lookup(program);
+        if (path.empty()) {
+            return false;   // Let the shell report "not found" as before
+        }
+        program = path;
+    } else if (program.compare(0, 2, "./") == 0 && !cwd.empty()) {
+        program = cwd + "/" + program.substr(2);
+    }
+    argv = std::move(words);
+    return true;
+}
+
+bool ExecutableResolver::check(const CronJob& job, std::string& missing) {
+    if (job.type != JobType::COMMAND || job.remote) {
+        return true;
+    }
+    std::string program = firstProgram(job.command);
+    if (program.empty()) {
+        return true;
+    }
+    if (program.find('/') == std::string::npos) {
+        // A user's login PATH or a PATH from "env" is not ours to search
+        if (!resolvable(job) || !lookup(program).empty()) {
+            return true;
+        }
+    } else if (program[0] == '/') {
+        if (isExecutableFile(program)) {
+            return true;
+        }
+    } else if (!job.user.empty() || isExecutableFile(cwd.empty() ? program : cwd + "/" + program)) {
+        return true;   // Relative paths of user jobs start from their home directory
+    }
+    missing = program;
+    return false;
+}
+
+std::string ExecutableResolver::programOf(const CronJob& job) {
+    if (job.type != JobType::COMMAND || job.remote) {
+        return "";
+    }
+    std::string program = firstProgram(job.command);
+    if (program.empty()) {
+        return "";
+    }
+    if (program.find('/') == std::string::npos) {
+        return resolvable(job) ? lookup(program) : "";
+    }
+    if (program[0] == '/') {
+        return program;
+    }
+    return job.user.empty() && !cwd.empty() ? cwd + "/" + program : "";
+}
+
+std::string ExecutableResolver::lookup(const std::string& name) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = cache.find(name);
+    if (it != cache.end()) {
+        hit_count++;
+        return it->second;
+    }
+    uint64_t seen = generation;
+    lock.unlock();
+
+    miss_count++;
+    std::string path = search(name);
+
+    lock.lock();
+    // An event during the search may already be stale for this result
+    if (caching && generation == seen) {
+        cache.emplace(name, path);
+    }
+    return path;
+}
+
+std::string ExecutableResolver::search(const std::string& name) const {
+    for (const auto& dir : path_dirs) {
+        std::string candidate = dir + "/" + name;
+        if (isExecutableFile(candidate)) {
+            if (candidate[0] != '/' && !cwd.empty()) {
+                candidate = cwd + "/" + candidate;
+            }
+            return candidate;
+        }
+    }
+    return "";
+}
+
+bool ExecutableResolver::addWatches() {
+    bool added = false;
+    for (const auto& dir : path_dirs) {
+        if (watched.count(dir)) {
+            continue;
+        }
+        int wd = inotify_add_watch(inotifyFd, dir.c_str(), DIR_EVENTS);
+        if (wd >= 0) {
+            watched.insert(dir);
+            watch_dirs[wd].push_back(dir);
+            added = true;
+            continue;
+        }
+        // Not there (yet): its creation shows up in the parent directory
+        wd = inotify_add_watch(inotifyFd, parentOf(dir).c_str(), PARENT_EVENTS);
+        if (wd >= 0) {
+            watch_dirs[wd];
+        }
+    }
+    return added;
+}
+
+void ExecutableResolver::invalidate(const std::string& name) {
+    if (cache.erase(name) > 0) {
+        invalidation_count++;
+    }
+    generation++;
+}
+
+void ExecutableResolver::invalidateAll() {
+    invalidation_count += cache.size();
+    cache.clear();
+    generation++;
+}
+
+void ExecutableResolver::watchLoop() {
+    alignas(struct inotify_event) char buffer[8192];
+
+    while (!shouldStop.load()) {
+        struct pollfd pfd = {inotifyFd, POLLIN, 0};
+        int rc = poll(&pfd, 1, 1000);
+        if (rc < 0 && errno != EINTR) {
+            logger.error("ExecutableResolver: poll failed: " + std::string(std::strerror(errno)));
+            std::lock_guard<std::mutex> lock(mutex);
+            caching = false;   // Nothing would invalidate the cache any more
+            invalidateAll();
+            break;
+        }
+        if (rc <= 0) {
+            continue;
+        }
+
+        ssize_t n;
+        while ((n = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (char* p = buffer; p < buffer + n;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    invalidateAll();
+                } else if (event->mask & IN_IGNORED) {
+                    // A PATH directory went away: watch for its return instead
+                    auto it = watch_dirs.find(event->wd);
+                    if (it != watch_dirs.end()) {
+                        for (const auto& dir : it->second) {
+                            watched.erase(dir);
+                        }
+                        watch_dirs.erase(it);
+                    }
+                    invalidateAll();
+                    addWatches();
+                } else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    invalidateAll();
+                } else if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                    if (addWatches()) {
+                        invalidateAll();   // Names cached as missing may live there
+                    }
+                } else if (event->len > 0) {
+                    invalidate(event->name);
+                }
+            }
+        }
+    }
+}
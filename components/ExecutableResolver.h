@@ -0,0 +1,119 @@
+#ifndef EXECUTABLE_RESOLVER_H
+#define EXECUTABLE_RESOLVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "CronTypes.h"
+#include "Logger.h"
+
+/**
+ * ExecutableResolver Class - Cached PATH lookup of job executables
+ *
+ * Commands without shell syntax ("/usr/bin/backup --full", "rsync -a a b")
+ * are split into words and executed directly, with the program resolved
+ * to an absolute path, instead of through /bin/sh -c and its PATH search.
+ * Anything else (pipes, redirections, quotes, variables, globbing, shell
+ * builtins, "VAR=x cmd") still goes through the shell.
+ *
+ * Lookups are cached by program name, misses included. Every PATH
+ * directory is watched with inotify and an event on a name drops only
+ * that name's entry; a PATH directory that does not exist yet is found
+ * through a watch on its parent. Between events a lookup costs one hash
+ * probe and no system call.
+ *
+ * Only jobs run with the daemon's own environment are resolved: jobs with
+ * a "user" (login PATH, home directory as working directory), jobs that
+ * set PATH in "env" and agent jobs (resolved on the agent's host) keep
+ * using the shell.
+ */
+class ExecutableResolver {
+public:
+    explicit ExecutableResolver(Logger& logger);
+    ~ExecutableResolver();
+
+    ExecutableResolver(const ExecutableResolver&) = delete;
+    ExecutableResolver& operator=(const ExecutableResolver&) = delete;
+
+    /**
+     * Read PATH and the working directory, watch the PATH directories and
+     * start the watcher thread
+     * @return false if inotify is unavailable (lookups then are not cached)
+     */
+    bool start();
+
+    /**
+     * Stop the watcher thread
+     */
+    void stop();
+
+    /**
+     * Direct-exec argv of a job
+     *
+     * @param job Job to run
+     * @param argv Output argv, argv[0] an absolute or relative path
+     * @return false if the job must run through the shell
+     */
+    bool argvFor(const CronJob& job, std::vector<std::string>& argv);
+
+    /**
+     * Check that the program a job starts exists (called on each load)
+     *
+     * For shell commands the first word is checked when it is a plain
+     * program name or path.
+     *
+     * @param job Job to check
+     * @param missing Output program that was not found
+     * @return false if the program cannot be found or is not executable
+     */
+    bool check(const CronJob& job, std::string& missing);
+
+    /**
+     * Path of the program a command job starts ("" if unknown: shell
+     * syntax first, builtin, not found, or a PATH that is not ours)
+     */
+    std::string programOf(const CronJob& job);
+
+    /**
+     * Absolute path of a program name searched in PATH ("" = not found)
+     */
+    std::string lookup(const std::string& name);
+
+    uint64_t hits() const { return hit_count.load(); }
+    uint64_t misses() const { return miss_count.load(); }
+    uint64_t invalidations() const { return invalidation_count.load(); }
+
+private:
+    bool resolvable(const CronJob& job) const;
+    std::string search(const std::string& name) const;
+    bool addWatches();
+    void invalidate(const std::string& name);
+    void invalidateAll();
+    void watchLoop();
+
+    Logger& logger;
+    std::vector<std::string> path_dirs;   // PATH entries, "" replaced by "."
+    std::string cwd;                      // Daemon working directory for "./" commands
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::string> cache;   // Program name -> path ("" = not found)
+    uint64_t generation = 0;                              // Bumped by every invalidation
+    bool caching = false;                                 // Only while invalidation events arrive
+    std::unordered_set<std::string> watched;              // PATH directories with a watch
+    std::unordered_map<int, std::vector<std::string>> watch_dirs;   // Watch -> PATH directories ({} = parent of a missing one)
+
+    std::atomic<uint64_t> hit_count{0};
+    std::atomic<uint64_t> miss_count{0};
+    std::atomic<uint64_t> invalidation_count{0};
+
+    int inotifyFd = -1;
+    std::atomic<bool> shouldStop{false};
+    std::thread watcherThread;
+};
+
+#endif // EXECUTABLE_RESOLVER_H
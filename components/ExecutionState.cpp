@@ -0,0 +1,99 @@
+/**
+ * @file ExecutionState.cpp
+ * @brief Crash-safe persistence of the last dispatched run per job
+ */
+
+#include "ExecutionState.h"
+#include "json.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+ExecutionState::ExecutionState(const std::string& path) : statePath(path) {}
+
+bool ExecutionState::load(std::string& error) {
+    last_fire.clear();
+    updated_at = -1;
+    owner.clear();
+    owner_epoch = 0;
+
+    std::ifstream file(statePath);
+    if (!file.is_open()) {
+        if (errno == ENOENT) {
+            return true;   // First start: no history
+        }
+        error = "Cannot open state file " + statePath + ": " + std::strerror(errno);
+        return false;
+    }
+
+    try {
+        json data;
+        file >> data;
+        updated_at = data.value("updated", static_cast<std::time_t>(-1));
+        owner = data.value("holder", std::string());
+        owner_epoch = data.value("epoch", static_cast<uint64_t>(0));
+        if (data.contains("last_fire") && data["last_fire"].is_object()) {
+            for (const auto& item : data["last_fire"].items()) {
+                last_fire[item.key()] = item.value().get<std::time_t>();
+            }
+        }
+    } catch (const std::exception& e) {
+        last_fire.clear();
+        updated_at = -1;
+        error = "Corrupted state file " + statePath + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+bool ExecutionState::save(std::string& error) {
+    std::time_t now = std::time(nullptr);
+    json data;
+    data["updated"] = now;
+    data["holder"] = owner;
+    data["epoch"] = owner_epoch;
+    data["last_fire"] = json::object();
+    for (const auto& entry : last_fire) {
+        data["last_fire"][entry.first] = entry.second;
+    }
+    std::string text = data.dump() + "\n";
+
+    std::string tmpPath = statePath + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "Cannot write " + tmpPath + ": " + std::strerror(errno);
+        return false;
+    }
+    bool ok = write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size()) && fsync(fd) == 0;
+    int saved_errno = errno;
+    close(fd);
+    if (!ok || std::rename(tmpPath.c_str(), statePath.c_str()) != 0) {
+        error = "Cannot save state file " + statePath + ": " + std::strerror(ok ? errno : saved_errno);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    updated_at = now;
+    return true;
+}
+
+std::time_t ExecutionState::lastFire(const std::string& id) const {
+    auto it = last_fire.find(id);
+    return it == last_fire.end() ? -1 : it->second;
+}
+
+void ExecutionState::recordFire(const std::string& id, std::time_t scheduled_time) {
+    std::time_t& slot = last_fire.emplace(id, -1).first->second;
+    if (scheduled_time > slot) {
+        slot = scheduled_time;
+    }
+}
+
+void ExecutionState::setOwner(const std::string& holder, uint64_t epoch) {
+    owner = holder;
+    owner_epoch = epoch;
+}
@@ -0,0 +1,73 @@
+#ifndef EXECUTION_STATE_H
+#define EXECUTION_STATE_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+
+/**
+ * ExecutionState Class - Persisted record of dispatched runs for failover
+ *
+ * Stores, per job ID, the latest scheduled minute that was dispatched, plus
+ * the time of the last save. The leader records a run and saves the file
+ * *before* executing it, so a standby taking over knows exactly which runs
+ * already happened (no duplicates) and that every fire time after the last
+ * save was missed (no losses).
+ *
+ * The file is JSON written to a temporary file, fsync'ed and renamed over
+ * the old one, so readers never see a partial state.
+ */
+class ExecutionState {
+public:
+    explicit ExecutionState(const std::string& path);
+
+    /**
+     * Load the state file. A missing file yields an empty state with
+     * updatedAt() == -1 (no history yet).
+     *
+     * @param error Output error message for unreadable or corrupted files
+     * @return false on error (the in-memory state is left empty)
+     */
+    bool load(std::string& error);
+
+    /**
+     * Atomically write the state file (updates updatedAt() to now)
+     * @param error Output error message
+     * @return true if the file was written and synced
+     */
+    bool save(std::string& error);
+
+    /**
+     * @return Latest dispatched scheduled time of a job, or -1 if none
+     */
+    std::time_t lastFire(const std::string& id) const;
+
+    /**
+     * Record a dispatched run (keeps the latest time per job)
+     */
+    void recordFire(const std::string& id, std::time_t scheduled_time);
+
+    /**
+     * Time of the last successful save, -1 if the state has no history
+     */
+    std::time_t updatedAt() const { return updated_at; }
+
+    /**
+     * Record which lease holder and epoch wrote the state
+     */
+    void setOwner(const std::string& holder, uint64_t epoch);
+
+    const std::string& holder() const { return owner; }
+    uint64_t epoch() const { return owner_epoch; }
+    const std::unordered_map<std::string, std::time_t>& entries() const { return last_fire; }
+
+private:
+    std::string statePath;
+    std::unordered_map<std::string, std::time_t> last_fire;
+    std::time_t updated_at = -1;
+    std::string owner;
+    uint64_t owner_epoch = 0;
+};
+
+#endif // EXECUTION_STATE_H
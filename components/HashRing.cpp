@@ -0,0 +1,63 @@
+/**
+ * @file HashRing.cpp
+ * @brief Consistent hash ring with virtual nodes
+ */
+
+#include "HashRing.h"
+#include <algorithm>
+
+namespace {
+const std::string NO_OWNER;
+}
+
+HashRing::HashRing(unsigned vnodes) : vnodesPerMember(vnodes > 0 ? vnodes : 1) {}
+
+void HashRing::setMembers(const std::vector<std::string>& members) {
+    nodes = members;
+    std::sort(nodes.begin(), nodes.end());
+    nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+    ring.clear();
+    ring.reserve(nodes.size() * vnodesPerMember);
+    for (uint32_t m = 0; m < nodes.size(); ++m) {
+        for (unsigned v = 0; v < vnodesPerMember; ++v) {
+            ring.push_back({hash(nodes[m] + "#" + std::to_string(v)), m});
+        }
+    }
+    // Ties (astronomically rare) are broken by member name for a stable order
+    std::sort(ring.begin(), ring.end(), [this](const Point& a, const Point& b) {
+        return a.position != b.position ? a.position < b.position : nodes[a.member] < nodes[b.member];
+    });
+}
+
+const std::string& HashRing::owner(const std::string& id) const {
+    if (ring.empty()) {
+        return NO_OWNER;
+    }
+    Point key{hash(id), 0};
+    auto it = std::lower_bound(ring.begin(), ring.end(), key);
+    if (it == ring.end()) {
+        it = ring.begin();   // Wrap around
+    }
+    return nodes[it->member];
+}
+
+bool HashRing::owns(const std::string& member, const std::string& id) const {
+    return !ring.empty() && owner(id) == member;
+}
+
+uint64_t HashRing::hash(const std::string& key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    // FNV-1a alone clusters similar keys ("node1#1", "node1#2"); finish with
+    // the splitmix64 mixer to spread them over the whole ring
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
@@ -0,0 +1,60 @@
+#ifndef HASH_RING_H
+#define HASH_RING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * HashRing Class - Consistent hashing of job IDs onto cluster members
+ *
+ * Each member is placed on a 64-bit ring at `vnodes` pseudo-random points;
+ * a job belongs to the first point clockwise from the hash of its ID.
+ * When a member joins or leaves only the jobs on the arcs it gains or
+ * loses move (about 1/N of them), every other assignment is unchanged.
+ * Many virtual nodes per member keep the shards within a few percent of
+ * the ideal size.
+ *
+ * Owner lookups are a binary search over a sorted vector: O(log(N*vnodes)),
+ * no allocation.
+ */
+class HashRing {
+public:
+    explicit HashRing(unsigned vnodes = 128);
+
+    /**
+     * Rebuild the ring for a member list (order does not matter)
+     */
+    void setMembers(const std::vector<std::string>& members);
+
+    /**
+     * @return Member owning a job ID, or "" if the ring is empty
+     */
+    const std::string& owner(const std::string& id) const;
+
+    /**
+     * @return true if `member` owns the job ID
+     */
+    bool owns(const std::string& member, const std::string& id) const;
+
+    const std::vector<std::string>& members() const { return nodes; }
+    bool empty() const { return nodes.empty(); }
+
+    /**
+     * 64-bit FNV-1a with a final avalanche step (stable across builds)
+     */
+    static uint64_t hash(const std::string& key);
+
+private:
+    struct Point {
+        uint64_t position;
+        uint32_t member;
+        bool operator<(const Point& other) const { return position < other.position; }
+    };
+
+    unsigned vnodesPerMember;
+    std::vector<std::string> nodes;
+    std::vector<Point> ring;
+};
+
+#endif // HASH_RING_H
@@ -4,15 +4,20 @@
  */
 
 #include "JobConfig.h"
+#include "AllocTracker.h"
+#include "CronExpression.h"
 #include "json.hpp"
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <unordered_map>
 
 /**
  * Load jobs from JSON configuration file
  */
 std::vector<CronJob> JobConfig::loadJobs(const std::string& filename) {
+    AllocScope scope(AllocTag::CONFIG);
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "Error: Cannot open config file: " << filename << std::endl;
@@ -37,25 +42,182 @@ std::vector<CronJob> JobConfig::loadJobs(const std::string& filename) {
  * Evita doppio parsing JSON -> string -> JSON
  */
 std::vector<CronJob> JobConfig::parseJobsFromJson(nlohmann::json&& j) {
-    std::vector<CronJob> jobs;
-    
     if (!j.contains("jobs") || !j["jobs"].is_array()) {
         std::cerr << "Error: JSON must contain 'jobs' array" << std::endl;
         return {};
     }
+    return parseJobEntries(j["jobs"], true, nullptr);
+}
+
+/**
+ * Job ID of every entry of a jobs.json document, in file order
+ */
+std::vector<std::string> JobConfig::entryIds(const nlohmann::json& doc) {
+    std::vector<std::string> ids;
+    if (!doc.contains("jobs") || !doc["jobs"].is_array()) {
+        return ids;
+    }
+    ids.resize(doc["jobs"].size());
+    std::vector<size_t> sources;
+    std::vector<CronJob> jobs = parseJobEntries(doc["jobs"], false, &sources);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        ids[sources[i]] = jobs[i].id;
+    }
+    return ids;
+}
+
+/**
+ * Parse a "jobs" array; entries that fail to parse are skipped with a warning
+ */
+std::vector<CronJob> JobConfig::parseJobEntries(const nlohmann::json& entries, bool check_conditions,
+                                                std::vector<size_t>* sources) {
+    AllocScope scope(AllocTag::CONFIG);
+    std::vector<CronJob> jobs;
+    std::unordered_map<std::string, int> id_counts;  // Detects duplicate job IDs
+    size_t position = 0;
     
     try {
-        for (const auto& job_json : j["jobs"]) {
+        for (const auto& job_json : entries) {
+            size_t source = position++;
             CronJob job;
             
+            // Job type: shell command (default), in-process plugin or pipeline
+            std::string type = job_json.value("type", "command");
+            if (type == "plugin") {
+                job.type = JobType::PLUGIN;
+            } else if (type == "pipeline") {
+                job.type = JobType::PIPELINE;
+            } else if (type != "command") {
+                std::cerr << "Warning: Skipping job with unknown type '" << type << "'" << std::endl;
+                continue;
+            }
+            
             // Required fields
-            if (!job_json.contains("description") || !job_json.contains("command")) {
-                std::cerr << "Warning: Skipping job missing required fields (description, command)" << std::endl;
+            if (!job_json.contains("description") ||
+                (job.type == JobType::COMMAND && !job_json.contains("command")) ||
+                (job.type == JobType::PLUGIN && !job_json.contains("plugin")) ||
+                (job.type == JobType::PIPELINE && !job_json.contains("stages"))) {
+                std::cerr << "Warning: Skipping job missing required fields (description, command, plugin or stages)" << std::endl;
                 continue;
             }
             
             job.description = job_json["description"].get<std::string>();
-            job.command = job_json["command"].get<std::string>();
+            if (job.type == JobType::PLUGIN) {
+                job.plugin_path = job_json["plugin"].get<std::string>();
+                job.plugin_arg = job_json.value("plugin_arg", "");
+                job.plugin_isolate = job_json.value("isolate", false);
+                // Plugins have no shell command; keep a readable key for logs and tracking
+                job.command = job_json.value("command", "plugin:" + job.plugin_path);
+            } else if (job.type == JobType::PIPELINE) {
+                // The stages joined like a shell pipeline name the job in logs and derived IDs
+                const auto& stages = job_json["stages"];
+                for (const auto& stage_json : stages.is_array() ? stages : nlohmann::json::array()) {
+                    if (!stage_json.is_object() || !stage_json.contains("command") ||
+                        !stage_json["command"].is_string()) {
+                        job.stages.clear();
+                        break;
+                    }
+                    PipelineStage stage;
+                    stage.command = stage_json["command"].get<std::string>();
+                    stage.timeout_seconds = stage_json.value("timeout", 0);
+                    if (stage_json.contains("limits") && stage_json["limits"].is_object()) {
+                        stage.cpu_limit_seconds = stage_json["limits"].value("cpu_seconds", 0);
+                        stage.memory_limit_mb = stage_json["limits"].value("memory_mb", 0);
+                    }
+                    job.command += (job.command.empty() ? "" : " | ") + stage.command;
+                    job.stages.push_back(std::move(stage));
+                }
+                if (job.stages.empty() || job.stages.size() > MAX_PIPELINE_STAGES) {
+                    std::cerr << "Warning: Skipping pipeline job '" << job.description
+                              << "' without valid stages" << std::endl;
+                    continue;
+                }
+                std::string failure = job_json.value("failure", "any");
+                job.pipeline_failure = failure == "last" ? PipelineFailure::LAST
+                                     : failure == "abort" ? PipelineFailure::ABORT : PipelineFailure::ANY;
+                job.pipeline_relay = job_json.value("relay", false);
+            } else {
+                job.command = job_json["command"].get<std::string>();
+            }
+            job.timeout_seconds = job_json.value("timeout", 300);
+            job.idle_timeout_seconds = job_json.value("idle_timeout", 0);
+            job.heartbeat_file = job_json.value("heartbeat", "");
+            if (job_json.contains("quota")) {
+                std::string quota_error;
+                if (!parseQuota(job_json["quota"], job.quota, quota_error)) {
+                    std::cerr << "Warning: Skipping job '" << job.description
+                              << "' with invalid quota: " << quota_error << std::endl;
+                    continue;
+                }
+                if (job.quota.action == QuotaAction::DOWNGRADE && job.type == JobType::PLUGIN) {
+                    std::cerr << "Warning: Job '" << job.description
+                              << "' is a plugin, skipping runs over quota instead of downgrading" << std::endl;
+                    job.quota.action = QuotaAction::SKIP;
+                }
+            }
+            
+            // Execution placement, environment and resource limits
+            job.remote = job_json.value("executor", "local") == "agent";
+            job.user = job_json.value("user", "");
+            if (job_json.contains("env") && job_json["env"].is_object()) {
+                for (const auto& var : job_json["env"].items()) {
+                    job.env.push_back(var.key() + "=" + var.value().get<std::string>());
+                }
+            }
+            if (job_json.contains("limits") && job_json["limits"].is_object()) {
+                job.cpu_limit_seconds = job_json["limits"].value("cpu_seconds", 0);
+                job.memory_limit_mb = job_json["limits"].value("memory_mb", 0);
+            }
+            if (job_json.contains("prewarm") && job_json["prewarm"].is_object()) {
+                job.prewarm_seconds = job_json["prewarm"].value("lead_seconds", 0);
+                job.prewarm_paths = job_json["prewarm"].value("paths", std::vector<std::string>());
+            }
+            if (job_json.contains("prestart") && job_json["prestart"].is_object()) {
+                job.prestart_seconds = job_json["prestart"].value("lead_seconds", 0);
+                if (job.type == JobType::PIPELINE && job.prestart_seconds > 0) {
+                    std::cerr << "Warning: Job '" << job.description
+                              << "' is a pipeline, ignoring 'prestart'" << std::endl;
+                    job.prestart_seconds = 0;
+                }
+            }
+            
+            // Template: the parameter table is kept, instances are created by the scheduler
+            if (job_json.contains("matrix")) {
+                auto matrix = std::make_shared<JobMatrix>();
+                std::string matrix_error;
+                bool valid = parseMatrix(job_json["matrix"], *matrix, matrix_error) &&
+                             matrix->checkPlaceholders(job.command, matrix_error) &&
+                             matrix->checkPlaceholders(job.plugin_arg, matrix_error) &&
+                             matrix->checkPlaceholders(job.heartbeat_file, matrix_error);
+                for (const std::string& var : job.env) {
+                    valid = valid && matrix->checkPlaceholders(var, matrix_error);
+                }
+                if (!valid) {
+                    std::cerr << "Warning: Skipping job '" << job.description 
+                              << "' with invalid matrix: " << matrix_error << std::endl;
+                    continue;
+                }
+                if (job.prestart_seconds > 0) {
+                    std::cerr << "Warning: Job '" << job.description
+                              << "' is a template, ignoring 'prestart'" << std::endl;
+                    job.prestart_seconds = 0;
+                }
+                job.matrix = std::move(matrix);
+                job.matrix_stagger = job_json.value("stagger", false);
+            }
+            
+            // Bundles only hold plain local shell commands; anything else runs on its own
+            if (job_json.contains("bundle") && job_json["bundle"].is_string()) {
+                job.bundle = job_json["bundle"].get<std::string>();
+                if (!job.bundle.empty() &&
+                    (job.type != JobType::COMMAND || job.remote || !job.user.empty() || !job.env.empty() ||
+                     job.cpu_limit_seconds > 0 || job.memory_limit_mb > 0 || job.prestart_seconds > 0 ||
+                     job.idle_timeout_seconds > 0 || job.matrix_stagger || job.quota.window_seconds > 0)) {
+                    std::cerr << "Warning: Job '" << job.description
+                              << "' cannot be bundled, running it in its own process" << std::endl;
+                    job.bundle.clear();
+                }
+            }
             
             // Schedule parsing (new unified format)
             if (job_json.contains("schedule")) {
@@ -87,6 +249,38 @@ std::vector<CronJob> JobConfig::parseJobsFromJson(nlohmann::json&& j) {
                 convertLegacyToSchedule(job);
             }
             
+            // Compile the schedule once; jobs with an invalid schedule are skipped
+            std::string schedule_error;
+            if (!CronExpression::compile(job.schedule, job.mask, schedule_error)) {
+                std::cerr << "Warning: Skipping job '" << job.description 
+                          << "' with invalid schedule: " << schedule_error << std::endl;
+                continue;
+            }
+            ScheduleReach reach = CronExpression::reach(job.mask);
+            if (reach == ScheduleReach::NEVER) {
+                std::cerr << "Warning: Skipping job '" << job.description 
+                          << "' whose schedule " << CronExpression::describeReach(reach) << std::endl;
+                continue;
+            }
+            if (reach == ScheduleReach::LEAP_YEARS) {
+                std::cerr << "Warning: Job '" << job.description 
+                          << "' " << CronExpression::describeReach(reach) << std::endl;
+            }
+            
+            // Stable job ID: explicit "id" or derived from the job definition
+            bool explicit_id = job_json.contains("id") && job_json["id"].is_string();
+            job.id = explicit_id ? job_json["id"].get<std::string>() : deriveJobId(job);
+            int& id_count = id_counts[job.id];
+            if (++id_count > 1) {
+                if (explicit_id) {
+                    std::cerr << "Warning: Skipping job '" << job.description 
+                              << "' with duplicate id '" << job.id << "'" << std::endl;
+                    continue;
+                }
+                // Identical definitions: keep them distinct and stable by position
+                job.id += "#" + std::to_string(id_count);
+            }
+            
             // Job conditions (optional)
             if (job_json.contains("conditions")) {
                 const auto& cond = job_json["conditions"];
@@ -103,8 +297,11 @@ std::vector<CronJob> JobConfig::parseJobsFromJson(nlohmann::json&& j) {
             }
             
             // Only add if conditions are met
-            if (checkJobConditions(job.conditions)) {
+            if (!check_conditions || checkJobConditions(job.conditions)) {
                 jobs.push_back(job);
+                if (sources) {
+                    sources->push_back(source);
+                }
             }
         }
     } catch (const nlohmann::json::exception& e) {
@@ -119,6 +316,7 @@ std::vector<CronJob> JobConfig::parseJobsFromJson(nlohmann::json&& j) {
  * Parse JSON string and return jobs
  */
 std::vector<CronJob> JobConfig::parseJobsFromJson(const std::string& json_string) {
+    AllocScope scope(AllocTag::CONFIG);
     try {
         nlohmann::json j = nlohmann::json::parse(json_string);
         return parseJobsFromJson(std::move(j));
@@ -128,6 +326,137 @@ std::vector<CronJob> JobConfig::parseJobsFromJson(const std::string& json_string
     }
 }
 
+/**
+ * Convert one job to its jobs.json representation
+ */
+nlohmann::json JobConfig::jobToJson(const CronJob& job) {
+    nlohmann::json job_json;
+    if (!job.id.empty())
+        job_json["id"] = job.id;
+    job_json["description"] = job.description;
+    if (job.type != JobType::PIPELINE)
+        job_json["command"] = job.command;
+    if (job.type == JobType::PIPELINE) {
+        job_json["type"] = "pipeline";
+        nlohmann::json stages_json = nlohmann::json::array();
+        for (const auto& stage : job.stages) {
+            nlohmann::json stage_json;
+            stage_json["command"] = stage.command;
+            if (stage.timeout_seconds > 0)
+                stage_json["timeout"] = stage.timeout_seconds;
+            if (stage.cpu_limit_seconds > 0)
+                stage_json["limits"]["cpu_seconds"] = stage.cpu_limit_seconds;
+            if (stage.memory_limit_mb > 0)
+                stage_json["limits"]["memory_mb"] = stage.memory_limit_mb;
+            stages_json.push_back(stage_json);
+        }
+        job_json["stages"] = stages_json;
+        if (job.pipeline_failure != PipelineFailure::ANY)
+            job_json["failure"] = job.pipeline_failure == PipelineFailure::LAST ? "last" : "abort";
+        if (job.pipeline_relay)
+            job_json["relay"] = true;
+    }
+    if (job.type == JobType::PLUGIN) {
+        job_json["type"] = "plugin";
+        job_json["plugin"] = job.plugin_path;
+        if (!job.plugin_arg.empty())
+            job_json["plugin_arg"] = job.plugin_arg;
+        if (job.plugin_isolate)
+            job_json["isolate"] = true;
+    }
+    if (job.timeout_seconds != 300)
+        job_json["timeout"] = job.timeout_seconds;
+    if (job.idle_timeout_seconds > 0)
+        job_json["idle_timeout"] = job.idle_timeout_seconds;
+    if (!job.heartbeat_file.empty())
+        job_json["heartbeat"] = job.heartbeat_file;
+    if (job.quota.window_seconds > 0) {
+        nlohmann::json quota_json;
+        quota_json["window"] = job.quota.window_seconds == 3600 ? "hour" : "day";
+        if (job.quota.runs > 0)
+            quota_json["runs"] = job.quota.runs;
+        if (job.quota.cpu_seconds > 0)
+            quota_json["cpu_seconds"] = job.quota.cpu_seconds;
+        if (job.quota.wall_seconds > 0)
+            quota_json["wall_seconds"] = job.quota.wall_seconds;
+        if (!job.quota.group.empty())
+            quota_json["group"] = job.quota.group;
+        if (job.quota.action != QuotaAction::SKIP)
+            quota_json["action"] = job.quota.action == QuotaAction::DEFER ? "defer" : "downgrade";
+        job_json["quota"] = quota_json;
+    }
+    if (job.remote)
+        job_json["executor"] = "agent";
+    if (!job.user.empty())
+        job_json["user"] = job.user;
+    if (!job.env.empty()) {
+        nlohmann::json env_json = nlohmann::json::object();
+        for (const auto& var : job.env) {
+            size_t eq = var.find('=');
+            env_json[var.substr(0, eq)] = var.substr(eq + 1);
+        }
+        job_json["env"] = env_json;
+    }
+    if (job.cpu_limit_seconds > 0)
+        job_json["limits"]["cpu_seconds"] = job.cpu_limit_seconds;
+    if (job.memory_limit_mb > 0)
+        job_json["limits"]["memory_mb"] = job.memory_limit_mb;
+    if (job.prewarm_seconds > 0) {
+        job_json["prewarm"]["lead_seconds"] = job.prewarm_seconds;
+        if (!job.prewarm_paths.empty())
+            job_json["prewarm"]["paths"] = job.prewarm_paths;
+    }
+    if (job.prestart_seconds > 0)
+        job_json["prestart"]["lead_seconds"] = job.prestart_seconds;
+    if (job.matrix) {
+        nlohmann::json matrix_json = nlohmann::json::object();
+        for (size_t p = 0; p < job.matrix->parameterNames().size(); ++p) {
+            matrix_json[job.matrix->parameterNames()[p]] = job.matrix->parameterValues(p);
+        }
+        job_json["matrix"] = matrix_json;
+        if (job.matrix_stagger)
+            job_json["stagger"] = true;
+    }
+    if (!job.bundle.empty())
+        job_json["bundle"] = job.bundle;
+    
+    // Use new schedule format
+    nlohmann::json schedule_json;
+    schedule_json["minute"] = job.schedule.minute;
+    schedule_json["hour"] = job.schedule.hour;
+    schedule_json["day_of_month"] = job.schedule.day_of_month;
+    schedule_json["month"] = job.schedule.month;
+    schedule_json["day_of_week"] = job.schedule.day_of_week;
+    job_json["schedule"] = schedule_json;
+    
+    // Add conditions only if they're not default
+    if (!job.conditions.cpu_threshold.empty() || 
+        !job.conditions.ram_threshold.empty() || 
+        !job.conditions.loadavg_threshold.empty() ||
+        !job.conditions.disk_thresholds.empty()) {
+        
+        nlohmann::json conditions_json;
+        
+        if (!job.conditions.cpu_threshold.empty())
+            conditions_json["cpu_threshold"] = job.conditions.cpu_threshold;
+        if (!job.conditions.ram_threshold.empty())
+            conditions_json["ram_threshold"] = job.conditions.ram_threshold;
+        if (!job.conditions.loadavg_threshold.empty())
+            conditions_json["loadavg_threshold"] = job.conditions.loadavg_threshold;
+        
+        if (!job.conditions.disk_thresholds.empty()) {
+            nlohmann::json disk_json;
+            for (const auto& [path, threshold] : job.conditions.disk_thresholds) {
+                disk_json[path] = threshold;
+            }
+            conditions_json["disk_thresholds"] = disk_json;
+        }
+        
+        job_json["conditions"] = conditions_json;
+    }
+    return job_json;
+}
+
 /**
  * Save jobs to JSON file with optimized structure
  */
@@ -140,46 +469,7 @@ bool JobConfig::saveJobsToJson(const std::vector<CronJob>& jobs, const std::stri
         config["jobs"].get_ref<nlohmann::json::array_t&>().reserve(jobs.size());
         
         for (const auto& job : jobs) {
-            nlohmann::json job_json;
-            job_json["description"] = job.description;
-            job_json["command"] = job.command;
-            
-            // Use new schedule format
-            nlohmann::json schedule_json;
-            schedule_json["minute"] = job.schedule.minute;
-            schedule_json["hour"] = job.schedule.hour;
-            schedule_json["day_of_month"] = job.schedule.day_of_month;
-            schedule_json["month"] = job.schedule.month;
-            schedule_json["day_of_week"] = job.schedule.day_of_week;
-            job_json["schedule"] = schedule_json;
-            
-            // Add conditions only if they're not default
-            if (!job.conditions.cpu_threshold.empty() || 
-                !job.conditions.ram_threshold.empty() || 
-                !job.conditions.loadavg_threshold.empty() ||
-                !job.conditions.disk_thresholds.empty()) {
-                
-                nlohmann::json conditions_json;
-                
-                if (!job.conditions.cpu_threshold.empty())
-                    conditions_json["cpu_threshold"] = job.conditions.cpu_threshold;
-                if (!job.conditions.ram_threshold.empty())
-                    conditions_json["ram_threshold"] = job.conditions.ram_threshold;
-                if (!job.conditions.loadavg_threshold.empty())
-                    conditions_json["loadavg_threshold"] = job.conditions.loadavg_threshold;
-                
-                if (!job.conditions.disk_thresholds.empty()) {
-                    nlohmann::json disk_json;
-                    for (const auto& [path, threshold] : job.conditions.disk_thresholds) {
-                        disk_json[path] = threshold;
-                    }
-                    conditions_json["disk_thresholds"] = disk_json;
-                }
-                
-                job_json["conditions"] = conditions_json;
-            }
-            
-            config["jobs"].push_back(job_json);
+            config["jobs"].push_back(jobToJson(job));
         }
         
         // Write to file with pretty formatting
@@ -202,6 +492,7 @@ bool JobConfig::saveJobsToJson(const std::vector<CronJob>& jobs, const std::stri
  * Validate JSON file before loading
  */
 bool JobConfig::validateJobsFile(const std::string& filename, std::string& errorMsg) {
+    AllocScope scope(AllocTag::CONFIG);
     std::ifstream file(filename);
     if (!file.is_open()) {
         errorMsg = "Cannot open file: " + filename;
@@ -209,7 +500,14 @@ bool JobConfig::validateJobsFile(const std::string& filename, std::string& error
     }
     
     std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    
+    return validateJobsJson(content, errorMsg);
+}
+
+/**
+ * Validate JSON content already read into memory (same rules as validateJobsFile)
+ */
+bool JobConfig::validateJobsJson(const std::string& content, std::string& errorMsg) {
+    AllocScope scope(AllocTag::CONFIG);
     try {
         nlohmann::json j = nlohmann::json::parse(content);
         
@@ -220,11 +518,297 @@ bool JobConfig::validateJobsFile(const std::string& filename, std::string& error
         }
         
         // Validate each job
+        std::unordered_map<std::string, int> ids;
+        std::unordered_map<std::string, JobQuota> quota_groups;
         for (const auto& job_json : j["jobs"]) {
-            if (!job_json.contains("description") || !job_json.contains("command")) {
+            std::string type = job_json.value("type", "command");
+            if (type != "command" && type != "plugin" && type != "pipeline") {
+                errorMsg = "Unknown job type '" + type + "' (expected 'command', 'plugin' or 'pipeline')";
+                return false;
+            }
+            if (!job_json.contains("description") || 
+                (type == "command" && !job_json.contains("command"))) {
                 errorMsg = "Each job must have 'description' and 'command' fields";
                 return false;
             }
+            
+            std::string description = job_json["description"].is_string() 
+                                      ? job_json["description"].get<std::string>() : "";
+            
+            if (type == "plugin") {
+                if (!job_json.contains("plugin") || !job_json["plugin"].is_string()) {
+                    errorMsg = "Job '" + description + "': plugin jobs need a 'plugin' shared object path";
+                    return false;
+                }
+                std::string pluginPath = job_json["plugin"].get<std::string>();
+                if (!std::filesystem::exists(pluginPath)) {
+                    errorMsg = "Job '" + description + "': plugin not found: " + pluginPath;
+                    return false;
+                }
+            }
+            if (type == "pipeline") {
+                const auto& stages = job_json.contains("stages") ? job_json["stages"] : nlohmann::json();
+                if (!stages.is_array() || stages.empty() || stages.size() > MAX_PIPELINE_STAGES) {
+                    errorMsg = "Job '" + description + "': pipeline jobs need 'stages' (1-" +
+                               std::to_string(MAX_PIPELINE_STAGES) + " objects with a 'command')";
+                    return false;
+                }
+                for (const auto& stage : stages) {
+                    bool valid = stage.is_object() && stage.contains("command") && stage["command"].is_string() &&
+                                 !stage["command"].get<std::string>().empty();
+                    valid = valid && (!stage.contains("timeout") ||
+                                      (stage["timeout"].is_number_integer() && stage["timeout"].get<int>() > 0));
+                    if (valid && stage.contains("limits")) {
+                        valid = stage["limits"].is_object();
+                        for (const char* key : {"cpu_seconds", "memory_mb"}) {
+                            valid = valid && (!stage["limits"].contains(key) ||
+                                              (stage["limits"][key].is_number_integer() &&
+                                               stage["limits"][key].get<int>() > 0));
+                        }
+                    }
+                    if (!valid) {
+                        errorMsg = "Job '" + description + "': each stage needs a 'command' and may set a positive "
+                                   "'timeout' and 'limits' (cpu_seconds, memory_mb)";
+                        return false;
+                    }
+                }
+                std::string failure = job_json.value("failure", std::string("any"));
+                if (job_json.contains("failure") &&
+                    (!job_json["failure"].is_string() || (failure != "any" && failure != "last" && failure != "abort"))) {
+                    errorMsg = "Job '" + description + "': 'failure' must be 'any', 'last' or 'abort'";
+                    return false;
+                }
+                if (job_json.contains("relay") && !job_json["relay"].is_boolean()) {
+                    errorMsg = "Job '" + description + "': 'relay' must be true or false";
+                    return false;
+                }
+                for (const char* key : {"prestart", "bundle"}) {
+                    if (job_json.contains(key)) {
+                        errorMsg = "Job '" + description + "': pipeline jobs cannot set '" + key + "'";
+                        return false;
+                    }
+                }
+            } else if (job_json.contains("stages") || job_json.contains("failure") || job_json.contains("relay")) {
+                errorMsg = "Job '" + description + "': 'stages', 'failure' and 'relay' need \"type\": \"pipeline\"";
+                return false;
+            }
+            if (job_json.contains("timeout") && 
+                (!job_json["timeout"].is_number_integer() || job_json["timeout"].get<int>() <= 0)) {
+                errorMsg = "Job '" + description + "': 'timeout' must be a positive number of seconds";
+                return false;
+            }
+            if (job_json.contains("idle_timeout")) {
+                if (!job_json["idle_timeout"].is_number_integer() || job_json["idle_timeout"].get<int>() <= 0) {
+                    errorMsg = "Job '" + description + "': 'idle_timeout' must be a positive number of seconds";
+                    return false;
+                }
+                if (type != "command") {
+                    errorMsg = "Job '" + description + "': 'idle_timeout' is only supported for command jobs";
+                    return false;
+                }
+            }
+            if (job_json.contains("heartbeat")) {
+                if (!job_json["heartbeat"].is_string() || job_json["heartbeat"].get<std::string>().compare(0, 1, "/") != 0) {
+                    errorMsg = "Job '" + description + "': 'heartbeat' must be an absolute file path";
+                    return false;
+                }
+                if (!job_json.contains("idle_timeout")) {
+                    errorMsg = "Job '" + description + "': 'heartbeat' needs an 'idle_timeout'";
+                    return false;
+                }
+            }
+            if (job_json.contains("quota")) {
+                JobQuota quota;
+                std::string quotaError;
+                if (!parseQuota(job_json["quota"], quota, quotaError)) {
+                    errorMsg = "Job '" + description + "': invalid quota: " + quotaError;
+                    return false;
+                }
+                if (quota.action == QuotaAction::DOWNGRADE && type == "plugin") {
+                    errorMsg = "Job '" + description + "': plugin jobs cannot be downgraded, use 'skip' or 'defer'";
+                    return false;
+                }
+                if (!quota.group.empty()) {
+                    auto inserted = quota_groups.emplace(quota.group, quota);
+                    const JobQuota& first = inserted.first->second;
+                    if (first.window_seconds != quota.window_seconds || first.runs != quota.runs ||
+                        first.cpu_seconds != quota.cpu_seconds || first.wall_seconds != quota.wall_seconds) {
+                        errorMsg = "Job '" + description + "': quota group '" + quota.group +
+                                   "' is declared with different limits by another job";
+                        return false;
+                    }
+                }
+            }
+            if (job_json.contains("executor")) {
+                std::string executor = job_json["executor"].is_string() ? job_json["executor"].get<std::string>() : "";
+                if (executor != "local" && executor != "agent") {
+                    errorMsg = "Job '" + description + "': 'executor' must be 'local' or 'agent'";
+                    return false;
+                }
+                if (executor == "agent" && type != "command") {
+                    errorMsg = "Job '" + description + "': " + type + " jobs cannot run on an agent";
+                    return false;
+                }
+            }
+            if (job_json.contains("user")) {
+                if (!job_json["user"].is_string() || job_json["user"].get<std::string>().empty()) {
+                    errorMsg = "Job '" + description + "': 'user' must be a non-empty account name";
+                    return false;
+                }
+                if (type == "plugin") {
+                    errorMsg = "Job '" + description + "': plugin jobs run inside the daemon and cannot set 'user'";
+                    return false;
+                }
+            }
+            if (job_json.contains("env")) {
+                bool valid = job_json["env"].is_object();
+                if (valid) {
+                    for (const auto& var : job_json["env"].items()) {
+                        valid = valid && var.value().is_string() && !var.key().empty() &&
+                                var.key().find('=') == std::string::npos;
+                    }
+                }
+                if (!valid) {
+                    errorMsg = "Job '" + description + "': 'env' must map variable names to strings";
+                    return false;
+                }
+            }
+            if (job_json.contains("limits")) {
+                const auto& limits = job_json["limits"];
+                bool valid = limits.is_object();
+                for (const char* key : {"cpu_seconds", "memory_mb"}) {
+                    valid = valid && (!limits.contains(key) ||
+                                      (limits[key].is_number_integer() && limits[key].get<int>() > 0));
+                }
+                if (!valid) {
+                    errorMsg = "Job '" + description + "': 'limits' values (cpu_seconds, memory_mb) must be positive integers";
+                    return false;
+                }
+            }
+            if (job_json.contains("prewarm")) {
+                const auto& prewarm = job_json["prewarm"];
+                bool valid = prewarm.is_object() && prewarm.contains("lead_seconds") &&
+                             prewarm["lead_seconds"].is_number_integer() &&
+                             prewarm["lead_seconds"].get<int>() > 0 && prewarm["lead_seconds"].get<int>() <= 86400;
+                if (valid && prewarm.contains("paths")) {
+                    valid = prewarm["paths"].is_array();
+                    for (const auto& path : valid ? prewarm["paths"] : nlohmann::json::array()) {
+                        valid = valid && path.is_string() && path.get<std::string>().compare(0, 1, "/") == 0;
+                    }
+                }
+                if (!valid) {
+                    errorMsg = "Job '" + description + "': 'prewarm' needs 'lead_seconds' (1-86400) and optional absolute 'paths'";
+                    return false;
+                }
+                if (job_json.value("executor", "local") == "agent") {
+                    errorMsg = "Job '" + description + "': 'prewarm' has no effect on agent jobs";
+                    return false;
+                }
+            }
+            if (job_json.contains("prestart")) {
+                const auto& prestart = job_json["prestart"];
+                if (!prestart.is_object() || !prestart.contains("lead_seconds") ||
+                    !prestart["lead_seconds"].is_number_integer() ||
+                    prestart["lead_seconds"].get<int>() <= 0 || prestart["lead_seconds"].get<int>() > 300) {
+                    errorMsg = "Job '" + description + "': 'prestart' needs 'lead_seconds' (1-300)";
+                    return false;
+                }
+                if (job_json.value("executor", "local") == "agent" || type == "plugin") {
+                    errorMsg = "Job '" + description + "': 'prestart' is only supported for local command jobs";
+                    return false;
+                }
+            }
+            if (job_json.contains("matrix")) {
+                JobMatrix matrix;
+                std::string matrixError;
+                bool valid = parseMatrix(job_json["matrix"], matrix, matrixError);
+                std::vector<std::string> texts = {job_json.value("command", ""), job_json.value("plugin_arg", ""),
+                                                  job_json.value("heartbeat", "")};
+                if (type == "pipeline") {
+                    for (const auto& stage : job_json["stages"]) {
+                        texts.push_back(stage["command"].get<std::string>());
+                    }
+                }
+                if (job_json.contains("env")) {
+                    for (const auto& var : job_json["env"].items()) {
+                        texts.push_back(var.value().get<std::string>());
+                    }
+                }
+                for (const auto& text : texts) {
+                    valid = valid && matrix.checkPlaceholders(text, matrixError);
+                }
+                if (!valid) {
+                    errorMsg = "Job '" + description + "': invalid matrix: " + matrixError;
+                    return false;
+                }
+                if (job_json.contains("prestart")) {
+                    errorMsg = "Job '" + description + "': 'prestart' cannot be combined with 'matrix'";
+                    return false;
+                }
+            }
+            if (job_json.contains("stagger") &&
+                (!job_json["stagger"].is_boolean() || !job_json.contains("matrix"))) {
+                errorMsg = "Job '" + description + "': 'stagger' must be true or false and needs a 'matrix'";
+                return false;
+            }
+            if (job_json.contains("bundle")) {
+                if (!job_json["bundle"].is_string() || job_json["bundle"].get<std::string>().empty()) {
+                    errorMsg = "Job '" + description + "': 'bundle' must be a non-empty name";
+                    return false;
+                }
+                if (type == "plugin" || job_json.value("executor", "local") == "agent") {
+                    errorMsg = "Job '" + description + "': 'bundle' is only supported for local command jobs";
+                    return false;
+                }
+                for (const char* key : {"user", "env", "limits", "prestart", "idle_timeout", "stagger", "quota"}) {
+                    if (job_json.contains(key)) {
+                        errorMsg = "Job '" + description + "': bundled jobs share one shell and cannot set '" +
+                                   key + "'";
+                        return false;
+                    }
+                }
+            }
+            
+            if (job_json.contains("id")) {
+                if (!job_json["id"].is_string() || job_json["id"].get<std::string>().empty()) {
+                    errorMsg = "Job '" + description + "': 'id' must be a non-empty string";
+                    return false;
+                }
+                if (++ids[job_json["id"].get<std::string>()] > 1) {
+                    errorMsg = "Duplicate job id '" + job_json["id"].get<std::string>() + "'";
+                    return false;
+                }
+            }
+            
+            // Schedules must compile and be able to fire, otherwise the job would be silently dropped
+            if (job_json.contains("schedule")) {
+                const auto& sched = job_json["schedule"];
+                CronMask mask;
+                std::string scheduleError;
+                bool valid = false;
+                if (sched.is_string()) {
+                    valid = CronExpression::parse(sched.get<std::string>(), mask, scheduleError);
+                } else if (sched.is_object()) {
+                    CronSchedule schedule;
+                    schedule.minute = sched.value("minute", "*");
+                    schedule.hour = sched.value("hour", "*");
+                    schedule.day_of_month = sched.value("day_of_month", "*");
+                    schedule.month = sched.value("month", "*");
+                    schedule.day_of_week = sched.value("day_of_week", "*");
+                    valid = CronExpression::compile(schedule, mask, scheduleError);
+                } else {
+                    scheduleError = "must be a string or an object";
+                }
+                if (!valid) {
+                    errorMsg = "Job '" + description + "': invalid schedule: " + scheduleError;
+                    return false;
+                }
+                if (CronExpression::reach(mask) == ScheduleReach::NEVER) {
+                    errorMsg = "Job '" + description + "': schedule " +
+                               CronExpression::describeReach(ScheduleReach::NEVER);
+                    return false;
+                }
+            }
         }
         
         return true;
@@ -250,6 +834,118 @@ bool JobConfig::isValidJobsJson(const std::string& json_string) {
     }
 }
 
+/**
+ * Read a "matrix" object; parameters are ordered by name (JSON objects are)
+ */
+bool JobConfig::parseMatrix(const nlohmann::json& matrix_json, JobMatrix& matrix, std::string& error) {
+    if (!matrix_json.is_object() || matrix_json.empty()) {
+        error = "'matrix' must map parameter names to arrays of strings";
+        return false;
+    }
+    for (const auto& parameter : matrix_json.items()) {
+        const auto& values_json = parameter.value();
+        bool valid = values_json.is_array();
+        for (const auto& value : valid ? values_json : nlohmann::json::array()) {
+            valid = valid && value.is_string();
+        }
+        if (!valid) {
+            error = "matrix parameter '" + parameter.key() + "' must be an array of strings";
+            return false;
+        }
+        if (!matrix.addParameter(parameter.key(), values_json.get<std::vector<std::string>>(), error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Read a "quota" object; the window defaults to a day and the action to skip
+ */
+bool JobConfig::parseQuota(const nlohmann::json& quota_json, JobQuota& quota, std::string& error) {
+    if (!quota_json.is_object()) {
+        error = "'quota' must be an object";
+        return false;
+    }
+    std::string window = quota_json.contains("window") && quota_json["window"].is_string()
+                         ? quota_json["window"].get<std::string>() : "";
+    if (!quota_json.contains("window") || window == "day") {
+        quota.window_seconds = 86400;
+    } else if (window == "hour") {
+        quota.window_seconds = 3600;
+    } else {
+        error = "'window' must be 'hour' or 'day'";
+        return false;
+    }
+    for (const char* key : {"runs", "cpu_seconds", "wall_seconds"}) {
+        if (quota_json.contains(key) &&
+            (!quota_json[key].is_number_integer() || quota_json[key].get<int64_t>() <= 0 ||
+             quota_json[key].get<int64_t>() > 1000000000)) {
+            error = "'" + std::string(key) + "' must be a positive integer";
+            return false;
+        }
+    }
+    quota.runs = quota_json.value("runs", 0);
+    quota.cpu_seconds = quota_json.value("cpu_seconds", int64_t(0));
+    quota.wall_seconds = quota_json.value("wall_seconds", int64_t(0));
+    if (quota.runs == 0 && quota.cpu_seconds == 0 && quota.wall_seconds == 0) {
+        error = "set at least one of 'runs', 'cpu_seconds' and 'wall_seconds'";
+        return false;
+    }
+    if (quota_json.contains("group")) {
+        if (!quota_json["group"].is_string() || quota_json["group"].get<std::string>().empty()) {
+            error = "'group' must be a non-empty name";
+            return false;
+        }
+        quota.group = quota_json["group"].get<std::string>();
+    }
+    std::string action = quota_json.contains("action") && quota_json["action"].is_string()
+                         ? quota_json["action"].get<std::string>() : "";
+    if (!quota_json.contains("action") || action == "skip") {
+        quota.action = QuotaAction::SKIP;
+    } else if (action == "defer") {
+        quota.action = QuotaAction::DEFER;
+    } else if (action == "downgrade") {
+        quota.action = QuotaAction::DOWNGRADE;
+    } else {
+        error = "'action' must be 'skip', 'defer' or 'downgrade'";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Derive a stable job ID from the job definition (FNV-1a, folded to 48 bits)
+ * Jobs keep their ID across reloads as long as their definition is unchanged.
+ * Twelve hex digits keep the ID inside std::string's inline buffer.
+ */
+std::string JobConfig::deriveJobId(const CronJob& job) {
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const std::string& text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xff;   // Field separator
+        hash *= 1099511628211ULL;
+    };
+    mix(job.description);
+    mix(job.command);
+    if (!job.plugin_arg.empty()) {
+        mix(job.plugin_arg);   // Same plugin with different arguments
+    }
+    mix(job.schedule.minute);
+    mix(job.schedule.hour);
+    mix(job.schedule.day_of_month);
+    mix(job.schedule.month);
+    mix(job.schedule.day_of_week);
+    
+    hash = (hash ^ (hash >> 48)) & 0xffffffffffffULL;
+    char buffer[13];
+    std::snprintf(buffer, sizeof(buffer), "%012llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
 /**
  * Parse cron schedule string to CronSchedule structure
  * Supports formats like "0 9 * * 1-5" (Monday-Friday at 9 AM)
@@ -5,6 +5,7 @@
 #include <string>
 #include <sstream>
 #include "CronTypes.h"
+#include "JobMatrix.h"
 #include "json.hpp"
 #include <sys/statvfs.h>
 #include <sstream> 
@@ -17,6 +18,9 @@
  */
 class JobConfig {
 public:
+    /** Upper bound of the stages of a pipeline job */
+    static constexpr size_t MAX_PIPELINE_STAGES = 16;
+    
     /**
      * Load jobs from JSON configuration file
      * 
@@ -51,6 +55,20 @@ public:
      */
     static bool saveJobsToJson(const std::vector<CronJob>& jobs, const std::string& filename);
     
+    /**
+     * Convert one job to its jobs.json object
+     */
+    static nlohmann::json jobToJson(const CronJob& job);
+    
+    /**
+     * Job ID of every entry of a jobs.json document, as parseJobsFromJson
+     * assigns them but ignoring conditions ("" for entries it would skip)
+     * 
+     * @param doc Parsed jobs.json document
+     * @return One ID per element of doc["jobs"]
+     */
+    static std::vector<std::string> entryIds(const nlohmann::json& doc);
+    
     // NEW: Validation methods for auto-reload feature
     /**
      * Validate JSON file before loading
@@ -60,6 +78,14 @@ public:
      */
     static bool validateJobsFile(const std::string& filename, std::string& errorMsg);
     
+    /**
+     * Validate JSON content already read into memory
+     * @param content Raw JSON content
+     * @param errorMsg Output error message if validation fails
+     * @return true if content is valid and parseable
+     */
+    static bool validateJobsJson(const std::string& content, std::string& errorMsg);
+    
     /**
      * Quick validation of JSON structure without full parsing
      * @param json_string Raw JSON content
@@ -68,6 +94,29 @@ public:
     static bool isValidJobsJson(const std::string& json_string);
 
 private:
+    /**
+     * Parse the elements of a "jobs" array
+     * @param check_conditions Drop jobs whose conditions are not met
+     * @param sources Optional output: array index of each returned job
+     */
+    static std::vector<CronJob> parseJobEntries(const nlohmann::json& entries, bool check_conditions,
+                                                std::vector<size_t>* sources);
+    
+    /**
+     * Read a "matrix" object (parameter name -> array of string values)
+     */
+    static bool parseMatrix(const nlohmann::json& matrix_json, JobMatrix& matrix, std::string& error);
+    
+    /**
+     * Read a "quota" object (window, limits, group, action)
+     */
+    static bool parseQuota(const nlohmann::json& quota_json, JobQuota& quota, std::string& error);
+    
+    /**
+     * Derive a stable job ID from description, command and schedule
+     */
+    static std::string deriveJobId(const CronJob& job);
+    
     /**
      * Parse cron schedule string to CronSchedule structure
      */
@@ -8,14 +8,74 @@
  */
 
 #include "JobExecutor.h"
-#include <cstdlib>
+#include "AgentPool.h"
+#include "AllocTracker.h"
+#include "BundleRunner.h"
+#include "CronScheduler.h"
+#include "EventBus.h"
+#include "ExecutableResolver.h"
+#include "PluginRunner.h"
+#include "Quotas.h"
+#include "StartLag.h"
+#include "UserAccounts.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
 #include <filesystem>
 #include <string>
 
+namespace {
+
+/** Pool receiving "executor": "agent" jobs (set by the daemon) */
+std::atomic<AgentPool*> g_agentPool{nullptr};
+
+/** PATH cache for direct execution of simple commands (set by the daemon) */
+std::atomic<ExecutableResolver*> g_resolver{nullptr};
+
+/** Worker shells per bundle run (set by the daemon) */
+std::atomic<size_t> g_bundleWorkers{1};
+
+/** Scheduler re-queuing runs deferred by a quota (set by the daemon) */
+std::atomic<CronScheduler*> g_scheduler{nullptr};
+
+/**
+ * Publish the "finished" event of a run (the caller checked EventBus::active())
+ */
+void publishFinished(const std::string& job_id, const std::string& description, const ExecResult& result,
+                     bool resources) {
+    const char* outcome = !result.started() ? "not_started"
+                        : result.timed_out ? "timeout"
+                        : result.hung ? "hung"
+                        : result.cancelled ? "cancelled"
+                        : result.exit_code == 0 ? "success"
+                        : result.term_signal != 0 ? "signal" : "failed";
+    nlohmann::json event = {{"description", description}, {"outcome", outcome}, {"exit_code", result.exit_code},
+                            {"duration_ms", result.duration_ms}};
+    if (result.term_signal != 0) {
+        event["signal"] = result.term_signal;
+    }
+    if (resources && result.started()) {
+        event["user_ms"] = result.user_ms;
+        event["sys_ms"] = result.sys_ms;
+        event["max_rss_kb"] = result.max_rss_kb;
+    }
+    if (!result.started()) {
+        event["error"] = result.error;
+    }
+    if (!result.output.empty()) {
+        event["output"] = result.output;
+    }
+    EventBus::publish("finished", job_id, std::move(event));
+}
+
+}
+
 /**
  * @brief Main job execution interface with comprehensive logging
  * @param job CronJob structure containing command and metadata
  * @param logger Logger instance for execution tracking and debugging
+ * @param scheduled_time Fire time the run was dispatched for (0 = now)
  * 
  * Orchestrates the complete job execution lifecycle including:
  * - Pre-execution logging with job identification
@@ -27,113 +87,563 @@
  * and the actual command execution subsystem, ensuring all executions are
  * properly tracked and logged for operational monitoring.
  */
-void JobExecutor::executeJob(const CronJob& job, Logger& logger) {
-    logger.info("Starting job: " + job.command, job.description);
+void JobExecutor::executeJob(const CronJob& job, Logger& logger, std::time_t scheduled_time) {
+    AllocScope scope(AllocTag::EXECUTOR);
+    
+    int nice = 0;
+    if (job.type == JobType::PLUGIN) {
+        if (job.quota.window_seconds == 0 || checkQuota(job, logger, nice)) {
+            executePlugin(job, logger, scheduled_time);
+        }
+        return;
+    }
+    if (!job.user.empty() && !UserAccounts::acquire(job.user)) {
+        logger.warning("Job skipped: user " + job.user + " is at its concurrency limit", job.description);
+        if (EventBus::active()) {
+            EventBus::publish("skipped", job.id, {{"description", job.description}, {"reason", "user_limit"}});
+        }
+        return;
+    }
+    // After the user cap, so a throttled run does not use up quota
+    if (job.quota.window_seconds > 0 && !checkQuota(job, logger, nice)) {
+        if (!job.user.empty()) {
+            UserAccounts::abandon(job.user);
+        }
+        return;
+    }
+    if (job.remote) {
+        executeRemote(job, logger, nice);
+        return;
+    }
+    if (job.type == JobType::PIPELINE) {
+        ExecResult result = executePipeline(job, logger, nice);
+        if (!job.user.empty()) {
+            UserAccounts::release(job.user, result);
+        }
+        if (job.quota.window_seconds > 0) {
+            Quotas::charge(job.id, job.quota, result);
+        }
+        return;
+    }
     
     /**
-     * Execute command with 300-second (5-minute) timeout protection
-     * This prevents runaway processes from consuming system resources
-     * indefinitely and ensures the daemon remains responsive for other
-     * scheduled jobs. The timeout value is chosen to accommodate most
-     * typical cron job execution times while preventing system lockup.
+     * A prestart job is dispatched prestart_seconds ahead of its fire time:
+     * its process is forked now and released at the fire time itself by
+     * the release timer, which hands it back to the scheduler's workers.
+     * This worker is free again meanwhile (without a scheduler it waits).
      */
-    int result = executeWithTimeout(job.command, 300);
+    ExecRequest request = buildRequest(job);
+    request.nice = nice;
+    request.due_ms = static_cast<int64_t>(scheduled_time) * 1000;
+    request.prestart = job.prestart_seconds > 0 && scheduled_time > std::time(nullptr);
+    logger.info(std::string(request.prestart ? "Prestarting job: " : "Starting job: ") + job.command,
+                job.description);
+    if (request.prestart && g_scheduler.load()) {
+        Logger* log = &logger;
+        auto on_release = [job, log, scheduled_time](PrestartedRun run) {
+            auto supervise = [job, log, scheduled_time, run]() mutable {
+                AllocScope worker_scope(AllocTag::EXECUTOR);
+                ExecResult result;
+                if (EventBus::active()) {
+                    ProcessRunner::finish(std::move(run), result, nullptr, [&job](pid_t pid) {
+                        EventBus::publish("started", job.id, {{"description", job.description}, {"pid", pid}});
+                    });
+                } else {
+                    ProcessRunner::finish(std::move(run), result);
+                }
+                completeCommand(job, *log, scheduled_time, true, result);
+            };
+            CronScheduler* scheduler = g_scheduler.load();
+            if (!scheduler || !scheduler->submit(job.id, supervise)) {
+                supervise();   // Scheduler stopped: only at shutdown, the run was cancelled
+            }
+        };
+        ExecResult result;
+        if (!ProcessRunner::prestart(request, std::move(on_release), result.error)) {
+            completeCommand(job, logger, scheduled_time, true, result);
+        }
+        return;
+    }
     
     /**
-     * Result analysis and logging based on exit codes
-     * 
-     * Process exit code interpretation:
-     * - 0: Successful execution (standard Unix convention)
-     * - 124 * 256: Timeout occurred (timeout command exit code, shifted)
-     * - Other values: Command-specific error codes
-     * 
-     * The exit code is multiplied by 256 because system() returns the
-     * exit status in the high byte of the return value (WEXITSTATUS format).
+     * Execute command with timeout protection (default 300 seconds)
+     * This prevents runaway processes from consuming system resources
+     * indefinitely and ensures the daemon remains responsive for other
+     * scheduled jobs. The job runs in its own process group, so on timeout
+     * the whole group (pipelines, background children) is terminated.
      */
-    if (result == 0) {
-        // Command completed successfully
-        logger.success("Job completed successfully", job.description);
-    } else if (result == 124 * 256) {
-        // Command terminated due to timeout
-        logger.error("Job timed out after 300 seconds", job.description);
+    ExecResult result;
+    if (EventBus::active()) {
+        ProcessRunner::run(request, result, nullptr, [&job](pid_t pid) {
+            EventBus::publish("started", job.id, {{"description", job.description}, {"pid", pid}});
+        });
     } else {
-        // Command failed with specific exit code
-        logger.error("Job failed with exit code " + std::to_string(result / 256), job.description);
+        ProcessRunner::run(request, result);
     }
+    completeCommand(job, logger, scheduled_time, request.prestart, result);
 }
 
 /**
- * @brief Executes command with timeout protection and path resolution
- * @param command Shell command string to execute
- * @param timeout_seconds Maximum execution time in seconds
- * @return Process exit code (0 for success, non-zero for failure/timeout)
+ * @brief Accounts and logs a finished command run
  * 
- * Implements robust command execution with the following features:
+ * Shared by runs supervised on the dispatching worker and prestart runs
+ * supervised on whichever worker took them over after their release.
+ */
+void JobExecutor::completeCommand(const CronJob& job, Logger& logger, std::time_t scheduled_time, bool prestart,
+                                  const ExecResult& result) {
+    if (!job.user.empty()) {
+        UserAccounts::release(job.user, result);
+    }
+    if (job.quota.window_seconds > 0) {
+        Quotas::charge(job.id, job.quota, result);
+    }
+    if (result.started() && !result.cancelled && scheduled_time > 0) {
+        StartLag::record(prestart, result.start_lag_us);
+        if (prestart) {
+            logger.debug("Released " + std::to_string(result.start_lag_us) + " us after the fire time",
+                         job.description);
+        }
+    }
+    logResult(job.id, job.description, job.timeout_seconds, job.idle_timeout_seconds, result, logger);
+}
+
+/**
+ * @brief Supervises a run handed over by the previous daemon image to completion
+ * @param run Run state from the upgrade hand-over
+ * @param logger Logger instance for execution tracking
  * 
- * 1. **Path Resolution**: Converts relative paths (./script) to absolute paths
- *    to ensure commands execute correctly regardless of daemon working directory
+ * The process kept running during the upgrade; its timeout still counts
+ * from the original start. The user slot is taken again because the
+ * per-user counters start from zero in the new image.
+ */
+void JobExecutor::resumeRun(const SupervisedRun& run, Logger& logger) {
+    AllocScope scope(AllocTag::EXECUTOR);
+    const std::string& user = run.request.user;
+    if (!user.empty()) {
+        UserAccounts::acquire(user, true);
+    }
+    logger.info("Resumed job after upgrade (pid " + std::to_string(run.pid) + ")", run.request.label);
+    
+    ExecResult result;
+    ProcessRunner::adopt(run, result);
+    if (!user.empty()) {
+        UserAccounts::release(user, result);
+    }
+    logResult(run.request.job_id, run.request.label, run.request.timeout_seconds, run.request.idle_timeout_seconds,
+              result, logger);
+}
+
+/**
+ * @brief Runs the due jobs of one bundle in shared worker shells
+ * @param bundle Bundle name used for the summary line
+ * @param jobs Local command jobs of the bundle due at the same time
+ * @param logger Logger instance for execution tracking
  * 
- * 2. **Timeout Protection**: Uses system timeout command to prevent runaway
- *    processes, with graceful fallback if timeout utility is unavailable
+ * Each job keeps its own start and result lines, the result logged as
+ * soon as its command finishes; only resource usage is not known per
+ * job. The summary at debug level tells how many processes the bundle
+ * needed. The shells run with the daemon's credentials, so a job that
+ * names a user is never bundled: it runs on its own through executeJob().
+ */
+void JobExecutor::executeBundle(const std::string& bundle, const std::vector<CronJob>& jobs, Logger& logger) {
+    AllocScope scope(AllocTag::EXECUTOR);
+    
+    std::vector<const CronJob*> bundled;
+    bundled.reserve(jobs.size());
+    for (const CronJob& job : jobs) {
+        if (job.user.empty()) {
+            bundled.push_back(&job);
+        } else {
+            logger.warning("Job runs as user " + job.user + ", not in bundle " + bundle, job.description);
+            executeJob(job, logger);
+        }
+    }
+    if (bundled.empty()) {
+        return;
+    }
+    
+    std::vector<BundledCommand> commands(bundled.size());
+    for (size_t i = 0; i < bundled.size(); ++i) {
+        const CronJob& job = *bundled[i];
+        commands[i].command = job.command;
+        commands[i].timeout_seconds = job.timeout_seconds;
+        logger.info("Starting job: " + job.command + " (bundle " + bundle + ")", job.description);
+        if (EventBus::active()) {
+            EventBus::publish("started", job.id, {{"description", job.description}, {"bundle", bundle}});
+        }
+    }
+    
+    std::vector<ExecResult> results;
+    int64_t total_ms = 0;
+    size_t shells = BundleRunner::run(commands, results, g_bundleWorkers.load(),
+        [&](size_t i) {
+            const CronJob& job = *bundled[i];
+            total_ms += results[i].duration_ms;
+            logResult(job.id, job.description, job.timeout_seconds, 0, results[i], logger, false);
+        });
+    logger.debug("Bundle " + bundle + ": " + std::to_string(bundled.size()) + " jobs in " +
+                 std::to_string(shells) + " shell processes, " + std::to_string(total_ms) + " ms");
+}
+
+void JobExecutor::setAgentPool(AgentPool* pool) {
+    g_agentPool.store(pool);
+}
+
+void JobExecutor::setResolver(ExecutableResolver* resolver) {
+    g_resolver.store(resolver);
+}
+
+void JobExecutor::setBundleWorkers(size_t workers) {
+    g_bundleWorkers.store(workers > 0 ? workers : 1);
+}
+
+void JobExecutor::setScheduler(CronScheduler* scheduler) {
+    g_scheduler.store(scheduler);
+}
+
+/**
+ * @brief Admits a run of a job with a quota, or skips, defers or downgrades it
+ * @param job Job with "quota"
+ * @param logger Logger instance for execution tracking
+ * @param nice Set to Quotas::DOWNGRADE_NICE when the run is downgraded
+ * @return true if the run goes ahead
  * 
- * 3. **Error Handling**: Distinguishes between timeout utility availability
- *    issues and actual command execution problems
+ * A deferred run is queued again for the time the window frees some
+ * room; when the job's own schedule fires before that, the run is
+ * simply skipped and the next regular run checks the quota again.
+ */
+bool JobExecutor::checkQuota(const CronJob& job, Logger& logger, int& nice) {
+    std::string reason;
+    std::time_t retry_at = 0;
+    switch (Quotas::admit(job.id, job.quota, std::time(nullptr), reason, retry_at)) {
+        case QuotaDecision::RUN:
+            return true;
+        case QuotaDecision::DOWNGRADE:
+            logger.warning("Quota exhausted (" + reason + "), running at lower priority", job.description);
+            nice = Quotas::DOWNGRADE_NICE;
+            return true;
+        case QuotaDecision::DEFER: {
+            CronScheduler* scheduler = g_scheduler.load();
+            if (scheduler && scheduler->deferRun(job.id, retry_at)) {
+                char at[16];
+                struct tm local;
+                localtime_r(&retry_at, &local);
+                std::strftime(at, sizeof(at), "%H:%M:%S", &local);
+                Quotas::refused(job.id, job.quota, QuotaDecision::DEFER);
+                logger.warning("Job deferred to " + std::string(at) + ": quota " + reason, job.description);
+                if (EventBus::active()) {
+                    EventBus::publish("deferred", job.id, {{"description", job.description}, {"reason", "quota"},
+                                                           {"quota", reason}, {"until", retry_at}});
+                }
+                return false;
+            }
+            break;
+        }
+        case QuotaDecision::SKIP:
+            break;
+    }
+    Quotas::refused(job.id, job.quota, QuotaDecision::SKIP);
+    logger.warning("Job skipped: quota " + reason, job.description);
+    if (EventBus::active()) {
+        EventBus::publish("skipped", job.id, {{"description", job.description}, {"reason", "quota"},
+                                              {"quota", reason}});
+    }
+    return false;
+}
+
+/**
+ * @brief Builds the process request for a command job
+ * @param job Command job
+ * @return ExecRequest running the command directly or through /bin/sh
+ * 
+ * Commands without shell syntax are executed directly with the program
+ * path from the resolver's cache; everything else goes through /bin/sh.
  * 
- * The function prioritizes using the system's timeout command for reliability
- * but gracefully degrades to direct execution if timeout is not available,
- * ensuring compatibility across different Unix/Linux distributions.
+ * Relative path resolution for improved reliability: converts "./script"
+ * to an absolute path to prevent execution failures when the daemon's
+ * working directory differs from the expected script location. The
+ * daemon never changes directory, so the path is read once.
  */
-int JobExecutor::executeWithTimeout(const std::string& command, int timeout_seconds) {
-    // Initialize with original command for fallback scenarios
-    std::string full_command = command;
-    
-    /**
-     * Relative path resolution for improved reliability
-     * 
-     * Converts "./script" format to absolute paths to prevent execution
-     * failures when the daemon's working directory differs from the
-     * expected script location. This is critical for cron jobs that
-     * assume specific working directories.
-     */
-    if (command.find("./") == 0) {
-        try {
-            auto current_path = std::filesystem::current_path();
-            full_command = current_path.string() + "/" + command.substr(2);
-        } catch (const std::exception& e) {
-            /**
-             * Path resolution failure handling
-             * If filesystem operations fail (permissions, invalid paths, etc.),
-             * continue with the original command rather than failing entirely.
-             * This provides graceful degradation for edge cases.
-             */
-            // Continue with original command if path resolution fails
+ExecRequest JobExecutor::buildRequest(const CronJob& job) {
+    ExecRequest request;
+    ExecutableResolver* resolver = g_resolver.load();
+    if (!resolver || !resolver->argvFor(job, request.argv)) {
+        std::string full_command = job.command;
+        if (job.user.empty() && job.command.find("./") == 0) {
+            static const std::string daemon_cwd = [] {
+                std::error_code ec;
+                return std::filesystem::current_path(ec).string();
+            }();
+            if (!daemon_cwd.empty()) {
+                full_command = daemon_cwd + "/" + job.command.substr(2);
+            }
         }
+        request.argv = ProcessRunner::shellArgv(full_command);
+    }
+    request.env = job.env;
+    request.timeout_seconds = job.timeout_seconds;
+    request.idle_timeout_seconds = job.idle_timeout_seconds;
+    request.heartbeat_file = job.heartbeat_file;
+    if (!job.heartbeat_file.empty()) {
+        request.env.push_back("NANOCRON_HEARTBEAT=" + job.heartbeat_file);
+    }
+    request.cpu_limit_seconds = job.cpu_limit_seconds;
+    request.memory_limit_mb = job.memory_limit_mb;
+    request.user = job.user;
+    request.label = job.description;
+    request.job_id = job.id;
+    return request;
+}
+
+/**
+ * @brief Runs a pipeline job: all stages at once, connected by pipes
+ * @param job CronJob of type PIPELINE
+ * @param logger Logger instance for execution tracking
+ * @param nice Priority decrease of every stage (quota downgrade, 0 = none)
+ * @return Outcome counted for the job under its failure policy
+ * 
+ * Every stage is built like a command job of its own (direct exec or
+ * /bin/sh, the job's env and user, the stage's or the job's timeout and
+ * limits) and logs its own resource line. The job's result is the
+ * rightmost failing stage ("any", like pipefail), the stage whose failure
+ * stopped the others ("abort") or the last stage ("last"); stages stopped
+ * by an abort are never blamed. It is logged with the usual lines so the
+ * pipeline reads like one job in the log.
+ */
+ExecResult JobExecutor::executePipeline(const CronJob& job, Logger& logger, int nice) {
+    std::vector<ExecRequest> requests;
+    requests.reserve(job.stages.size());
+    for (const PipelineStage& stage : job.stages) {
+        CronJob stage_job;
+        stage_job.command = stage.command;
+        stage_job.user = job.user;
+        stage_job.env = job.env;
+        stage_job.timeout_seconds = stage.timeout_seconds > 0 ? stage.timeout_seconds : job.timeout_seconds;
+        stage_job.cpu_limit_seconds = stage.cpu_limit_seconds > 0 ? stage.cpu_limit_seconds : job.cpu_limit_seconds;
+        stage_job.memory_limit_mb = stage.memory_limit_mb > 0 ? stage.memory_limit_mb : job.memory_limit_mb;
+        stage_job.description = job.description;
+        requests.push_back(buildRequest(stage_job));
+        requests.back().nice = nice;
+    }
+    logger.info("Starting pipeline: " + job.command, job.description);
+    if (EventBus::active()) {
+        EventBus::publish("started", job.id, {{"description", job.description}, {"stages", job.stages.size()}});
     }
     
-    /**
-     * Primary execution path: Use system timeout command
-     * 
-     * Constructs a timeout-protected command using the Unix timeout utility.
-     * This provides reliable process termination after the specified duration
-     * and is the preferred execution method for production environments.
-     */
-    std::string timed_command = "timeout " + std::to_string(timeout_seconds) + " " + full_command;
-    int result = std::system(timed_command.c_str());
+    std::vector<ExecResult> results;
+    size_t aborted_by = SIZE_MAX;
+    ProcessRunner::runPipeline(requests, results, job.pipeline_relay,
+                               job.pipeline_failure == PipelineFailure::ABORT, &aborted_by);
     
-    /**
-     * Fallback execution for systems without timeout command
-     * 
-     * Exit code 127 * 256 indicates command not found (timeout utility missing).
-     * In this case, fall back to direct command execution without timeout
-     * protection. While less safe, this ensures compatibility with minimal
-     * systems that may not have timeout installed.
-     * 
-     * Note: The original code checks for 127 * 256, but this should be
-     * corrected to detect timeout command availability more reliably.
-     */
-    if (result == 127 * 256) {
-        result = std::system(full_command.c_str());
+    size_t counted = results.size() - 1;
+    size_t rightmost_failure = SIZE_MAX;
+    ExecResult total;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ExecResult& stage = results[i];
+        std::string label = "Stage " + std::to_string(i + 1) + " (" + job.stages[i].command + "): ";
+        if (!stage.started()) {
+            logger.debug(label + "not started: " + stage.error, job.description);
+        } else {
+            logger.debug(label + (stage.term_signal ? "signal " + std::to_string(stage.term_signal)
+                                                     : "exit " + std::to_string(stage.exit_code)) +
+                         ", " + std::to_string(stage.duration_ms) + " ms wall, " +
+                         std::to_string(stage.user_ms) + " ms user, " + std::to_string(stage.sys_ms) +
+                         " ms sys, " + std::to_string(stage.max_rss_kb) + " KB max RSS" +
+                         (job.pipeline_relay ? ", " + std::to_string(stage.bytes_out) + " bytes out" : ""),
+                         job.description);
+        }
+        // Stages stopped because another one failed are victims, not the cause
+        bool failed = !stage.started() || (!stage.cancelled && (stage.timed_out || stage.exit_code != 0));
+        if (failed) {
+            rightmost_failure = i;
+        }
+        total.duration_ms = std::max(total.duration_ms, stage.duration_ms);
+        total.user_ms += stage.user_ms;
+        total.sys_ms += stage.sys_ms;
+        total.max_rss_kb = std::max(total.max_rss_kb, stage.max_rss_kb);
     }
     
+    if (job.pipeline_failure == PipelineFailure::ABORT && aborted_by < results.size()) {
+        counted = aborted_by;
+    } else if (job.pipeline_failure != PipelineFailure::LAST && rightmost_failure != SIZE_MAX) {
+        counted = rightmost_failure;   // pipefail: the last stage that failed
+    }
+    ExecResult result = results[counted];
+    result.duration_ms = total.duration_ms;
+    result.user_ms = total.user_ms;
+    result.sys_ms = total.sys_ms;
+    result.max_rss_kb = total.max_rss_kb;
+    if (counted + 1 < results.size()) {
+        logger.warning("Pipeline failed at stage " + std::to_string(counted + 1) + ": " +
+                       job.stages[counted].command, job.description);
+    }
+    logResult(job.id, job.description, requests[counted].timeout_seconds, 0, result, logger);
     return result;
+}
+
+/**
+ * @brief Sends a command job to the least loaded agent
+ * @param job Command job with "executor": "agent"
+ * @param logger Logger instance for execution tracking
+ * @param nice Priority decrease applied by the agent (quota downgrade, 0 = none)
+ * 
+ * Returns as soon as the run is on the wire, so a worker thread is not
+ * held for the duration of remote runs. The result is logged from the
+ * agent pool thread when the agent reports completion (or is lost).
+ */
+void JobExecutor::executeRemote(const CronJob& job, Logger& logger, int nice) {
+    AgentPool* pool = g_agentPool.load();
+    std::string error;
+    uint64_t run_id = 0;
+    
+    if (!pool) {
+        error = "no agent listener is configured (AGENT_LISTEN)";
+    } else {
+        std::string job_id = job.id;
+        std::string description = job.description;
+        std::string user = job.user;
+        int timeout_seconds = job.timeout_seconds;
+        int idle_timeout_seconds = job.idle_timeout_seconds;
+        JobQuota quota = job.quota;
+        Logger* log = &logger;
+        ExecRequest request = buildRequest(job);
+        request.nice = nice;
+        run_id = pool->submit(job.id, request,
+            [job_id, description, user, timeout_seconds, idle_timeout_seconds, quota, log](const ExecResult& result,
+                                                                                          const std::string& agent_id) {
+                if (!user.empty()) {
+                    UserAccounts::release(user, result);
+                }
+                if (quota.window_seconds > 0) {
+                    Quotas::charge(job_id, quota, result);
+                }
+                if (result.started()) {
+                    log->info("Finished on agent " + agent_id, description);
+                }
+                logResult(job_id, description, timeout_seconds, idle_timeout_seconds, result, *log);
+            }, error);
+    }
+    
+    if (run_id == 0) {
+        if (!job.user.empty()) {
+            ExecResult not_started;
+            not_started.error = error;
+            UserAccounts::release(job.user, not_started);
+        }
+        logger.error("Job not dispatched: " + error, job.description);
+        if (EventBus::active()) {
+            EventBus::publish("skipped", job.id, {{"description", job.description}, {"reason", "no_agent"},
+                                                  {"error", error}});
+        }
+    } else {
+        logger.info("Starting job on agent: " + job.command, job.description);
+        if (EventBus::active()) {
+            EventBus::publish("started", job.id, {{"description", job.description}, {"executor", "agent"}});
+        }
+    }
+}
+
+/**
+ * @brief Logs the outcome of a command run and publishes its "finished" event
+ * @param job_id Job ID for the event
+ * @param description Job description used as log tag
+ * @param timeout_seconds Configured timeout for the timeout message
+ * @param idle_timeout_seconds Configured idle timeout for the hung message
+ * @param result Outcome reported by ProcessRunner or an agent
+ * @param logger Logger instance
+ * 
+ * Keeps the historical log lines ("Job completed successfully", "Job timed
+ * out after N seconds", "Job failed with exit code N") so nanoCronCLI and
+ * existing log filters keep working. Resource usage is logged at debug
+ * level; the output tail of failed runs at warning level.
+ */
+void JobExecutor::logResult(const std::string& job_id, const std::string& description, int timeout_seconds,
+                            int idle_timeout_seconds, const ExecResult& result, Logger& logger, bool resources) {
+    if (EventBus::active()) {
+        publishFinished(job_id, description, result, resources);
+    }
+    if (!result.started()) {
+        logger.error("Job failed to start: " + result.error, description);
+        return;
+    }
+    
+    if (resources) {
+        logger.debug("Resources: " + std::to_string(result.duration_ms) + " ms wall, " +
+                     std::to_string(result.user_ms) + " ms user, " + std::to_string(result.sys_ms) +
+                     " ms sys, " + std::to_string(result.max_rss_kb) + " KB max RSS", description);
+    } else {
+        logger.debug("Duration: " + std::to_string(result.duration_ms) + " ms wall", description);
+    }
+    
+    if (result.timed_out) {
+        logger.error("Job timed out after " + std::to_string(timeout_seconds) + " seconds", description);
+    } else if (result.hung) {
+        logger.error("Job hung: no output or heartbeat for " + std::to_string(idle_timeout_seconds) +
+                     " seconds, killed after " + std::to_string(result.duration_ms / 1000) + " seconds", description);
+    } else if (result.cancelled) {
+        logger.warning("Job cancelled", description);
+    } else if (result.exit_code == 0) {
+        logger.success("Job completed successfully", description);
+        return;
+    } else if (result.term_signal != 0) {
+        logger.error("Job killed by signal " + std::to_string(result.term_signal), description);
+    } else {
+        logger.error("Job failed with exit code " + std::to_string(result.exit_code), description);
+    }
+    if (!result.output.empty()) {
+        logger.warning("Output: " + result.output, description);
+    }
+}
+
+/**
+ * @brief Runs a plugin job in-process (or in an isolated child) and logs the result
+ * @param job CronJob of type PLUGIN
+ * @param logger Logger instance for execution tracking
+ * @param scheduled_time Fire time passed to the plugin (0 = current minute)
+ * 
+ * Uses the same start/success/error log lines as command jobs so plugin
+ * runs show up identically in the log and in nanoCronCLI.
+ */
+void JobExecutor::executePlugin(const CronJob& job, Logger& logger, std::time_t scheduled_time) {
+    logger.info("Starting job: plugin " + job.plugin_path + (job.plugin_isolate ? " (isolated)" : ""),
+                job.description);
+    if (EventBus::active()) {
+        EventBus::publish("started", job.id, {{"description", job.description}, {"plugin", job.plugin_path}});
+    }
+    
+    std::time_t now = std::time(nullptr);
+    auto started = std::chrono::steady_clock::now();
+    PluginOutcome outcome = PluginRunner::run(job, logger, scheduled_time > 0 ? scheduled_time : now - now % 60);
+    if (job.quota.window_seconds > 0) {
+        // Plugins share the daemon's rusage; only their wall time is charged
+        ExecResult charged;
+        charged.duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count();
+        Quotas::charge(job.id, job.quota, charged);
+    }
+    if (EventBus::active()) {
+        const char* result = !outcome.loaded ? "not_started"
+                           : outcome.timed_out ? "timeout"
+                           : outcome.cancelled ? "cancelled"
+                           : outcome.code == 0 ? "success" : "failed";
+        nlohmann::json event = {{"description", job.description}, {"outcome", result}, {"exit_code", outcome.code}};
+        if (!outcome.error.empty()) {
+            event["error"] = outcome.error;
+        }
+        EventBus::publish("finished", job.id, std::move(event));
+    }
+    
+    if (!outcome.loaded) {
+        logger.error("Plugin failed to run: " + outcome.error, job.description);
+    } else if (outcome.timed_out) {
+        logger.error("Job timed out after " + std::to_string(job.timeout_seconds) + " seconds", job.description);
+    } else if (outcome.cancelled) {
+        logger.warning("Plugin job cancelled", job.description);
+    } else if (outcome.code == 0) {
+        logger.success("Job completed successfully", job.description);
+    } else if (!outcome.error.empty()) {
+        logger.error("Plugin failed: " + outcome.error, job.description);
+    } else {
+        logger.error("Job failed with exit code " + std::to_string(outcome.code), job.description);
+    }
 }
\ No newline at end of file
@@ -1,14 +1,28 @@
 #ifndef JOB_EXECUTOR_H
 #define JOB_EXECUTOR_H
 
+#include <ctime>
+#include <string>
+#include <vector>
 #include "CronTypes.h"
 #include "Logger.h"
+#include "ProcessRunner.h"
+
+class AgentPool;
+class CronScheduler;
+class ExecutableResolver;
 
 /**
  * JobExecutor Class - Handles job execution
  * 
  * Manages the actual execution of scheduled jobs with
  * timeout handling, error management, and detailed logging.
+ * Command jobs run locally through ProcessRunner, or on a remote
+ * nanoCronAgent when the job asks for "executor": "agent".
+ * Jobs sharing a "bundle" and a fire time run together in a few worker
+ * shells (BundleRunner) instead of one process each. Pipeline jobs start
+ * their stages together through ProcessRunner::runPipeline. Runs of jobs
+ * with a "quota" are checked and charged through Quotas.
  */
 class JobExecutor {
 public:
@@ -17,18 +31,128 @@ public:
      * 
      * @param job The job to execute
      * @param logger Logger instance for output
+     * @param scheduled_time Fire time of the run (0 = now); a "prestart" job
+     *                       dispatched ahead of it starts exactly at it
+     */
+    static void executeJob(const CronJob& job, Logger& logger, std::time_t scheduled_time = 0);
+    
+    /**
+     * Execute the runs of one bundle due at the same time
+     * 
+     * @param bundle Bundle name (log tag of the summary line)
+     * @param jobs Local command jobs of the bundle, run in this order
+     * @param logger Logger instance for output
+     */
+    static void executeBundle(const std::string& bundle, const std::vector<CronJob>& jobs, Logger& logger);
+    
+    /**
+     * Continue a command run started by the previous daemon image
+     * Blocks until the run finishes, then logs it like executeJob().
+     * 
+     * @param run Run state handed over on upgrade
+     * @param logger Logger instance for output
+     */
+    static void resumeRun(const SupervisedRun& run, Logger& logger);
+    
+    /**
+     * Route "executor": "agent" jobs to this pool (nullptr = none)
+     * 
+     * @param pool Agent pool owned by the caller; must outlive every run
+     */
+    static void setAgentPool(AgentPool* pool);
+    
+    /**
+     * Run simple commands directly with cached PATH lookups (nullptr = always /bin/sh)
+     * 
+     * @param resolver Resolver owned by the caller; must outlive every run
+     */
+    static void setResolver(ExecutableResolver* resolver);
+    
+    /**
+     * Worker shells per bundle run (BUNDLE_WORKERS, default 1)
+     */
+    static void setBundleWorkers(size_t workers);
+    
+    /**
+     * Retry runs refused by a "defer" quota through this scheduler (nullptr = skip them)
+     * 
+     * @param scheduler Scheduler owned by the caller; must outlive every run
+     */
+    static void setScheduler(CronScheduler* scheduler);
+    
+    /**
+     * Build the process request for a command job (shell, env, limits)
+     * 
+     * @param job Command job
+     * @return Request ready for ProcessRunner or an agent
      */
-    static void executeJob(const CronJob& job, Logger& logger);
+    static ExecRequest buildRequest(const CronJob& job);
     
 private:
     /**
-     * Execute job with timeout and advanced error handling
+     * Execute a plugin job through PluginRunner
+     * 
+     * @param job The plugin job to execute
+     * @param logger Logger instance for output
+     * @param scheduled_time Fire time of the run (0 = current minute)
+     */
+    static void executePlugin(const CronJob& job, Logger& logger, std::time_t scheduled_time);
+    
+    /**
+     * Run the stages of a pipeline job and log each stage and the outcome
+     * 
+     * @param job The pipeline job to execute
+     * @param logger Logger instance for output
+     * @param nice Priority lowered by this much for every stage (quota downgrade)
+     * @return Outcome of the pipeline under its failure policy
+     */
+    static ExecResult executePipeline(const CronJob& job, Logger& logger, int nice);
+    
+    /**
+     * Send a command job to the agent pool; the result is logged on completion
+     * 
+     * @param job The command job to execute
+     * @param logger Logger instance for output
+     * @param nice Priority lowered by this much (quota downgrade)
+     */
+    static void executeRemote(const CronJob& job, Logger& logger, int nice);
+    
+    /**
+     * Apply a job's quota to the run about to start
+     * 
+     * @param job Job with a quota
+     * @param logger Logger instance for output
+     * @param nice Output: priority to lower the run by (downgrade)
+     * @return false if the run was skipped or deferred
+     */
+    static bool checkQuota(const CronJob& job, Logger& logger, int& nice);
+    
+    /**
+     * Account and log a finished command run (user slot, quota, start lag)
      * 
-     * @param command Command to execute
-     * @param timeout_seconds Maximum execution time (default: 5 minutes)
-     * @return Command exit code
+     * @param job The command job that ran
+     * @param logger Logger instance for output
+     * @param scheduled_time Fire time of the run (0 = now)
+     * @param prestart The run was prestarted
+     * @param result Outcome of the run
+     */
+    static void completeCommand(const CronJob& job, Logger& logger, std::time_t scheduled_time, bool prestart,
+                                const ExecResult& result);
+    
+    /**
+     * Log the outcome of a command run with the usual success/error lines
+     * and publish it as a "finished" event
+     * 
+     * @param job_id Job ID (event only)
+     * @param description Job description (log tag)
+     * @param timeout_seconds Configured timeout, for the timeout message
+     * @param idle_timeout_seconds Configured idle timeout, for the hung message
+     * @param result Outcome of the run
+     * @param logger Logger instance for output
+     * @param resources Log the run's resource usage (not known for bundled runs)
      */
-    static int executeWithTimeout(const std::string& command, int timeout_seconds = 300);
+    static void logResult(const std::string& job_id, const std::string& description, int timeout_seconds,
+                          int idle_timeout_seconds, const ExecResult& result, Logger& logger, bool resources = true);
 };
 
 #endif // JOB_EXECUTOR_H
\ No newline at end of file
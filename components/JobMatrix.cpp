@@ -0,0 +1,127 @@
+/**
+ * @file JobMatrix.cpp
+ * @brief Parameter tables of job templates and instance materialization
+ */
+
+#include "JobMatrix.h"
+#include <cctype>
+
+bool JobMatrix::addParameter(const std::string& name, std::vector<std::string> parameter_values,
+                             std::string& error) {
+    if (name.empty()) {
+        error = "matrix parameter names must not be empty";
+        return false;
+    }
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            error = "matrix parameter '" + name + "' may only use letters, digits and '_'";
+            return false;
+        }
+    }
+    if (find(name, 0, name.size()) >= 0) {
+        error = "matrix parameter '" + name + "' is listed twice";
+        return false;
+    }
+    if (parameter_values.empty()) {
+        error = "matrix parameter '" + name + "' has no values";
+        return false;
+    }
+    if (instances * parameter_values.size() > MAX_INSTANCES) {
+        error = "matrix has more than " + std::to_string(MAX_INSTANCES) + " instances";
+        return false;
+    }
+
+    // The new parameter varies fastest
+    for (size_t& stride : strides) {
+        stride *= parameter_values.size();
+    }
+    strides.push_back(1);
+    instances *= parameter_values.size();
+    names.push_back(name);
+    values.push_back(std::move(parameter_values));
+    return true;
+}
+
+std::string JobMatrix::instanceId(const std::string& template_id, size_t instance) const {
+    std::string id = template_id + "[";
+    for (size_t p = 0; p < names.size(); ++p) {
+        if (p > 0) id += ',';
+        id += names[p];
+        id += '=';
+        id += values[p][valueIndex(p, instance)];
+    }
+    id += ']';
+    return id;
+}
+
+std::string JobMatrix::substitute(const std::string& text, size_t instance) const {
+    std::string result;
+    size_t pos = 0;
+    while (true) {
+        size_t open = text.find("{{", pos);
+        size_t close = open == std::string::npos ? std::string::npos : text.find("}}", open + 2);
+        int parameter = close == std::string::npos ? -1 : find(text, open + 2, close);
+        if (parameter < 0) {
+            if (open == std::string::npos || close == std::string::npos) {
+                break;
+            }
+            result.append(text, pos, close + 2 - pos);   // Not a parameter: kept as written
+            pos = close + 2;
+            continue;
+        }
+        result.append(text, pos, open - pos);
+        result += values[parameter][valueIndex(parameter, instance)];
+        pos = close + 2;
+    }
+    result.append(text, pos, std::string::npos);
+    return result;
+}
+
+bool JobMatrix::checkPlaceholders(const std::string& text, std::string& error) const {
+    for (size_t open = text.find("{{"); open != std::string::npos; open = text.find("{{", open + 2)) {
+        size_t close = text.find("}}", open + 2);
+        if (close == std::string::npos) {
+            return true;
+        }
+        if (find(text, open + 2, close) < 0) {
+            error = "'" + text.substr(open, close + 2 - open) + "' is not a matrix parameter";
+            return false;
+        }
+        open = close;
+    }
+    return true;
+}
+
+CronJob JobMatrix::materialize(const CronJob& job, size_t instance) const {
+    CronJob result = job;
+    result.matrix.reset();
+    result.id = instanceId(job.id, instance);
+    result.description = job.description + " " + result.id.substr(job.id.size());
+    result.command = substitute(job.command, instance);
+    result.plugin_arg = substitute(job.plugin_arg, instance);
+    result.heartbeat_file = substitute(job.heartbeat_file, instance);
+    for (std::string& var : result.env) {
+        var = substitute(var, instance);
+    }
+    for (PipelineStage& stage : result.stages) {
+        stage.command = substitute(stage.command, instance);
+    }
+    return result;
+}
+
+int JobMatrix::staggerSeconds(size_t instance) const {
+    return static_cast<int>(instance * 60 / instances);
+}
+
+size_t JobMatrix::valueIndex(size_t parameter, size_t instance) const {
+    return (instance / strides[parameter]) % values[parameter].size();
+}
+
+int JobMatrix::find(const std::string& name, size_t begin, size_t end) const {
+    for (size_t p = 0; p < names.size(); ++p) {
+        if (names[p].size() == end - begin && name.compare(begin, end - begin, names[p]) == 0) {
+            return static_cast<int>(p);
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,91 @@
+#ifndef JOB_MATRIX_H
+#define JOB_MATRIX_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "CronTypes.h"
+
+/**
+ * JobMatrix Class - Parameter table of a job template
+ *
+ * A job with a "matrix" stands for one instance per combination of its
+ * parameter values:
+ *
+ *   "matrix": {"db": ["orders", "users"], "region": ["eu", "us"]}
+ *
+ * gives four instances, the last parameter varying fastest. Only the value
+ * lists are stored, so a template costs the sum of its value counts, not
+ * their product. `{{name}}` in the command, plugin_arg, heartbeat and env values is
+ * replaced by the instance's value when the instance is materialized,
+ * which the scheduler does right before each run.
+ */
+class JobMatrix {
+public:
+    /** Upper bound of the instances of one template */
+    static constexpr size_t MAX_INSTANCES = 100000;
+
+    /**
+     * Add a parameter and its values
+     *
+     * @param name Parameter name (letters, digits, '_')
+     * @param values Non-empty list of values
+     * @param error Output error message
+     * @return false for a bad or duplicate name, no values, or too many instances
+     */
+    bool addParameter(const std::string& name, std::vector<std::string> values, std::string& error);
+
+    /**
+     * Number of instances (product of the value counts)
+     */
+    size_t size() const { return instances; }
+
+    const std::vector<std::string>& parameterNames() const { return names; }
+    const std::vector<std::string>& parameterValues(size_t parameter) const { return values[parameter]; }
+
+    /**
+     * Job ID of an instance: "<template id>[name=value,...]"
+     */
+    std::string instanceId(const std::string& template_id, size_t instance) const;
+
+    /**
+     * Replace every `{{name}}` of a text with the instance's values
+     */
+    std::string substitute(const std::string& text, size_t instance) const;
+
+    /**
+     * Check that every `{{name}}` of a text names a parameter
+     */
+    bool checkPlaceholders(const std::string& text, std::string& error) const;
+
+    /**
+     * Runnable copy of a template for one instance: ID, description,
+     * command, pipeline stages, plugin_arg, heartbeat and env values substituted,
+     * no matrix
+     */
+    CronJob materialize(const CronJob& job, size_t instance) const;
+
+    /**
+     * Seconds an instance starts after the fire time when the template
+     * staggers its instances: spread evenly over the fire minute
+     */
+    int staggerSeconds(size_t instance) const;
+
+private:
+    /**
+     * Index of each parameter's value for an instance
+     */
+    size_t valueIndex(size_t parameter, size_t instance) const;
+
+    /**
+     * Parameter index of a name, or -1
+     */
+    int find(const std::string& name, size_t begin, size_t end) const;
+
+    std::vector<std::string> names;
+    std::vector<std::vector<std::string>> values;
+    std::vector<size_t> strides;   // Instances per step of each parameter
+    size_t instances = 1;
+};
+
+#endif // JOB_MATRIX_H
@@ -0,0 +1,111 @@
+/**
+ * @file JobStore.cpp
+ * @brief Live job set of the main configuration
+ */
+
+#include "JobStore.h"
+#include "AllocTracker.h"
+#include <algorithm>
+#include <unordered_set>
+
+void JobStore::reset(std::shared_ptr<const std::vector<CronJob>> snapshot) {
+    AllocScope scope(AllocTag::CONFIG);
+    std::unordered_map<std::string, Entry> loaded;
+    loaded.reserve(snapshot ? snapshot->size() : 0);
+    uint64_t seq = 0;
+    if (snapshot) {
+        for (const auto& job : *snapshot) {
+            // Aliasing pointer: shares ownership of the whole snapshot
+            loaded[job.id] = Entry{seq++, std::shared_ptr<const CronJob>(snapshot, &job)};
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.swap(loaded);
+    next_seq = seq;
+}
+
+bool JobStore::apply(JobMutation mutation, std::vector<std::shared_ptr<const CronJob>>& upserted, std::string& error) {
+    AllocScope scope(AllocTag::CONFIG);
+    upserted.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Validate the whole batch first: an ID may appear once per batch
+    std::unordered_set<std::string> seen;
+    auto once = [&](const std::string& id) {
+        if (id.empty()) {
+            error = "job without an id";
+            return false;
+        }
+        if (!seen.insert(id).second) {
+            error = "id '" + id + "' appears twice in the batch";
+            return false;
+        }
+        return true;
+    };
+    for (const auto& job : mutation.add) {
+        if (!once(job.id)) return false;
+        if (jobs.count(job.id)) {
+            error = "id '" + job.id + "' already exists";
+            return false;
+        }
+    }
+    for (const auto& job : mutation.update) {
+        if (!once(job.id)) return false;
+        if (!jobs.count(job.id)) {
+            error = "unknown id '" + job.id + "'";
+            return false;
+        }
+    }
+    for (const auto& id : mutation.remove) {
+        if (!once(id)) return false;
+        if (!jobs.count(id)) {
+            error = "unknown id '" + id + "'";
+            return false;
+        }
+    }
+
+    for (const auto& id : mutation.remove) {
+        jobs.erase(id);
+    }
+    upserted.reserve(mutation.add.size() + mutation.update.size());
+    for (auto& job : mutation.update) {
+        auto definition = std::make_shared<const CronJob>(std::move(job));
+        jobs[definition->id].job = definition;   // Keeps its position
+        upserted.push_back(std::move(definition));
+    }
+    for (auto& job : mutation.add) {
+        auto definition = std::make_shared<const CronJob>(std::move(job));
+        jobs[definition->id] = Entry{next_seq++, definition};
+        upserted.push_back(std::move(definition));
+    }
+    return true;
+}
+
+std::shared_ptr<const CronJob> JobStore::find(const std::string& id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    return it == jobs.end() ? nullptr : it->second.job;
+}
+
+std::shared_ptr<const std::vector<CronJob>> JobStore::snapshot() const {
+    AllocScope scope(AllocTag::CONFIG);
+    std::vector<const Entry*> ordered;
+    auto copy = std::make_shared<std::vector<CronJob>>();
+    std::lock_guard<std::mutex> lock(mutex);
+    ordered.reserve(jobs.size());
+    for (const auto& entry : jobs) {
+        ordered.push_back(&entry.second);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const Entry* a, const Entry* b) { return a->seq < b->seq; });
+    copy->reserve(ordered.size());
+    for (const Entry* entry : ordered) {
+        copy->push_back(*entry->job);
+    }
+    return copy;
+}
+
+size_t JobStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size();
+}
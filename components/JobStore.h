@@ -0,0 +1,75 @@
+#ifndef JOB_STORE_H
+#define JOB_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CronTypes.h"
+
+/**
+ * STRUCT: One batch of job changes, applied all or nothing
+ */
+struct JobMutation {
+    std::vector<CronJob> add;            // New IDs (error if the ID exists)
+    std::vector<CronJob> update;         // Replacements (error if the ID is unknown)
+    std::vector<std::string> remove;     // IDs to delete (error if unknown)
+};
+
+/**
+ * JobStore Class - Live job set of the main configuration
+ *
+ * Holds the jobs currently defined by jobs.json plus the mutations applied
+ * through the control socket since the file was last loaded. Jobs are
+ * indexed by ID, so applying a batch costs O(batch) instead of a reparse
+ * of the whole file; the definition order is kept for snapshot().
+ *
+ * All methods are thread-safe.
+ */
+class JobStore {
+public:
+    /**
+     * Replace the whole set with a freshly loaded configuration
+     * Entries point into the snapshot instead of copying each job.
+     */
+    void reset(std::shared_ptr<const std::vector<CronJob>> jobs);
+
+    /**
+     * Apply a batch after checking every entry against the current set
+     *
+     * @param mutation Jobs to add or update (with their ID) and IDs to remove
+     * @param upserted Output definitions of the added and updated jobs
+     * @param error Output error naming the first offending ID
+     * @return false (and nothing changed) if any entry is invalid
+     */
+    bool apply(JobMutation mutation, std::vector<std::shared_ptr<const CronJob>>& upserted, std::string& error);
+
+    /**
+     * @return Definition of a job, or null for unknown IDs
+     */
+    std::shared_ptr<const CronJob> find(const std::string& id) const;
+
+    /**
+     * Copy of every job in definition order (used for full resyncs)
+     */
+    std::shared_ptr<const std::vector<CronJob>> snapshot() const;
+
+    /**
+     * Number of jobs
+     */
+    size_t size() const;
+
+private:
+    struct Entry {
+        uint64_t seq;                          // Definition order
+        std::shared_ptr<const CronJob> job;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> jobs;
+    uint64_t next_seq = 0;
+};
+
+#endif // JOB_STORE_H
@@ -0,0 +1,220 @@
+/**
+ * @file LeaderLease.cpp
+ * @brief flock-protected lease file used for active/standby failover
+ */
+
+#include "LeaderLease.h"
+#include <chrono>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace {
+
+/** Standby polling period: bounds the takeover delay after expiry */
+const int64_t STANDBY_POLL_MS = 250;
+
+/**
+ * RAII flock() holder
+ */
+class FileLock {
+public:
+    FileLock(int fd, int operation) : fd(fd), locked(flock(fd, operation) == 0) {}
+    ~FileLock() { if (locked) flock(fd, LOCK_UN); }
+    bool ok() const { return locked; }
+private:
+    int fd;
+    bool locked;
+};
+
+std::string readAll(int fd) {
+    std::string text;
+    char buffer[512];
+    off_t offset = 0;
+    ssize_t n;
+    while ((n = pread(fd, buffer, sizeof(buffer), offset)) > 0) {
+        text.append(buffer, static_cast<size_t>(n));
+        offset += n;
+    }
+    return text;
+}
+
+} // namespace
+
+LeaderLease::LeaderLease(const std::string& path, const std::string& node_id, int ttl_seconds, Logger& loggerRef)
+    : leasePath(path), node(node_id), ttlMs(static_cast<int64_t>(ttl_seconds > 0 ? ttl_seconds : 1) * 1000),
+      logger(loggerRef) {}
+
+LeaderLease::~LeaderLease() {
+    stop();
+}
+
+bool LeaderLease::start() {
+    fd = open(leasePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        logger.error("LeaderLease: cannot open lease file " + leasePath);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        stopping = false;
+    }
+    tryAcquireOrRenew();
+    loopThread = std::thread(&LeaderLease::leaseLoop, this);
+    return true;
+}
+
+void LeaderLease::stop() {
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        stopping = true;
+    }
+    loopCv.notify_all();
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+    if (fd >= 0) {
+        if (leader.load()) {
+            release();
+        }
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool LeaderLease::isLeader() const {
+    return leader.load() && nowMs() < fenceMs.load();
+}
+
+int64_t LeaderLease::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool LeaderLease::readRecord(const std::string& path, LeaseRecord& record) {
+    int rfd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (rfd < 0) {
+        return false;
+    }
+    bool ok = false;
+    {
+        FileLock lock(rfd, LOCK_SH);
+        ok = lock.ok() && parseRecord(readAll(rfd), record);
+    }
+    close(rfd);
+    return ok;
+}
+
+/**
+ * One read-modify-write of the lease record under an exclusive lock
+ */
+bool LeaderLease::tryAcquireOrRenew() {
+    FileLock lock(fd, LOCK_EX);
+    if (!lock.ok()) {
+        return false;
+    }
+
+    LeaseRecord record;
+    parseRecord(readAll(fd), record);   // Empty or garbled file = free lease
+
+    int64_t now = nowMs();
+    bool mine = record.holder == node;
+    bool free = record.holder.empty() || record.expires_ms <= now;
+    if (!mine && !free) {
+        if (leader.exchange(false)) {
+            logger.warning("LeaderLease: leadership lost to " + record.holder);
+        }
+        heldEpoch.store(0);
+        return false;
+    }
+
+    if (!mine) {
+        record.epoch += 1;
+        record.holder = node;
+    }
+    record.expires_ms = now + ttlMs;
+
+    std::string text = formatRecord(record);
+    if (ftruncate(fd, 0) != 0 ||
+        pwrite(fd, text.data(), text.size(), 0) != static_cast<ssize_t>(text.size()) ||
+        fdatasync(fd) != 0) {
+        logger.error("LeaderLease: cannot write lease file " + leasePath);
+        return false;   // Keep the previous fence; it will expire on its own
+    }
+
+    // Stop acting one renewal interval before the recorded expiry
+    fenceMs.store(record.expires_ms - ttlMs / 3);
+    heldEpoch.store(record.epoch);
+    if (!leader.exchange(true)) {
+        logger.info("LeaderLease: " + node + " is now leader (epoch " + std::to_string(record.epoch) + ")");
+    }
+    return true;
+}
+
+/**
+ * Expire our own record so a standby can take over without waiting
+ */
+bool LeaderLease::release() {
+    FileLock lock(fd, LOCK_EX);
+    if (!lock.ok()) {
+        return false;
+    }
+    LeaseRecord record;
+    if (!parseRecord(readAll(fd), record) || record.holder != node) {
+        return false;
+    }
+    record.expires_ms = 0;
+    std::string text = formatRecord(record);
+    bool ok = ftruncate(fd, 0) == 0 &&
+              pwrite(fd, text.data(), text.size(), 0) == static_cast<ssize_t>(text.size()) &&
+              fdatasync(fd) == 0;
+    leader.store(false);
+    heldEpoch.store(0);
+    logger.info("LeaderLease: " + node + " released leadership");
+    return ok;
+}
+
+void LeaderLease::leaseLoop() {
+    std::unique_lock<std::mutex> lock(loopMutex);
+    while (!stopping) {
+        int64_t wait_ms = leader.load() ? ttlMs / 3 : STANDBY_POLL_MS;
+        loopCv.wait_for(lock, std::chrono::milliseconds(wait_ms));
+        if (stopping) {
+            break;
+        }
+        lock.unlock();
+        tryAcquireOrRenew();
+        lock.lock();
+    }
+}
+
+bool LeaderLease::parseRecord(const std::string& text, LeaseRecord& record) {
+    std::istringstream iss(text);
+    std::string token;
+    bool have_holder = false;
+    while (iss >> token) {
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = token.substr(0, eq);
+        std::string value = token.substr(eq + 1);
+        try {
+            if (key == "holder") {
+                record.holder = value;
+                have_holder = true;
+            } else if (key == "expires_ms") {
+                record.expires_ms = std::stoll(value);
+            } else if (key == "epoch") {
+                record.epoch = std::stoull(value);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return have_holder;
+}
+
+std::string LeaderLease::formatRecord(const LeaseRecord& record) {
+    return "holder=" + record.holder + " expires_ms=" + std::to_string(record.expires_ms) +
+           " epoch=" + std::to_string(record.epoch) + "\n";
+}
@@ -0,0 +1,108 @@
+#ifndef LEADER_LEASE_H
+#define LEADER_LEASE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Logger.h"
+
+/**
+ * STRUCT: Content of the shared lease file
+ */
+struct LeaseRecord {
+    std::string holder;        // Node ID of the current leader ("" = free)
+    int64_t expires_ms = 0;    // Wall-clock expiry, milliseconds since epoch
+    uint64_t epoch = 0;        // Incremented on every change of holder
+};
+
+/**
+ * LeaderLease Class - Active/standby leader election over a shared file
+ *
+ * Every instance periodically takes an exclusive flock() on the lease file
+ * and rewrites its single record. The holder renews its expiry every
+ * ttl/3; a standby polls every 250 ms and takes the lease over as soon as
+ * the recorded expiry is in the past. The flock only protects each
+ * read-modify-write, so a hung leader cannot block the others: it simply
+ * stops renewing.
+ *
+ * The leader fences itself: isLeader() turns false one renewal interval
+ * before the recorded expiry, so an instance that cannot renew stops
+ * dispatching before any standby is allowed to take over. This requires
+ * the clocks of all instances to agree within that interval (NTP).
+ */
+class LeaderLease {
+public:
+    /**
+     * @param path Lease file on storage shared by all instances
+     * @param node_id Unique name of this instance
+     * @param ttl_seconds Lease lifetime; bounds the failover time
+     * @param logger Logger for leadership changes
+     */
+    LeaderLease(const std::string& path, const std::string& node_id, int ttl_seconds, Logger& logger);
+    ~LeaderLease();
+
+    LeaderLease(const LeaderLease&) = delete;
+    LeaderLease& operator=(const LeaderLease&) = delete;
+
+    /**
+     * Start the background acquire/renew thread
+     * @return false if the lease file cannot be opened
+     */
+    bool start();
+
+    /**
+     * Stop the thread and release the lease if held, so a standby can take
+     * over immediately on planned shutdowns
+     */
+    void stop();
+
+    /**
+     * @return true while this instance holds a lease that is not about to expire
+     */
+    bool isLeader() const;
+
+    /**
+     * Epoch of the lease currently held (0 if not leader)
+     */
+    uint64_t epoch() const { return heldEpoch.load(); }
+
+    const std::string& nodeId() const { return node; }
+
+    /**
+     * Read the lease file without modifying it (shared lock)
+     */
+    static bool readRecord(const std::string& path, LeaseRecord& record);
+
+    /**
+     * Current wall-clock time in milliseconds
+     */
+    static int64_t nowMs();
+
+private:
+    bool tryAcquireOrRenew();
+    bool release();
+    void leaseLoop();
+
+    static bool parseRecord(const std::string& text, LeaseRecord& record);
+    static std::string formatRecord(const LeaseRecord& record);
+
+    std::string leasePath;
+    std::string node;
+    int64_t ttlMs;
+    Logger& logger;
+
+    int fd = -1;
+    std::atomic<bool> leader{false};
+    std::atomic<int64_t> fenceMs{0};       // isLeader() false from this instant on
+    std::atomic<uint64_t> heldEpoch{0};
+
+    std::mutex loopMutex;
+    std::condition_variable loopCv;
+    bool stopping = false;
+    std::thread loopThread;
+};
+
+#endif // LEADER_LEASE_H
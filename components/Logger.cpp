@@ -1,4 +1,5 @@
 #include "Logger.h"
+#include "AllocTracker.h"
 #include <iostream>
 #include <chrono>
 #include <iomanip>
@@ -63,6 +64,7 @@ bool Logger::isSilentMode() const {
 }
 
 void Logger::log(LogLevel level, const std::string& message, const std::string& job_name) {
+    AllocScope scope(AllocTag::LOGGER);
     std::lock_guard<std::mutex> lock(log_mutex);
     
     std::string timestamp = get_timestamp();
@@ -0,0 +1,384 @@
+/**
+ * @file MaskBatch.cpp
+ * @brief Structure-of-arrays cron masks with SIMD minute matching
+ *
+ * A job fires in a minute when its minute, hour and month bits are set
+ * and its day matches: day of month AND day of week, or OR when both are
+ * restricted (an unrestricted field has every bit set, so AND is right
+ * for it). The kernels compute that as a "miss" lane mask per field and
+ * emit the indices of the lanes where nothing missed.
+ */
+
+#include "MaskBatch.h"
+#include "CronExpression.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MASK_BATCH_X86 1
+#endif
+
+namespace {
+
+/**
+ * Columns of one batch, the minute column chosen for the probed minute
+ */
+struct Columns {
+    const uint32_t* minutes;
+    const uint32_t* hours;
+    const uint32_t* days_of_month;
+    const uint32_t* months;
+    const uint32_t* days_of_week;
+    const uint32_t* either_day;
+    size_t count;
+};
+
+/**
+ * Single-bit masks of the probed local minute
+ */
+struct Probe {
+    uint32_t minute;
+    uint32_t hour;
+    uint32_t day_of_month;
+    uint32_t month;
+    uint32_t day_of_week;
+};
+
+using Kernel = void (*)(const Columns&, const Probe&, std::vector<uint32_t>&);
+
+void scanScalar(const Columns& c, const Probe& p, size_t begin, std::vector<uint32_t>& due) {
+    for (size_t i = begin; i < c.count; ++i) {
+        if (!(c.minutes[i] & p.minute) || !(c.hours[i] & p.hour) || !(c.months[i] & p.month)) {
+            continue;
+        }
+        bool dom = c.days_of_month[i] & p.day_of_month;
+        bool dow = c.days_of_week[i] & p.day_of_week;
+        if (c.either_day[i] ? (dom || dow) : (dom && dow)) {
+            due.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+/**
+ * Append the lanes of one vector whose bit is set in `hits`
+ */
+inline void emit(uint32_t hits, size_t base, std::vector<uint32_t>& due) {
+    while (hits) {
+        due.push_back(static_cast<uint32_t>(base + __builtin_ctz(hits)));
+        hits &= hits - 1;
+    }
+}
+
+#ifdef MASK_BATCH_X86
+
+void scanSse2(const Columns& c, const Probe& p, std::vector<uint32_t>& due) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i minute = _mm_set1_epi32(static_cast<int>(p.minute));
+    const __m128i hour = _mm_set1_epi32(static_cast<int>(p.hour));
+    const __m128i dom_bit = _mm_set1_epi32(static_cast<int>(p.day_of_month));
+    const __m128i month = _mm_set1_epi32(static_cast<int>(p.month));
+    const __m128i dow_bit = _mm_set1_epi32(static_cast<int>(p.day_of_week));
+    auto load = [](const uint32_t* column, size_t i) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i));
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= c.count; i += 4) {
+        __m128i miss = _mm_cmpeq_epi32(_mm_and_si128(load(c.minutes, i), minute), zero);
+        miss = _mm_or_si128(miss, _mm_cmpeq_epi32(_mm_and_si128(load(c.hours, i), hour), zero));
+        miss = _mm_or_si128(miss, _mm_cmpeq_epi32(_mm_and_si128(load(c.months, i), month), zero));
+        __m128i miss_dom = _mm_cmpeq_epi32(_mm_and_si128(load(c.days_of_month, i), dom_bit), zero);
+        __m128i miss_dow = _mm_cmpeq_epi32(_mm_and_si128(load(c.days_of_week, i), dow_bit), zero);
+        __m128i miss_day = _mm_or_si128(_mm_and_si128(miss_dom, miss_dow),
+                                        _mm_andnot_si128(load(c.either_day, i), _mm_or_si128(miss_dom, miss_dow)));
+        miss = _mm_or_si128(miss, miss_day);
+        emit(~static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(miss))) & 0xFu, i, due);
+    }
+    scanScalar(c, p, i, due);
+}
+
+#define load(column, i) _mm256_loadu_si256(reinterpret_cast<const __m256i*>((column) + (i)))
+
+__attribute__((target("avx2")))
+void scanAvx2(const Columns& c, const Probe& p, std::vector<uint32_t>& due) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minute = _mm256_set1_epi32(static_cast<int>(p.minute));
+    const __m256i hour = _mm256_set1_epi32(static_cast<int>(p.hour));
+    const __m256i dom_bit = _mm256_set1_epi32(static_cast<int>(p.day_of_month));
+    const __m256i month = _mm256_set1_epi32(static_cast<int>(p.month));
+    const __m256i dow_bit = _mm256_set1_epi32(static_cast<int>(p.day_of_week));
+    size_t i = 0;
+    for (; i + 8 <= c.count; i += 8) {
+        __m256i miss = _mm256_cmpeq_epi32(_mm256_and_si256(load(c.minutes, i), minute), zero);
+        miss = _mm256_or_si256(miss, _mm256_cmpeq_epi32(_mm256_and_si256(load(c.hours, i), hour), zero));
+        miss = _mm256_or_si256(miss, _mm256_cmpeq_epi32(_mm256_and_si256(load(c.months, i), month), zero));
+        __m256i miss_dom = _mm256_cmpeq_epi32(_mm256_and_si256(load(c.days_of_month, i), dom_bit), zero);
+        __m256i miss_dow = _mm256_cmpeq_epi32(_mm256_and_si256(load(c.days_of_week, i), dow_bit), zero);
+        __m256i miss_day = _mm256_or_si256(_mm256_and_si256(miss_dom, miss_dow),
+                                           _mm256_andnot_si256(load(c.either_day, i),
+                                                               _mm256_or_si256(miss_dom, miss_dow)));
+        miss = _mm256_or_si256(miss, miss_day);
+        emit(~static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(miss))) & 0xFFu, i, due);
+    }
+    scanScalar(c, p, i, due);
+}
+
+#undef load
+
+#else
+
+void scanPlain(const Columns& c, const Probe& p, std::vector<uint32_t>& due) {
+    scanScalar(c, p, 0, due);
+}
+
+#endif
+
+/**
+ * Advance a local date (day, month, year, weekday) by one day
+ */
+void nextDate(std::tm& date) {
+    static const int DAYS_IN_MONTH[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int year = date.tm_year + 1900;
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    int length = DAYS_IN_MONTH[date.tm_mon] + (date.tm_mon == 1 && leap ? 1 : 0);
+    date.tm_wday = (date.tm_wday + 1) % 7;
+    if (++date.tm_mday > length) {
+        date.tm_mday = 1;
+        if (++date.tm_mon == 12) {
+            date.tm_mon = 0;
+            ++date.tm_year;
+        }
+    }
+}
+
+/**
+ * Local time on a day with a UTC offset change. A time that occurs twice
+ * resolves to its first occurrence, one skipped over as mktime() moves it.
+ */
+std::time_t offsetChangeTime(const std::tm& date, int hour, int minute) {
+    std::time_t best = -1;
+    for (int isdst : {0, 1, -1}) {
+        std::tm candidate = date;
+        candidate.tm_hour = hour;
+        candidate.tm_min = minute;
+        candidate.tm_sec = 0;
+        candidate.tm_isdst = isdst;
+        std::time_t t = mktime(&candidate);
+        if (isdst < 0) {
+            return best >= 0 ? best : t;
+        }
+        std::tm check;
+        if (t != -1 && localtime_r(&t, &check) && check.tm_hour == hour && check.tm_min == minute &&
+            check.tm_mday == date.tm_mday && (best < 0 || t < best)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+struct Backend {
+    Kernel kernel;
+    const char* name;
+};
+
+const Backend& backendInUse() {
+    static const Backend chosen = [] {
+#ifdef MASK_BATCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Backend{scanAvx2, "avx2"};
+        }
+        return Backend{scanSse2, "sse2"};
+#else
+        return Backend{scanPlain, "scalar"};
+#endif
+    }();
+    return chosen;
+}
+
+} // namespace
+
+void MaskBatch::reserve(size_t count) {
+    minutes_low.reserve(count);
+    minutes_high.reserve(count);
+    hours.reserve(count);
+    days_of_month.reserve(count);
+    months.reserve(count);
+    days_of_week.reserve(count);
+    either_day.reserve(count);
+}
+
+void MaskBatch::clear() {
+    minutes_low.clear();
+    minutes_high.clear();
+    hours.clear();
+    days_of_month.clear();
+    months.clear();
+    days_of_week.clear();
+    either_day.clear();
+}
+
+void MaskBatch::add(const CronMask& mask) {
+    minutes_low.push_back(static_cast<uint32_t>(mask.minutes));
+    minutes_high.push_back(static_cast<uint32_t>(mask.minutes >> 32));
+    hours.push_back(mask.hours);
+    days_of_month.push_back(mask.days_of_month);
+    months.push_back(mask.months);
+    days_of_week.push_back(mask.days_of_week);
+    either_day.push_back(mask.dom_restricted && mask.dow_restricted ? ~0u : 0u);
+}
+
+size_t MaskBatch::due(const std::tm& local_time, std::vector<uint32_t>& due) const {
+    due.clear();
+    if (hours.empty()) {
+        return 0;
+    }
+    bool high = local_time.tm_min >= 32;
+    Columns columns{high ? minutes_high.data() : minutes_low.data(), hours.data(), days_of_month.data(),
+                    months.data(), days_of_week.data(), either_day.data(), hours.size()};
+    Probe probe{1u << (local_time.tm_min - (high ? 32 : 0)), 1u << local_time.tm_hour,
+                1u << local_time.tm_mday, 1u << (local_time.tm_mon + 1), 1u << local_time.tm_wday};
+    backendInUse().kernel(columns, probe, due);
+    return due.size();
+}
+
+size_t MaskBatch::dueOnDay(const std::tm& date, std::vector<uint32_t>& due) const {
+    due.clear();
+    if (hours.empty()) {
+        return 0;
+    }
+    // Every bit probed in the hour column: only the day fields can miss
+    Columns columns{hours.data(), hours.data(), days_of_month.data(), months.data(), days_of_week.data(),
+                    either_day.data(), hours.size()};
+    Probe probe{~0u, ~0u, 1u << date.tm_mday, 1u << (date.tm_mon + 1), 1u << date.tm_wday};
+    backendInUse().kernel(columns, probe, due);
+    return due.size();
+}
+
+/**
+ * First fire times of a whole batch
+ *
+ * Stepping the epoch minute by minute visits the local minutes of the
+ * current day in the order CronExpression::nextFireTime() does while the
+ * UTC offset stays the same. On later days that function returns the first
+ * hour and minute of the first matching day, which is what is computed
+ * here, from one mktime() per day unless the day has an offset change.
+ */
+std::vector<std::time_t> MaskBatch::nextFireTimes(const std::vector<const CronMask*>& masks, std::time_t after) {
+    std::vector<std::time_t> next(masks.size(), -1);
+    std::vector<uint8_t> resolved(masks.size(), 0);
+
+    std::tm today;
+    localtime_r(&after, &today);
+    long offset = today.tm_gmtoff;
+
+    if (masks.size() >= MIN_BATCH && after >= 0 && offset % 60 == 0) {
+        MaskBatch batch;
+        std::vector<uint32_t> owner;   // Batch index -> masks index
+        size_t stale = 0;              // Resolved entries still in the batch
+        auto rebuild = [&] {
+            batch.clear();
+            owner.clear();
+            for (size_t i = 0; i < masks.size(); ++i) {
+                if (!resolved[i]) {
+                    batch.add(*masks[i]);
+                    owner.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            stale = 0;
+        };
+        auto resolve = [&](uint32_t hit, std::time_t t) {
+            uint32_t i = owner[hit];
+            if (!resolved[i]) {
+                resolved[i] = 1;
+                next[i] = t;
+                ++stale;
+            }
+        };
+        // Schedules that never fire, or only on February 29th, would keep the
+        // day loop below running to the end of the horizon
+        for (size_t i = 0; i < masks.size(); ++i) {
+            ScheduleReach reach = CronExpression::reach(*masks[i]);
+            if (reach != ScheduleReach::REGULAR) {
+                resolved[i] = 1;
+                next[i] = (reach == ScheduleReach::NEVER) ? -1 : CronExpression::nextFireTime(*masks[i], after);
+            }
+        }
+        batch.reserve(masks.size());
+        owner.reserve(masks.size());
+        rebuild();
+
+        // Rest of the current day
+        std::vector<uint32_t> hits;
+        bool steady = true;
+        std::tm local_time;
+        for (std::time_t t = (after / 60 + 1) * 60; stale < batch.size(); t += 60) {
+            localtime_r(&t, &local_time);
+            if (local_time.tm_mday != today.tm_mday) {
+                break;
+            }
+            if (local_time.tm_gmtoff != offset) {
+                steady = false;
+                break;
+            }
+            batch.due(local_time, hits);
+            for (uint32_t hit : hits) {
+                resolve(hit, t);
+            }
+            if (stale * 2 > batch.size()) {
+                rebuild();
+            }
+        }
+
+        // Following days
+        std::tm date = today;
+        for (int d = 1; steady && d < CronExpression::MAX_SEARCH_DAYS && stale < batch.size(); ++d) {
+            nextDate(date);
+            if (batch.dueOnDay(date, hits) == 0) {
+                continue;
+            }
+            std::tm midnight = date;
+            midnight.tm_hour = midnight.tm_min = midnight.tm_sec = 0;
+            midnight.tm_isdst = -1;
+            std::time_t day_start = mktime(&midnight);
+            bool plain_day = midnight.tm_hour == 0 && midnight.tm_min == 0;
+            if (plain_day) {
+                std::time_t last_minute = day_start + 24 * 3600 - 60;
+                std::tm check;
+                localtime_r(&last_minute, &check);
+                plain_day = check.tm_gmtoff == midnight.tm_gmtoff && check.tm_hour == 23 && check.tm_min == 59;
+            }
+            for (uint32_t hit : hits) {
+                const CronMask& mask = *masks[owner[hit]];
+                if (mask.minutes == 0) {
+                    resolve(hit, -1);
+                    continue;
+                }
+                int hour = __builtin_ctz(mask.hours);
+                int minute = __builtin_ctzll(mask.minutes);
+                if (plain_day) {
+                    resolve(hit, day_start + hour * 3600 + minute * 60);
+                } else {
+                    resolve(hit, offsetChangeTime(date, hour, minute));
+                }
+            }
+            if (stale * 2 > batch.size()) {
+                rebuild();
+            }
+        }
+        if (steady) {
+            std::fill(resolved.begin(), resolved.end(), 1);   // The rest never fires within the horizon
+        }
+    }
+
+    for (size_t i = 0; i < masks.size(); ++i) {
+        if (!resolved[i]) {
+            next[i] = CronExpression::nextFireTime(*masks[i], after);
+        }
+    }
+    return next;
+}
+
+const char* MaskBatch::backend() {
+    return backendInUse().name;
+}
@@ -0,0 +1,78 @@
+#ifndef MASK_BATCH_H
+#define MASK_BATCH_H
+
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include "CronTypes.h"
+
+/**
+ * MaskBatch Class - Many compiled schedules matched at once
+ *
+ * Stores CronMasks as a structure of arrays (one 32-bit word per field and
+ * job) so "which of these jobs fire in this minute?" is answered for 8 jobs
+ * per AVX2 instruction, 4 per SSE2 instruction, or one at a time where
+ * neither exists. The kernel is chosen once at runtime from the CPU
+ * features. Results are identical to CronExpression::matches().
+ *
+ * Used where many schedules are evaluated together: the first fire times
+ * of a large reload (nextFireTimes) and the daemon's --simulate mode.
+ */
+class MaskBatch {
+public:
+    /** Batches smaller than this are cheaper to schedule one job at a time */
+    static constexpr size_t MIN_BATCH = 256;
+
+    void reserve(size_t count);
+    void clear();
+
+    /**
+     * Append a schedule; its index is the previous size()
+     */
+    void add(const CronMask& mask);
+
+    size_t size() const { return hours.size(); }
+
+    /**
+     * Indices of the schedules matching a local minute
+     *
+     * @param local_time Broken-down local time (minute resolution)
+     * @param due Output indices in ascending order (cleared first)
+     * @return Number of matching schedules
+     */
+    size_t due(const std::tm& local_time, std::vector<uint32_t>& due) const;
+
+    /**
+     * Next fire time strictly after `after` of every mask, equal to
+     * CronExpression::nextFireTime() of each
+     *
+     * The rest of the current day is matched minute by minute against the
+     * whole batch, the following days by their day part only (the first
+     * hour and minute of a matching day are then read off the mask). A
+     * UTC offset change (DST) during the current day, batches under
+     * MIN_BATCH and masks that are not ScheduleReach::REGULAR are computed
+     * one mask at a time.
+     */
+    static std::vector<std::time_t> nextFireTimes(const std::vector<const CronMask*>& masks, std::time_t after);
+
+    /**
+     * Kernel in use: "avx2", "sse2" or "scalar"
+     */
+    static const char* backend();
+
+private:
+    /**
+     * Indices of the schedules whose month and day fields match a date
+     */
+    size_t dueOnDay(const std::tm& date, std::vector<uint32_t>& due) const;
+
+    std::vector<uint32_t> minutes_low;      // Minute bits 0-31
+    std::vector<uint32_t> minutes_high;     // Minute bits 32-59
+    std::vector<uint32_t> hours;
+    std::vector<uint32_t> days_of_month;
+    std::vector<uint32_t> months;
+    std::vector<uint32_t> days_of_week;
+    std::vector<uint32_t> either_day;       // All ones: cron OR rule (both day fields restricted)
+};
+
+#endif // MASK_BATCH_H
@@ -0,0 +1,32 @@
+#ifndef NANOCRON_H
+#define NANOCRON_H
+
+/**
+ * libnanocron - Umbrella header of the embeddable scheduler library
+ *
+ * Installed to /usr/local/include/nanocron/ by init/install.sh together with
+ * libnanocron.a and libnanocron.so. Typical use:
+ *
+ *   #include <nanocron/NanoCron.h>
+ *
+ *   CronScheduler scheduler;
+ *   std::string error;
+ *   scheduler.addJob("flush", "0 * * * *",
+ *                    [](const ScheduledRun& run) { flushCaches(); }, error);
+ *   scheduler.useWorkerPool(2);
+ *   scheduler.start();
+ *
+ * Link with: -lnanocron -pthread -ldl
+ */
+
+#include "CronTypes.h"
+#include "CronExpression.h"
+#include "CronExpr.h"
+#include "CronScheduler.h"
+#include "WorkerPool.h"
+#include "JobConfig.h"
+#include "JobExecutor.h"
+#include "PluginRunner.h"
+#include "Logger.h"
+
+#endif // NANOCRON_H
@@ -0,0 +1,314 @@
+/**
+ * @file PluginRunner.cpp
+ * @brief dlopen-based in-process job execution with deadline and cancellation
+ */
+
+#include "PluginRunner.h"
+#include "ProcessRunner.h"
+#include "nanocron_plugin.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <mutex>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+
+using AbiVersionFn = uint32_t (*)();
+using RunFn = int (*)(nanocron_job_ctx*);
+
+/**
+ * Loaded plugin entry (handles are never closed)
+ */
+struct LoadedPlugin {
+    void* handle = nullptr;
+    RunFn run = nullptr;
+};
+
+/**
+ * Host data reachable from ctx->host
+ */
+struct PluginHost {
+    Logger* logger;
+    const CronJob* job;
+    int log_fd;        // Isolated child: write end of the log pipe (-1 = in process)
+};
+
+/** Grace period given to an isolated child after its deadline (or shutdown) before SIGKILL */
+const int ISOLATED_KILL_GRACE_MS = 2000;
+
+/** Longest log line an isolated plugin sends (one atomic pipe write) */
+const size_t ISOLATED_LOG_LINE = 1024;
+
+std::atomic<bool> g_cancelAll{false};
+std::mutex g_pluginMutex;
+std::unordered_map<std::string, LoadedPlugin> g_plugins;
+
+int64_t monotonicMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Open (or fetch from cache) a plugin and check its ABI version
+ */
+bool loadPlugin(const std::string& path, LoadedPlugin& out, std::string& error) {
+    std::lock_guard<std::mutex> lock(g_pluginMutex);
+    auto it = g_plugins.find(path);
+    if (it != g_plugins.end()) {
+        out = it->second;
+        return true;
+    }
+
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        const char* reason = dlerror();
+        error = "dlopen failed: " + std::string(reason ? reason : "unknown error");
+        return false;
+    }
+
+    auto version = reinterpret_cast<AbiVersionFn>(dlsym(handle, "nanocron_plugin_abi_version"));
+    auto run = reinterpret_cast<RunFn>(dlsym(handle, "nanocron_job_run"));
+    if (!version || !run) {
+        error = "missing nanocron_plugin_abi_version or nanocron_job_run symbol";
+        dlclose(handle);
+        return false;
+    }
+    if (version() != NANOCRON_PLUGIN_ABI_VERSION) {
+        error = "ABI version " + std::to_string(version()) + " not supported (host " +
+                std::to_string(NANOCRON_PLUGIN_ABI_VERSION) + ")";
+        dlclose(handle);
+        return false;
+    }
+
+    out.handle = handle;
+    out.run = run;
+    g_plugins.emplace(path, out);
+    return true;
+}
+
+extern "C" int hostIsCancelled(const nanocron_job_ctx* ctx) {
+    return g_cancelAll.load(std::memory_order_relaxed) || monotonicMs() >= ctx->deadline_ms;
+}
+
+/**
+ * SIGTERM handler of an isolated child: turn its cancellation token on
+ */
+extern "C" void cancelIsolated(int) {
+    g_cancelAll.store(true);
+}
+
+extern "C" void hostLog(const nanocron_job_ctx* ctx, int level, const char* message) {
+    const PluginHost* host = static_cast<const PluginHost*>(ctx->host);
+    if (level < NANOCRON_LOG_DEBUG || level > NANOCRON_LOG_SUCCESS) {
+        level = NANOCRON_LOG_INFO;
+    }
+    if (host->log_fd >= 0) {
+        // Forked child: no allocation, no stdio; the parent logs "<level><text>\n"
+        char line[ISOLATED_LOG_LINE];
+        size_t size = 0;
+        line[size++] = static_cast<char>('0' + level);
+        for (const char* c = message; c && *c && size < sizeof(line) - 1; ++c) {
+            line[size++] = *c == '\n' ? ' ' : *c;
+        }
+        line[size++] = '\n';
+        ssize_t ignored = write(host->log_fd, line, size);
+        (void)ignored;
+        return;
+    }
+    host->logger->log(static_cast<LogLevel>(level), message ? message : "", host->job->description);
+}
+
+/**
+ * Log the complete lines an isolated child wrote to its log pipe
+ */
+void relayLog(int fd, std::string& pending, Logger& logger, const CronJob& job) {
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        pending.append(buffer, static_cast<size_t>(n));
+    }
+    size_t start = 0;
+    size_t end;
+    while ((end = pending.find('\n', start)) != std::string::npos) {
+        if (end > start) {
+            int level = pending[start] - '0';
+            if (level < NANOCRON_LOG_DEBUG || level > NANOCRON_LOG_SUCCESS) {
+                level = NANOCRON_LOG_INFO;
+            }
+            logger.log(static_cast<LogLevel>(level), pending.substr(start + 1, end - start - 1), job.description);
+        }
+        start = end + 1;
+    }
+    pending.erase(0, start);
+}
+
+void fillContext(nanocron_job_ctx& ctx, PluginHost& host, const CronJob& job, std::time_t scheduled_time) {
+    ctx.abi_version = NANOCRON_PLUGIN_ABI_VERSION;
+    ctx.struct_size = sizeof(nanocron_job_ctx);
+    ctx.job_id = job.id.c_str();
+    ctx.job_description = job.description.c_str();
+    ctx.argument = job.plugin_arg.c_str();
+    ctx.scheduled_time = static_cast<int64_t>(scheduled_time);
+    ctx.deadline_ms = monotonicMs() + static_cast<int64_t>(job.timeout_seconds) * 1000;
+    ctx.is_cancelled = hostIsCancelled;
+    ctx.log = hostLog;
+    ctx.host = &host;
+}
+
+} // namespace
+
+PluginOutcome PluginRunner::run(const CronJob& job, Logger& logger, std::time_t scheduled_time) {
+    if (job.plugin_isolate) {
+        return runIsolated(job, logger, scheduled_time);
+    }
+    return runInProcess(job, logger, scheduled_time);
+}
+
+void PluginRunner::cancelAll() {
+    g_cancelAll.store(true);
+}
+
+/**
+ * Call the plugin on the current thread
+ */
+PluginOutcome PluginRunner::runInProcess(const CronJob& job, Logger& logger, std::time_t scheduled_time) {
+    PluginOutcome outcome;
+    LoadedPlugin plugin;
+    if (!loadPlugin(job.plugin_path, plugin, outcome.error)) {
+        return outcome;
+    }
+
+    nanocron_job_ctx ctx = {};
+    PluginHost host{&logger, &job, -1};
+    fillContext(ctx, host, job, scheduled_time);
+
+    outcome.loaded = true;
+    outcome.code = plugin.run(&ctx);
+    outcome.cancelled = outcome.code == NANOCRON_JOB_CANCELLED;
+    outcome.timed_out = monotonicMs() >= ctx.deadline_ms;
+    return outcome;
+}
+
+/**
+ * Fork a child that calls the plugin; the return code comes back whole
+ * through a result pipe (an exit status only holds 0-255, and 128 and up
+ * would read as signals). The plugin is loaded by the parent before forking so the child
+ * never touches locks that another daemon thread may have held at fork
+ * time; its log lines are written with write(2) from a fixed buffer to a
+ * pipe, and the parent passes them on to the Logger. The child is killed
+ * once the deadline plus grace expires. At shutdown cancelAll() cannot
+ * reach the child's memory: it gets SIGTERM, which turns its token on,
+ * then SIGKILL after the grace period.
+ */
+PluginOutcome PluginRunner::runIsolated(const CronJob& job, Logger& logger, std::time_t scheduled_time) {
+    PluginOutcome outcome;
+    LoadedPlugin plugin;
+    if (!loadPlugin(job.plugin_path, plugin, outcome.error)) {
+        return outcome;
+    }
+
+    nanocron_job_ctx ctx = {};
+    int log_pipe[2];
+    int result_pipe[2];
+    if (pipe2(log_pipe, O_CLOEXEC) != 0) {
+        outcome.error = "pipe failed";
+        return outcome;
+    }
+    if (pipe2(result_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        outcome.error = "pipe failed";
+        close(log_pipe[0]);
+        close(log_pipe[1]);
+        return outcome;
+    }
+    PluginHost host{&logger, &job, log_pipe[1]};
+    fillContext(ctx, host, job, scheduled_time);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        outcome.error = "fork failed";
+        for (int fd : {log_pipe[0], log_pipe[1], result_pipe[0], result_pipe[1]}) {
+            close(fd);
+        }
+        return outcome;
+    }
+
+    if (pid == 0) {
+        // Child: restore what the daemon changed (default signal handling,
+        // empty mask) and drop its descriptors, as ProcessRunner does for jobs
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+        struct sigaction term = {};
+        term.sa_handler = cancelIsolated;
+        sigaction(SIGTERM, &term, nullptr);
+        ProcessRunner::closeInheritedFds({log_pipe[1], result_pipe[1]});
+
+        int code = plugin.run(&ctx);
+        ssize_t ignored = write(result_pipe[1], &code, sizeof(code));
+        (void)ignored;
+        _exit(code == 0 ? 0 : 1);
+    }
+
+    close(log_pipe[1]);
+    close(result_pipe[1]);
+    fcntl(log_pipe[0], F_SETFL, O_NONBLOCK);
+    std::string pending;
+
+    int status = 0;
+    bool killed = false;
+    int64_t kill_at = -1;   // SIGKILL time once SIGTERM was sent at shutdown
+    while (true) {
+        pid_t done = waitpid(pid, &status, WNOHANG);
+        if (done == pid) {
+            break;
+        }
+        if (done < 0) {
+            outcome.error = "waitpid failed";
+            close(log_pipe[0]);
+            close(result_pipe[0]);
+            return outcome;
+        }
+        int64_t now = monotonicMs();
+        if (kill_at < 0 && g_cancelAll.load(std::memory_order_relaxed)) {
+            kill(pid, SIGTERM);
+            kill_at = now + ISOLATED_KILL_GRACE_MS;
+        }
+        if (!killed && (now > ctx.deadline_ms + ISOLATED_KILL_GRACE_MS || (kill_at >= 0 && now >= kill_at))) {
+            kill(pid, SIGKILL);
+            killed = true;
+        }
+        struct pollfd pfd = {log_pipe[0], POLLIN, 0};
+        poll(&pfd, 1, 10);
+        relayLog(log_pipe[0], pending, logger, job);
+    }
+    relayLog(log_pipe[0], pending, logger, job);
+    close(log_pipe[0]);
+    int code = 0;
+    bool returned = read(result_pipe[0], &code, sizeof(code)) == static_cast<ssize_t>(sizeof(code));
+    close(result_pipe[0]);
+
+    bool stopped = kill_at >= 0;
+    outcome.loaded = true;
+    outcome.timed_out = !stopped && (killed || monotonicMs() >= ctx.deadline_ms);
+    outcome.cancelled = stopped;
+    if (WIFEXITED(status)) {
+        outcome.code = returned ? code : WEXITSTATUS(status);   // Else the plugin called exit() itself
+        outcome.cancelled = stopped || outcome.code == NANOCRON_JOB_CANCELLED;
+    } else if (WIFSIGNALED(status)) {
+        outcome.code = 128 + WTERMSIG(status);
+        if (!killed && !stopped) {
+            outcome.error = "isolated plugin crashed with signal " + std::to_string(WTERMSIG(status));
+        }
+    }
+    return outcome;
+}
@@ -0,0 +1,55 @@
+#ifndef PLUGIN_RUNNER_H
+#define PLUGIN_RUNNER_H
+
+#include <ctime>
+#include <string>
+#include "CronTypes.h"
+#include "Logger.h"
+
+/**
+ * STRUCT: Result of one plugin run
+ */
+struct PluginOutcome {
+    int code = -1;             // Value returned by nanocron_job_run (-1 if not run)
+    bool loaded = false;       // Plugin was loaded and called
+    bool timed_out = false;    // Run finished (or was killed) after its deadline
+    bool cancelled = false;    // Plugin returned NANOCRON_JOB_CANCELLED
+    std::string error;         // Load or isolation failure description
+};
+
+/**
+ * PluginRunner Class - Executes plugin jobs through the nanocron_plugin.h ABI
+ *
+ * Shared objects are opened once with dlopen() and cached for the lifetime
+ * of the process (replacing a plugin file requires a daemon restart).
+ * In-process runs happen on the calling worker thread; a plugin that
+ * ignores its cancellation token cannot be stopped and keeps that worker
+ * busy. Jobs with "isolate": true run in a forked child instead, which is
+ * killed when the deadline plus a short grace period expires; its log
+ * lines reach the job's log through a pipe the parent reads.
+ */
+class PluginRunner {
+public:
+    /**
+     * Run a plugin job until it returns or its deadline expires
+     *
+     * @param job Job with type PLUGIN
+     * @param logger Logger receiving the plugin's log lines
+     * @param scheduled_time Minute the run was scheduled for
+     * @return Outcome of the run
+     */
+    static PluginOutcome run(const CronJob& job, Logger& logger, std::time_t scheduled_time);
+
+    /**
+     * Turn on the cancellation token of every running and future plugin run
+     * (called once at daemon shutdown); isolated children get SIGTERM,
+     * which turns theirs on, and SIGKILL after a short grace period
+     */
+    static void cancelAll();
+
+private:
+    static PluginOutcome runInProcess(const CronJob& job, Logger& logger, std::time_t scheduled_time);
+    static PluginOutcome runIsolated(const CronJob& job, Logger& logger, std::time_t scheduled_time);
+};
+
+#endif // PLUGIN_RUNNER_H
@@ -0,0 +1,415 @@
+/**
+ * @file Prewarmer.cpp
+ * @brief Read-ahead of job programs, libraries and data before their fire time
+ */
+
+#include "Prewarmer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <fstream>
+#include <glob.h>
+#include <pwd.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+
+namespace {
+
+const size_t MAX_ELF_OBJECTS = 512;
+
+/**
+ * Dynamic loader view of an ELF object
+ */
+struct ElfInfo {
+    uint16_t machine = 0;
+    std::string interp;                 // PT_INTERP (executables only)
+    std::vector<std::string> needed;    // DT_NEEDED names
+    std::vector<std::string> search;    // DT_RUNPATH or DT_RPATH, $ORIGIN expanded
+};
+
+std::string dirOf(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+}
+
+bool readAt(int fd, void* buffer, size_t size, uint64_t offset) {
+    return pread(fd, buffer, size, static_cast<off_t>(offset)) == static_cast<ssize_t>(size);
+}
+
+/**
+ * Parse the program headers and dynamic section of a native 64-bit ELF file
+ */
+bool readElf(const std::string& path, ElfInfo& info) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    info = ElfInfo();
+    Elf64_Ehdr header;
+    bool ok = readAt(fd, &header, sizeof(header), 0) &&
+              std::memcmp(header.e_ident, ELFMAG, SELFMAG) == 0 &&
+              header.e_ident[EI_CLASS] == ELFCLASS64 &&
+              header.e_ident[EI_DATA] == (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ? ELFDATA2LSB : ELFDATA2MSB) &&
+              header.e_phentsize == sizeof(Elf64_Phdr) && header.e_phnum > 0 && header.e_phnum <= 256;
+    std::vector<Elf64_Phdr> segments(ok ? header.e_phnum : 0);
+    ok = ok && readAt(fd, segments.data(), segments.size() * sizeof(Elf64_Phdr), header.e_phoff);
+    if (!ok) {
+        close(fd);
+        return false;
+    }
+    info.machine = header.e_machine;
+
+    // Dynamic entries hold virtual addresses; PT_LOAD maps them to file offsets
+    auto fileOffset = [&](uint64_t vaddr, uint64_t& offset) {
+        for (const auto& segment : segments) {
+            if (segment.p_type == PT_LOAD && vaddr >= segment.p_vaddr && vaddr < segment.p_vaddr + segment.p_filesz) {
+                offset = vaddr - segment.p_vaddr + segment.p_offset;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<Elf64_Dyn> dynamic;
+    for (const auto& segment : segments) {
+        if (segment.p_type == PT_INTERP && segment.p_filesz > 1 && segment.p_filesz < 4096) {
+            std::string interp(segment.p_filesz, '\0');
+            if (readAt(fd, &interp[0], interp.size(), segment.p_offset)) {
+                info.interp = interp.c_str();
+            }
+        } else if (segment.p_type == PT_DYNAMIC) {
+            dynamic.resize(std::min<uint64_t>(segment.p_filesz / sizeof(Elf64_Dyn), 4096));
+            if (!readAt(fd, dynamic.data(), dynamic.size() * sizeof(Elf64_Dyn), segment.p_offset)) {
+                dynamic.clear();
+            }
+        }
+    }
+
+    uint64_t strtab = 0, strsz = 0;
+    std::vector<uint64_t> needed, search;
+    bool runpath = false;
+    for (const auto& entry : dynamic) {
+        if (entry.d_tag == DT_NULL) {
+            break;
+        }
+        switch (entry.d_tag) {
+            case DT_STRTAB: strtab = entry.d_un.d_ptr; break;
+            case DT_STRSZ: strsz = entry.d_un.d_val; break;
+            case DT_NEEDED: needed.push_back(entry.d_un.d_val); break;
+            case DT_RUNPATH:
+                if (!runpath) search.clear();   // RUNPATH overrides RPATH
+                runpath = true;
+                search.push_back(entry.d_un.d_val);
+                break;
+            case DT_RPATH:
+                if (!runpath) search.push_back(entry.d_un.d_val);
+                break;
+        }
+    }
+    uint64_t offset = 0;
+    std::string strings;
+    if (strtab && strsz && strsz <= (1u << 20) && fileOffset(strtab, offset)) {
+        strings.resize(strsz);
+        if (!readAt(fd, &strings[0], strsz, offset)) {
+            strings.clear();
+        }
+    }
+    close(fd);
+
+    auto stringAt = [&](uint64_t index) {
+        return index < strings.size() ? std::string(strings.c_str() + index) : std::string();
+    };
+    for (uint64_t index : needed) {
+        std::string name = stringAt(index);
+        if (!name.empty()) info.needed.push_back(name);
+    }
+    std::string origin = dirOf(path);
+    for (uint64_t index : search) {
+        std::stringstream list(stringAt(index));
+        std::string dir;
+        while (std::getline(list, dir, ':')) {
+            for (const char* token : {"${ORIGIN}", "$ORIGIN"}) {
+                size_t at;
+                while ((at = dir.find(token)) != std::string::npos) {
+                    dir.replace(at, std::strlen(token), origin);
+                }
+            }
+            if (!dir.empty()) info.search.push_back(dir);
+        }
+    }
+    return true;
+}
+
+void parseLdConf(const std::string& path, std::vector<std::string>& dirs, int depth) {
+    std::ifstream file(path);
+    std::string line;
+    while (depth < 4 && std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) {
+            continue;
+        }
+        line = line.substr(start, line.find_last_not_of(" \t\r") + 1 - start);
+        if (line.compare(0, 8, "include ") == 0) {
+            std::string pattern = line.substr(line.find_first_not_of(" \t", 8));
+            if (pattern[0] != '/') {
+                pattern = dirOf(path) + "/" + pattern;
+            }
+            glob_t matches;
+            if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+                for (size_t i = 0; i < matches.gl_pathc; i++) {
+                    parseLdConf(matches.gl_pathv[i], dirs, depth + 1);
+                }
+            }
+            globfree(&matches);
+        } else if (line[0] == '/') {
+            dirs.push_back(line);
+        }
+    }
+}
+
+/**
+ * Library directories of the dynamic loader (ld.so.conf, then the defaults)
+ */
+const std::vector<std::string>& systemLibraryDirs() {
+    static const std::vector<std::string> dirs = [] {
+        std::vector<std::string> list;
+        parseLdConf("/etc/ld.so.conf", list, 0);
+        for (const char* dir : {"/lib64", "/usr/lib64", "/lib", "/usr/lib"}) {
+            list.push_back(dir);
+        }
+        return list;
+    }();
+    return dirs;
+}
+
+/**
+ * Interpreter of a "#!" script, with "/usr/bin/env NAME" resolved through PATH
+ */
+std::vector<std::string> scriptInterpreter(const std::string& path, ExecutableResolver* resolver) {
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    if (!std::getline(file, line) || line.compare(0, 2, "#!") != 0) {
+        return {};
+    }
+    std::stringstream words(line.substr(2));
+    std::string interp;
+    words >> interp;
+    if (interp.empty()) {
+        return {};
+    }
+    std::vector<std::string> result = {interp};
+    if (interp.size() >= 4 && interp.compare(interp.size() - 4, 4, "/env") == 0) {
+        std::string name;
+        while (words >> name && name[0] == '-') {}   // Options such as -S
+        if (!name.empty() && name[0] != '-') {
+            std::string target = name.find('/') != std::string::npos ? name : (resolver ? resolver->lookup(name) : "");
+            if (!target.empty()) {
+                result.push_back(target);
+            }
+        }
+    }
+    return result;
+}
+
+bool allowedFor(const struct stat& st, long uid, bool dir) {
+    if (uid < 0) {
+        return true;
+    }
+    if (st.st_uid == static_cast<uid_t>(uid)) {
+        return (st.st_mode & S_IRUSR) && (!dir || (st.st_mode & S_IXUSR));
+    }
+    return (st.st_mode & S_IROTH) && (!dir || (st.st_mode & S_IXOTH));
+}
+
+/**
+ * Read ahead one file or directory tree within the remaining budget
+ */
+void warmPath(const std::string& path, const struct stat& st, long uid, size_t& files, uint64_t& bytes) {
+    if (files >= Prewarmer::MAX_FILES || bytes >= Prewarmer::MAX_BYTES || !allowedFor(st, uid, S_ISDIR(st.st_mode))) {
+        return;
+    }
+    if (S_ISREG(st.st_mode)) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        if (fd >= 0) {
+            // Asynchronous: queues the reads and returns
+            if (posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0) {
+                files++;
+                bytes += static_cast<uint64_t>(st.st_size);
+            }
+            close(fd);
+        }
+    } else if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path.c_str());
+        if (!dir) {
+            return;
+        }
+        while (struct dirent* entry = readdir(dir)) {
+            if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            std::string child = path + "/" + entry->d_name;
+            struct stat child_st;
+            if (lstat(child.c_str(), &child_st) == 0) {   // Symlinks inside trees are not followed
+                warmPath(child, child_st, uid, files, bytes);
+            }
+        }
+        closedir(dir);
+    }
+}
+
+} // namespace
+
+Prewarmer::Prewarmer(ExecutableResolver* resolverPtr, Logger& loggerRef)
+    : resolver(resolverPtr), logger(loggerRef) {}
+
+Prewarmer::~Prewarmer() {
+    stop();
+}
+
+void Prewarmer::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (worker_thread.joinable()) {
+        return;
+    }
+    stopping = false;
+    worker_thread = std::thread(&Prewarmer::workerLoop, this);
+}
+
+void Prewarmer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queued.clear();
+    }
+    cv.notify_all();
+    if (worker_thread.joinable()) {
+        worker_thread.join();
+    }
+}
+
+void Prewarmer::enqueue(std::shared_ptr<const CronJob> job, std::time_t fire_time) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.push_back(Request{std::move(job), fire_time});
+    }
+    cv.notify_one();
+}
+
+std::vector<std::string> Prewarmer::filesOf(const CronJob& job) {
+    std::vector<std::string> files;
+    std::string program = job.type == JobType::PLUGIN ? job.plugin_path : (resolver ? resolver->programOf(job) : "");
+    if (program.empty()) {
+        return files;
+    }
+    files.push_back(program);
+
+    std::deque<std::string> objects = {program};
+    for (const auto& interp : scriptInterpreter(program, resolver)) {
+        files.push_back(interp);
+        objects.push_back(interp);
+    }
+
+    // Loader and libraries, breadth first, each object once
+    std::unordered_set<std::string> seen(files.begin(), files.end());
+    size_t parsed = 0;
+    while (!objects.empty() && parsed++ < MAX_ELF_OBJECTS) {
+        ElfInfo info;
+        std::string object = objects.front();
+        objects.pop_front();
+        if (!readElf(object, info)) {
+            continue;
+        }
+        if (!info.interp.empty() && seen.insert(info.interp).second) {
+            files.push_back(info.interp);
+        }
+        for (const auto& name : info.needed) {
+            std::vector<std::string> candidates;
+            if (name.find('/') != std::string::npos) {
+                candidates.push_back(name);
+            } else {
+                for (const auto& dir : info.search) candidates.push_back(dir + "/" + name);
+                for (const auto& dir : systemLibraryDirs()) candidates.push_back(dir + "/" + name);
+            }
+            for (const auto& candidate : candidates) {
+                ElfInfo library;
+                if (access(candidate.c_str(), R_OK) != 0 || !readElf(candidate, library) ||
+                    library.machine != info.machine) {
+                    continue;   // Missing, or a library of another architecture
+                }
+                if (seen.insert(candidate).second) {
+                    files.push_back(candidate);
+                    objects.push_back(candidate);
+                }
+                break;
+            }
+        }
+    }
+    return files;
+}
+
+size_t Prewarmer::warm(const std::vector<std::string>& paths, long uid, uint64_t& bytes) {
+    size_t files = 0;
+    bytes = 0;
+    for (const auto& path : paths) {
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0) {
+            warmPath(path, st, uid, files, bytes);
+        }
+    }
+    return files;
+}
+
+void Prewarmer::workerLoop() {
+    while (true) {
+        std::vector<Request> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !queued.empty(); });
+            if (stopping) {
+                return;
+            }
+            batch.swap(queued);
+        }
+
+        for (const auto& request : batch) {
+            const CronJob& job = *request.job;
+            auto started = std::chrono::steady_clock::now();
+
+            uint64_t program_bytes = 0;
+            size_t files = warm(filesOf(job), -1, program_bytes);
+
+            // Data paths of a user's job: only what that user could read
+            long uid = -1;
+            if (!job.user.empty()) {
+                struct passwd pwd;
+                struct passwd* found = nullptr;
+                char buffer[4096];
+                if (getpwnam_r(job.user.c_str(), &pwd, buffer, sizeof(buffer), &found) != 0 || !found) {
+                    continue;
+                }
+                uid = static_cast<long>(found->pw_uid);
+            }
+            uint64_t data_bytes = 0;
+            files += warm(job.prewarm_paths, uid, data_bytes);
+
+            auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started).count();
+            char at[16];
+            struct tm local;
+            localtime_r(&request.fire_time, &local);
+            std::strftime(at, sizeof(at), "%H:%M", &local);
+            run_count++;
+            byte_count += program_bytes + data_bytes;
+            logger.debug("Prewarmed " + std::to_string(files) + " files (" +
+                         std::to_string((program_bytes + data_bytes) / (1024 * 1024)) + " MB) for the " +
+                         at + " run in " + std::to_string(took) + " ms", job.description);
+        }
+    }
+}
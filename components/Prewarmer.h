@@ -0,0 +1,110 @@
+#ifndef PREWARMER_H
+#define PREWARMER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CronTypes.h"
+#include "ExecutableResolver.h"
+#include "Logger.h"
+
+/**
+ * Prewarmer Class - Pulls a job's files into the page cache before it fires
+ *
+ * For jobs with a "prewarm" lead time the daemon hands each upcoming fire
+ * (CronScheduler::collectPrewarm) to a background thread, which asks the
+ * kernel to read ahead (posix_fadvise WILLNEED) the files the run will
+ * touch first:
+ *
+ *   - the program, resolved like JobExecutor resolves it (plugin: the .so)
+ *   - the interpreter of a "#!" script ("#!/usr/bin/env python3" included)
+ *   - the dynamic loader and the shared libraries of every ELF file above,
+ *     transitively, found through RUNPATH/RPATH and the ld.so.conf
+ *     directories
+ *   - the job's declared "paths"; directories are walked, symlinks not
+ *     followed, up to MAX_FILES files and MAX_BYTES bytes per run
+ *
+ * Read-ahead is asynchronous and only hints the kernel, so nothing is kept
+ * resident: pages age out again like any other cache. Data paths of jobs
+ * with a "user" are only warmed if that user could read them.
+ */
+class Prewarmer {
+public:
+    static constexpr size_t MAX_FILES = 10000;
+    static constexpr uint64_t MAX_BYTES = 2ULL * 1024 * 1024 * 1024;
+
+    /**
+     * @param resolver Program lookup shared with JobExecutor (may be null)
+     * @param logger Logger for per-run summaries
+     */
+    Prewarmer(ExecutableResolver* resolver, Logger& logger);
+    ~Prewarmer();
+
+    Prewarmer(const Prewarmer&) = delete;
+    Prewarmer& operator=(const Prewarmer&) = delete;
+
+    /**
+     * Start the warming thread
+     */
+    void start();
+
+    /**
+     * Drop queued requests and stop the warming thread
+     */
+    void stop();
+
+    /**
+     * Queue the files of one upcoming run
+     *
+     * @param job Job definition (kept alive until warmed)
+     * @param fire_time Fire time being prepared
+     */
+    void enqueue(std::shared_ptr<const CronJob> job, std::time_t fire_time);
+
+    /**
+     * Program files of a job in warming order (program, interpreter, loader,
+     * libraries); the declared data paths are warmed separately
+     */
+    std::vector<std::string> filesOf(const CronJob& job);
+
+    /**
+     * Read ahead files and directory trees
+     *
+     * @param paths Files or directories
+     * @param uid Only warm what this user can read (-1 = anything)
+     * @param bytes Output number of bytes read ahead
+     * @return Number of files read ahead
+     */
+    static size_t warm(const std::vector<std::string>& paths, long uid, uint64_t& bytes);
+
+    uint64_t runs() const { return run_count.load(); }
+    uint64_t bytes() const { return byte_count.load(); }
+
+private:
+    struct Request {
+        std::shared_ptr<const CronJob> job;
+        std::time_t fire_time;
+    };
+
+    void workerLoop();
+
+    ExecutableResolver* resolver;
+    Logger& logger;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<Request> queued;
+    bool stopping = false;
+    std::thread worker_thread;
+
+    std::atomic<uint64_t> run_count{0};
+    std::atomic<uint64_t> byte_count{0};
+};
+
+#endif // PREWARMER_H
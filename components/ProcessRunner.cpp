@@ -0,0 +1,1121 @@
+/**
+ * @file ProcessRunner.cpp
+ * @brief Job process creation, supervision and accounting
+ */
+
+#include "ProcessRunner.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pwd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+int64_t monotonicMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t realtimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Idle check of a run: move its last activity up to the heartbeat file's
+ * mtime, which is only looked at once the output has gone quiet
+ * @return true if the run made no progress for its idle timeout
+ */
+bool idleExpired(SupervisedRun& run, int64_t now) {
+    int64_t idle_ms = static_cast<int64_t>(run.request.idle_timeout_seconds) * 1000;
+    if (idle_ms <= 0 || now - run.active_ms < idle_ms) {
+        return false;
+    }
+    struct stat info;
+    if (!run.request.heartbeat_file.empty() && stat(run.request.heartbeat_file.c_str(), &info) == 0) {
+        int64_t age_ms = realtimeUs() / 1000 -
+                         (static_cast<int64_t>(info.st_mtim.tv_sec) * 1000 + info.st_mtim.tv_nsec / 1000000);
+        run.active_ms = std::max(run.active_ms, now - std::max<int64_t>(age_ms, 0));
+    }
+    return now - run.active_ms >= idle_ms;
+}
+
+/** Daemon shutdown: every run behaves as if its cancel flag was raised */
+std::atomic<bool> g_cancelAll{false};
+
+/** Upgrade hand-over: runs park while suspended (see suspendAll) */
+std::mutex g_parkMutex;
+std::condition_variable g_parkCv;
+std::atomic<bool> g_suspended{false};
+std::unordered_set<SupervisedRun*> g_parked;
+
+/**
+ * Wait while supervision is suspended; the run is listed as parked meanwhile
+ */
+void park(SupervisedRun& run) {
+    std::unique_lock<std::mutex> lock(g_parkMutex);
+    if (!g_suspended.load()) {
+        return;
+    }
+    g_parked.insert(&run);
+    g_parkCv.wait(lock, [] { return !g_suspended.load(); });
+    g_parked.erase(&run);
+}
+
+/**
+ * Keep only the last `limit` bytes of the captured output
+ */
+void appendTail(std::string& output, const char* data, size_t size, size_t limit) {
+    output.append(data, size);
+    if (output.size() > limit) {
+        output.erase(0, output.size() - limit);
+    }
+}
+
+/**
+ * Credentials of the account a job runs as, resolved before fork()
+ */
+struct Identity {
+    bool switch_user = false;
+    uid_t uid = 0;
+    gid_t gid = 0;
+    std::vector<gid_t> groups;   // Supplementary groups (initgroups equivalent)
+    std::string home;
+    std::string name;
+};
+
+/**
+ * Look up a user in the password and group databases
+ */
+bool resolveIdentity(const std::string& user, Identity& identity, std::string& error) {
+    struct passwd pwd;
+    struct passwd* found = nullptr;
+    std::vector<char> buffer(16384);
+    int rc = getpwnam_r(user.c_str(), &pwd, buffer.data(), buffer.size(), &found);
+    if (rc != 0 || !found) {
+        error = "unknown user " + user;
+        return false;
+    }
+    identity.uid = pwd.pw_uid;
+    identity.gid = pwd.pw_gid;
+    identity.home = pwd.pw_dir ? pwd.pw_dir : "/";
+    identity.name = user;
+    identity.switch_user = pwd.pw_uid != geteuid();
+
+    int count = 64;
+    identity.groups.resize(count);
+    while (getgrouplist(user.c_str(), pwd.pw_gid, identity.groups.data(), &count) < 0) {
+        identity.groups.resize(count);
+    }
+    identity.groups.resize(count);
+    return true;
+}
+
+/**
+ * argv, environment, credentials and working directory of a request,
+ * prepared before fork() so the child does not allocate
+ */
+struct Launch {
+    std::vector<char*> argv;
+    std::vector<char*> envp;
+    std::vector<std::string> login_env;   // Backing strings of envp for user jobs
+    Identity identity;
+    std::string cwd;
+};
+
+bool prepareLaunch(const ExecRequest& request, Launch& launch, std::string& error) {
+    for (const auto& arg : request.argv) {
+        launch.argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    launch.argv.push_back(nullptr);
+
+    launch.cwd = request.cwd;
+    if (!request.user.empty()) {
+        if (!resolveIdentity(request.user, launch.identity, error)) {
+            return false;
+        }
+        // Like cron: a minimal login environment, not the daemon's
+        const Identity& identity = launch.identity;
+        launch.login_env = {"HOME=" + identity.home, "USER=" + identity.name, "LOGNAME=" + identity.name,
+                            "SHELL=/bin/sh", "PATH=/usr/local/bin:/usr/bin:/bin"};
+        if (launch.cwd.empty()) {
+            launch.cwd = identity.home;
+        }
+    }
+
+    std::vector<char*> base_env;
+    if (request.user.empty()) {
+        for (char** entry = environ; entry && *entry; ++entry) {
+            base_env.push_back(*entry);
+        }
+    } else {
+        for (auto& var : launch.login_env) {
+            base_env.push_back(const_cast<char*>(var.c_str()));
+        }
+    }
+    for (char* entry : base_env) {
+        bool overridden = false;
+        for (const auto& var : request.env) {
+            size_t eq = var.find('=');
+            if (eq != std::string::npos && std::strncmp(entry, var.c_str(), eq + 1) == 0) {
+                overridden = true;
+                break;
+            }
+        }
+        if (!overridden) launch.envp.push_back(entry);
+    }
+    for (const auto& var : request.env) {
+        launch.envp.push_back(const_cast<char*>(var.c_str()));
+    }
+    launch.envp.push_back(nullptr);
+    return true;
+}
+
+/**
+ * Child side: everything between fork() and exec(). Only async-signal-safe
+ * calls are allowed here; all strings were prepared by the parent.
+ *
+ * @param input_fd stdin of the job (-1 = /dev/null)
+ */
+[[noreturn]] void execChild(const ExecRequest& request, const Launch& launch, int input_fd, int stdout_fd,
+                            int stderr_fd, int error_fd, int release_fd, int release_timeout_ms) {
+    setpgid(0, 0);
+
+    // Restore what the daemon changed: default signal handling, empty mask
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, nullptr);
+
+    if (input_fd >= 0) {
+        dup2(input_fd, STDIN_FILENO);
+    } else {
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            if (null_fd != STDIN_FILENO) close(null_fd);
+        }
+    }
+    dup2(stdout_fd, STDOUT_FILENO);
+    dup2(stderr_fd, STDERR_FILENO);
+    for (int fd : {input_fd, stdout_fd, stderr_fd}) {
+        if (fd > STDERR_FILENO) close(fd);
+    }
+
+    if (request.cpu_limit_seconds > 0) {
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(request.cpu_limit_seconds);
+        setrlimit(RLIMIT_CPU, &limit);
+    }
+    if (request.memory_limit_mb > 0) {
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(request.memory_limit_mb) * 1024 * 1024;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+    if (request.nice > 0) {
+        errno = 0;
+        int current = getpriority(PRIO_PROCESS, 0);
+        if (errno == 0) {
+            setpriority(PRIO_PROCESS, 0, std::min(current + request.nice, 19));
+        }
+    }
+
+    // Drop privileges last, so the limits above are set as hard limits
+    // the job cannot raise again
+    const Identity& identity = launch.identity;
+    if (identity.switch_user &&
+        (setgroups(identity.groups.size(), identity.groups.data()) != 0 ||
+         setresgid(identity.gid, identity.gid, identity.gid) != 0 ||
+         setresuid(identity.uid, identity.uid, identity.uid) != 0)) {
+        int err = errno;
+        ssize_t ignored = write(error_fd, &err, sizeof(err));
+        (void)ignored;
+        _exit(127);
+    }
+
+    if (!launch.cwd.empty() && chdir(launch.cwd.c_str()) != 0) {
+        int err = errno;
+        ssize_t ignored = write(error_fd, &err, sizeof(err));
+        (void)ignored;
+        _exit(127);
+    }
+
+    // Prestart: everything but exec is done, wait to be released. Drop the
+    // daemon's descriptors first: close-on-exec only takes effect at exec,
+    // and a parked child holding the pipes of another run forked meanwhile
+    // would keep that run from seeing its own exec
+    if (release_fd >= 0) {
+        ProcessRunner::closeInheritedFds({error_fd, release_fd});
+        struct pollfd pfd = {release_fd, POLLIN, 0};
+        int rc;
+        do {
+            rc = poll(&pfd, 1, release_timeout_ms);
+        } while (rc < 0 && errno == EINTR);
+        if (rc != 1) {
+            _exit(127);   // Never released: cancelled, or the daemon went away
+        }
+    }
+
+    execvpe(launch.argv[0], launch.argv.data(), launch.envp.data());
+    int err = errno;
+    ssize_t ignored = write(error_fd, &err, sizeof(err));   // Reported by the parent
+    (void)ignored;
+    _exit(127);
+}
+
+/**
+ * Close the descriptors first..last (last may exceed the table size)
+ */
+void closeRange(unsigned first, unsigned last) {
+    if (first > last) {
+        return;
+    }
+#ifdef SYS_close_range
+    if (syscall(SYS_close_range, first, last, 0) == 0) {
+        return;
+    }
+#endif
+    struct rlimit limit;
+    unsigned end = 65536;   // Fallback bound when the table size is unknown
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        end = static_cast<unsigned>(limit.rlim_cur);
+    }
+    for (unsigned fd = first; fd <= last && fd < end; ++fd) {
+        close(static_cast<int>(fd));
+    }
+}
+
+/**
+ * Create the pipes and fork a child running execChild()
+ *
+ * @param error_fd Output read end of the close-on-exec error pipe
+ * @return false (error set) if the launch could not be prepared or forked
+ */
+bool spawn(const ExecRequest& request, int release_fd, int release_timeout_ms, pid_t& pid, int& output_fd,
+           int& error_fd, std::string& error) {
+    Launch launch;
+    if (!prepareLaunch(request, launch, error)) {
+        return false;
+    }
+
+    int output_pipe[2];
+    int error_pipe[2];
+    if (pipe2(output_pipe, O_CLOEXEC) != 0) {
+        error = std::string("pipe failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (pipe2(error_pipe, O_CLOEXEC) != 0) {
+        error = std::string("pipe failed: ") + std::strerror(errno);
+        close(output_pipe[0]);
+        close(output_pipe[1]);
+        return false;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        error = std::string("fork failed: ") + std::strerror(errno);
+        close(output_pipe[0]); close(output_pipe[1]);
+        close(error_pipe[0]); close(error_pipe[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(output_pipe[0]);
+        close(error_pipe[0]);
+        execChild(request, launch, -1, output_pipe[1], output_pipe[1], error_pipe[1],
+                  release_fd, release_timeout_ms);
+    }
+
+    setpgid(pid, pid);   // Also done by the child; whichever runs first wins
+    close(output_pipe[1]);
+    close(error_pipe[1]);
+    output_fd = output_pipe[0];
+    error_fd = error_pipe[0];
+    return true;
+}
+
+/**
+ * Wait for the child's exec: it succeeded iff the close-on-exec error
+ * pipe is closed without data
+ * @return 0, or the errno of the failed exec (error_fd is closed either way)
+ */
+int execResult(int error_fd) {
+    int exec_errno = 0;
+    ssize_t n;
+    do {
+        n = read(error_fd, &exec_errno, sizeof(exec_errno));
+    } while (n < 0 && errno == EINTR);
+    close(error_fd);
+    return n == sizeof(exec_errno) ? exec_errno : 0;
+}
+
+/**
+ * A forked prestart run waiting for its due time
+ */
+struct PendingRelease {
+    PrestartedRun run;
+    int error_fd = -1;
+    int release_fd = -1;                        // eventfd the child waits on
+    const std::atomic<bool>* cancel = nullptr;
+    ProcessRunner::ReleaseCallback on_release;
+};
+
+/**
+ * Release timer: a single thread releases every prestart run, so no
+ * worker sleeps through a lead time. Created on first use and never
+ * destroyed, as its detached thread may still run at exit.
+ */
+struct ReleaseTimer {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<PendingRelease> pending;   // Few entries: scanned linearly
+    size_t releasing = 0;                  // Taken from pending, callback not returned yet
+    bool started = false;
+};
+
+ReleaseTimer& releaseTimer() {
+    static ReleaseTimer* timer = new ReleaseTimer();
+    return *timer;
+}
+
+/** The last stretch before a release is one absolute timer, not polled */
+const int64_t RELEASE_STRETCH_MS = 150;
+
+/**
+ * Kill a run that is never released (nothing of the job has run yet)
+ */
+void dropRelease(PendingRelease& entry) {
+    kill(-entry.run.pid, SIGKILL);
+    waitpid(entry.run.pid, nullptr, 0);
+    close(entry.error_fd);
+    close(entry.release_fd);
+    close(entry.run.output_fd);
+    entry.run.output_fd = -1;
+    entry.run.released = false;
+    entry.on_release(std::move(entry.run));
+}
+
+/**
+ * Release runs due at the same instant: sleep on an absolute
+ * CLOCK_REALTIME timer, signal every eventfd, then wait for each exec
+ */
+void releaseGroup(PendingRelease* group, size_t count) {
+    int64_t due_ms = group[0].run.request.due_ms;
+    struct timespec at;
+    at.tv_sec = static_cast<time_t>(due_ms / 1000);
+    at.tv_nsec = static_cast<long>(due_ms % 1000) * 1000000L;
+    while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &at, nullptr) == EINTR) {}
+
+    int64_t released_ms = monotonicMs();
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t one = 1;
+        ssize_t ignored = write(group[i].release_fd, &one, sizeof(one));
+        (void)ignored;
+        close(group[i].release_fd);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        PendingRelease& entry = group[i];
+        entry.run.exec_errno = execResult(entry.error_fd);
+        entry.run.start_lag_us = realtimeUs() - due_ms * 1000;
+        entry.run.started_ms = released_ms;   // The timeout counts from the release
+        entry.run.released = true;
+        entry.on_release(std::move(entry.run));
+    }
+}
+
+/**
+ * Release timer thread: poll the cancel flags every 100 ms until a run is
+ * RELEASE_STRETCH_MS from its due time, then release it on time
+ */
+void releaseLoop() {
+    prctl(PR_SET_TIMERSLACK, 1UL);   // The default 50 us slack would show up as start jitter
+    ReleaseTimer& timer = releaseTimer();
+    std::vector<PendingRelease> due;
+    std::vector<PendingRelease> dropped;
+    std::unique_lock<std::mutex> lock(timer.mutex);
+    while (true) {
+        int64_t now_ms = realtimeUs() / 1000;
+        int64_t next_ms = INT64_MAX;
+        for (size_t i = 0; i < timer.pending.size();) {
+            PendingRelease& entry = timer.pending[i];
+            int64_t due_ms = entry.run.request.due_ms;
+            if ((entry.cancel && entry.cancel->load()) || g_cancelAll.load(std::memory_order_relaxed)) {
+                dropped.push_back(std::move(entry));
+            } else if (due_ms - now_ms <= RELEASE_STRETCH_MS) {
+                due.push_back(std::move(entry));
+            } else {
+                next_ms = std::min(next_ms, due_ms);
+                ++i;
+                continue;
+            }
+            if (i + 1 < timer.pending.size()) {
+                entry = std::move(timer.pending.back());
+            }
+            timer.pending.pop_back();
+        }
+        if (due.empty() && dropped.empty()) {
+            if (timer.pending.empty()) {
+                timer.cv.wait(lock);
+            } else {
+                int64_t wait_ms = std::min<int64_t>(next_ms - RELEASE_STRETCH_MS - now_ms, 100);
+                timer.cv.wait_for(lock, std::chrono::milliseconds(std::max<int64_t>(wait_ms, 1)));
+            }
+            continue;
+        }
+
+        size_t taken = due.size() + dropped.size();
+        timer.releasing += taken;
+        lock.unlock();
+        for (auto& entry : dropped) {
+            dropRelease(entry);
+        }
+        std::sort(due.begin(), due.end(), [](const PendingRelease& a, const PendingRelease& b) {
+            return a.run.request.due_ms < b.run.request.due_ms;
+        });
+        for (size_t begin = 0; begin < due.size();) {
+            size_t end = begin + 1;
+            while (end < due.size() && due[end].run.request.due_ms == due[begin].run.request.due_ms) {
+                ++end;
+            }
+            releaseGroup(&due[begin], end - begin);
+            begin = end;
+        }
+        due.clear();
+        dropped.clear();
+        lock.lock();
+        timer.releasing -= taken;
+        timer.cv.notify_all();   // cancelAll() waits for releases under way
+    }
+}
+
+} // namespace
+
+void ProcessRunner::closeInheritedFds(std::initializer_list<int> keep) {
+    int kept[8];
+    size_t count = 0;
+    for (int fd : keep) {
+        if (fd > STDERR_FILENO && count < 8) kept[count++] = fd;
+    }
+    std::sort(kept, kept + count);
+    unsigned first = STDERR_FILENO + 1;
+    for (size_t i = 0; i < count; ++i) {
+        closeRange(first, static_cast<unsigned>(kept[i]) - 1);
+        first = static_cast<unsigned>(kept[i]) + 1;
+    }
+    closeRange(first, ~0U);
+}
+
+std::vector<std::string> ProcessRunner::shellArgv(const std::string& command) {
+    return {"/bin/sh", "-c", command};
+}
+
+bool ProcessRunner::run(const ExecRequest& request, ExecResult& result,
+                        const std::atomic<bool>* cancel, const std::function<void(pid_t)>& on_start) {
+    result = ExecResult();
+    if (request.argv.empty()) {
+        result.error = "empty argv";
+        return false;
+    }
+
+    if (request.prestart && request.due_ms * 1000 > realtimeUs()) {
+        // Released by the release timer; this thread only waits for it
+        std::mutex mutex;
+        std::condition_variable released_cv;
+        bool released = false;
+        PrestartedRun parked;
+        auto on_release = [&](PrestartedRun run) {
+            std::lock_guard<std::mutex> lock(mutex);
+            parked = std::move(run);
+            released = true;
+            released_cv.notify_one();
+        };
+        if (!prestart(request, on_release, result.error, cancel)) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        released_cv.wait(lock, [&released] { return released; });
+        return finish(std::move(parked), result, cancel, on_start);
+    }
+
+    PrestartedRun run;
+    run.request = request;
+    run.started_ms = monotonicMs();
+    int error_fd = -1;
+    if (!spawn(request, -1, 0, run.pid, run.output_fd, error_fd, result.error)) {
+        return false;
+    }
+    run.exec_errno = execResult(error_fd);
+    if (request.due_ms > 0) {
+        run.start_lag_us = realtimeUs() - request.due_ms * 1000;
+    }
+    run.released = true;
+    return finish(std::move(run), result, cancel, on_start);
+}
+
+bool ProcessRunner::prestart(const ExecRequest& request, ReleaseCallback on_release, std::string& error,
+                             const std::atomic<bool>* cancel) {
+    if (request.argv.empty()) {
+        error = "empty argv";
+        return false;
+    }
+    // The child blocks on this eventfd right before exec, and gives up on
+    // its own shortly after the due time if nobody releases it
+    PendingRelease entry;
+    entry.release_fd = eventfd(0, EFD_CLOEXEC);
+    if (entry.release_fd < 0) {
+        error = std::string("eventfd failed: ") + std::strerror(errno);
+        return false;
+    }
+    int release_timeout_ms = static_cast<int>(std::max<int64_t>(request.due_ms - realtimeUs() / 1000, 0)) + 10000;
+    if (!spawn(request, entry.release_fd, release_timeout_ms, entry.run.pid, entry.run.output_fd, entry.error_fd,
+               error)) {
+        close(entry.release_fd);
+        return false;
+    }
+    entry.run.request = request;
+    entry.cancel = cancel;
+    entry.on_release = std::move(on_release);
+
+    ReleaseTimer& timer = releaseTimer();
+    {
+        std::lock_guard<std::mutex> lock(timer.mutex);
+        timer.pending.push_back(std::move(entry));
+        if (!timer.started) {
+            std::thread(releaseLoop).detach();
+            timer.started = true;
+        }
+    }
+    timer.cv.notify_all();
+    return true;
+}
+
+bool ProcessRunner::finish(PrestartedRun run, ExecResult& result, const std::atomic<bool>* cancel,
+                           const std::function<void(pid_t)>& on_start) {
+    result = ExecResult();
+    if (!run.released) {
+        result.cancelled = true;   // Killed before exec, already reaped
+        return true;
+    }
+    if (run.exec_errno != 0) {
+        waitpid(run.pid, nullptr, 0);
+        close(run.output_fd);
+        result.error = "cannot execute " + run.request.argv[0] +
+                       (run.request.user.empty() ? "" : " as " + run.request.user) + ": " +
+                       std::strerror(run.exec_errno);
+        return false;
+    }
+    result.start_lag_us = run.start_lag_us;
+
+    if (on_start) {
+        on_start(run.pid);
+    }
+
+    SupervisedRun supervised;
+    supervised.pid = run.pid;
+    supervised.output_fd = run.output_fd;
+    supervised.started_ms = run.started_ms;
+    supervised.request = std::move(run.request);
+    // A pidfd becomes readable when the child exits, so short jobs are
+    // reaped at once instead of on the next 100 ms poll tick (Linux >= 5.3)
+#ifdef SYS_pidfd_open
+    supervised.pid_fd = static_cast<int>(syscall(SYS_pidfd_open, supervised.pid, 0));
+#endif
+    supervise(supervised, result, cancel);
+    return true;
+}
+
+size_t ProcessRunner::prestartedCount() {
+    ReleaseTimer& timer = releaseTimer();
+    std::lock_guard<std::mutex> lock(timer.mutex);
+    return timer.pending.size() + timer.releasing;
+}
+
+/**
+ * Stages are forked first and checked for exec errors afterwards, so a
+ * stage that cannot start still sees its neighbours' pipes close like a
+ * failing program would. Each stage has its own process group, timeout
+ * and wait4() accounting; stderr (and stdout of the last stage) is
+ * captured per stage.
+ *
+ * With relay, stage i writes to a pipe the daemon splices into the next
+ * stage's stdin pipe: the data moves between pipe buffers in the kernel,
+ * never through user space, and every chunk is counted. A link whose
+ * reader is gone is closed, so the writer gets EPIPE like in a shell.
+ */
+bool ProcessRunner::runPipeline(const std::vector<ExecRequest>& stages, std::vector<ExecResult>& results,
+                                bool relay, bool abort_on_failure, size_t* failed_stage) {
+    size_t count = stages.size();
+    results.assign(count, ExecResult());
+    size_t cause = SIZE_MAX;
+    if (failed_stage) {
+        *failed_stage = SIZE_MAX;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    std::vector<Launch> launches(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (stages[i].argv.empty()) {
+            results[i].error = "empty argv";
+        } else if (prepareLaunch(stages[i], launches[i], results[i].error)) {
+            continue;
+        }
+        if (failed_stage) {
+            *failed_stage = i;
+        }
+        return false;
+    }
+
+    // Descriptors: child ends are closed once every stage is forked
+    struct Link {
+        int read_fd = -1;       // Relay: read end of stage i's stdout
+        int write_fd = -1;      // Relay: write end of stage i+1's stdin
+        bool blocked = false;   // Data waits for room in write_fd
+    };
+    std::vector<Link> links(count - 1);
+    std::vector<int> stdin_fds(count, -1);
+    std::vector<int> stdout_fds(count, -1);
+    std::vector<int> capture_fds(count, -1);     // Parent end of each stage's output
+    std::vector<int> capture_child(count, -1);
+    std::vector<int> child_fds;
+    auto closeAll = [&] {
+        for (int fd : child_fds) close(fd);
+        for (int fd : capture_fds) if (fd >= 0) close(fd);
+        for (Link& link : links) {
+            if (link.read_fd >= 0) close(link.read_fd);
+            if (link.write_fd >= 0) close(link.write_fd);
+        }
+    };
+    auto makePipe = [&](int fds[2]) {
+        if (pipe2(fds, O_CLOEXEC) == 0) {
+            return true;
+        }
+        results[0].error = std::string("pipe failed: ") + std::strerror(errno);
+        closeAll();
+        return false;
+    };
+
+    int fds[2];
+    for (size_t i = 0; i < count; ++i) {
+        if (!makePipe(fds)) return false;
+        capture_fds[i] = fds[0];
+        capture_child[i] = fds[1];
+        child_fds.push_back(fds[1]);
+        stdout_fds[i] = fds[1];   // Last stage: stdout is captured with stderr
+    }
+    for (size_t i = 0; i + 1 < count; ++i) {
+        if (!makePipe(fds)) return false;
+        stdout_fds[i] = fds[1];
+        child_fds.push_back(fds[1]);
+        if (!relay) {
+            stdin_fds[i + 1] = fds[0];
+            child_fds.push_back(fds[0]);
+            continue;
+        }
+        links[i].read_fd = fds[0];
+        if (!makePipe(fds)) return false;
+        links[i].write_fd = fds[1];
+        stdin_fds[i + 1] = fds[0];
+        child_fds.push_back(fds[0]);
+        for (int fd : {links[i].read_fd, links[i].write_fd}) {
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+            fcntl(fd, F_SETPIPE_SZ, 1 << 20);   // Best effort: larger chunks per splice
+        }
+    }
+
+    std::vector<SupervisedRun> runs(count);
+    std::vector<int> error_fds(count, -1);
+    int64_t started = monotonicMs();
+    for (size_t i = 0; i < count; ++i) {
+        int error_pipe[2];
+        pid_t pid = -1;
+        if (pipe2(error_pipe, O_CLOEXEC) == 0) {
+            pid = fork();
+            if (pid < 0) {
+                close(error_pipe[0]);
+                close(error_pipe[1]);
+            }
+        }
+        if (pid < 0) {
+            results[i].error = std::string("fork failed: ") + std::strerror(errno);
+            for (size_t j = 0; j < i; ++j) {
+                kill(-runs[j].pid, SIGKILL);
+                waitpid(runs[j].pid, nullptr, 0);
+                close(error_fds[j]);
+            }
+            closeAll();
+            return false;
+        }
+        if (pid == 0) {
+            close(error_pipe[0]);
+            execChild(stages[i], launches[i], stdin_fds[i], stdout_fds[i], capture_child[i], error_pipe[1], -1, 0);
+        }
+        setpgid(pid, pid);
+        close(error_pipe[1]);
+        error_fds[i] = error_pipe[0];
+        runs[i].request = stages[i];
+        runs[i].pid = pid;
+        runs[i].started_ms = started;
+    }
+    for (int fd : child_fds) {
+        close(fd);
+    }
+    child_fds.clear();
+
+    // exec succeeded iff the close-on-exec error pipe is closed without data
+    size_t remaining = 0;
+    std::vector<struct rusage> usage(count);
+    std::vector<int> status(count, 0);
+    std::vector<bool> done(count, false);
+    bool all_started = true;
+    for (size_t i = 0; i < count; ++i) {
+        int exec_errno = 0;
+        ssize_t n;
+        do {
+            n = read(error_fds[i], &exec_errno, sizeof(exec_errno));
+        } while (n < 0 && errno == EINTR);
+        close(error_fds[i]);
+        if (n == sizeof(exec_errno)) {
+            waitpid(runs[i].pid, nullptr, 0);
+            results[i].error = "cannot execute " + stages[i].argv[0] +
+                               (stages[i].user.empty() ? "" : " as " + stages[i].user) + ": " +
+                               std::strerror(exec_errno);
+            done[i] = true;
+            if (all_started && abort_on_failure) {
+                cause = i;
+            }
+            all_started = false;
+            continue;
+        }
+        ++remaining;
+#ifdef SYS_pidfd_open
+        runs[i].pid_fd = static_cast<int>(syscall(SYS_pidfd_open, runs[i].pid, 0));
+#endif
+    }
+
+    // A splice into a pipe without reader raises SIGPIPE; report it as EPIPE instead
+    sigset_t pipe_set;
+    sigset_t previous;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &previous);
+
+    bool stop_all = !all_started && abort_on_failure;
+    char buffer[4096];
+    std::vector<struct pollfd> polled;
+    std::vector<std::pair<int, size_t>> owners;   // (kind, stage): 0 output, 1 pidfd, 2 link
+    while (remaining > 0) {
+        polled.clear();
+        owners.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (capture_fds[i] >= 0) {
+                polled.push_back({capture_fds[i], POLLIN, 0});
+                owners.emplace_back(0, i);
+            }
+            if (!done[i] && runs[i].pid_fd >= 0) {
+                polled.push_back({runs[i].pid_fd, POLLIN, 0});
+                owners.emplace_back(1, i);
+            }
+            if (i + 1 < count && links[i].read_fd >= 0) {
+                polled.push_back(links[i].blocked ? pollfd{links[i].write_fd, POLLOUT, 0}
+                                                  : pollfd{links[i].read_fd, POLLIN, 0});
+                owners.emplace_back(2, i);
+            }
+        }
+        if (poll(polled.data(), polled.size(), 100) > 0) {
+            for (size_t p = 0; p < polled.size(); ++p) {
+                if (!polled[p].revents) continue;
+                size_t i = owners[p].second;
+                if (owners[p].first == 0) {
+                    ssize_t n = read(capture_fds[i], buffer, sizeof(buffer));
+                    if (n > 0) {
+                        appendTail(runs[i].output, buffer, static_cast<size_t>(n), stages[i].max_output);
+                    } else if (n == 0 || errno != EINTR) {
+                        close(capture_fds[i]);
+                        capture_fds[i] = -1;
+                    }
+                } else if (owners[p].first == 2) {
+                    Link& link = links[i];
+                    link.blocked = false;
+                    while (true) {
+                        ssize_t n = splice(link.read_fd, nullptr, link.write_fd, nullptr, 1 << 20,
+                                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                        if (n > 0) {
+                            results[i].bytes_out += static_cast<uint64_t>(n);
+                            continue;
+                        }
+                        if (n < 0 && errno == EINTR) continue;
+                        if (n < 0 && errno == EAGAIN) {
+                            // Data left over means the next stage's pipe is full
+                            int pending = 0;
+                            link.blocked = ioctl(link.read_fd, FIONREAD, &pending) == 0 && pending > 0;
+                            break;
+                        }
+                        close(link.read_fd);    // End of data, or the reader is gone
+                        close(link.write_fd);
+                        link.read_fd = link.write_fd = -1;
+                        break;
+                    }
+                }
+            }
+        }
+
+        int64_t now = monotonicMs();
+        bool stopped_before = stop_all;
+        for (size_t i = 0; i < count; ++i) {
+            if (done[i]) continue;
+            pid_t reaped = wait4(runs[i].pid, &status[i], WNOHANG, &usage[i]);
+            if (reaped == runs[i].pid || (reaped < 0 && errno != EINTR)) {
+                done[i] = true;
+                --remaining;
+                results[i].duration_ms = now - started;
+                bool failed = reaped < 0 || !WIFEXITED(status[i]) || WEXITSTATUS(status[i]) != 0;
+                if (failed && abort_on_failure && !stopped_before) {
+                    // Upstream stages die of SIGPIPE right after the one that
+                    // failed: of those reaped together, blame the rightmost
+                    stop_all = true;
+                    cause = i;
+                }
+                if (runs[i].pid_fd >= 0) {
+                    close(runs[i].pid_fd);
+                    runs[i].pid_fd = -1;
+                }
+                continue;
+            }
+            SupervisedRun& run = runs[i];
+            if (run.kill_at_ms < 0) {
+                bool expired = now >= run.started_ms + static_cast<int64_t>(stages[i].timeout_seconds) * 1000;
+                bool stop = stop_all || g_cancelAll.load(std::memory_order_relaxed);
+                if (expired || stop) {
+                    run.timed_out = expired;
+                    run.cancelled = !expired;
+                    kill(-run.pid, SIGTERM);
+                    run.kill_at_ms = now + KILL_GRACE_MS;
+                }
+            } else if (now >= run.kill_at_ms) {
+                kill(-run.pid, SIGKILL);
+                run.kill_at_ms = INT64_MAX;
+            }
+        }
+    }
+
+    // Collect what the stages wrote right before exiting
+    for (size_t i = 0; i < count; ++i) {
+        if (capture_fds[i] >= 0) {
+            fcntl(capture_fds[i], F_SETFL, O_NONBLOCK);
+            ssize_t n;
+            while ((n = read(capture_fds[i], buffer, sizeof(buffer))) > 0) {
+                appendTail(runs[i].output, buffer, static_cast<size_t>(n), stages[i].max_output);
+            }
+            close(capture_fds[i]);
+            capture_fds[i] = -1;
+        }
+    }
+    closeAll();
+    struct timespec zero = {0, 0};
+    while (sigtimedwait(&pipe_set, nullptr, &zero) > 0) {}
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    if (failed_stage) {
+        *failed_stage = cause;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        ExecResult& result = results[i];
+        if (!result.started()) continue;
+        result.output = std::move(runs[i].output);
+        result.timed_out = runs[i].timed_out;
+        result.cancelled = runs[i].cancelled;
+        result.user_ms = usage[i].ru_utime.tv_sec * 1000 + usage[i].ru_utime.tv_usec / 1000;
+        result.sys_ms = usage[i].ru_stime.tv_sec * 1000 + usage[i].ru_stime.tv_usec / 1000;
+        result.max_rss_kb = usage[i].ru_maxrss;
+        if (WIFEXITED(status[i])) {
+            result.exit_code = WEXITSTATUS(status[i]);
+        } else if (WIFSIGNALED(status[i])) {
+            result.term_signal = WTERMSIG(status[i]);
+        }
+    }
+    return all_started;
+}
+
+void ProcessRunner::adopt(SupervisedRun run, ExecResult& result, const std::atomic<bool>* cancel) {
+    result = ExecResult();
+    // Inherited without close-on-exec; later jobs must not inherit them again
+    if (run.pid_fd >= 0) {
+        fcntl(run.pid_fd, F_SETFD, FD_CLOEXEC);
+    }
+    if (run.output_fd >= 0) {
+        fcntl(run.output_fd, F_SETFD, FD_CLOEXEC);
+    }
+    supervise(run, result, cancel);
+}
+
+void ProcessRunner::supervise(SupervisedRun& run, ExecResult& result, const std::atomic<bool>* cancel) {
+    int64_t deadline = run.started_ms + static_cast<int64_t>(run.request.timeout_seconds) * 1000;
+    int status = 0;
+    struct rusage usage;
+    std::memset(&usage, 0, sizeof(usage));
+    char buffer[4096];
+    ssize_t n;
+    run.active_ms = std::max(run.active_ms, run.started_ms);
+
+    while (true) {
+        if (g_suspended.load()) {
+            park(run);
+        }
+
+        struct pollfd fds[2];
+        nfds_t count = 0;
+        bool output_open = run.output_fd >= 0;
+        if (output_open) {
+            fds[count++] = {run.output_fd, POLLIN, 0};
+        }
+        if (run.pid_fd >= 0) {
+            fds[count++] = {run.pid_fd, POLLIN, 0};
+        }
+        int timeout_ms = count ? 100 : 10;
+        if (poll(count ? fds : nullptr, count, timeout_ms) > 0 && output_open && fds[0].revents) {
+            n = read(run.output_fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                appendTail(run.output, buffer, static_cast<size_t>(n), run.request.max_output);
+                run.active_ms = monotonicMs();
+            } else if (n == 0 || errno != EINTR) {
+                close(run.output_fd);   // All writers gone
+                run.output_fd = -1;
+            }
+        }
+
+        pid_t done = wait4(run.pid, &status, WNOHANG, &usage);
+        if (done == run.pid) {
+            break;
+        }
+        if (done < 0 && errno != EINTR) {
+            result.error = std::string("wait4 failed: ") + std::strerror(errno);
+            break;
+        }
+
+        int64_t now = monotonicMs();
+        if (run.kill_at_ms < 0) {
+            bool expired = now >= deadline;
+            bool hung = !expired && idleExpired(run, now);
+            bool stop = (cancel && cancel->load()) || g_cancelAll.load(std::memory_order_relaxed);
+            if (expired || hung || stop) {
+                run.timed_out = expired;
+                run.hung = hung;
+                run.cancelled = !expired && !hung;
+                kill(-run.pid, SIGTERM);
+                run.kill_at_ms = now + KILL_GRACE_MS;
+            }
+        } else if (now >= run.kill_at_ms) {
+            kill(-run.pid, SIGKILL);
+            run.kill_at_ms = INT64_MAX;
+        }
+    }
+
+    // Collect what the job wrote right before exiting; do not wait for
+    // background grandchildren that may keep the pipe open
+    if (run.output_fd >= 0) {
+        fcntl(run.output_fd, F_SETFL, O_NONBLOCK);
+        while ((n = read(run.output_fd, buffer, sizeof(buffer))) > 0) {
+            appendTail(run.output, buffer, static_cast<size_t>(n), run.request.max_output);
+        }
+        close(run.output_fd);
+        run.output_fd = -1;
+    }
+    if (run.pid_fd >= 0) {
+        close(run.pid_fd);
+        run.pid_fd = -1;
+    }
+
+    result.output = std::move(run.output);
+    result.timed_out = run.timed_out;
+    result.cancelled = run.cancelled;
+    result.hung = run.hung;
+    result.duration_ms = monotonicMs() - run.started_ms;
+    result.user_ms = usage.ru_utime.tv_sec * 1000 + usage.ru_utime.tv_usec / 1000;
+    result.sys_ms = usage.ru_stime.tv_sec * 1000 + usage.ru_stime.tv_usec / 1000;
+    result.max_rss_kb = usage.ru_maxrss;
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.term_signal = WTERMSIG(status);
+    }
+}
+
+void ProcessRunner::cancelAll() {
+    g_cancelAll.store(true);
+
+    // Kill the parked prestart children here and wait for releases already
+    // under way, so every callback has run when this returns
+    ReleaseTimer& timer = releaseTimer();
+    std::vector<PendingRelease> dropped;
+    {
+        std::lock_guard<std::mutex> lock(timer.mutex);
+        dropped.swap(timer.pending);
+        timer.releasing += dropped.size();
+    }
+    for (auto& entry : dropped) {
+        dropRelease(entry);
+    }
+    std::unique_lock<std::mutex> lock(timer.mutex);
+    timer.releasing -= dropped.size();
+    timer.cv.notify_all();
+    timer.cv.wait(lock, [&timer] { return timer.releasing == 0; });
+}
+
+bool ProcessRunner::cancelRequested() {
+    return g_cancelAll.load(std::memory_order_relaxed);
+}
+
+void ProcessRunner::suspendAll() {
+    std::lock_guard<std::mutex> lock(g_parkMutex);
+    g_suspended.store(true);
+}
+
+void ProcessRunner::resumeAll() {
+    {
+        std::lock_guard<std::mutex> lock(g_parkMutex);
+        g_suspended.store(false);
+    }
+    g_parkCv.notify_all();
+}
+
+size_t ProcessRunner::suspendedCount() {
+    std::lock_guard<std::mutex> lock(g_parkMutex);
+    return g_parked.size();
+}
+
+std::vector<SupervisedRun> ProcessRunner::suspendedRuns() {
+    std::lock_guard<std::mutex> lock(g_parkMutex);
+    std::vector<SupervisedRun> runs;
+    runs.reserve(g_parked.size());
+    for (const SupervisedRun* run : g_parked) {
+        runs.push_back(*run);
+    }
+    return runs;
+}
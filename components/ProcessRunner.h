@@ -0,0 +1,260 @@
+#ifndef PROCESS_RUNNER_H
+#define PROCESS_RUNNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * STRUCT: Everything needed to start one job process
+ */
+struct ExecRequest {
+    std::vector<std::string> argv;      // argv[0] is resolved through PATH if it has no '/'
+    std::vector<std::string> env;       // "KEY=value" entries added to the inherited environment
+    std::string cwd;                    // Working directory ("" = inherit, or the user's home)
+    std::string user;                   // Account to run as ("" = the caller's own)
+    int timeout_seconds = 300;          // Wall-clock limit, process group killed after it
+    int idle_timeout_seconds = 0;       // Killed as hung after this long without output (0 = off)
+    std::string heartbeat_file;         // A recent mtime of this file also counts as progress
+    int cpu_limit_seconds = 0;          // RLIMIT_CPU (0 = unlimited)
+    int memory_limit_mb = 0;            // RLIMIT_AS (0 = unlimited)
+    int nice = 0;                       // Scheduling priority added to the inherited one (0-19)
+    size_t max_output = 4096;           // Bytes of combined stdout/stderr kept (tail)
+    std::string label;                  // Caller's name for the run (kept across an upgrade)
+    std::string job_id;                 // Caller's job ID for events (kept across an upgrade)
+    int64_t due_ms = 0;                 // Wall-clock time the run is due (ms since epoch, 0 = unknown)
+    bool prestart = false;              // Fork ahead of due_ms and exec exactly at it
+};
+
+/**
+ * STRUCT: Outcome and resource usage of one job process
+ */
+struct ExecResult {
+    int exit_code = -1;         // Exit status, -1 if killed by a signal or not started
+    int term_signal = 0;        // Signal that terminated the process (0 = none)
+    bool timed_out = false;     // Killed because timeout_seconds expired
+    bool cancelled = false;     // Killed because the cancel flag was raised
+    bool hung = false;          // Killed because it made no progress for idle_timeout_seconds
+    int64_t duration_ms = 0;    // Wall-clock run time
+    int64_t user_ms = 0;        // CPU time in user mode (wait4 rusage)
+    int64_t sys_ms = 0;         // CPU time in kernel mode
+    int64_t max_rss_kb = 0;     // Peak resident set size
+    std::string output;         // Last max_output bytes of stdout/stderr
+    std::string error;          // fork/exec failure description
+    int64_t start_lag_us = 0;   // exec completed this long after due_ms (0 if due_ms is unset)
+    uint64_t bytes_out = 0;     // Pipeline stage: bytes relayed to the next stage (relay mode only)
+
+    bool started() const { return error.empty(); }
+};
+
+/**
+ * STRUCT: Supervision state of a started job process
+ *
+ * Holds everything the supervising loop works with, so a run can be
+ * handed to a new daemon image: execve() keeps the PID, the daemon stays
+ * the parent of its jobs and the new image continues with adopt().
+ */
+struct SupervisedRun {
+    ExecRequest request;        // What was started (timeout, user, label, output limit)
+    pid_t pid = -1;
+    int pid_fd = -1;            // pidfd of the child (-1 if unsupported)
+    int output_fd = -1;         // Read end of the output pipe (-1 once closed)
+    int64_t started_ms = 0;     // Monotonic start time (system-wide clock)
+    int64_t kill_at_ms = -1;    // SIGKILL time once SIGTERM was sent (-1 = not sent)
+    int64_t active_ms = 0;      // Monotonic time of the last output or heartbeat
+    bool timed_out = false;
+    bool cancelled = false;
+    bool hung = false;
+    std::string output;         // Output tail captured so far
+};
+
+/**
+ * STRUCT: A prestart run once its release timer fired
+ *
+ * Handed to the callback of ProcessRunner::prestart(), which passes it on
+ * to ProcessRunner::finish() on the thread that supervises it.
+ */
+struct PrestartedRun {
+    ExecRequest request;
+    pid_t pid = -1;
+    int output_fd = -1;         // Read end of the output pipe (-1 if not released)
+    bool released = false;      // false: cancelled first, the child was killed and reaped
+    int exec_errno = 0;         // Why exec failed (0 = the program started)
+    int64_t started_ms = 0;     // Monotonic release time, where the timeout starts
+    int64_t start_lag_us = 0;   // exec completed this long after due_ms
+};
+
+/**
+ * ProcessRunner Class - fork/exec with process groups, limits and rusage
+ *
+ * Each job runs in its own process group with stdin on /dev/null and
+ * stdout/stderr captured through a pipe. On timeout or cancellation the
+ * whole group receives SIGTERM, then SIGKILL after a grace period, so
+ * shell pipelines and background children do not survive their job.
+ * Resource usage comes from wait4(), so it covers exactly this job.
+ *
+ * With ExecRequest::idle_timeout_seconds set, a job that writes nothing
+ * and does not touch its heartbeat file for that long is killed the same
+ * way and reported as hung rather than timed out.
+ *
+ * With ExecRequest::user set, the child switches to that account
+ * (setgroups from the user's group list, setresgid, setresuid) right
+ * before exec and gets a login-like environment instead of the daemon's.
+ *
+ * Used by JobExecutor for local runs and by nanoCronAgent for remote ones.
+ *
+ * A prestart run (prestart(), or run() with ExecRequest::prestart and
+ * due_ms in the future) is forked at once and does everything up to exec
+ * in the child (process group, limits, credentials, working directory),
+ * then closes the daemon's descriptors and waits on an eventfd. A single
+ * release timer thread sleeps until due_ms with an absolute
+ * CLOCK_REALTIME timer and releases it, so only exec itself lies between
+ * the deadline and the program's start, and no caller thread waits
+ * through the lead time. The timeout counts from the release. A child
+ * that is never released (cancellation, daemon gone) exits on its own
+ * shortly after the deadline.
+ *
+ * runPipeline() starts several processes connected stdout to stdin, each
+ * supervised and accounted like a single run.
+ *
+ * For a daemon upgrade, suspendAll() parks every supervised run without
+ * touching its child, suspendedRuns() returns their state, and the new
+ * image continues each one with adopt().
+ */
+class ProcessRunner {
+public:
+    /**
+     * Run a process to completion
+     *
+     * @param request What to run
+     * @param result Output outcome (always filled)
+     * @param cancel Optional flag polled every 100 ms; raising it kills the job
+     * @param on_start Optional callback invoked with the child PID once forked
+     * @return true if the process was started
+     */
+    static bool run(const ExecRequest& request, ExecResult& result,
+                    const std::atomic<bool>* cancel = nullptr,
+                    const std::function<void(pid_t)>& on_start = nullptr);
+
+    using ReleaseCallback = std::function<void(PrestartedRun run)>;
+
+    /**
+     * Fork a prestart run and leave it to the release timer
+     *
+     * @param request What to run; exec happens at due_ms
+     * @param on_release Called on the release timer thread (or in
+     *                   cancelAll()) once the child was released or killed;
+     *                   it must hand the run over to finish() elsewhere
+     *                   and return at once, other releases wait for it
+     * @param error Output fork failure description
+     * @param cancel Optional flag; raising it before due_ms kills the child
+     * @return false if nothing was forked (on_release is never called)
+     */
+    static bool prestart(const ExecRequest& request, ReleaseCallback on_release, std::string& error,
+                         const std::atomic<bool>* cancel = nullptr);
+
+    /**
+     * Supervise a released prestart run to completion, like run()
+     *
+     * @return true if the process was started
+     */
+    static bool finish(PrestartedRun run, ExecResult& result, const std::atomic<bool>* cancel = nullptr,
+                       const std::function<void(pid_t)>& on_start = nullptr);
+
+    /**
+     * Prestart runs forked and not handed to their callback yet
+     */
+    static size_t prestartedCount();
+
+    /**
+     * Run the stages of a pipeline together, the stdout of each stage
+     * feeding the stdin of the next one
+     *
+     * Pipelines are not parked by suspendAll(); they run to completion.
+     *
+     * @param stages One request per stage (argv, env, user, limits, timeout)
+     * @param results One outcome per stage (always filled); the output is
+     *                the stage's stderr, plus stdout for the last stage
+     * @param relay Connect the stages through the daemon with splice()
+     *              instead of direct pipes, counting ExecResult::bytes_out
+     * @param abort_on_failure Terminate every stage once one fails
+     * @param failed_stage Optional output: with abort_on_failure, the stage
+     *                     whose failure stopped the others (the rightmost
+     *                     one if several were reaped together), else SIZE_MAX
+     * @return true if every stage was started
+     */
+    static bool runPipeline(const std::vector<ExecRequest>& stages, std::vector<ExecResult>& results,
+                            bool relay = false, bool abort_on_failure = false, size_t* failed_stage = nullptr);
+
+    /**
+     * Continue supervising a run started by a previous daemon image
+     *
+     * @param run State saved by suspendedRuns() (its descriptors inherited)
+     * @param result Output outcome (always filled)
+     * @param cancel Optional flag polled every 100 ms; raising it kills the job
+     */
+    static void adopt(SupervisedRun run, ExecResult& result, const std::atomic<bool>* cancel = nullptr);
+
+    /**
+     * Park every supervised run at its next poll (within 100 ms)
+     *
+     * Parked runs neither read, reap nor kill their child until resumeAll().
+     * Runs started meanwhile park as soon as their process is forked.
+     */
+    static void suspendAll();
+
+    /**
+     * Let parked runs continue (the upgrade did not happen)
+     */
+    static void resumeAll();
+
+    /**
+     * Number of parked runs
+     */
+    static size_t suspendedCount();
+
+    /**
+     * Copy of the state of every parked run
+     */
+    static std::vector<SupervisedRun> suspendedRuns();
+
+    /**
+     * Raise the cancel flag of every running and future run
+     * (called once at daemon shutdown when the drain timeout expires);
+     * parked prestart children are killed and their callbacks run before
+     * it returns
+     */
+    static void cancelAll();
+
+    /**
+     * @return true once cancelAll() was called
+     */
+    static bool cancelRequested();
+
+    /**
+     * Build the argv for a shell command line (/bin/sh -c command)
+     */
+    static std::vector<std::string> shellArgv(const std::string& command);
+
+    /**
+     * Close every descriptor above stderr except `keep`: called in a
+     * forked child so it pins none of the daemon's pipes and sockets
+     * (async-signal-safe; close_range() where available)
+     */
+    static void closeInheritedFds(std::initializer_list<int> keep = {});
+
+    /** Delay between SIGTERM and SIGKILL on timeout or cancellation */
+    static constexpr int KILL_GRACE_MS = 5000;
+
+private:
+    /**
+     * Read output, enforce the timeout and reap the child of a started run
+     */
+    static void supervise(SupervisedRun& run, ExecResult& result, const std::atomic<bool>* cancel);
+};
+
+#endif // PROCESS_RUNNER_H
@@ -0,0 +1,195 @@
+/**
+ * @file Quotas.cpp
+ * @brief Rolling-window run, CPU and wall-time quotas
+ */
+
+#include "Quotas.h"
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+struct Slice {
+    uint64_t runs = 0;
+    int64_t cpu_ms = 0;
+    int64_t wall_ms = 0;
+};
+
+/**
+ * Sliding window of one counter: BUCKETS slices plus their running sum
+ */
+struct Counter {
+    QuotaUsage usage;                       // Totals of the slices in the window
+    std::array<Slice, Quotas::BUCKETS> slices;
+    int64_t head = -1;                      // Absolute number of the current slice
+    std::time_t last_used = 0;              // Last run admitted, refused or charged
+
+    int64_t sliceSeconds() const {
+        return std::max<int64_t>(1, usage.window_seconds / static_cast<int64_t>(Quotas::BUCKETS));
+    }
+
+    /**
+     * Move the window to `now`, dropping the slices that left it
+     * (at most BUCKETS steps, however long the counter was idle)
+     */
+    void advance(std::time_t now) {
+        int64_t current = static_cast<int64_t>(now) / sliceSeconds();
+        if (head < 0 || current - head >= static_cast<int64_t>(Quotas::BUCKETS)) {
+            slices.fill(Slice());
+            usage.runs = 0;
+            usage.cpu_ms = usage.wall_ms = 0;
+            head = current;
+            return;
+        }
+        while (head < current) {
+            Slice& expired = slices[static_cast<size_t>(++head) % Quotas::BUCKETS];
+            usage.runs -= expired.runs;
+            usage.cpu_ms -= expired.cpu_ms;
+            usage.wall_ms -= expired.wall_ms;
+            expired = Slice();
+        }
+    }
+
+    Slice& current() {
+        return slices[static_cast<size_t>(head) % Quotas::BUCKETS];
+    }
+
+    /**
+     * Time the oldest non-empty slice leaves the window
+     */
+    std::time_t nextRelease() const {
+        for (int64_t n = head - static_cast<int64_t>(Quotas::BUCKETS) + 1; n <= head; ++n) {
+            const Slice& slice = slices[static_cast<size_t>(n) % Quotas::BUCKETS];
+            if (slice.runs || slice.cpu_ms || slice.wall_ms) {
+                return static_cast<std::time_t>((n + static_cast<int64_t>(Quotas::BUCKETS)) * sliceSeconds());
+            }
+        }
+        return static_cast<std::time_t>((head + 1) * sliceSeconds());
+    }
+};
+
+std::mutex g_mutex;
+std::unordered_map<std::string, Counter> g_counters;
+
+std::string windowName(int window_seconds) {
+    return window_seconds == 86400 ? "day" : window_seconds == 3600 ? "hour" : std::to_string(window_seconds) + "s";
+}
+
+/**
+ * Counter of a job's quota (the group's when it names one), created on first use
+ */
+Counter& counterFor(const std::string& job_id, const JobQuota& quota, std::time_t now) {
+    bool group = !quota.group.empty();
+    const std::string& name = group ? quota.group : job_id;
+    std::string key = (group ? "group:" : "job:") + name + "/" + std::to_string(quota.window_seconds);
+    Counter& counter = g_counters[key];
+    if (counter.usage.name.empty()) {
+        counter.usage.name = name;
+        counter.usage.group = group;
+        counter.usage.window_seconds = quota.window_seconds;
+    }
+    counter.usage.limits = quota;
+    counter.last_used = now;
+    return counter;
+}
+
+} // namespace
+
+QuotaDecision Quotas::admit(const std::string& job_id, const JobQuota& quota, std::time_t now,
+                            std::string& reason, std::time_t& retry_at) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    Counter& counter = counterFor(job_id, quota, now);
+    counter.advance(now);
+    QuotaUsage& usage = counter.usage;
+    std::string per = " per " + windowName(quota.window_seconds);
+    if (quota.runs > 0 && usage.runs >= static_cast<uint64_t>(quota.runs)) {
+        reason = std::to_string(usage.runs) + "/" + std::to_string(quota.runs) + " runs" + per;
+    } else if (quota.cpu_seconds > 0 && usage.cpu_ms >= quota.cpu_seconds * 1000) {
+        reason = std::to_string(usage.cpu_ms / 1000) + "/" + std::to_string(quota.cpu_seconds) + " CPU seconds" + per;
+    } else if (quota.wall_seconds > 0 && usage.wall_ms >= quota.wall_seconds * 1000) {
+        reason = std::to_string(usage.wall_ms / 1000) + "/" + std::to_string(quota.wall_seconds) + " wall seconds" + per;
+    } else {
+        usage.runs++;
+        counter.current().runs++;
+        return QuotaDecision::RUN;
+    }
+    if (!quota.group.empty()) {
+        reason += " (group " + quota.group + ")";
+    }
+
+    switch (quota.action) {
+        case QuotaAction::DEFER:
+            retry_at = counter.nextRelease();
+            return QuotaDecision::DEFER;
+        case QuotaAction::DOWNGRADE:
+            usage.downgraded++;
+            usage.runs++;
+            counter.current().runs++;
+            return QuotaDecision::DOWNGRADE;
+        case QuotaAction::SKIP:
+            break;
+    }
+    return QuotaDecision::SKIP;
+}
+
+void Quotas::refused(const std::string& job_id, const JobQuota& quota, QuotaDecision outcome) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    QuotaUsage& usage = counterFor(job_id, quota, std::time(nullptr)).usage;
+    if (outcome == QuotaDecision::DEFER) {
+        usage.deferred++;
+    } else {
+        usage.skipped++;
+    }
+}
+
+void Quotas::charge(const std::string& job_id, const JobQuota& quota, const ExecResult& result) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    std::time_t now = std::time(nullptr);
+    Counter& counter = counterFor(job_id, quota, now);
+    counter.advance(now);
+    int64_t cpu_ms = result.user_ms + result.sys_ms;
+    counter.usage.cpu_ms += cpu_ms;
+    counter.usage.wall_ms += result.duration_ms;
+    counter.current().cpu_ms += cpu_ms;
+    counter.current().wall_ms += result.duration_ms;
+}
+
+std::vector<QuotaUsage> Quotas::snapshot() {
+    std::vector<QuotaUsage> counters;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        std::time_t now = std::time(nullptr);
+        for (auto it = g_counters.begin(); it != g_counters.end();) {
+            // Removed jobs, old derived IDs and finished template instances
+            if (now - it->second.last_used >= it->second.usage.window_seconds) {
+                it = g_counters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        counters.reserve(g_counters.size());
+        for (auto& entry : g_counters) {
+            entry.second.advance(now);
+            counters.push_back(entry.second.usage);
+        }
+    }
+    std::sort(counters.begin(), counters.end(), [](const QuotaUsage& a, const QuotaUsage& b) {
+        return a.cpu_ms != b.cpu_ms ? a.cpu_ms > b.cpu_ms : a.name < b.name;
+    });
+    return counters;
+}
+
+std::string Quotas::report(size_t top) {
+    std::vector<QuotaUsage> counters = snapshot();
+    std::string line = "Quotas (" + std::to_string(counters.size()) + " counters):";
+    for (size_t i = 0; i < counters.size() && i < top; ++i) {
+        const QuotaUsage& q = counters[i];
+        line += " " + std::string(q.group ? "group " : "") + q.name + "=" + std::to_string(q.runs) + " runs/" +
+                std::to_string(q.cpu_ms) + "ms cpu/" + std::to_string(q.wall_ms) + "ms wall per " +
+                windowName(q.window_seconds) + " (" + std::to_string(q.skipped) + " skipped/" +
+                std::to_string(q.deferred) + " deferred/" + std::to_string(q.downgraded) + " downgraded)";
+    }
+    return line;
+}
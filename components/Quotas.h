@@ -0,0 +1,96 @@
+#ifndef QUOTAS_H
+#define QUOTAS_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "CronTypes.h"
+#include "ProcessRunner.h"
+
+/**
+ * ENUM: Verdict on a run of a job with a quota
+ */
+enum class QuotaDecision {
+    RUN,        // Within the quota (the run is counted)
+    SKIP,       // Exhausted, action "skip"
+    DEFER,      // Exhausted, action "defer": retry at the returned time
+    DOWNGRADE   // Exhausted, action "downgrade": run at DOWNGRADE_NICE (counted)
+};
+
+/**
+ * STRUCT: Consumption of one quota counter over its current window
+ */
+struct QuotaUsage {
+    std::string name;           // Job ID or group name
+    bool group = false;         // Shared by the jobs of a group
+    int window_seconds = 0;
+    uint64_t runs = 0;          // Runs started in the window
+    int64_t cpu_ms = 0;         // CPU time of runs finished in the window
+    int64_t wall_ms = 0;        // Wall-clock time of runs finished in the window
+    JobQuota limits;            // Limits the counter was last checked against
+    uint64_t skipped = 0;       // Runs refused since daemon start
+    uint64_t deferred = 0;
+    uint64_t downgraded = 0;
+};
+
+/**
+ * Quotas Class - Per-job and per-group consumption over rolling windows
+ *
+ * Each counter covers the last hour or day in BUCKETS slices: a run is
+ * added to the current slice, and slices falling out of the window are
+ * subtracted from the running totals as time moves on. Checking and
+ * charging a run is O(1) whatever the number of runs in the window; the
+ * window slides in steps of one slice (1 minute per hour, 24 per day).
+ *
+ * Runs are counted when admitted, CPU (rusage user + system) and wall
+ * time when they finish. Counters live in memory and start from zero
+ * when the daemon starts. A counter left unused for a whole window (its
+ * job removed, renamed or not due) holds nothing any more and is dropped
+ * by the next snapshot(), which the status report takes every 4 hours.
+ */
+class Quotas {
+public:
+    static constexpr size_t BUCKETS = 60;
+    static constexpr int DOWNGRADE_NICE = 19;
+
+    /**
+     * Decide whether a run may start, counting it if so
+     *
+     * A refused run (SKIP, DEFER) is not counted as skipped or deferred
+     * until the caller reports what it did with refused().
+     *
+     * @param job_id Job the run belongs to
+     * @param quota The job's quota (window_seconds > 0)
+     * @param now Current time
+     * @param reason Output description of the exhausted limit
+     * @param retry_at Output time the window next frees some room (DEFER)
+     */
+    static QuotaDecision admit(const std::string& job_id, const JobQuota& quota, std::time_t now,
+                               std::string& reason, std::time_t& retry_at);
+
+    /**
+     * Count a run refused by admit() as skipped or deferred
+     *
+     * @param outcome SKIP, or DEFER if the run was actually queued again
+     */
+    static void refused(const std::string& job_id, const JobQuota& quota, QuotaDecision outcome);
+
+    /**
+     * Add the CPU and wall time of a finished run
+     */
+    static void charge(const std::string& job_id, const JobQuota& quota, const ExecResult& result);
+
+    /**
+     * Every counter, sorted by CPU time (highest first), after dropping
+     * those unused for a whole window
+     */
+    static std::vector<QuotaUsage> snapshot();
+
+    /**
+     * One-line summary of the `top` counters by CPU time, for the status log
+     */
+    static std::string report(size_t top = 10);
+};
+
+#endif // QUOTAS_H
@@ -0,0 +1,76 @@
+/**
+ * @file StartLag.cpp
+ * @brief Start lag and jitter of local command runs
+ */
+
+#include "StartLag.h"
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+
+namespace {
+
+/**
+ * Counters of one kind of run, with a ring of the latest samples
+ */
+struct LagSeries {
+    uint64_t runs = 0;
+    int64_t max_us = 0;
+    std::vector<int64_t> recent;   // Ring of up to StartLag::WINDOW samples
+    size_t next = 0;
+};
+
+std::mutex g_mutex;
+LagSeries g_series[2];   // [0] spawn, [1] prestart
+
+LagSummary summarize(const char* kind, const LagSeries& series) {
+    LagSummary summary;
+    summary.kind = kind;
+    summary.runs = series.runs;
+    summary.max_us = series.max_us;
+    if (series.recent.empty()) {
+        return summary;
+    }
+    std::vector<int64_t> sorted = series.recent;
+    std::sort(sorted.begin(), sorted.end());
+    summary.p50_us = sorted[sorted.size() / 2];
+    summary.p99_us = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+    int64_t deviation = 0;
+    for (int64_t lag : sorted) {
+        deviation += std::llabs(lag - summary.p50_us);
+    }
+    summary.jitter_us = deviation / static_cast<int64_t>(sorted.size());
+    return summary;
+}
+
+}
+
+void StartLag::record(bool prestart, int64_t lag_us) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    LagSeries& series = g_series[prestart ? 1 : 0];
+    if (series.runs == 0 || lag_us > series.max_us) {
+        series.max_us = lag_us;
+    }
+    series.runs++;
+    if (series.recent.size() < WINDOW) {
+        series.recent.push_back(lag_us);
+    } else {
+        series.recent[series.next] = lag_us;
+        series.next = (series.next + 1) % WINDOW;
+    }
+}
+
+std::vector<LagSummary> StartLag::snapshot() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return {summarize("spawn", g_series[0]), summarize("prestart", g_series[1])};
+}
+
+std::string StartLag::report() {
+    std::string line = "Start lag:";
+    for (const auto& s : snapshot()) {
+        line += " " + s.kind + "=" + std::to_string(s.runs) + " runs/p50 " + std::to_string(s.p50_us) +
+                "us/p99 " + std::to_string(s.p99_us) + "us/max " + std::to_string(s.max_us) +
+                "us/jitter " + std::to_string(s.jitter_us) + "us";
+    }
+    return line;
+}
@@ -0,0 +1,50 @@
+#ifndef START_LAG_H
+#define START_LAG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * STRUCT: Start lag of one kind of run since daemon start
+ *
+ * Percentiles cover the last StartLag::WINDOW runs; runs and max_us all of them.
+ */
+struct LagSummary {
+    std::string kind;          // "spawn" or "prestart"
+    uint64_t runs = 0;         // Runs measured
+    int64_t p50_us = 0;        // Median lag
+    int64_t p99_us = 0;        // 99th percentile lag
+    int64_t max_us = 0;        // Largest lag
+    int64_t jitter_us = 0;     // Mean absolute deviation from the median
+};
+
+/**
+ * StartLag Class - How late local command runs start
+ *
+ * The lag of a run is the time its exec completed minus the second it
+ * was scheduled for. Ordinary runs ("spawn") include the main loop wake
+ * up, the worker queue and fork/exec; prestart runs only the release and
+ * exec, so their spread is the achieved start jitter.
+ */
+class StartLag {
+public:
+    static constexpr size_t WINDOW = 1024;
+
+    /**
+     * Account the lag of one started run
+     */
+    static void record(bool prestart, int64_t lag_us);
+
+    /**
+     * Summaries of both kinds ("spawn", then "prestart")
+     */
+    static std::vector<LagSummary> snapshot();
+
+    /**
+     * One-line summary for the status log
+     */
+    static std::string report();
+};
+
+#endif // START_LAG_H
@@ -0,0 +1,207 @@
+/**
+ * @file UpgradeHandoff.cpp
+ * @brief Re-exec of the daemon with its schedule, running jobs and control socket
+ */
+
+#include "UpgradeHandoff.h"
+#include "json.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <unordered_set>
+
+using json = nlohmann::json;
+
+extern char** environ;
+
+namespace {
+
+/**
+ * Descriptors of the state that must survive execve()
+ */
+std::vector<int> inheritedFds(const HandoffState& state) {
+    std::vector<int> fds;
+    if (state.control_fd >= 0) {
+        fds.push_back(state.control_fd);
+    }
+    for (const auto& run : state.runs) {
+        if (run.pid_fd >= 0) fds.push_back(run.pid_fd);
+        if (run.output_fd >= 0) fds.push_back(run.output_fd);
+    }
+    return fds;
+}
+
+json runToJson(const SupervisedRun& run) {
+    return {
+        {"pid", run.pid},
+        {"pid_fd", run.pid_fd},
+        {"output_fd", run.output_fd},
+        {"started_ms", run.started_ms},
+        {"kill_at_ms", run.kill_at_ms},
+        {"active_ms", run.active_ms},
+        {"timed_out", run.timed_out},
+        {"cancelled", run.cancelled},
+        {"hung", run.hung},
+        {"output", run.output},
+        {"argv", run.request.argv},
+        {"user", run.request.user},
+        {"label", run.request.label},
+        {"job_id", run.request.job_id},
+        {"timeout", run.request.timeout_seconds},
+        {"idle_timeout", run.request.idle_timeout_seconds},
+        {"heartbeat", run.request.heartbeat_file},
+        {"max_output", run.request.max_output}
+    };
+}
+
+SupervisedRun runFromJson(const json& data) {
+    SupervisedRun run;
+    run.pid = data.at("pid").get<pid_t>();
+    run.pid_fd = data.at("pid_fd").get<int>();
+    run.output_fd = data.at("output_fd").get<int>();
+    run.started_ms = data.at("started_ms").get<int64_t>();
+    run.kill_at_ms = data.at("kill_at_ms").get<int64_t>();
+    run.timed_out = data.at("timed_out").get<bool>();
+    run.cancelled = data.at("cancelled").get<bool>();
+    run.active_ms = data.value("active_ms", int64_t(0));   // Absent in hand-overs from older images
+    run.hung = data.value("hung", false);
+    run.output = data.at("output").get<std::string>();
+    run.request.argv = data.at("argv").get<std::vector<std::string>>();
+    run.request.user = data.at("user").get<std::string>();
+    run.request.label = data.at("label").get<std::string>();
+    run.request.job_id = data.value("job_id", "");
+    run.request.timeout_seconds = data.at("timeout").get<int>();
+    run.request.idle_timeout_seconds = data.value("idle_timeout", 0);
+    run.request.heartbeat_file = data.value("heartbeat", "");
+    run.request.max_output = data.at("max_output").get<size_t>();
+    return run;
+}
+
+} // namespace
+
+bool UpgradeHandoff::exec(const std::string& binary, const std::vector<std::string>& argv,
+                          const HandoffState& state, std::string& error) {
+    json data;
+    data["created"] = state.created;
+    data["control_fd"] = state.control_fd;
+    data["control_path"] = state.control_path;
+    data["next_fire"] = json::array();
+    for (const auto& entry : state.next_fires) {
+        data["next_fire"].push_back({entry.first, entry.second});
+    }
+    data["runs"] = json::array();
+    for (const auto& run : state.runs) {
+        data["runs"].push_back(runToJson(run));
+    }
+    // Job output is arbitrary bytes: replace invalid UTF-8 instead of throwing
+    std::string text = data.dump(-1, ' ', false, json::error_handler_t::replace);
+
+    int fd = memfd_create("nanoCron-upgrade", 0);   // Not close-on-exec: read by the new image
+    if (fd < 0) {
+        error = std::string("memfd_create failed: ") + std::strerror(errno);
+        return false;
+    }
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t n = write(fd, text.data() + written, text.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            error = std::string("cannot write upgrade state: ") + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    lseek(fd, 0, SEEK_SET);
+
+    std::vector<int> fds = inheritedFds(state);
+    for (int inherited : fds) {
+        fcntl(inherited, F_SETFD, 0);
+    }
+
+    std::vector<char*> args;
+    for (const auto& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    std::string variable = std::string(STATE_ENV) + "=" + std::to_string(fd);
+    std::vector<char*> envp;
+    for (char** entry = environ; entry && *entry; ++entry) {
+        if (std::strncmp(*entry, STATE_ENV, std::strlen(STATE_ENV)) != 0) {
+            envp.push_back(*entry);
+        }
+    }
+    envp.push_back(const_cast<char*>(variable.c_str()));
+    envp.push_back(nullptr);
+
+    execve(binary.c_str(), args.data(), envp.data());
+
+    error = "cannot execute " + binary + ": " + std::strerror(errno);
+    for (int inherited : fds) {
+        fcntl(inherited, F_SETFD, FD_CLOEXEC);
+    }
+    close(fd);
+    return false;
+}
+
+bool UpgradeHandoff::load(int fd, HandoffState& state, std::string& error) {
+    state = HandoffState();
+    std::string text;
+    char buffer[65536];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = std::string("cannot read upgrade state: ") + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+        text.append(buffer, static_cast<size_t>(n));
+    }
+    close(fd);
+
+    try {
+        json data = json::parse(text);
+        state.created = data.at("created").get<std::time_t>();
+        state.control_fd = data.at("control_fd").get<int>();
+        state.control_path = data.at("control_path").get<std::string>();
+        for (const auto& entry : data.at("next_fire")) {
+            state.next_fires.emplace_back(entry.at(0).get<std::string>(), entry.at(1).get<std::time_t>());
+        }
+        for (const auto& run : data.at("runs")) {
+            state.runs.push_back(runFromJson(run));
+        }
+    } catch (const std::exception& e) {
+        state = HandoffState();
+        error = std::string("corrupted upgrade state: ") + e.what();
+        return false;
+    }
+
+    // Whatever else the old image left open is of no use here
+    std::vector<int> keep = inheritedFds(state);
+    std::unordered_set<int> wanted(keep.begin(), keep.end());
+    std::vector<int> stray;
+    if (DIR* dir = opendir("/proc/self/fd")) {
+        int dir_fd = dirfd(dir);
+        while (struct dirent* entry = readdir(dir)) {
+            int open_fd = std::atoi(entry->d_name);
+            if (open_fd > STDERR_FILENO && open_fd != dir_fd && !wanted.count(open_fd)) {
+                stray.push_back(open_fd);
+            }
+        }
+        closedir(dir);
+    }
+    for (int open_fd : stray) {
+        close(open_fd);
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef UPGRADE_HANDOFF_H
+#define UPGRADE_HANDOFF_H
+
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ProcessRunner.h"
+
+/**
+ * STRUCT: What a daemon hands over to its new image on upgrade
+ */
+struct HandoffState {
+    std::time_t created = 0;                                       // When the old image stopped dispatching
+    std::vector<std::pair<std::string, std::time_t>> next_fires;   // Pending fire time per job ID
+    std::vector<SupervisedRun> runs;                               // Job processes still running
+    int control_fd = -1;                                           // Listening control socket (-1 = none)
+    std::string control_path;                                      // Path it is bound to
+};
+
+/**
+ * UpgradeHandoff Class - In-place re-exec of the daemon
+ *
+ * execve() keeps the PID, so running jobs stay children of the daemon and
+ * their pidfds and output pipes stay valid in the new image once they are
+ * no longer close-on-exec; the control socket keeps its bound address and
+ * listen backlog the same way. The rest of the state travels as JSON in an
+ * anonymous memory file whose descriptor number is passed in the
+ * NANOCRON_UPGRADE_STATE environment variable, so the command line (and
+ * with it pgrep and systemd's view of the service) does not change.
+ */
+class UpgradeHandoff {
+public:
+    static constexpr const char* STATE_ENV = "NANOCRON_UPGRADE_STATE";
+
+    /**
+     * Replace the process image; returns only on failure
+     *
+     * @param binary Executable to run (the installed daemon)
+     * @param argv Full argument vector, argv[0] included
+     * @param state State to hand over; its descriptors are made inheritable
+     * @param error Output error message
+     * @return false if exec failed (descriptors are close-on-exec again)
+     */
+    static bool exec(const std::string& binary, const std::vector<std::string>& argv,
+                     const HandoffState& state, std::string& error);
+
+    /**
+     * Read the state handed over by the previous image
+     *
+     * Closes the state descriptor and every other inherited descriptor
+     * above stderr that is not part of the state (such as the old image's
+     * log stream), so call it before opening anything else.
+     *
+     * @param fd Descriptor number from STATE_ENV
+     * @param state Output state
+     * @param error Output error message for unreadable or corrupted state
+     */
+    static bool load(int fd, HandoffState& state, std::string& error);
+};
+
+#endif // UPGRADE_HANDOFF_H
@@ -0,0 +1,89 @@
+/**
+ * @file UserAccounts.cpp
+ * @brief Per-user concurrency caps and run accounting
+ */
+
+#include "UserAccounts.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+std::mutex g_mutex;
+std::unordered_map<std::string, UserUsage> g_usage;
+std::atomic<int> g_maxConcurrent{0};
+
+}
+
+void UserAccounts::setMaxConcurrent(int limit) {
+    g_maxConcurrent.store(std::max(0, limit));
+}
+
+bool UserAccounts::acquire(const std::string& user, bool force) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    UserUsage& usage = g_usage[user];
+    if (usage.user.empty()) {
+        usage.user = user;
+    }
+    int limit = g_maxConcurrent.load();
+    if (!force && limit > 0 && usage.running >= static_cast<uint32_t>(limit)) {
+        usage.throttled++;
+        return false;
+    }
+    usage.running++;
+    return true;
+}
+
+void UserAccounts::release(const std::string& user, const ExecResult& result) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_usage.find(user);
+    if (it == g_usage.end()) {
+        return;
+    }
+    UserUsage& usage = it->second;
+    if (usage.running > 0) {
+        usage.running--;
+    }
+    usage.runs++;
+    if (!result.started() || result.exit_code != 0) {
+        usage.failures++;
+    }
+    usage.cpu_ms += result.user_ms + result.sys_ms;
+    usage.wall_ms += result.duration_ms;
+}
+
+void UserAccounts::abandon(const std::string& user) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_usage.find(user);
+    if (it != g_usage.end() && it->second.running > 0) {
+        it->second.running--;
+    }
+}
+
+std::vector<UserUsage> UserAccounts::snapshot() {
+    std::vector<UserUsage> users;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        users.reserve(g_usage.size());
+        for (const auto& entry : g_usage) {
+            users.push_back(entry.second);
+        }
+    }
+    std::sort(users.begin(), users.end(), [](const UserUsage& a, const UserUsage& b) {
+        return a.cpu_ms != b.cpu_ms ? a.cpu_ms > b.cpu_ms : a.user < b.user;
+    });
+    return users;
+}
+
+std::string UserAccounts::report(size_t top) {
+    std::vector<UserUsage> users = snapshot();
+    std::string line = "User accounting (" + std::to_string(users.size()) + " users):";
+    for (size_t i = 0; i < users.size() && i < top; ++i) {
+        const UserUsage& u = users[i];
+        line += " " + u.user + "=" + std::to_string(u.runs) + " runs/" + std::to_string(u.failures) +
+                " failed/" + std::to_string(u.throttled) + " throttled/" + std::to_string(u.cpu_ms) + "ms cpu";
+    }
+    return line;
+}
@@ -0,0 +1,66 @@
+#ifndef USER_ACCOUNTS_H
+#define USER_ACCOUNTS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ProcessRunner.h"
+
+/**
+ * STRUCT: Run counters of one user since daemon start
+ */
+struct UserUsage {
+    std::string user;
+    uint32_t running = 0;      // Runs in progress
+    uint64_t runs = 0;         // Runs started
+    uint64_t failures = 0;     // Runs that did not exit with status 0
+    uint64_t throttled = 0;    // Runs skipped at the concurrency cap
+    int64_t cpu_ms = 0;        // User + system CPU time of finished runs
+    int64_t wall_ms = 0;       // Wall-clock time of finished runs
+};
+
+/**
+ * UserAccounts Class - Per-user concurrency caps and run accounting
+ *
+ * Jobs that run as a user (spool jobs, "user" in jobs.json) take a slot
+ * before starting and give it back with their result, so a single user
+ * cannot occupy every worker thread or agent slot on a shared machine.
+ * Jobs without a user are not counted.
+ */
+class UserAccounts {
+public:
+    /**
+     * Maximum concurrent runs per user (0 = unlimited)
+     */
+    static void setMaxConcurrent(int limit);
+
+    /**
+     * Take a run slot for a user
+     * @param force Take it even at the cap (run already started, e.g. adopted after an upgrade)
+     * @return false (and count a throttled run) if the user is at the cap
+     */
+    static bool acquire(const std::string& user, bool force = false);
+
+    /**
+     * Give back a slot taken with acquire() and account the run
+     */
+    static void release(const std::string& user, const ExecResult& result);
+
+    /**
+     * Give back a slot taken with acquire() for a run that was not started
+     * after all (e.g. refused by its quota); nothing is accounted
+     */
+    static void abandon(const std::string& user);
+
+    /**
+     * Counters of every user seen so far, sorted by CPU time (highest first)
+     */
+    static std::vector<UserUsage> snapshot();
+
+    /**
+     * One-line summary of the `top` users by CPU time, for the status log
+     */
+    static std::string report(size_t top = 10);
+};
+
+#endif // USER_ACCOUNTS_H
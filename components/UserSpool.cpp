@@ -0,0 +1,272 @@
+/**
+ * @file UserSpool.cpp
+ * @brief Per-user job files with independent reloads
+ */
+
+#include "UserSpool.h"
+#include "AllocTracker.h"
+#include "JobConfig.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pwd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::string SPOOL_SUFFIX = ".json";
+const off_t MAX_SPOOL_FILE = 1024 * 1024;
+
+/**
+ * Read a spool file without following symlinks, checking ownership and
+ * permissions on the opened descriptor (no check-then-open race)
+ */
+bool readSpoolFile(const std::string& path, uid_t owner, std::string& content, std::string& error) {
+    int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        error = std::string("cannot open: ") + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (!ok || !S_ISREG(st.st_mode)) {
+        error = "not a regular file";
+    } else if (st.st_uid != owner && st.st_uid != 0) {
+        error = "owned by uid " + std::to_string(st.st_uid) + ", expected the user or root";
+    } else if (st.st_mode & (S_IWGRP | S_IWOTH)) {
+        error = "writable by group or others";
+    } else if (st.st_size > MAX_SPOOL_FILE) {
+        error = "larger than " + std::to_string(MAX_SPOOL_FILE) + " bytes";
+    } else {
+        content.resize(static_cast<size_t>(st.st_size));
+        ssize_t n = read(fd, &content[0], content.size());
+        if (n != st.st_size) {
+            error = "short read";
+        }
+    }
+    close(fd);
+    return error.empty();
+}
+
+} // namespace
+
+UserSpool::UserSpool(const std::string& dir, size_t max_jobs_per_user, Logger& loggerRef)
+    : directory(dir), maxJobs(max_jobs_per_user), logger(loggerRef) {}
+
+UserSpool::~UserSpool() {
+    stop();
+}
+
+bool UserSpool::start() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        logger.error("UserSpool: inotify_init1 failed: " + std::string(std::strerror(errno)));
+        return false;
+    }
+    // Whole-file events only: editors that rewrite in place trigger
+    // IN_CLOSE_WRITE, atomic saves IN_MOVED_TO; IN_ATTRIB catches chmod/chown
+    if (inotify_add_watch(inotifyFd, directory.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB) < 0) {
+        logger.error("UserSpool: cannot watch " + directory + ": " + std::strerror(errno));
+        close(inotifyFd);
+        inotifyFd = -1;
+        return false;
+    }
+
+    DIR* dir = opendir(directory.c_str());
+    if (dir) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string user = userOfFile(entry->d_name);
+            if (!user.empty()) {
+                loadUser(user);
+            }
+        }
+        closedir(dir);
+    }
+    logger.info("UserSpool: watching " + directory + ", " + std::to_string(userCount()) + " users loaded");
+
+    shouldStop.store(false);
+    watcherThread = std::thread(&UserSpool::watchLoop, this);
+    return true;
+}
+
+void UserSpool::stop() {
+    shouldStop.store(true);
+    if (watcherThread.joinable()) {
+        watcherThread.join();
+    }
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+}
+
+std::vector<SpoolUpdate> UserSpool::takeUpdates() {
+    std::map<std::string, std::shared_ptr<const std::vector<CronJob>>> taken;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        taken.swap(pending);
+    }
+    std::vector<SpoolUpdate> updates;
+    updates.reserve(taken.size());
+    for (auto& entry : taken) {
+        updates.push_back({entry.first, std::move(entry.second)});
+    }
+    return updates;
+}
+
+std::vector<SpoolUpdate> UserSpool::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<SpoolUpdate> all;
+    all.reserve(users.size());
+    for (const auto& entry : users) {
+        all.push_back({entry.first, entry.second});
+    }
+    return all;
+}
+
+size_t UserSpool::userCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return users.size();
+}
+
+/**
+ * Parse one user's file and publish its jobs
+ * @return false if the file was rejected (the previous jobs stay active)
+ */
+bool UserSpool::loadUser(const std::string& user) {
+    AllocScope scope(AllocTag::CONFIG);
+    std::string path = directory + "/" + user + SPOOL_SUFFIX;
+
+    struct passwd pwd;
+    struct passwd* found = nullptr;
+    std::vector<char> buffer(16384);
+    if (getpwnam_r(user.c_str(), &pwd, buffer.data(), buffer.size(), &found) != 0 || !found) {
+        logger.error("UserSpool: ignoring " + path + ": no such user");
+        return false;
+    }
+
+    std::string content;
+    std::string error;
+    if (!readSpoolFile(path, pwd.pw_uid, content, error) || !JobConfig::validateJobsJson(content, error)) {
+        logger.error("UserSpool: rejected " + path + ": " + error);
+        return false;
+    }
+
+    auto jobs = std::make_shared<std::vector<CronJob>>(JobConfig::parseJobsFromJson(content));
+    if (maxJobs > 0 && jobs->size() > maxJobs) {
+        logger.error("UserSpool: rejected " + path + ": " + std::to_string(jobs->size()) +
+                     " jobs, limit is " + std::to_string(maxJobs));
+        return false;
+    }
+    for (auto& job : *jobs) {
+        if (job.type == JobType::PLUGIN) {
+            logger.error("UserSpool: rejected " + path + ": plugin jobs are not allowed in user files");
+            return false;
+        }
+        if (!job.bundle.empty()) {
+            // Bundle shells run as the daemon, not as the user
+            logger.error("UserSpool: rejected " + path + ": bundles are not allowed in user files");
+            return false;
+        }
+        if (!job.user.empty() && job.user != user) {
+            logger.error("UserSpool: rejected " + path + ": job '" + job.description + "' asks for user " + job.user);
+            return false;
+        }
+        job.user = user;
+        job.id = user + ":" + job.id;
+        if (!job.quota.group.empty()) {
+            job.quota.group = user + ":" + job.quota.group;   // Never shared with other users' groups
+        }
+    }
+
+    logger.info("UserSpool: loaded " + std::to_string(jobs->size()) + " jobs for " + user);
+    publish(user, std::move(jobs));
+    return true;
+}
+
+void UserSpool::removeUser(const std::string& user) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!users.count(user)) {
+            return;
+        }
+    }
+    logger.info("UserSpool: " + user + SPOOL_SUFFIX + " removed, unscheduling its jobs");
+    publish(user, std::make_shared<const std::vector<CronJob>>());
+}
+
+void UserSpool::publish(const std::string& user, std::shared_ptr<const std::vector<CronJob>> jobs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (jobs->empty()) {
+        users.erase(user);
+    } else {
+        users[user] = jobs;
+    }
+    pending[user] = std::move(jobs);
+}
+
+std::string UserSpool::userOfFile(const std::string& name) {
+    if (name.size() <= SPOOL_SUFFIX.size() ||
+        name.compare(name.size() - SPOOL_SUFFIX.size(), SPOOL_SUFFIX.size(), SPOOL_SUFFIX) != 0) {
+        return "";
+    }
+    std::string user = name.substr(0, name.size() - SPOOL_SUFFIX.size());
+    // POSIX portable user names; rejects dot files and editor temp names
+    if (user.size() > 32 || !(std::isalnum(static_cast<unsigned char>(user[0])) || user[0] == '_')) {
+        return "";
+    }
+    for (char c : user) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.') {
+            return "";
+        }
+    }
+    return user;
+}
+
+void UserSpool::watchLoop() {
+    alignas(struct inotify_event) char buffer[8192];
+    std::set<std::string> changed;
+
+    while (!shouldStop.load()) {
+        struct pollfd pfd = {inotifyFd, POLLIN, 0};
+        // While changes are pending, wait 100 ms for the rest of a burst
+        int rc = poll(&pfd, 1, changed.empty() ? 1000 : 100);
+        if (rc < 0 && errno != EINTR) {
+            logger.error("UserSpool: poll failed: " + std::string(std::strerror(errno)));
+            break;
+        }
+        if (rc > 0) {
+            ssize_t n;
+            while ((n = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + n;) {
+                    auto* event = reinterpret_cast<struct inotify_event*>(p);
+                    if (event->len > 0) {
+                        std::string user = userOfFile(event->name);
+                        if (!user.empty()) {
+                            changed.insert(user);
+                        }
+                    }
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            continue;
+        }
+
+        // Quiet for 100 ms: reload only the files that changed
+        for (const auto& user : changed) {
+            struct stat st;
+            if (lstat((directory + "/" + user + SPOOL_SUFFIX).c_str(), &st) == 0) {
+                loadUser(user);
+            } else {
+                removeUser(user);
+            }
+        }
+        changed.clear();
+    }
+}
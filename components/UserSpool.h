@@ -0,0 +1,107 @@
+#ifndef USER_SPOOL_H
+#define USER_SPOOL_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CronTypes.h"
+#include "Logger.h"
+
+/**
+ * STRUCT: New job set of one spool user
+ */
+struct SpoolUpdate {
+    std::string user;
+    std::shared_ptr<const std::vector<CronJob>> jobs;   // Empty when the file was removed
+};
+
+/**
+ * UserSpool Class - Per-user job files (<dir>/<user>.json)
+ *
+ * Each file holds one user's jobs in the jobs.json format. Files are
+ * watched through one inotify watch on the directory and reloaded
+ * independently: a change to alice.json parses only alice.json, and the
+ * daemon resyncs only alice's jobs (CronScheduler::syncJobs group
+ * "user:alice").
+ *
+ * Every job of a file runs as its user: IDs are prefixed with "<user>:"
+ * and CronJob::user is set, so JobExecutor drops privileges and applies
+ * the per-user caps. A file is rejected (previous version kept) unless
+ * it is a regular file owned by that user or by root, not writable by
+ * group or others, valid, free of plugin jobs and within the per-user
+ * job limit.
+ */
+class UserSpool {
+public:
+    /**
+     * @param dir Spool directory
+     * @param max_jobs_per_user Files with more jobs are rejected (0 = unlimited)
+     * @param logger Logger for load and reject messages
+     */
+    UserSpool(const std::string& dir, size_t max_jobs_per_user, Logger& logger);
+    ~UserSpool();
+
+    UserSpool(const UserSpool&) = delete;
+    UserSpool& operator=(const UserSpool&) = delete;
+
+    /**
+     * Load every file in the directory and start the watcher thread
+     * @return false if the directory cannot be watched
+     */
+    bool start();
+
+    /**
+     * Stop the watcher thread
+     */
+    void stop();
+
+    /**
+     * Users whose job set changed since the last call, with the new set
+     */
+    std::vector<SpoolUpdate> takeUpdates();
+
+    /**
+     * Current job set of every user (full resync, e.g. after a cluster rebalance)
+     */
+    std::vector<SpoolUpdate> snapshot() const;
+
+    /**
+     * Number of users with a loaded file
+     */
+    size_t userCount() const;
+
+    /**
+     * Scheduler group of a user's jobs
+     */
+    static std::string groupOf(const std::string& user) { return "user:" + user; }
+
+private:
+    bool loadUser(const std::string& user);
+    void removeUser(const std::string& user);
+    void publish(const std::string& user, std::shared_ptr<const std::vector<CronJob>> jobs);
+    void watchLoop();
+
+    /**
+     * User name of a spool file name, or "" for anything else (temp files, ...)
+     */
+    static std::string userOfFile(const std::string& name);
+
+    std::string directory;
+    size_t maxJobs;
+    Logger& logger;
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_ptr<const std::vector<CronJob>>> users;
+    std::map<std::string, std::shared_ptr<const std::vector<CronJob>>> pending;   // Not yet taken
+
+    int inotifyFd = -1;
+    std::atomic<bool> shouldStop{false};
+    std::thread watcherThread;
+};
+
+#endif // USER_SPOOL_H
@@ -0,0 +1,89 @@
+/**
+ * @file WorkerPool.cpp
+ * @brief Fixed-size FIFO thread pool used to run scheduled jobs
+ */
+
+#include "WorkerPool.h"
+#include <iostream>
+
+WorkerPool::WorkerPool(size_t threads) {
+    if (threads == 0) threads = 1;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    shutdown();
+}
+
+bool WorkerPool::submit(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stopping) {
+            return false;
+        }
+        queue.push_back(std::move(task));
+    }
+    queue_cv.notify_one();
+    return true;
+}
+
+void WorkerPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+    }
+    queue_cv.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+size_t WorkerPool::pending() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return queue.size();
+}
+
+size_t WorkerPool::active() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return running;
+}
+
+/**
+ * Worker thread body: pop and run tasks until stopped and drained.
+ * Exceptions thrown by a task are reported and do not kill the worker.
+ */
+void WorkerPool::workerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;   // stopping and nothing left to run
+            }
+            task = std::move(queue.front());
+            queue.pop_front();
+            ++running;
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "WorkerPool: task threw exception: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "WorkerPool: task threw unknown exception" << std::endl;
+        }
+        task = nullptr;   // Release captures before the task counts as done
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        --running;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * WorkerPool Class - Fixed-size thread pool
+ *
+ * Runs submitted tasks on a fixed number of threads in FIFO order.
+ * Used as the default executor of CronScheduler so a long-running job
+ * never delays the dispatch of the next one.
+ */
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * Create and start the pool
+     *
+     * @param threads Number of worker threads (at least 1)
+     */
+    explicit WorkerPool(size_t threads = 4);
+
+    /**
+     * Stop the pool, waiting for queued tasks to finish
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * Queue a task for execution
+     *
+     * @param task Task to run
+     * @return false if the pool is stopping and the task was rejected
+     */
+    bool submit(Task task);
+
+    /**
+     * Stop accepting tasks, drain the queue and join all threads
+     */
+    void shutdown();
+
+    /**
+     * Number of tasks queued but not started yet
+     */
+    size_t pending() const;
+
+    /**
+     * Number of tasks running right now
+     */
+    size_t active() const;
+
+    /**
+     * Number of worker threads
+     */
+    size_t size() const { return workers.size(); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<Task> queue;
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    size_t running = 0;
+    bool stopping = false;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,75 @@
+#ifndef NANOCRON_PLUGIN_H
+#define NANOCRON_PLUGIN_H
+
+/**
+ * nanoCron plugin ABI - C interface for in-process jobs
+ *
+ * A plugin is a shared object loaded with dlopen() by jobs of type "plugin".
+ * It must export both functions declared at the bottom of this header:
+ *
+ *   uint32_t nanocron_plugin_abi_version(void);   // return NANOCRON_PLUGIN_ABI_VERSION
+ *   int      nanocron_job_run(nanocron_job_ctx* ctx);
+ *
+ * nanocron_job_run() is called on a daemon worker thread (or inside a
+ * forked child when the job sets "isolate": true) once per scheduled run.
+ * It must be reentrant, must not call exit(), and should poll
+ * ctx->is_cancelled(ctx) during long work: the token turns on when the
+ * job's timeout expires or the daemon shuts down.
+ *
+ * Build a plugin with:
+ *   gcc -shared -fPIC -I/usr/local/include/nanocron my_plugin.c -o my_plugin.so
+ *
+ * The ABI only grows by appending fields to nanocron_job_ctx; the major
+ * version changes whenever an existing field changes meaning.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NANOCRON_PLUGIN_ABI_VERSION 1u
+
+/* Return codes of nanocron_job_run() (any other non-zero value is a failure) */
+#define NANOCRON_JOB_OK         0
+#define NANOCRON_JOB_FAILED     1
+#define NANOCRON_JOB_CANCELLED  2
+
+/* Levels accepted by ctx->log() (same order as the daemon's LogLevel) */
+#define NANOCRON_LOG_DEBUG    0
+#define NANOCRON_LOG_INFO     1
+#define NANOCRON_LOG_WARNING  2
+#define NANOCRON_LOG_ERROR    3
+#define NANOCRON_LOG_SUCCESS  4
+
+typedef struct nanocron_job_ctx nanocron_job_ctx;
+
+struct nanocron_job_ctx {
+    uint32_t abi_version;            /* NANOCRON_PLUGIN_ABI_VERSION of the host */
+    uint32_t struct_size;            /* sizeof(nanocron_job_ctx) of the host */
+
+    const char* job_id;              /* Stable job ID */
+    const char* job_description;     /* Job description from jobs.json */
+    const char* argument;            /* "plugin_arg" from jobs.json ("" if absent) */
+    int64_t scheduled_time;          /* Scheduled minute, seconds since epoch */
+    int64_t deadline_ms;             /* CLOCK_MONOTONIC deadline in milliseconds */
+
+    /* Non-zero once the plugin should stop (deadline passed or shutdown) */
+    int (*is_cancelled)(const nanocron_job_ctx* ctx);
+
+    /* Write a line to the daemon log, attributed to this job */
+    void (*log)(const nanocron_job_ctx* ctx, int level, const char* message);
+
+    void* host;                      /* Opaque host data, do not touch */
+};
+
+/* Exported by the plugin */
+uint32_t nanocron_plugin_abi_version(void);
+int nanocron_job_run(nanocron_job_ctx* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NANOCRON_PLUGIN_H */
@@ -38,18 +38,55 @@ if ! g++ --version &> /dev/null; then
     exit 1
 fi
 
+# ------------------------------------------------------------------------------
+# Library Build Step:
+# Compile the shared components once as position-independent objects and
+# package them as libnanocron (static and shared) for embedding applications.
+echo "[nanoCron] Building libnanocron..."
+
+# Optional per-subsystem heap accounting (sudo NANOCRON_ALLOC_TRACKING=1 ./install.sh)
+EXTRA_FLAGS=""
+if [[ "${NANOCRON_ALLOC_TRACKING:-0}" == "1" ]]; then
+    echo "[nanoCron] Allocation tracking enabled"
+    EXTRA_FLAGS="-DNANOCRON_ALLOC_TRACKING"
+fi
+
+LIB_COMPONENTS=(AllocTracker Logger JobConfig JobMatrix CronEngine CronExpression MaskBatch JobExecutor PluginRunner ConfigWatcher WorkerPool CronScheduler LeaderLease ExecutionState HashRing ClusterMembership ProcessRunner BundleRunner EventBus AgentProtocol AgentPool UserAccounts Quotas UserSpool JobStore ConfigPersister ControlServer UpgradeHandoff ExecutableResolver Prewarmer StartLag)
+BUILD_DIR="$(mktemp -d)"
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+LIB_OBJECTS=()
+for component in "${LIB_COMPONENTS[@]}"; do
+    g++ -O2 -std=c++17 -fPIC -pthread -Wno-unused-result $EXTRA_FLAGS -I"$PROJECT_ROOT/components" \
+        -c "$PROJECT_ROOT/components/$component.cpp" -o "$BUILD_DIR/$component.o"
+    LIB_OBJECTS+=("$BUILD_DIR/$component.o")
+done
+
+ar rcs "$BUILD_DIR/libnanocron.a" "${LIB_OBJECTS[@]}"
+g++ -shared -pthread "${LIB_OBJECTS[@]}" -ldl -o "$BUILD_DIR/libnanocron.so"
+
+echo "[nanoCron] Installing libnanocron to /usr/local/lib and /usr/local/include/nanocron..."
+install -m 644 "$BUILD_DIR/libnanocron.a" /usr/local/lib/libnanocron.a
+install -m 755 "$BUILD_DIR/libnanocron.so" /usr/local/lib/libnanocron.so
+mkdir -p /usr/local/include/nanocron
+install -m 644 "$PROJECT_ROOT"/components/*.h "$PROJECT_ROOT/components/json.hpp" /usr/local/include/nanocron/
+ldconfig || true
+
 # ------------------------------------------------------------------------------
 # Compilation Step:
-# Compile `nanoCron.cpp` with all components, including new ConfigWatcher
+# Link the daemon statically against libnanocron
 echo "[nanoCron] Compiling nanoCron.cpp with auto-reload support..."
-g++ -O2 -pthread -Wno-unused-result -I"$PROJECT_ROOT/components" \
+
+g++ -O2 -std=c++17 -pthread -Wno-unused-result $EXTRA_FLAGS -I"$PROJECT_ROOT/components" \
     "$PROJECT_ROOT/nanoCron.cpp" \
-    "$PROJECT_ROOT/components/Logger.cpp" \
-    "$PROJECT_ROOT/components/JobConfig.cpp" \
-    "$PROJECT_ROOT/components/CronEngine.cpp" \
-    "$PROJECT_ROOT/components/JobExecutor.cpp" \
-    "$PROJECT_ROOT/components/ConfigWatcher.cpp" \
-    -o /usr/local/bin/nanoCron
+    "$BUILD_DIR/libnanocron.a" \
+    -ldl -o /usr/local/bin/nanoCron
+
+echo "[nanoCron] Compiling nanoCronAgent..."
+g++ -O2 -std=c++17 -pthread -Wno-unused-result $EXTRA_FLAGS -I"$PROJECT_ROOT/components" \
+    "$PROJECT_ROOT/nanoCronAgent.cpp" \
+    "$BUILD_DIR/libnanocron.a" \
+    -ldl -o /usr/local/bin/nanoCronAgent
 
 echo "[nanoCron] Compiling nanoCronCLI..."
 g++ -O2 "$PROJECT_ROOT/nanoCronCLI.cpp" -o /usr/local/bin/nanoCronCLI
@@ -69,15 +106,29 @@ echo "[nanoCron] Creating clean config.env with paths..."
 # Create clean config.env with all paths
 cat > "$SCRIPT_DIR/config.env" << EOF
 CRON_INTERVAL_SECONDS=60
+WORKER_THREADS=4
+SCHEDULER_SHARDS=1
+BUNDLE_WORKERS=1
 LOG_PATH=/var/log/nanoCron.log
 ORIGINAL_JOBS_JSON_PATH=$SCRIPT_DIR/jobs.json
 ORIGINAL_CRON_LOG_PATH=$SCRIPT_DIR/logs/cron.log
+SPOOL_DIR=/var/spool/nanoCron
+USER_MAX_CONCURRENT=4
+SPOOL_MAX_JOBS=100
+CONTROL_SOCKET=/run/nanoCron.sock
+DRAIN_TIMEOUT_SECONDS=60
 EOF
 
 # Copy to system location
 echo "[nanoCron] Copying config.env to /opt/nanoCron/init/..."
 cp "$SCRIPT_DIR/config.env" /opt/nanoCron/init/config.env
 
+# Per-user job files: anyone may create <user>.json, nobody can list or
+# replace other users' files (sticky, write+search only, like cron's spool)
+echo "[nanoCron] Creating user spool /var/spool/nanoCron..."
+mkdir -p /var/spool/nanoCron
+chmod 1733 /var/spool/nanoCron
+
 # Create logs directory if it doesn't exist
 echo "[nanoCron] Creating logs directory..."
 mkdir -p "$SCRIPT_DIR/logs"
@@ -91,10 +142,17 @@ cp "$SCRIPT_DIR/nanoCron.service" /etc/systemd/system/nanoCron.service
 # ------------------------------------------------------------------------------
 # Enable and Start Service:
 # Reload systemd configuration, then enable (auto-start on boot) and start nanoCron.
+# With NANOCRON_UPGRADE=1 a running service re-executes the new binary in
+# place (ExecReload sends SIGUSR2) instead of restarting, so running jobs survive.
 echo "[nanoCron] Reloading systemd config and starting service..."
 systemctl daemon-reload
 systemctl enable nanoCron
-systemctl restart nanoCron
+if [ "${NANOCRON_UPGRADE:-0}" = "1" ] && systemctl is-active --quiet nanoCron; then
+    echo "[nanoCron] Upgrading running service in place..."
+    systemctl reload nanoCron
+else
+    systemctl restart nanoCron
+fi
 
 # Give the service a moment to start
 sleep 3
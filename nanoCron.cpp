@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <ctime>
+#include <cstdio>
 #include <chrono>
 #include <thread>
 #include <map>
@@ -18,16 +19,42 @@
 #include <string>
 #include <unistd.h>
 #include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <algorithm>
 
 // Import modular components
 #include "components/Logger.h"
 #include "components/CronTypes.h"
+#include "components/CronExpr.h"
+#include "components/CronExpression.h"
 #include "components/JobConfig.h"
 #include "components/CronEngine.h"
 #include "components/JobExecutor.h"
 #include "components/ConfigWatcher.h"
+#include "components/CronScheduler.h"
+#include "components/PluginRunner.h"
+#include "components/LeaderLease.h"
+#include "components/ExecutionState.h"
+#include "components/ClusterMembership.h"
+#include "components/HashRing.h"
+#include "components/AgentPool.h"
+#include "components/UserSpool.h"
+#include "components/UserAccounts.h"
+#include "components/Quotas.h"
+#include "components/JobStore.h"
+#include "components/ConfigPersister.h"
+#include "components/ControlServer.h"
+#include "components/EventBus.h"
+#include "components/UpgradeHandoff.h"
+#include "components/ExecutableResolver.h"
+#include "components/Prewarmer.h"
+#include "components/StartLag.h"
+#include "components/MaskBatch.h"
+#include "components/AllocTracker.h"
 
 /**
  * @brief Global variables for graceful shutdown management
@@ -38,6 +65,52 @@
 std::unique_ptr<ConfigWatcher> configWatcher;  // Auto-reload configuration manager
 Logger* globalLogger = nullptr;                // Global logger instance for signal handling
 std::atomic<bool> shouldExit{false};          // Thread-safe shutdown flag
+std::atomic<bool> skipDrain{false};           // Second signal: stop running jobs at once
+std::string configFilePath = "/opt/nanoCron/init/config.env";  // Overridable with --config
+std::atomic<bool> upgradeRequested{false};    // SIGUSR2 or control "upgrade" seen
+const int UPGRADE_SETTLE_MS = 10000;          // Wait for runs that cannot be handed over
+int wakePipe[2] = {-1, -1};                   // Written to cut the main loop sleep short
+
+/**
+ * @brief Schedules of the main loop's own maintenance, checked at compile time
+ */
+constexpr CronMask LOG_ROTATION_SCHEDULE = CronExpr::compile("0 0 * * *");     // Midnight
+constexpr CronMask STATUS_REPORT_SCHEDULE = CronExpr::compile("0 */4 * * *");  // Every 4 hours
+constexpr CronMask NO_JOBS_WARNING_SCHEDULE = CronExpr::compile("*/5 * * * *"); // Every 5 minutes
+
+/**
+ * @brief A maintenance task of the main loop and its next fire time
+ */
+struct MaintenanceTask {
+    CronMask schedule;
+    std::time_t next_fire;
+
+    MaintenanceTask(const CronMask& mask, std::time_t now)
+        : schedule(mask), next_fire(CronExpression::nextFireTime(mask, now)) {}
+
+    /**
+     * True once per fire time; a fire time missed while the loop slept
+     * (suspend, clock step) is taken at once and not repeated.
+     */
+    bool due(std::time_t now) {
+        if (next_fire < 0 || now < next_fire) {
+            return false;
+        }
+        next_fire = CronExpression::nextFireTime(schedule, now);
+        return true;
+    }
+};
+
+/**
+ * @brief Wakes the main loop from its sleep (async-signal-safe)
+ */
+void wakeMainLoop() {
+    if (wakePipe[1] >= 0) {
+        char byte = 1;
+        ssize_t ignored = write(wakePipe[1], &byte, 1);
+        (void)ignored;
+    }
+}
 
 /**
  * @brief Signal handler for graceful daemon shutdown
@@ -45,13 +118,50 @@ std::atomic<bool> shouldExit{false};          // Thread-safe shutdown flag
  * 
  * Handles system signals to initiate graceful shutdown sequence.
  * Uses atomic operations to ensure thread safety between signal context
- * and main thread execution.
+ * and main thread execution. The main loop is woken at once; a second
+ * signal cuts the drain of running jobs short.
  */
 void signalHandler(int signal) {
+    if (shouldExit.exchange(true)) {
+        skipDrain.store(true);
+        return;
+    }
     if (globalLogger) {
         globalLogger->info("Received signal " + std::to_string(signal) + ", shutting down gracefully...");
     }
-    shouldExit.store(true);  // Atomic write for thread safety
+    wakeMainLoop();
+}
+
+/**
+ * @brief SIGUSR2 handler: upgrade in place at the next main loop pass
+ * 
+ * Only sets a flag and wakes the main loop; the hand-over itself runs on
+ * the main thread, between two scheduler passes.
+ */
+void upgradeSignalHandler(int) {
+    upgradeRequested.store(true);
+    wakeMainLoop();
+}
+
+/**
+ * @brief Path of the running executable, resolved at startup
+ * 
+ * Read before anything can replace the file, so an upgrade execs whatever
+ * is installed at that path by then.
+ */
+std::string daemonExecutablePath(const char* argv0) {
+    char path[4096];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n <= 0) {
+        return argv0;
+    }
+    std::string resolved(path, static_cast<size_t>(n));
+    const std::string deleted = " (deleted)";
+    if (resolved.size() > deleted.size() &&
+        resolved.compare(resolved.size() - deleted.size(), deleted.size(), deleted) == 0) {
+        resolved.erase(resolved.size() - deleted.size());
+    }
+    return resolved;
 }
 
 /**
@@ -64,7 +174,7 @@ void signalHandler(int signal) {
  * file is inaccessible or malformed.
  */
 std::string getJobsJsonPath() {
-    const std::string CONFIG_FILE = "/opt/nanoCron/init/config.env";
+    const std::string CONFIG_FILE = configFilePath;
     std::ifstream configFile(CONFIG_FILE);
     
     if (!configFile.is_open()) {
@@ -96,7 +206,7 @@ std::string getJobsJsonPath() {
  * (system-wide vs local development).
  */
 std::string getCronLogPath() {
-    const std::string CONFIG_FILE = "/opt/nanoCron/init/config.env";
+    const std::string CONFIG_FILE = configFilePath;
     std::ifstream configFile(CONFIG_FILE);
     
     if (!configFile.is_open()) {
@@ -118,27 +228,266 @@ std::string getCronLogPath() {
     return "./logs/cron.log";
 }
 
+/**
+ * @brief Reads a single KEY=value setting from the environment config
+ * @param key Setting name (e.g. "WORKER_THREADS")
+ * @param fallback Value returned when the file or the key is missing
+ * @return Configured value or fallback
+ */
+std::string getConfigValue(const std::string& key, const std::string& fallback) {
+    const std::string CONFIG_FILE = configFilePath;
+    std::ifstream configFile(CONFIG_FILE);
+    if (!configFile.is_open()) {
+        return fallback;
+    }
+    
+    const std::string prefix = key + "=";
+    std::string line;
+    while (std::getline(configFile, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0) {
+            return line.substr(prefix.size());
+        }
+    }
+    return fallback;
+}
+
+/**
+ * @brief Reads a positive integer setting from the environment config
+ * @param key Setting name
+ * @param fallback Value used when the key is missing or invalid
+ * @param logger Logger for invalid values
+ */
+int getConfigInt(const std::string& key, int fallback, Logger& logger) {
+    try {
+        return std::max(1, std::stoi(getConfigValue(key, std::to_string(fallback))));
+    } catch (const std::exception&) {
+        logger.warning("Invalid " + key + " in config.env, using " + std::to_string(fallback));
+        return fallback;
+    }
+}
+
+/**
+ * @brief Default HA node name: <hostname>-<pid>
+ */
+std::string defaultNodeId() {
+    char host[256] = {0};
+    if (gethostname(host, sizeof(host) - 1) != 0) {
+        std::snprintf(host, sizeof(host), "node");
+    }
+    return std::string(host) + "-" + std::to_string(getpid());
+}
+
+/**
+ * @brief Parses the "add" or "update" list of a jobs.apply request
+ * @param request Control request
+ * @param key "add" or "update"
+ * @param jobs Output jobs whose conditions are met
+ * @param skipped Output IDs left out because their conditions are not met
+ * @param entries Output (ID, jobs.json object) pairs to persist
+ * @param error Output error message
+ * @return false if the list is malformed or a job is invalid
+ * 
+ * Entries follow the jobs.json format and must carry an explicit "id", so
+ * later updates and removals can address them.
+ */
+bool parseJobList(const nlohmann::json& request, const std::string& key, std::vector<CronJob>& jobs,
+                  std::vector<std::string>& skipped, std::vector<std::pair<std::string, nlohmann::json>>& entries,
+                  std::string& error) {
+    if (!request.contains(key)) {
+        return true;
+    }
+    const nlohmann::json& list = request[key];
+    if (!list.is_array()) {
+        error = "\"" + key + "\" must be an array of jobs";
+        return false;
+    }
+    for (const auto& entry : list) {
+        if (!entry.is_object() || !entry.contains("id") || !entry["id"].is_string() ||
+            entry["id"].get<std::string>().empty()) {
+            error = "every job in \"" + key + "\" needs an \"id\"";
+            return false;
+        }
+    }
+    
+    // Same rules as a jobs.json reload, applied to this batch only
+    nlohmann::json doc = {{"jobs", list}};
+    if (!JobConfig::validateJobsJson(doc.dump(), error)) {
+        return false;
+    }
+    std::vector<CronJob> parsed = JobConfig::parseJobsFromJson(std::move(doc));
+    size_t next = 0;
+    for (const auto& entry : list) {
+        std::string id = entry["id"].get<std::string>();
+        if (next < parsed.size() && parsed[next].id == id) {
+            jobs.push_back(std::move(parsed[next++]));
+        } else {
+            skipped.push_back(id);
+        }
+        entries.emplace_back(id, entry);
+    }
+    return true;
+}
+
+/**
+ * @brief Flags jobs whose program does not exist
+ * @param jobs Jobs just loaded
+ * @param resolver Executable cache
+ * @param logger Logger for the warnings
+ * @return IDs of the jobs with a missing program
+ * 
+ * Runs on every load, so a missing binary shows up when the job is added
+ * instead of when it first fires. The jobs are still scheduled: the
+ * program may be installed before then.
+ */
+std::vector<std::string> checkExecutables(const std::vector<CronJob>& jobs, ExecutableResolver& resolver,
+                                          Logger& logger) {
+    std::vector<std::string> missing;
+    for (const auto& job : jobs) {
+        std::string program;
+        if (!resolver.check(job, program)) {
+            logger.warning("Executable not found: " + program, job.description);
+            missing.push_back(job.id);
+        }
+    }
+    return missing;
+}
+
+/**
+ * @brief Publishes the "reload" event of a scheduler sync
+ * @param source What changed: "config", "spool", "control" or "cluster"
+ * @param jobs Jobs in the synced set (or batch)
+ * @param stats Result of the sync
+ * @param user Spool owner ("" for other sources)
+ */
+void publishReload(const char* source, size_t jobs, const SchedulerSyncStats& stats, const std::string& user = "") {
+    if (!EventBus::active()) {
+        return;
+    }
+    nlohmann::json event = {{"source", source}, {"ok", true}, {"jobs", jobs}, {"added", stats.added},
+                            {"rescheduled", stats.rescheduled}, {"updated", stats.updated}, {"removed", stats.removed}};
+    if (!user.empty()) {
+        event["user"] = user;
+    }
+    EventBus::publish("reload", "", std::move(event));
+}
+
+/**
+ * @brief Prints the runs jobs.json would make over the next hours
+ * @param jobsPath Job configuration to load
+ * @param hours Length of the simulated window
+ * @return Exit code (1 if the configuration cannot be loaded)
+ * 
+ * Dry run for checking a configuration: nothing is executed and no daemon
+ * state is touched. Each minute of the window is matched against every
+ * schedule at once (MaskBatch). Jobs whose system conditions do not hold
+ * right now are left out, as on a real load.
+ */
+int simulateSchedule(const std::string& jobsPath, int hours) {
+    std::string error;
+    if (!JobConfig::validateJobsFile(jobsPath, error)) {
+        std::cerr << "Cannot load " << jobsPath << ": " << error << std::endl;
+        return 1;
+    }
+    std::vector<CronJob> jobs = JobConfig::loadJobs(jobsPath);
+    MaskBatch batch;
+    batch.reserve(jobs.size());
+    for (const auto& job : jobs) {
+        batch.add(job.mask);
+    }
+    
+    std::time_t now = std::time(nullptr);
+    std::time_t first = (now / 60 + 1) * 60;
+    std::vector<uint32_t> due;
+    size_t runs = 0;
+    for (std::time_t t = first; t < first + static_cast<std::time_t>(hours) * 3600; t += 60) {
+        std::tm local_time;
+        localtime_r(&t, &local_time);
+        if (batch.due(local_time, due) == 0) {
+            continue;
+        }
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M", &local_time);
+        for (uint32_t index : due) {
+            std::cout << stamp << "  " << jobs[index].id << "  " << jobs[index].description << std::endl;
+        }
+        runs += due.size();
+    }
+    std::cout << runs << " runs of " << jobs.size() << " jobs in the next " << hours << " hours ("
+              << MaskBatch::backend() << " matching)" << std::endl;
+    return 0;
+}
+
 /**
  * @brief Main daemon entry point and execution loop
+ * @param argc Argument count
+ * @param argv Arguments ("--config PATH" selects another config.env,
+ *             "--simulate HOURS" prints the upcoming runs and exits)
  * @return Exit code (0 for successful termination)
  * 
  * Orchestrates the complete nanoCron daemon lifecycle:
  * 1. Signal handler registration for graceful shutdown
  * 2. Logger initialization with silent mode for daemon operation
  * 3. ConfigWatcher setup for automatic configuration reloading
- * 4. Main execution loop with job scheduling and system maintenance
- * 5. Graceful cleanup and resource deallocation
+ * 4. Optional leader lease (HA mode): only the leader dispatches jobs
+ * 5. Main execution loop feeding CronScheduler and doing system maintenance
+ * 6. Graceful cleanup and resource deallocation
+ * 
+ * Started by an upgrade (NANOCRON_UPGRADE_STATE set), it first takes over
+ * the previous image's running jobs, schedule and control socket.
  */
-int main() {
+int main(int argc, char* argv[]) {
+    /**
+     * Upgrade hand-over: read the state before anything else is opened,
+     * since loading it also closes the descriptors the old image leaked.
+     * The variable is removed so job processes do not inherit it.
+     */
+    std::unique_ptr<HandoffState> handoff;
+    std::string handoffError;
+    if (const char* stateFd = getenv(UpgradeHandoff::STATE_ENV)) {
+        handoff = std::make_unique<HandoffState>();
+        if (!UpgradeHandoff::load(std::atoi(stateFd), *handoff, handoffError)) {
+            handoff.reset();
+        }
+        unsetenv(UpgradeHandoff::STATE_ENV);
+    }
+    const std::string daemonBinary = daemonExecutablePath(argv[0]);
+    const std::vector<std::string> daemonArgs(argv, argv + argc);
+    
+    int simulateHours = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            configFilePath = argv[++i];
+        } else if (arg == "--simulate" && i + 1 < argc && std::atoi(argv[i + 1]) > 0) {
+            simulateHours = std::min(std::atoi(argv[++i]), 24 * 366);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--config PATH] [--simulate HOURS]" << std::endl;
+            return 1;
+        }
+    }
+    if (simulateHours > 0) {
+        return simulateSchedule(getJobsJsonPath(), simulateHours);
+    }
+    
     // Setup signal handlers for graceful shutdown
     signal(SIGTERM, signalHandler);  // Handle systemd stop commands
     signal(SIGINT, signalHandler);   // Handle Ctrl+C during development
+    if (pipe2(wakePipe, O_CLOEXEC | O_NONBLOCK) == 0) {
+        signal(SIGUSR2, upgradeSignalHandler);  // In-place upgrade (nanoCronCLI "upgrade")
+    }
     
     // Initialize logging subsystem in silent mode (daemon operation)
     Logger logger(getCronLogPath());
     globalLogger = &logger;
     logger.setSilentMode(true);  // Suppress console output for daemon mode
     logger.info("=== NANOCRON DAEMON STARTED (v2.1.0) ===");
+    if (handoff) {
+        logger.info("Upgrade: resumed from the previous image (" + std::to_string(handoff->runs.size()) +
+                    " running jobs, " + std::to_string(handoff->next_fires.size()) + " schedules, handed over " +
+                    std::to_string(std::time(nullptr) - handoff->created) + "s ago)");
+    } else if (!handoffError.empty()) {
+        logger.error("Upgrade: " + handoffError + " - starting without the previous state");
+    }
     
     // Log current working directory for debugging path resolution issues
     char cwd[1024];
@@ -171,37 +520,503 @@ int main() {
         logger.info("Initial load: " + std::to_string(jobs->size()) + " jobs");
         // Log each job for startup verification
         for (const auto& job : *jobs) {
-            logger.info("Job: " + job.description + " [" + job.command + "]");
+            std::string instances = job.matrix
+                ? " (template, " + std::to_string(job.matrix->size()) + " instances)" : "";
+            logger.info("Job: " + job.description + " [" + job.command + "]" + instances);
         }
     }
     
     /**
-     * Job execution tracking map prevents duplicate executions within the same minute.
-     * Key: job command string, Value: pair<hour, minute> of last execution
-     * This is critical for preventing runaway job executions when the daemon
-     * checks every 20 seconds but jobs are scheduled per minute.
+     * Scheduler holding every job in a heap keyed by next fire time.
+     * Each job fires once per matching minute, so no duplicate-execution
+     * tracking is needed, and jobs run on a worker pool so a slow job no
+     * longer delays the ones scheduled after it.
+     */
+    int workerThreads = getConfigInt("WORKER_THREADS", 4, logger);
+    CronScheduler scheduler;
+    scheduler.useWorkerPool(static_cast<size_t>(workerThreads));
+    logger.info("Job executor: " + std::to_string(workerThreads) + " worker threads");
+    JobExecutor::setScheduler(&scheduler);   // Runs deferred by a "defer" quota are queued again here
+    int drainTimeout = getConfigInt("DRAIN_TIMEOUT_SECONDS", 60, logger);
+    
+    /**
+     * Live job store: the jobs.json snapshot plus the mutations applied
+     * through the control socket since it was loaded. configMutex orders
+     * those mutations with the resyncs done by the main loop.
+     */
+    JobStore jobStore;
+    std::mutex configMutex;
+    uint64_t storeGeneration = configWatcher->getReloadStats().generation;  // Read before getJobs()
+    std::shared_ptr<std::vector<CronJob>> scheduled_snapshot = configWatcher->getJobs();  // Snapshot in the store
+    jobStore.reset(scheduled_snapshot);
+    bool schedulerSynced = false;
+    
+    /**
+     * High availability (HA_LEASE_PATH set): every instance runs the full
+     * scheduler, but a dispatch filter drops all runs unless this instance
+     * holds the leader lease. The leader records each run in the shared
+     * execution state *before* executing it; a new leader reloads that
+     * state and dispatches only the runs nobody recorded (at most one
+     * catch-up run per job), so failover neither loses nor repeats runs.
+     */
+    std::unique_ptr<LeaderLease> lease;
+    std::unique_ptr<ExecutionState> executionState;
+    std::time_t catchupSeconds = 0;
+    bool wasLeader = false;
+    std::vector<ScheduledRun> catchupRuns;
+    
+    std::string leasePath = getConfigValue("HA_LEASE_PATH", "");
+    if (!leasePath.empty()) {
+        std::string nodeId = getConfigValue("HA_NODE_ID", "");
+        if (nodeId.empty()) {
+            nodeId = defaultNodeId();
+        }
+        int ttl = getConfigInt("HA_LEASE_TTL", 10, logger);
+        catchupSeconds = getConfigInt("HA_CATCHUP_SECONDS", 300, logger);
+        executionState = std::make_unique<ExecutionState>(getConfigValue("HA_STATE_PATH", leasePath + ".state"));
+        lease = std::make_unique<LeaderLease>(leasePath, nodeId, ttl, logger);
+        
+        if (!lease->start()) {
+            logger.error("HA: cannot use lease file " + leasePath + ", exiting");
+            return 1;
+        }
+        logger.info("HA mode: node " + nodeId + ", lease " + leasePath + ", ttl " + std::to_string(ttl) + "s");
+        
+        scheduler.setDispatchFilter([&](std::vector<ScheduledRun>& runs) {
+            if (!lease->isLeader()) {
+                runs.clear();   // Standby: the leader runs these
+                return;
+            }
+            runs.erase(std::remove_if(runs.begin(), runs.end(), [&](const ScheduledRun& run) {
+                return executionState->lastFire(run.id()) >= run.scheduled_time;
+            }), runs.end());
+            if (runs.empty()) {
+                return;
+            }
+            
+            for (const auto& run : runs) {
+                executionState->recordFire(run.id(), run.scheduled_time);
+            }
+            executionState->setOwner(lease->nodeId(), lease->epoch());
+            std::string error;
+            if (!executionState->save(error)) {
+                logger.error("HA: " + error + " - skipping " + std::to_string(runs.size()) + " runs");
+                runs.clear();
+            } else if (!lease->isLeader()) {
+                // Fence reached while saving: the runs are recorded but a new
+                // leader may already be active, so never risk a duplicate
+                logger.warning("HA: lease fence reached while dispatching, " +
+                               std::to_string(runs.size()) + " runs dropped");
+                runs.clear();
+            }
+        });
+    }
+    
+    /**
+     * Cluster mode (CLUSTER_DIR set): active-active sharding. Live members
+     * are read from heartbeat files and every job belongs to exactly one
+     * of them through a consistent hash of its ID, so each node only
+     * schedules its own shard. A join or leave moves about 1/N of the
+     * jobs; syncJobs() keeps the next fire time of all the others.
      */
-    std::map<std::string, std::pair<int, int>> last_execution;
+    std::unique_ptr<ClusterMembership> membership;
+    HashRing ring;
+    uint64_t ringGeneration = 0;
     
-    // Maintenance operation tracking variables
-    int last_rotation_day = -1;   // Track daily log rotation
-    int last_debug_hour = -1;     // Track periodic system status logging
-    int config_check_counter = 0; // Counter for "no jobs" warning frequency
+    std::string clusterDir = getConfigValue("CLUSTER_DIR", "");
+    if (!clusterDir.empty()) {
+        if (lease) {
+            logger.error("CLUSTER_DIR and HA_LEASE_PATH are mutually exclusive, exiting");
+            return 1;
+        }
+        std::string nodeId = getConfigValue("CLUSTER_NODE_ID", "");
+        if (nodeId.empty()) {
+            nodeId = defaultNodeId();
+        }
+        int ttl = getConfigInt("CLUSTER_HEARTBEAT_TTL", 10, logger);
+        ring = HashRing(static_cast<unsigned>(getConfigInt("CLUSTER_VNODES", 128, logger)));
+        membership = std::make_unique<ClusterMembership>(clusterDir, nodeId, ttl, logger);
+        
+        if (!membership->start()) {
+            logger.error("Cluster: cannot use membership directory " + clusterDir + ", exiting");
+            return 1;
+        }
+        logger.info("Cluster mode: node " + nodeId + ", directory " + clusterDir + ", ttl " + std::to_string(ttl) + "s");
+    }
     
+    /**
+     * Sharded scheduler (SCHEDULER_SHARDS > 1): jobs are split by a hash of
+     * their ID between that many scheduler shards, each with its own heap,
+     * lock, worker pool and thread pinned to a core, so the fire-time
+     * bursts of very large configurations are dispatched in parallel. The
+     * main loop then only syncs configuration and runs maintenance. Not
+     * combined with HA or cluster mode, whose dispatch bookkeeping lives
+     * on the main loop.
+     */
+    int schedulerShards = getConfigInt("SCHEDULER_SHARDS", 1, logger);
+    bool sharded = false;
+    if (schedulerShards > 1) {
+        if (lease || membership) {
+            logger.warning("SCHEDULER_SHARDS is ignored in HA and cluster mode");
+        } else if (scheduler.useShards(static_cast<size_t>(schedulerShards))) {
+            sharded = true;
+            logger.info("Scheduler: " + std::to_string(schedulerShards) + " shards");
+        }
+    }
+    
+    /**
+     * Worker agents (AGENT_LISTEN set): jobs with "executor": "agent" are
+     * sent to nanoCronAgent processes connected to this endpoint instead
+     * of being forked locally. Results come back asynchronously.
+     */
+    std::unique_ptr<AgentPool> agentPool;
+    std::string agentEndpoint = getConfigValue("AGENT_LISTEN", "");
+    if (!agentEndpoint.empty()) {
+        agentPool = std::make_unique<AgentPool>(logger);
+        std::string error;
+        if (!agentPool->start(agentEndpoint, error)) {
+            logger.error("Agents: cannot listen on " + agentEndpoint + ": " + error + ", exiting");
+            return 1;
+        }
+        JobExecutor::setAgentPool(agentPool.get());
+        logger.info("Agent endpoint: " + agentEndpoint);
+    }
+    
+    /**
+     * Executable cache: commands without shell syntax run without /bin/sh,
+     * their program looked up in PATH once and again only after inotify
+     * reports a change of that name in a PATH directory.
+     */
+    ExecutableResolver resolver(logger);
+    resolver.start();
+    JobExecutor::setResolver(&resolver);
+    
+    /**
+     * Bundles: jobs with the same "bundle" due at the same time run in
+     * BUNDLE_WORKERS shared shells, one command after the other per shell.
+     */
+    JobExecutor::setBundleWorkers(static_cast<size_t>(getConfigInt("BUNDLE_WORKERS", 1, logger)));
+    
+    /**
+     * Prewarming: jobs with a "prewarm" lead time get their program,
+     * libraries and declared data paths read ahead into the page cache
+     * that many seconds before each fire.
+     */
+    Prewarmer prewarmer(&resolver, logger);
+    prewarmer.start();
+    std::vector<ScheduledRun> prewarmRuns;
+    
+    /**
+     * Per-user spool (SPOOL_DIR set): <user>.json files next to the main
+     * jobs.json, each reloaded and resynced on its own. Their jobs, and
+     * jobs.json entries with a "user", run with that user's credentials
+     * and at most USER_MAX_CONCURRENT at a time per user.
+     */
+    UserAccounts::setMaxConcurrent(getConfigInt("USER_MAX_CONCURRENT", 4, logger));
+    std::unique_ptr<UserSpool> spool;
+    std::string spoolDir = getConfigValue("SPOOL_DIR", "");
+    if (!spoolDir.empty()) {
+        int maxJobs = getConfigInt("SPOOL_MAX_JOBS", 100, logger);
+        spool = std::make_unique<UserSpool>(spoolDir, static_cast<size_t>(std::max(0, maxJobs)), logger);
+        if (!spool->start()) {
+            logger.error("Spool: cannot watch " + spoolDir + " - user job files disabled");
+            spool.reset();
+        }
+    }
+    
+    /**
+     * Control socket (CONTROL_SOCKET set): local administration commands.
+     * "jobs.apply" adds, updates and removes jobs by ID in one batch,
+     * applied straight to the job store and the scheduler (O(batch), no
+     * reparse of jobs.json). ConfigPersister writes the batch back to
+     * jobs.json shortly after, and ConfigWatcher recognizes that write as
+     * our own instead of reloading the file. "events.subscribe" turns a
+     * connection into a stream of job lifecycle events (EventBus).
+     */
+    std::unique_ptr<ConfigPersister> persister;
+    std::unique_ptr<ControlServer> control;
+    std::string controlPath = getConfigValue("CONTROL_SOCKET", "");
+    if (!controlPath.empty()) {
+        persister = std::make_unique<ConfigPersister>(jobsPath, logger);
+        persister->setHook([](const std::string& previous, const std::string& content, uint64_t generation) {
+            configWatcher->expectOwnWrite(previous, content, generation);
+        });
+        persister->start();
+        
+        control = std::make_unique<ControlServer>(logger);
+        control->handle("ping", [&](const nlohmann::json&, nlohmann::json& response, std::string&) {
+            response["pid"] = getpid();
+            response["jobs"] = scheduler.size();
+            return true;
+        });
+        
+        control->handle("jobs.apply", [&](const nlohmann::json& request, nlohmann::json& response, std::string& error) {
+            JobMutation mutation;
+            std::vector<std::string> skipped;
+            std::vector<std::pair<std::string, nlohmann::json>> entries;
+            if (!parseJobList(request, "add", mutation.add, skipped, entries, error) ||
+                !parseJobList(request, "update", mutation.update, skipped, entries, error)) {
+                return false;
+            }
+            if (request.contains("remove")) {
+                if (!request["remove"].is_array()) {
+                    error = "\"remove\" must be an array of job IDs";
+                    return false;
+                }
+                for (const auto& id : request["remove"]) {
+                    if (!id.is_string()) {
+                        error = "\"remove\" must be an array of job IDs";
+                        return false;
+                    }
+                    mutation.remove.push_back(id.get<std::string>());
+                    entries.emplace_back(mutation.remove.back(), nullptr);
+                }
+            }
+            
+            std::vector<std::string> unresolved = checkExecutables(mutation.add, resolver, logger);
+            for (const auto& id : checkExecutables(mutation.update, resolver, logger)) {
+                unresolved.push_back(id);
+            }
+            
+            std::lock_guard<std::mutex> lock(configMutex);
+            // An update whose conditions no longer hold unloads the job, as a reload would
+            for (const auto& id : skipped) {
+                if (jobStore.find(id)) {
+                    mutation.remove.push_back(id);
+                }
+            }
+            std::vector<std::string> removals = mutation.remove;
+            std::vector<std::shared_ptr<const CronJob>> upserted;
+            if (!jobStore.apply(std::move(mutation), upserted, error)) {
+                return false;
+            }
+            if (membership) {
+                upserted.erase(std::remove_if(upserted.begin(), upserted.end(), [&](const std::shared_ptr<const CronJob>& job) {
+                    return !ring.owns(membership->nodeId(), job->id);   // Another node's shard
+                }), upserted.end());
+            }
+            SchedulerSyncStats stats = scheduler.applyJobs(upserted, removals, logger);
+            publishReload("control", upserted.size() + removals.size(), stats);
+            for (auto& entry : entries) {
+                persister->enqueue(entry.first, std::move(entry.second), storeGeneration);
+            }
+            
+            response["added"] = stats.added;
+            response["rescheduled"] = stats.rescheduled;
+            response["updated"] = stats.updated;
+            response["removed"] = stats.removed;
+            response["skipped"] = skipped;
+            response["unresolved"] = unresolved;
+            logger.info("Control: jobs.apply " + std::to_string(stats.added) + " added, " +
+                        std::to_string(stats.rescheduled) + " rescheduled, " +
+                        std::to_string(stats.updated) + " updated, " +
+                        std::to_string(stats.removed) + " removed, " +
+                        std::to_string(skipped.size()) + " skipped by conditions");
+            return true;
+        });
+        
+        control->handle("jobs.get", [&](const nlohmann::json& request, nlohmann::json& response, std::string& error) {
+            std::vector<std::shared_ptr<const CronJob>> found;
+            if (request.contains("ids")) {
+                if (!request["ids"].is_array()) {
+                    error = "\"ids\" must be an array of job IDs";
+                    return false;
+                }
+                response["missing"] = nlohmann::json::array();
+                for (const auto& id : request["ids"]) {
+                    auto job = id.is_string() ? jobStore.find(id.get<std::string>()) : nullptr;
+                    if (job) {
+                        found.push_back(job);
+                    } else {
+                        response["missing"].push_back(id);
+                    }
+                }
+            } else {
+                auto all = jobStore.snapshot();
+                for (const auto& job : *all) {
+                    found.push_back(std::shared_ptr<const CronJob>(all, &job));
+                }
+            }
+            response["jobs"] = nlohmann::json::array();
+            for (const auto& job : found) {
+                nlohmann::json entry = JobConfig::jobToJson(*job);
+                entry["next_fire"] = scheduler.nextFireTime(job->id);   // -1: not scheduled on this node
+                entry["running"] = scheduler.runningCount(job->id);
+                response["jobs"].push_back(std::move(entry));
+            }
+            return true;
+        });
+        
+        control->handle("metrics", [&](const nlohmann::json&, nlohmann::json& response, std::string&) {
+            for (const auto& lag : StartLag::snapshot()) {
+                response["start_lag"][lag.kind] = {{"runs", lag.runs}, {"p50_us", lag.p50_us}, {"p99_us", lag.p99_us},
+                                                   {"max_us", lag.max_us}, {"jitter_us", lag.jitter_us}};
+            }
+            response["quotas"] = nlohmann::json::array();
+            for (const auto& quota : Quotas::snapshot()) {
+                nlohmann::json entry = {{quota.group ? "group" : "job", quota.name},
+                                        {"window", quota.window_seconds == 3600 ? "hour" : "day"},
+                                        {"runs", quota.runs}, {"cpu_ms", quota.cpu_ms}, {"wall_ms", quota.wall_ms},
+                                        {"skipped", quota.skipped}, {"deferred", quota.deferred},
+                                        {"downgraded", quota.downgraded}};
+                entry["limits"] = {{"runs", quota.limits.runs}, {"cpu_seconds", quota.limits.cpu_seconds},
+                                   {"wall_seconds", quota.limits.wall_seconds}};   // 0 = no limit
+                response["quotas"].push_back(entry);
+            }
+            return true;
+        });
+        
+        control->handleStream("events.subscribe", [](const nlohmann::json& request, int fd, std::string& error) {
+            return EventBus::subscribe(fd, request, error);
+        });
+        
+        control->handle("upgrade", [&](const nlohmann::json&, nlohmann::json& response, std::string&) {
+            upgradeRequested.store(true);   // Done by the main loop once this reply is sent
+            wakeMainLoop();
+            response["pid"] = getpid();
+            return true;
+        });
+        
+        std::string error;
+        if (!EventBus::start(logger, error)) {
+            logger.error("Event stream: " + error + ", exiting");
+            return 1;
+        }
+        
+        // After an upgrade the socket is already bound: clients never see it missing
+        bool inherited = handoff && handoff->control_fd >= 0 && handoff->control_path == controlPath;
+        if (inherited ? !control->adopt(handoff->control_fd, controlPath, error) : !control->start(controlPath, error)) {
+            logger.error("Control socket: " + error + ", exiting");
+            return 1;
+        }
+        if (handoff) {
+            handoff->control_fd = -1;
+        }
+    }
+    if (handoff && handoff->control_fd >= 0) {
+        // CONTROL_SOCKET changed or was removed across the upgrade
+        close(handoff->control_fd);
+        unlink(handoff->control_path.c_str());
+        handoff->control_fd = -1;
+    }
+    
+    /**
+     * Job processes started by the previous image keep running through an
+     * upgrade. Each one is supervised to completion here (timeout, output,
+     * result log) on its own thread, outside the worker pool.
+     */
+    std::atomic<size_t> adoptedRuns{0};
+    std::vector<std::thread> adoptedThreads;
+    if (handoff) {
+        for (const auto& run : handoff->runs) {
+            adoptedRuns++;
+            adoptedThreads.emplace_back([run, &logger, &adoptedRuns] {
+                JobExecutor::resumeRun(run, logger);
+                adoptedRuns--;
+            });
+        }
+        handoff->runs.clear();
+    }
+    
+    /**
+     * In-place upgrade (SIGUSR2 or control "upgrade"): re-exec the installed
+     * binary without stopping. Runs on the main thread, so nothing new is
+     * dispatched meanwhile:
+     * 1. The control socket stops serving (no more mutations) but stays bound
+     * 2. Every job process is parked; plugin and agent runs must finish first
+     * 3. Pending job changes are written to jobs.json, which the new image loads
+     * 4. The pending fire time of every job, the running processes and the
+     *    control socket are handed to the new image through execve()
+     * Any failure undoes the steps and the daemon carries on as before.
+     */
+    auto upgradeDaemon = [&](std::string& error) {
+        logger.info("Upgrade: handing over to " + daemonBinary);
+        int controlFd = control ? control->detach() : -1;
+        if (sharded) {
+            scheduler.stopThreads();   // Shard threads dispatch on their own
+        }
+        ProcessRunner::suspendAll();
+        auto rollback = [&] {
+            ProcessRunner::resumeAll();
+            if (sharded) {
+                scheduler.start();
+            }
+            if (persister) {
+                persister->start();
+            }
+            std::string controlError;
+            if (controlFd >= 0 && !control->adopt(controlFd, controlPath, controlError)) {
+                logger.error("Control socket: " + controlError);
+            }
+            return false;
+        };
+        
+        auto settleBy = std::chrono::steady_clock::now() + std::chrono::milliseconds(UPGRADE_SETTLE_MS);
+        size_t busy = 0;
+        size_t parked = 0;
+        while (true) {
+            parked = ProcessRunner::suspendedCount();
+            busy = scheduler.inFlight() + ProcessRunner::prestartedCount() + adoptedRuns.load() +
+                   (agentPool ? agentPool->inFlight() : 0);
+            if (busy <= parked || std::chrono::steady_clock::now() >= settleBy) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        if (busy > parked) {
+            error = std::to_string(busy - parked) + " runs cannot be handed over (plugin, agent, pipeline or prestarted jobs still running), retry later";
+            return rollback();
+        }
+        if (persister) {
+            persister->stop();
+            if (persister->pending() > 0) {
+                error = "job changes could not be written to " + jobsPath;
+                return rollback();
+            }
+        }
+        
+        HandoffState state;
+        state.created = std::time(nullptr);
+        state.next_fires = scheduler.nextFireTimes();
+        state.runs = ProcessRunner::suspendedRuns();
+        state.control_fd = controlFd;
+        state.control_path = controlPath;
+        logger.info("Upgrade: " + std::to_string(state.runs.size()) + " running jobs and " +
+                    std::to_string(state.next_fires.size()) + " schedules handed over");
+        UpgradeHandoff::exec(daemonBinary, daemonArgs, state, error);   // Returns only on failure
+        return rollback();
+    };
+    
+    // Maintenance tasks, on cron schedules of their own
+    std::time_t startTime = std::time(nullptr);
+    MaintenanceTask logRotation(LOG_ROTATION_SCHEDULE, startTime);
+    MaintenanceTask statusReport(STATUS_REPORT_SCHEDULE, startTime);
+    MaintenanceTask noJobsWarning(NO_JOBS_WARNING_SCHEDULE, startTime);
+    
+    if (sharded) {
+        scheduler.start();
+    }
     logger.info("Entering main daemon loop");
     
     /**
      * Main daemon execution loop - runs continuously until shutdown signal
      * 
-     * Loop operations (every 20 seconds):
+     * Loop operations (at the next fire time, at most every 20 seconds):
      * 1. Get current system time with thread-safe localtime_r
      * 2. Perform daily maintenance (log rotation at midnight)
      * 3. Log periodic system status (every 4 hours)
-     * 4. Retrieve current job configuration from ConfigWatcher
-     * 5. Evaluate and execute scheduled jobs
+     * 4. Sync the scheduler when ConfigWatcher publishes a new snapshot
+     * 5. Dispatch due jobs to the worker pool (shard threads do it when sharded)
      * 6. Handle error conditions (missing configuration)
      */
     while (!shouldExit.load()) {
+        if (upgradeRequested.exchange(false)) {
+            std::string error;
+            if (!upgradeDaemon(error)) {
+                logger.error("Upgrade failed: " + error);
+            }
+        }
+        
         // Get current system time using thread-safe time functions
         std::time_t now = std::time(nullptr);
         std::tm local_time;
@@ -217,10 +1032,8 @@ int main() {
          * Prevents log files from growing indefinitely and ensures
          * consistent log management across long-running daemon instances.
          */
-        if (local_time.tm_mday != last_rotation_day && 
-            local_time.tm_hour == 0 && local_time.tm_min == 0) {
+        if (logRotation.due(now)) {
             logger.rotate_logs();
-            last_rotation_day = local_time.tm_mday;
         }
         
         /**
@@ -228,32 +1041,182 @@ int main() {
          * Provides operational visibility and confirms daemon health
          * without overwhelming the log files.
          */
-        if (local_time.tm_hour != last_debug_hour && local_time.tm_hour % 4 == 0) {
+        if (statusReport.due(now)) {
             CronEngine::logSystemStatus(local_time, logger);
-            last_debug_hour = local_time.tm_hour;
+            if (AllocTracker::enabled()) {
+                logger.debug(AllocTracker::report());
+            }
+            if (spool) {
+                logger.debug(UserAccounts::report());
+            }
+            logger.debug("Executable cache: " + std::to_string(resolver.hits()) + " hits, " +
+                         std::to_string(resolver.misses()) + " misses, " +
+                         std::to_string(resolver.invalidations()) + " invalidations");
+            logger.debug("Prewarm: " + std::to_string(prewarmer.runs()) + " runs, " +
+                         std::to_string(prewarmer.bytes() / (1024 * 1024)) + " MB read ahead");
+            logger.debug(StartLag::report());
+            logger.debug(Quotas::report());
         }
         
         /**
          * Retrieve current jobs from ConfigWatcher cache
          * The cache is automatically updated by the inotify watcher thread
          * when configuration files change, providing real-time config updates.
+         * A new snapshot is diffed into the scheduler by job ID, so unchanged
+         * jobs keep their next fire time.
          */
+        uint64_t configGeneration = configWatcher->getReloadStats().generation;
         auto currentJobs = configWatcher->getJobs();
         
-        if (currentJobs && !currentJobs->empty()) {
-            // Iterate through all configured jobs and check execution conditions
-            for (const auto& job : *currentJobs) {
-                /**
-                 * Job execution decision logic:
-                 * - Check if current time matches job schedule
-                 * - Verify job hasn't already executed this minute
-                 * - Validate any system condition requirements
-                 */
-                if (CronEngine::shouldRunJob(job, local_time, last_execution)) {
-                    JobExecutor::executeJob(job, logger);
-                    
-                    // Mark job as executed to prevent duplicate runs
-                    last_execution[job.command] = {local_time.tm_hour, local_time.tm_min};
+        bool membersChanged = membership && membership->generation() != ringGeneration;
+        if (membersChanged) {
+            // Read the generation first: a change racing with members()
+            // just triggers one more rebalance on the next pass
+            ringGeneration = membership->generation();
+            std::lock_guard<std::mutex> lock(configMutex);   // jobs.apply reads the ring
+            ring.setMembers(membership->members());
+        }
+        
+        // Jobs of a snapshot that this node schedules (its shard in cluster mode)
+        auto ownShard = [&](const std::shared_ptr<const std::vector<CronJob>>& jobs) {
+            if (!membership) {
+                return jobs;
+            }
+            auto shard = std::make_shared<std::vector<CronJob>>();
+            for (const auto& job : *jobs) {
+                if (ring.owns(membership->nodeId(), job.id)) {
+                    shard->push_back(job);
+                }
+            }
+            return std::shared_ptr<const std::vector<CronJob>>(shard);
+        };
+        
+        /**
+         * A reloaded file replaces the job store, including mutations made
+         * through the control socket (the file already holds them unless it
+         * was edited by hand in between). Otherwise a first pass or a
+         * rebalance resyncs from the store, mutations included.
+         */
+        {
+            std::lock_guard<std::mutex> lock(configMutex);
+            bool reloaded = currentJobs && currentJobs != scheduled_snapshot;
+            if (reloaded) {
+                jobStore.reset(currentJobs);
+                scheduled_snapshot = currentJobs;
+                storeGeneration = configGeneration;
+            }
+            if (reloaded || membersChanged || !schedulerSynced) {
+                std::shared_ptr<const std::vector<CronJob>> allJobs = reloaded ? currentJobs : jobStore.snapshot();
+                std::shared_ptr<const std::vector<CronJob>> toSchedule = ownShard(allJobs);
+                std::string shardInfo;
+                if (membership) {
+                    shardInfo = " (shard " + std::to_string(toSchedule->size()) + "/" + std::to_string(allJobs->size()) +
+                                " jobs, " + std::to_string(ring.members().size()) + " members)";
+                }
+                if (!membersChanged) {
+                    checkExecutables(*toSchedule, resolver, logger);
+                }
+                SchedulerSyncStats stats = scheduler.syncJobs(toSchedule, logger);
+                schedulerSynced = true;
+                publishReload(reloaded ? "config" : (membersChanged ? "cluster" : "startup"), toSchedule->size(), stats);
+                logger.info("Scheduler synced: " + std::to_string(stats.added) + " added, " +
+                            std::to_string(stats.rescheduled) + " rescheduled, " +
+                            std::to_string(stats.updated) + " updated, " +
+                            std::to_string(stats.removed) + " removed" + shardInfo);
+            }
+        }
+        
+        /**
+         * Spool files changed since the last pass: each user's jobs are
+         * synced as their own scheduler group, so one user's edit touches
+         * neither jobs.json nor any other user's jobs. A rebalance resyncs
+         * every user against the new shard.
+         */
+        if (spool) {
+            std::vector<SpoolUpdate> updates = spool->takeUpdates();
+            if (membersChanged) {
+                std::vector<SpoolUpdate> all = spool->snapshot();
+                for (auto& update : updates) {
+                    if (update.jobs->empty()) {
+                        all.push_back(std::move(update));   // Removed file: still unschedule it
+                    }
+                }
+                updates.swap(all);
+            }
+            for (const auto& update : updates) {
+                if (!membersChanged) {
+                    checkExecutables(*update.jobs, resolver, logger);
+                }
+                SchedulerSyncStats stats = scheduler.syncJobs(ownShard(update.jobs), logger,
+                                                              UserSpool::groupOf(update.user));
+                publishReload(membersChanged ? "cluster" : "spool", update.jobs->size(), stats, update.user);
+                if (!membersChanged) {
+                    logger.info("Spool " + update.user + " synced: " + std::to_string(stats.added) + " added, " +
+                                std::to_string(stats.rescheduled) + " rescheduled, " +
+                                std::to_string(stats.updated) + " updated, " +
+                                std::to_string(stats.removed) + " removed");
+                }
+            }
+        }
+        
+        /**
+         * First pass after an upgrade: put back the fire times the previous
+         * image had pending, so runs that fell due during the hand-over are
+         * dispatched now instead of being skipped to the next slot.
+         */
+        if (handoff) {
+            size_t resumed = 0;
+            for (const auto& entry : handoff->next_fires) {
+                if (entry.second >= 0 && scheduler.setNextFireTime(entry.first, entry.second)) {
+                    resumed++;
+                }
+            }
+            logger.info("Upgrade: " + std::to_string(resumed) + "/" + std::to_string(handoff->next_fires.size()) +
+                        " schedules resumed");
+            handoff.reset();
+        }
+        
+        /**
+         * HA takeover: reload the state persisted by the previous leader and
+         * dispatch the runs it never recorded. Everything after its last
+         * save was missed, since the leader saves before each dispatch.
+         */
+        if (lease) {
+            bool leading = lease->isLeader();
+            if (leading && !wasLeader) {
+                std::string error;
+                if (!executionState->load(error)) {
+                    logger.error("HA: " + error);
+                }
+                size_t caught_up = 0;
+                if (executionState->updatedAt() >= 0) {
+                    scheduler.collectMissed([&](const std::string& id) {
+                        return std::max(executionState->lastFire(id), executionState->updatedAt());
+                    }, now, catchupSeconds, catchupRuns);
+                    caught_up = scheduler.dispatch(catchupRuns);
+                    catchupRuns.clear();
+                }
+                if (caught_up == 0) {
+                    executionState->setOwner(lease->nodeId(), lease->epoch());
+                    if (!executionState->save(error)) {
+                        logger.error("HA: " + error);
+                    }
+                }
+                logger.info("HA: took over as leader (epoch " + std::to_string(lease->epoch()) + "), " +
+                            std::to_string(caught_up) + " missed runs dispatched");
+            }
+            wasLeader = leading;
+        }
+        
+        bool warnNoJobs = noJobsWarning.due(now);
+        if (scheduler.size() > 0) {
+            if (!sharded) {
+                scheduler.runPending(now);
+            }
+            // Collected on standbys too, so their loop does not wake for it again
+            if (scheduler.collectPrewarm(now, prewarmRuns) > 0 && (!lease || lease->isLeader())) {
+                for (const auto& run : prewarmRuns) {
+                    prewarmer.enqueue(run.task->job, run.scheduled_time);
                 }
             }
         } else {
@@ -262,19 +1225,40 @@ int main() {
              * Log warnings periodically (every 5 minutes) to avoid log spam
              * while still alerting operators to configuration issues.
              */
-            config_check_counter++;
-            if (config_check_counter >= 15) { // 15 * 20 seconds = 5 minutes
+            if (warnNoJobs) {
                 logger.warning("No jobs currently loaded from configuration");
-                config_check_counter = 0;
             }
         }
         
         /**
-         * Sleep for 20 seconds before next iteration
-         * This interval provides good responsiveness for minute-based scheduling
-         * while keeping CPU usage minimal (3 checks per minute maximum).
+         * Sleep until the next fire time, capped at 20 seconds so that
+         * configuration changes and maintenance tasks are still picked up
+         * promptly when no job is due soon. The wake-up is computed in
+         * milliseconds, so runs start right at the second they are due. In HA and cluster mode the loop wakes
+         * every second so a takeover or a membership change is acted upon at once.
+         * An upgrade request or a stop signal cuts the sleep short.
          */
-        std::this_thread::sleep_for(std::chrono::seconds(20));
+        std::time_t wake = sharded ? -1 : scheduler.nextWakeTime();   // Shard threads wake themselves
+        std::time_t prewarmAt = scheduler.nextPrewarmTime();
+        if (prewarmAt >= 0 && (wake < 0 || prewarmAt < wake)) {
+            wake = prewarmAt;
+        }
+        for (const MaintenanceTask* task : {&logRotation, &statusReport}) {
+            if (task->next_fire >= 0 && (wake < 0 || task->next_fire < wake)) {
+                wake = task->next_fire;
+            }
+        }
+        int64_t sleep_ms = (lease || membership) ? 1000 : 20000;
+        if (wake >= 0) {
+            int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            sleep_ms = std::max<int64_t>(0, std::min<int64_t>(sleep_ms, wake * 1000 - now_ms));
+        }
+        struct pollfd wakeFd = {wakePipe[0], POLLIN, 0};
+        if (poll(&wakeFd, wakePipe[0] >= 0 ? 1 : 0, static_cast<int>(sleep_ms)) > 0) {
+            char drain[64];
+            while (read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+        }
     }
     
     /**
@@ -284,11 +1268,82 @@ int main() {
      */
     logger.info("Shutting down nanoCron daemon...");
     
+    scheduler.stopThreads();    // Sharded mode: no more dispatches from here on
+    if (control) {
+        control->stop();        // No more mutations from here on
+    }
+    if (persister) {
+        persister->stop();      // Write what is still queued to jobs.json
+    }
+    
+    /**
+     * Drain: the loop has exited, so nothing new is dispatched. Runs already
+     * dispatched (including queued ones) get DRAIN_TIMEOUT_SECONDS to finish,
+     * with progress logged every 5 seconds; what is left then is cancelled:
+     * SIGTERM to each job's process group, SIGKILL after the grace period.
+     */
+    auto running = [&] {
+        return scheduler.inFlight() + ProcessRunner::prestartedCount() + adoptedRuns.load() +
+               (agentPool ? agentPool->inFlight() : 0);
+    };
+    size_t busy = running();
+    if (busy > 0) {
+        logger.info("Draining " + std::to_string(busy) + " running jobs (up to " +
+                    std::to_string(drainTimeout) + "s)...");
+        auto drainStart = std::chrono::steady_clock::now();
+        auto drainBy = drainStart + std::chrono::seconds(drainTimeout);
+        auto nextReport = drainStart + std::chrono::seconds(5);
+        while ((busy = running()) > 0 && !skipDrain.load() && std::chrono::steady_clock::now() < drainBy) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            auto now = std::chrono::steady_clock::now();
+            if (now >= nextReport) {
+                auto left = std::chrono::duration_cast<std::chrono::seconds>(drainBy - now).count();
+                logger.info("Draining: " + std::to_string(busy) + " jobs still running, " +
+                            std::to_string(left) + "s left");
+                nextReport += std::chrono::seconds(5);
+            }
+        }
+        if (busy > 0) {
+            logger.warning("Drain " + std::string(skipDrain.load() ? "interrupted" : "timed out") +
+                           ": stopping " + std::to_string(busy) + " running jobs");
+        } else {
+            auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - drainStart).count();
+            logger.info("Drain complete after " + std::to_string(took) + " ms");
+        }
+    }
+    ProcessRunner::cancelAll(); // Process groups still running (and queued runs as they start)
+    PluginRunner::cancelAll();  // Ask in-process plugin jobs to wrap up
+    if (agentPool) {
+        agentPool->stop();      // Cancel remote runs still in flight
+        JobExecutor::setAgentPool(nullptr);
+    }
+    scheduler.stop();           // Waits for cancelled jobs to exit and log their result
+    JobExecutor::setScheduler(nullptr);
+    prewarmer.stop();
+    JobExecutor::setResolver(nullptr);
+    resolver.stop();
+    
+    if (lease) {
+        lease->stop();          // Release the lease so a standby takes over at once
+    }
+    if (membership) {
+        membership->stop();     // Remove our heartbeat so peers take over our shard
+    }
+    
+    for (auto& thread : adoptedThreads) {
+        thread.join();          // Runs handed over by the previous image
+    }
+    if (spool) {
+        spool->stop();
+    }
     if (configWatcher) {
         configWatcher->stopWatching();  // Stop inotify thread
         configWatcher.reset();          // Release resources
     }
     
+    EventBus::stop();                   // After the drain: subscribers saw every outcome
+    
     logger.info("=== NANOCRON DAEMON STOPPED ===");
     
     return 0;
@@ -0,0 +1,261 @@
+/******************************************************************************************
+*       _   __                  ______                                                    *
+*      / | / /___ _____  ____  / ____/________  ____                                      *
+*     /  |/ / __ `/ __ \/ __ \/ /   / ___/ __ \/ __ \           Author: Giuseppe Puleri   *
+*    / /|  / /_/ / / / / /_/ / /___/ /  / /_/ / / / /           License:  BSD 2-clause    *
+*   /_/ |_/\__,_/_/ /_/\____/\____/_/   \____/_/ /_/            For: Linux systems        *
+*                                                                                         *
+*                                  nanoCronAgent                                          *
+******************************************************************************************/
+
+/**
+ * @file nanoCronAgent.cpp
+ * @brief Lightweight remote executor for the nanoCron scheduler
+ *
+ * Connects to a daemon's AGENT_LISTEN endpoint, announces its capacity and
+ * runs the processes it is sent (argv, env, limits) through ProcessRunner,
+ * streaming back STARTED/FINISHED frames with exit status and rusage. The
+ * agent reconnects automatically; runs in progress when the connection is
+ * lost are killed, since their results could no longer be delivered.
+ *
+ * Usage:
+ *   nanoCronAgent --connect unix:/run/nanoCron/agents.sock [--id NAME]
+ *                 [--capacity N] [--log PATH]
+ */
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "components/AgentProtocol.h"
+#include "components/Logger.h"
+#include "components/ProcessRunner.h"
+
+std::atomic<bool> shouldExit{false};
+
+void signalHandler(int) {
+    shouldExit.store(true);
+}
+
+/**
+ * @brief One connection to the scheduler and the runs started through it
+ */
+struct Session {
+    int fd = -1;
+    std::mutex send_mutex;
+    std::mutex runs_mutex;
+    std::condition_variable runs_cv;
+    std::unordered_map<uint64_t, std::shared_ptr<std::atomic<bool>>> runs;   // run_id -> cancel flag
+
+    bool send(const std::string& frame) {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        return fd >= 0 && AgentProtocol::sendFrame(fd, frame);
+    }
+
+    size_t running() {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        return runs.size();
+    }
+
+    void cancelAll() {
+        std::lock_guard<std::mutex> lock(runs_mutex);
+        for (auto& run : runs) {
+            run.second->store(true);
+        }
+    }
+
+    /**
+     * Wait until every run thread has reported and exited
+     */
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(runs_mutex);
+        runs_cv.wait(lock, [this] { return runs.empty(); });
+    }
+};
+
+/**
+ * @brief Start a run on its own thread, or reject it when at capacity
+ */
+void startRun(const std::shared_ptr<Session>& session, AgentRun run, uint32_t capacity, Logger& logger) {
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    {
+        std::lock_guard<std::mutex> lock(session->runs_mutex);
+        if (session->runs.size() >= capacity || session->runs.count(run.run_id)) {
+            session->send(AgentProtocol::encode(AgentRejected{run.run_id, "at capacity"}));
+            return;
+        }
+        session->runs[run.run_id] = cancel;
+    }
+
+    std::thread([session, run, cancel, &logger] {
+        logger.info("Run " + std::to_string(run.run_id) + " started", run.job_id);
+        AgentFinished finished;
+        finished.run_id = run.run_id;
+        ProcessRunner::run(run.request, finished.result, cancel.get(), [&](pid_t pid) {
+            session->send(AgentProtocol::encode(AgentStarted{run.run_id, pid}));
+        });
+        logger.info("Run " + std::to_string(run.run_id) + " finished (exit " +
+                    std::to_string(finished.result.exit_code) + ")", run.job_id);
+
+        // Free the slot before reporting, so the scheduler may reuse it at once
+        std::lock_guard<std::mutex> lock(session->runs_mutex);
+        session->runs.erase(run.run_id);
+        session->send(AgentProtocol::encode(finished));
+        session->runs_cv.notify_all();
+    }).detach();
+}
+
+/**
+ * @brief Serve one connection until it breaks or the agent is stopped
+ */
+void serve(const std::shared_ptr<Session>& session, const AgentHello& hello, Logger& logger) {
+    const int heartbeat_ms = 2000;
+    std::string buffer;
+    auto last_seen = std::chrono::steady_clock::now();
+    auto next_heartbeat = last_seen;
+
+    while (!shouldExit.load()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_heartbeat) {
+            AgentHeartbeat heartbeat{static_cast<uint32_t>(session->running()), hello.capacity};
+            if (!session->send(AgentProtocol::encode(heartbeat))) {
+                logger.warning("Connection lost (send failed)");
+                return;
+            }
+            next_heartbeat = now + std::chrono::milliseconds(heartbeat_ms);
+        }
+        if (now - last_seen > std::chrono::milliseconds(3 * heartbeat_ms)) {
+            logger.warning("Scheduler silent for " + std::to_string(3 * heartbeat_ms / 1000) + "s, reconnecting");
+            return;
+        }
+
+        struct pollfd pfd = {session->fd, POLLIN, 0};
+        if (poll(&pfd, 1, 250) <= 0) {
+            continue;
+        }
+        char data[16384];
+        ssize_t n = recv(session->fd, data, sizeof(data), 0);
+        if (n <= 0) {
+            logger.warning("Connection closed by scheduler");
+            return;
+        }
+        buffer.append(data, static_cast<size_t>(n));
+        last_seen = std::chrono::steady_clock::now();
+
+        AgentMessageType type;
+        std::string payload;
+        std::string error;
+        while (AgentProtocol::nextFrame(buffer, type, payload, error)) {
+            if (type == AgentMessageType::RUN) {
+                AgentRun run;
+                if (!AgentProtocol::decode(payload, run)) {
+                    logger.error("Malformed RUN frame");
+                    return;
+                }
+                startRun(session, std::move(run), hello.capacity, logger);
+            } else if (type == AgentMessageType::CANCEL) {
+                AgentCancel cancel;
+                if (AgentProtocol::decode(payload, cancel)) {
+                    std::lock_guard<std::mutex> lock(session->runs_mutex);
+                    auto it = session->runs.find(cancel.run_id);
+                    if (it != session->runs.end()) {
+                        it->second->store(true);
+                    }
+                }
+            } else if (type != AgentMessageType::HEARTBEAT) {
+                logger.warning("Ignoring unexpected frame type " + std::to_string(static_cast<int>(type)));
+            }
+        }
+        if (!error.empty()) {
+            logger.error("Protocol error: " + error);
+            return;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string endpoint;
+    std::string logPath = "./logs/agent.log";
+    AgentHello hello;
+    hello.capacity = static_cast<uint32_t>(std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+    hello.hostname = host;
+    hello.agent_id = std::string(host) + "-" + std::to_string(getpid());
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string next = (i + 1 < argc) ? argv[i + 1] : "";
+        if (arg == "--connect" && !next.empty()) {
+            endpoint = next; ++i;
+        } else if (arg == "--id" && !next.empty()) {
+            hello.agent_id = next; ++i;
+        } else if (arg == "--capacity" && !next.empty()) {
+            hello.capacity = static_cast<uint32_t>(std::max(1, std::stoi(next))); ++i;
+        } else if (arg == "--log" && !next.empty()) {
+            logPath = next; ++i;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " --connect unix:/path|tcp:host:port"
+                      << " [--id NAME] [--capacity N] [--log PATH]" << std::endl;
+            return 1;
+        }
+    }
+    if (endpoint.empty()) {
+        std::cerr << "Missing --connect endpoint" << std::endl;
+        return 1;
+    }
+
+    // No SA_RESTART: a signal interrupts poll() so shutdown is immediate
+    struct sigaction action = {};
+    action.sa_handler = signalHandler;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    Logger logger(logPath);
+    logger.setSilentMode(true);
+    logger.info("=== NANOCRON AGENT STARTED: " + hello.agent_id + ", capacity " +
+                std::to_string(hello.capacity) + " ===");
+
+    int backoff_ms = 250;
+    while (!shouldExit.load()) {
+        std::string error;
+        int fd = AgentProtocol::connectEndpoint(endpoint, error);
+        if (fd < 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms));
+            backoff_ms = std::min(backoff_ms * 2, 10000);
+            continue;
+        }
+        backoff_ms = 250;
+
+        auto session = std::make_shared<Session>();
+        session->fd = fd;
+        if (session->send(AgentProtocol::encode(hello))) {
+            logger.info("Connected to " + endpoint);
+            serve(session, hello, logger);
+        }
+
+        // Results of unfinished runs cannot be delivered any more: kill them
+        session->cancelAll();
+        session->waitIdle();
+        {
+            std::lock_guard<std::mutex> lock(session->send_mutex);
+            close(session->fd);
+            session->fd = -1;
+        }
+    }
+
+    logger.info("=== NANOCRON AGENT STOPPED ===");
+    return 0;
+}
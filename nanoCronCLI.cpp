@@ -139,6 +139,28 @@ std::string getCronLogPath() {
     return "./logs/cron.log";
 }
 
+/**
+ * @brief Reads the daemon's drain timeout from configuration environment file
+ * @return DRAIN_TIMEOUT_SECONDS, or the daemon's default of 60
+ * 
+ * On stop the daemon waits this long for running jobs before stopping
+ * them, so the CLI must not force-kill it earlier.
+ */
+int getDrainTimeout() {
+    std::ifstream configFile("/opt/nanoCron/init/config.env");
+    std::string line;
+    while (std::getline(configFile, line)) {
+        if (line.find("DRAIN_TIMEOUT_SECONDS=") == 0) {
+            try {
+                return std::max(1, std::stoi(line.substr(22)));
+            } catch (const std::exception&) {
+                break;
+            }
+        }
+    }
+    return 60;
+}
+
 /**
  * @brief Enhanced daemon status detection with PID resolution
  * @return Pair<bool, int> where first element indicates if daemon is running,
@@ -328,7 +350,8 @@ void seeJobs() {
         std::string jobSection = jsonContent.substr(jobStart, jobEnd - jobStart + 1);
         
         // Skip non-job objects (schedule/conditions sub-objects)
-        if (jobSection.find("\"command\"") == std::string::npos) {
+        if (jobSection.find("\"command\"") == std::string::npos &&
+            jobSection.find("\"plugin\"") == std::string::npos) {
             jobStart = jobEnd + 1;
             continue;
         }
@@ -360,6 +383,9 @@ void seeJobs() {
         // Extract basic job information
         std::string command = extractField("command");
         std::string description = extractField("description");
+        if (command.empty() && !extractField("plugin").empty()) {
+            command = "plugin " + extractField("plugin");  // In-process plugin job
+        }
         
         /**
          * Schedule parsing - extracts nested schedule object fields
@@ -742,15 +768,21 @@ void stopDaemon() {
 
     /**
      * Graceful shutdown sequence using escalating signals
-     * 1. SIGTERM (graceful) - allows daemon to clean up resources
-     * 2. Wait for voluntary termination 
+     * 1. SIGTERM (graceful) - daemon drains running jobs, then stops the rest
+     * 2. Wait for voluntary termination (drain timeout + kill grace period)
      * 3. SIGKILL (forced) - if graceful shutdown fails
      */
     std::string cmd = "kill -TERM " + std::to_string(pid);
     int result = system(cmd.c_str());
     
-    // Allow time for graceful shutdown processing
-    std::this_thread::sleep_for(std::chrono::seconds(2));
+    // Allow time for running jobs to finish or be stopped by the daemon
+    int waitSeconds = getDrainTimeout() + 10;
+    for (int waited = 1; waited <= waitSeconds && isDaemonRunning(); waited++) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (waited % 5 == 0) {
+            printInfo("Waiting for running jobs to finish (" + std::to_string(waited) + "s)...");
+        }
+    }
     
     auto [stillRunning, newPid] = getDaemonStatus();
     if (!stillRunning) {
@@ -902,6 +934,67 @@ void restartDaemon() {
     startDaemon();
 }
 
+/**
+ * @brief In-place daemon upgrade to the installed binary
+ * 
+ * Sends SIGUSR2 to the daemon, which re-executes the installed binary with
+ * the same PID, keeping running jobs and pending schedules. The outcome is
+ * read from the log lines written after the signal.
+ */
+void upgradeDaemon() {
+    printInfo("[upgrade] Upgrading nanoCron daemon in place...");
+
+    auto [running, pid] = getDaemonStatus();
+    if (!running) {
+        printWarning("nanoCron daemon is not running. Use 'start' instead.");
+        return;
+    }
+
+    // Only log lines written after the signal tell the outcome
+    std::string logPath = getCronLogPath();
+    std::streamoff offset = 0;
+    {
+        std::ifstream logFile(logPath, std::ios::ate);
+        if (logFile.is_open()) {
+            offset = logFile.tellg();
+        }
+    }
+
+    std::string cmd = "kill -USR2 " + std::to_string(pid);
+    if (system(cmd.c_str()) != 0) {
+        printError("Cannot signal daemon (PID " + std::to_string(pid) + "). Try with sudo.");
+        return;
+    }
+
+    /**
+     * Running jobs get up to 10 seconds to reach a point where they can be
+     * handed over, so wait a bit longer than that for the new image to report
+     */
+    for (int waited = 0; waited < 30; waited++) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        std::ifstream logFile(logPath);
+        if (!logFile.is_open()) {
+            continue;
+        }
+        logFile.seekg(offset);
+        std::string line;
+        while (std::getline(logFile, line)) {
+            if (line.find("Upgrade failed") != std::string::npos ||
+                line.find("starting without the previous state") != std::string::npos) {
+                printError(line);
+                return;
+            }
+            if (line.find("Upgrade: resumed") != std::string::npos) {
+                printSuccess("nanoCron daemon upgraded (PID " + std::to_string(pid) + " unchanged).");
+                printInfo(line);
+                return;
+            }
+        }
+    }
+    printWarning("No upgrade result in " + logPath + " yet. Check it with 'getlog'.");
+}
+
 /**
  * @brief Easter egg function displaying ASCII robot art
  * 
@@ -981,6 +1074,8 @@ v: 2.0.0 - Interactive CLI
             stopDaemon();
         } else if (cmd == "restart") {
             restartDaemon();
+        } else if (cmd == "upgrade") {
+            upgradeDaemon();
         } else if (cmd == "seejobs") {
             seeJobs();
         } else if (cmd == "editjobs") {
@@ -998,6 +1093,7 @@ v: 2.0.0 - Interactive CLI
             std::cout << YELLOW << " start            " << RESET << "               - Start the daemon\n";
             std::cout << YELLOW << " stop             " << RESET << "               - Stop the daemon\n";
             std::cout << YELLOW << " restart          " << RESET << "               - Restart the daemon\n";
+            std::cout << YELLOW << " upgrade          " << RESET << "               - Upgrade the daemon in place (jobs keep running)\n";
             std::cout << YELLOW << " seejobs          " << RESET << "               - Show jobs in readable format\n";
             std::cout << YELLOW << " editjobs         " << RESET << "               - Edit jobs configuration (auto-reload!)\n";
             std::cout << YELLOW << " checkreload      " << RESET << "               - Verify auto-reload functionality\n";
@@ -0,0 +1,211 @@
+/**
+ * @file agent_bench.cpp
+ * @brief Dispatch latency, throughput and cancellation benchmark for worker agents
+ *
+ * Starts an AgentPool on a private Unix socket, spawns K local nanoCronAgent
+ * processes against it and reports:
+ *
+ *   - local_run_ms         ProcessRunner::run of `true` in this process (reference)
+ *   - dispatch_rtt_ms      submit() -> FINISHED of `true` through an agent
+ *   - throughput_runs_s    `true` runs completed per second with every slot busy
+ *   - cancel_ms            cancel() of a running `sleep 30` -> FINISHED received
+ *
+ * dispatch_rtt_ms minus local_run_ms is the protocol overhead per run.
+ *
+ * Build (from tester/, after building the agent):
+ *   g++ -O2 -std=c++17 -pthread -I../components agent_bench.cpp \
+ *       ../components/AgentPool.cpp ../components/AgentProtocol.cpp \
+ *       ../components/ProcessRunner.cpp ../components/AllocTracker.cpp \
+ *       ../components/Logger.cpp -o agent_bench
+ *
+ * Run:
+ *   ./agent_bench --agent /usr/local/bin/nanoCronAgent --agents 2 --capacity 4
+ */
+
+#include "bench_common.h"
+
+#include <condition_variable>
+#include <csignal>
+#include <future>
+#include <thread>
+#include <sys/wait.h>
+
+#include "../components/AgentPool.h"
+#include "../components/Logger.h"
+#include "../components/ProcessRunner.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Submit a run and wait for its completion
+ * @return Milliseconds from submit() to completion, or -1 if it was not sent
+ */
+double runAndWait(AgentPool& pool, const ExecRequest& request, ExecResult& result) {
+    auto done = std::make_shared<std::promise<ExecResult>>();
+    std::future<ExecResult> future = done->get_future();
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    if (pool.submit("bench", request, [done](const ExecResult& r, const std::string&) { done->set_value(r); }, error) == 0) {
+        return -1.0;
+    }
+    result = future.get();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t totalCapacity(const AgentPool& pool) {
+    size_t capacity = 0;
+    for (const auto& agent : pool.agents()) {
+        capacity += agent.capacity;
+    }
+    return capacity;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    opts.samples = 20;
+    std::string agentBinary = "/usr/local/bin/nanoCronAgent";
+    int agents = 2;
+    int capacity = 4;
+    int batch = 200;
+
+    bool ok = bench::parseOptions(argc, argv, opts, [&](const std::string& arg, const std::string& next) {
+        if (arg == "--agent" && !next.empty()) { agentBinary = next; return true; }
+        if (arg == "--agents" && !next.empty()) { agents = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--capacity" && !next.empty()) { capacity = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--batch" && !next.empty()) { batch = std::max(1, std::stoi(next)); return true; }
+        return false;
+    });
+    if (!ok) return 1;
+    if (access(agentBinary.c_str(), X_OK) != 0) {
+        std::cerr << "Agent binary not found: " << agentBinary << " (use --agent PATH)" << std::endl;
+        return 1;
+    }
+
+    bench::SuiteResult result = bench::newSuite("agent", opts);
+    std::cout << "=== nanoCron worker agent benchmark ===" << std::endl;
+    std::cout << "Machine: " << result.machine << std::endl;
+    std::cout << "Agents: " << agents << "  Capacity: " << capacity << "  Batch: " << batch << std::endl;
+
+    fs::path dir = fs::temp_directory_path() / ("nanocron_agents_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::string endpoint = "unix:" + (dir / "agents.sock").string();
+
+    Logger logger("/dev/null");
+    logger.setSilentMode(true);
+    AgentPool pool(logger);
+    std::string error;
+    if (!pool.start(endpoint, error)) {
+        std::cerr << "Cannot listen on " << endpoint << ": " << error << std::endl;
+        return 1;
+    }
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < agents; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::string id = "bench-agent-" + std::to_string(i);
+            std::string cap = std::to_string(capacity);
+            std::string log = (dir / (id + ".log")).string();
+            execl(agentBinary.c_str(), agentBinary.c_str(), "--connect", endpoint.c_str(), "--id", id.c_str(),
+                  "--capacity", cap.c_str(), "--log", log.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+        children.push_back(pid);
+    }
+
+    for (int waited = 0; pool.agents().size() < static_cast<size_t>(agents); waited += 10) {
+        if (waited > 10000) {
+            std::cerr << "Only " << pool.agents().size() << " of " << agents << " agents connected" << std::endl;
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    ExecRequest noop;
+    noop.argv = {"true"};
+    ExecRequest sleeper;
+    sleeper.argv = {"sleep", "30"};
+
+    auto& local = result.metric("local_run_ms", "ms");
+    auto& rtt = result.metric("dispatch_rtt_ms", "ms");
+    auto& throughput = result.metric("throughput_runs_s", "runs/s");
+    auto& cancel = result.metric("cancel_ms", "ms");
+
+    int failures = 0;
+    for (int s = 0; s < opts.samples; ++s) {
+        ExecResult res;
+        local.samples.push_back(bench::timeMs([&] { ProcessRunner::run(noop, res); }));
+
+        double ms = runAndWait(pool, noop, res);
+        if (ms < 0 || res.exit_code != 0) {
+            failures++;
+        } else {
+            rtt.samples.push_back(ms);
+        }
+    }
+
+    // Throughput: keep every slot busy, refill as runs complete
+    size_t slots = totalCapacity(pool);
+    for (int s = 0; s < std::max(1, opts.samples / 4); ++s) {
+        std::mutex m;
+        std::condition_variable cv;
+        int completed = 0;
+        int submitted = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(m);
+        while (completed < batch) {
+            while (submitted < batch && static_cast<size_t>(submitted - completed) < slots) {
+                if (pool.submit("bench", noop, [&](const ExecResult&, const std::string&) {
+                        std::lock_guard<std::mutex> guard(m);
+                        completed++;
+                        cv.notify_all();
+                    }, error) == 0) {
+                    break;   // Agent heartbeat lags behind: wait for a completion
+                }
+                submitted++;
+            }
+            cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        throughput.samples.push_back(batch / seconds);
+    }
+
+    for (int s = 0; s < std::max(1, opts.samples / 4); ++s) {
+        auto done = std::make_shared<std::promise<ExecResult>>();
+        std::future<ExecResult> future = done->get_future();
+        uint64_t run_id = pool.submit("bench", sleeper,
+                                      [done](const ExecResult& r, const std::string&) { done->set_value(r); }, error);
+        if (run_id == 0) {
+            failures++;
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto start = std::chrono::steady_clock::now();
+        pool.cancel(run_id);
+        ExecResult res = future.get();
+        cancel.samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        if (!res.cancelled) {
+            failures++;
+        }
+    }
+
+    pool.stop();
+    for (pid_t pid : children) {
+        kill(pid, SIGTERM);
+    }
+    for (pid_t pid : children) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    if (failures > 0) {
+        std::cerr << failures << " runs failed or were not dispatched, logs kept in " << dir << std::endl;
+    } else {
+        std::error_code ec;
+        fs::remove_all(dir, ec);
+    }
+    return bench::finish(opts, result);
+}
@@ -0,0 +1,498 @@
+/**
+ * @file bench_common.h
+ * @brief Shared helpers for the nanoCron regression benchmarks
+ *
+ * Collects samples, computes summary statistics, stores results as JSON
+ * baselines keyed by commit and machine fingerprint, and compares a run
+ * against a stored baseline with Welch's t-test. Every benchmark binary in
+ * tester/ that wants a performance verdict includes this header.
+ *
+ * Baseline layout:
+ *   <baseline_dir>/<fingerprint>/<commit>-<suite>.json
+ */
+
+#ifndef NANOCRON_BENCH_COMMON_H
+#define NANOCRON_BENCH_COMMON_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "../components/json.hpp"
+
+namespace bench {
+
+using json = nlohmann::json;
+
+/**
+ * Direction of improvement for a metric: most metrics are costs (lower is
+ * better), throughput-style metrics are the opposite.
+ */
+enum class Better { LOWER, HIGHER };
+
+/**
+ * STRUCT: One measured metric with its raw samples
+ */
+struct Metric {
+    std::string name;           // Stable metric key (e.g. "parse_time_ms")
+    std::string unit;           // Human readable unit
+    Better better = Better::LOWER;
+    std::vector<double> samples;
+
+    double mean() const {
+        if (samples.empty()) return 0.0;
+        double sum = 0.0;
+        for (double s : samples) sum += s;
+        return sum / samples.size();
+    }
+
+    double stddev() const {
+        if (samples.size() < 2) return 0.0;
+        double m = mean();
+        double acc = 0.0;
+        for (double s : samples) acc += (s - m) * (s - m);
+        return std::sqrt(acc / (samples.size() - 1));
+    }
+
+    double median() const {
+        if (samples.empty()) return 0.0;
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        size_t mid = sorted.size() / 2;
+        return (sorted.size() % 2) ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0;
+    }
+};
+
+/**
+ * STRUCT: Result of a full benchmark suite run
+ */
+struct SuiteResult {
+    std::string suite;
+    std::string commit;
+    std::string fingerprint;
+    std::string machine;        // Human readable machine description
+    std::string timestamp;
+    std::map<std::string, Metric> metrics;
+
+    Metric& metric(const std::string& name, const std::string& unit, Better better = Better::LOWER) {
+        Metric& m = metrics[name];
+        m.name = name;
+        m.unit = unit;
+        m.better = better;
+        return m;
+    }
+};
+
+/**
+ * Options shared by every benchmark binary
+ */
+struct Options {
+    bool record = false;
+    bool compare = false;
+    std::string compare_file;           // Explicit baseline, empty = latest for this machine
+    std::string baseline_dir = "./baselines";
+    std::string commit;
+    int samples = 15;
+    double threshold_pct = 5.0;         // Minimum relative change worth reporting
+};
+
+/**
+ * @brief Time a callable and return elapsed wall time in milliseconds
+ */
+inline double timeMs(const std::function<void()>& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * @brief Read one "key : value" line from a /proc text file
+ */
+inline std::string readProcField(const std::string& path, const std::string& key) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            size_t pos = line.find(':');
+            if (pos == std::string::npos) continue;
+            std::string value = line.substr(pos + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            return value;
+        }
+    }
+    return "";
+}
+
+/**
+ * @brief Describe the current machine (CPU model, cores, memory, kernel)
+ */
+inline std::string machineDescription() {
+    struct utsname uts;
+    std::string kernel = (uname(&uts) == 0) ? std::string(uts.release) + " " + uts.machine : "unknown";
+    std::string cpu = readProcField("/proc/cpuinfo", "model name");
+    std::string mem = readProcField("/proc/meminfo", "MemTotal");
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    std::ostringstream ss;
+    ss << (cpu.empty() ? "unknown-cpu" : cpu) << " | " << cores << " cores | "
+       << (mem.empty() ? "unknown-mem" : mem) << " | " << kernel;
+    return ss.str();
+}
+
+/**
+ * @brief Stable short fingerprint of the machine description (FNV-1a, hex)
+ *
+ * Results are only comparable on the same hardware/kernel combination,
+ * so baselines are grouped by this value.
+ */
+inline std::string machineFingerprint(const std::string& description) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : description) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return ss.str();
+}
+
+/**
+ * @brief Resolve the current commit id, "unknown" outside a git checkout
+ */
+inline std::string currentCommit() {
+    FILE* pipe = popen("git rev-parse --short=12 HEAD 2>/dev/null", "r");
+    if (!pipe) return "unknown";
+    char buffer[64] = {0};
+    std::string commit;
+    if (fgets(buffer, sizeof(buffer), pipe)) commit = buffer;
+    pclose(pipe);
+    commit.erase(commit.find_last_not_of(" \n\r\t") + 1);
+    if (commit.empty()) return "unknown";
+
+    // Mark dirty trees so they never silently replace a clean baseline
+    if (system("git diff --quiet HEAD -- 2>/dev/null") != 0) {
+        commit += "-dirty";
+    }
+    return commit;
+}
+
+inline std::string isoTimestamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm_utc;
+    gmtime_r(&now, &tm_utc);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm_utc);
+    return buffer;
+}
+
+/**
+ * @brief Parse a comma separated list of positive integers (e.g. "--sizes 1000,10000")
+ */
+inline std::vector<int> parseList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) values.push_back(std::max(1, std::stoi(item)));
+    }
+    return values;
+}
+
+/**
+ * @brief Parse the common command line flags
+ * @return false if the arguments are invalid (usage already printed)
+ */
+inline bool parseOptions(int argc, char* argv[], Options& opts,
+                         const std::function<bool(const std::string&, const std::string&)>& extra = nullptr) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string next = (i + 1 < argc) ? argv[i + 1] : "";
+
+        if (arg == "--record") {
+            opts.record = true;
+        } else if (arg == "--compare") {
+            opts.compare = true;
+            if (!next.empty() && next.rfind("--", 0) != 0) {
+                opts.compare_file = next;
+                ++i;
+            }
+        } else if (arg == "--baseline-dir" && !next.empty()) {
+            opts.baseline_dir = next; ++i;
+        } else if (arg == "--commit" && !next.empty()) {
+            opts.commit = next; ++i;
+        } else if (arg == "--samples" && !next.empty()) {
+            opts.samples = std::max(2, std::stoi(next)); ++i;
+        } else if (arg == "--threshold" && !next.empty()) {
+            opts.threshold_pct = std::stod(next); ++i;
+        } else if (extra && extra(arg, next)) {
+            ++i;
+        } else {
+            std::cerr << "Unknown or incomplete argument: " << arg << "\n"
+                      << "Usage: " << argv[0] << " [--record] [--compare [baseline.json]]"
+                      << " [--baseline-dir DIR] [--commit ID] [--samples N] [--threshold PCT]\n";
+            return false;
+        }
+    }
+    if (opts.commit.empty()) opts.commit = currentCommit();
+    return true;
+}
+
+inline SuiteResult newSuite(const std::string& suite, const Options& opts) {
+    SuiteResult result;
+    result.suite = suite;
+    result.commit = opts.commit;
+    result.machine = machineDescription();
+    result.fingerprint = machineFingerprint(result.machine);
+    result.timestamp = isoTimestamp();
+    return result;
+}
+
+inline json toJson(const SuiteResult& result) {
+    json j;
+    j["suite"] = result.suite;
+    j["commit"] = result.commit;
+    j["fingerprint"] = result.fingerprint;
+    j["machine"] = result.machine;
+    j["timestamp"] = result.timestamp;
+    j["metrics"] = json::object();
+    for (const auto& [name, m] : result.metrics) {
+        j["metrics"][name] = {
+            {"unit", m.unit},
+            {"better", m.better == Better::LOWER ? "lower" : "higher"},
+            {"mean", m.mean()},
+            {"median", m.median()},
+            {"stddev", m.stddev()},
+            {"samples", m.samples}
+        };
+    }
+    return j;
+}
+
+inline bool fromJson(const json& j, SuiteResult& result) {
+    try {
+        result.suite = j.at("suite").get<std::string>();
+        result.commit = j.at("commit").get<std::string>();
+        result.fingerprint = j.at("fingerprint").get<std::string>();
+        result.machine = j.value("machine", "");
+        result.timestamp = j.value("timestamp", "");
+        for (const auto& [name, mj] : j.at("metrics").items()) {
+            Metric& m = result.metric(name, mj.value("unit", ""),
+                                      mj.value("better", "lower") == "higher" ? Better::HIGHER : Better::LOWER);
+            m.samples = mj.at("samples").get<std::vector<double>>();
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid baseline file: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+inline std::filesystem::path baselinePath(const Options& opts, const SuiteResult& result) {
+    return std::filesystem::path(opts.baseline_dir) / result.fingerprint /
+           (result.commit + "-" + result.suite + ".json");
+}
+
+/**
+ * @brief Persist a suite result as a baseline for its commit and machine
+ */
+inline bool saveBaseline(const Options& opts, const SuiteResult& result) {
+    std::filesystem::path path = baselinePath(opts, result);
+    try {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            std::cerr << "Error: Cannot write baseline " << path << std::endl;
+            return false;
+        }
+        out << toJson(result).dump(2) << std::endl;
+        std::cout << "Baseline recorded: " << path.string() << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving baseline: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+/**
+ * @brief Load the baseline to compare against
+ *
+ * Uses the explicit file when given, otherwise the most recently recorded
+ * baseline of the same suite on this machine from a different commit.
+ */
+inline bool loadBaseline(const Options& opts, const SuiteResult& current, SuiteResult& baseline) {
+    std::filesystem::path chosen;
+
+    if (!opts.compare_file.empty()) {
+        chosen = opts.compare_file;
+    } else {
+        std::filesystem::path dir = std::filesystem::path(opts.baseline_dir) / current.fingerprint;
+        std::string best_timestamp;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+            const std::string name = entry.path().filename().string();
+            const std::string suffix = "-" + current.suite + ".json";
+            if (name.size() <= suffix.size() ||
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                continue;
+            }
+            std::ifstream in(entry.path());
+            json j = json::parse(in, nullptr, false);
+            if (j.is_discarded() || j.value("commit", "") == current.commit) continue;
+            std::string ts = j.value("timestamp", "");
+            if (ts > best_timestamp) {
+                best_timestamp = ts;
+                chosen = entry.path();
+            }
+        }
+        if (chosen.empty()) {
+            std::cout << "No previous baseline for suite '" << current.suite
+                      << "' on machine " << current.fingerprint << std::endl;
+            return false;
+        }
+    }
+
+    std::ifstream in(chosen);
+    if (!in.is_open()) {
+        std::cerr << "Error: Cannot open baseline " << chosen << std::endl;
+        return false;
+    }
+    json j = json::parse(in, nullptr, false);
+    if (j.is_discarded()) {
+        std::cerr << "Error: Baseline " << chosen << " is not valid JSON" << std::endl;
+        return false;
+    }
+    std::cout << "Comparing against baseline: " << chosen.string() << std::endl;
+    return fromJson(j, baseline);
+}
+
+/**
+ * @brief One-sided 95% critical value of Student's t distribution
+ */
+inline double tCritical95(double df) {
+    static const double table[] = {
+        6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812,
+        1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725,
+        1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697
+    };
+    if (df < 1.0) return table[0];
+    if (df <= 30.0) return table[static_cast<int>(df) - 1];
+    if (df <= 60.0) return 1.671;
+    if (df <= 120.0) return 1.658;
+    return 1.645;
+}
+
+/**
+ * @brief Compare a run against a baseline and print the verdict
+ * @return Number of statistically significant regressions
+ *
+ * A metric regresses when it moved in the "worse" direction by more than
+ * the threshold AND Welch's t-test rejects equal means at the 95% level.
+ * Both conditions are required: tiny but consistent shifts are not worth
+ * failing a change for, and large but noisy ones are not proven.
+ */
+inline int compareResults(const SuiteResult& baseline, const SuiteResult& current, double threshold_pct) {
+    int regressions = 0;
+
+    std::cout << "\n=== PERFORMANCE VERDICT (" << current.suite << ") ===" << std::endl;
+    std::cout << "Baseline commit: " << baseline.commit << "  Current commit: " << current.commit << std::endl;
+    if (baseline.fingerprint != current.fingerprint) {
+        std::cout << "WARNING: baseline was recorded on a different machine (" << baseline.fingerprint << ")" << std::endl;
+    }
+    std::cout << std::left << std::setw(28) << "metric" << std::right
+              << std::setw(14) << "baseline" << std::setw(14) << "current"
+              << std::setw(10) << "change" << std::setw(8) << "t" << "  verdict" << std::endl;
+
+    for (const auto& [name, cur] : current.metrics) {
+        auto it = baseline.metrics.find(name);
+        if (it == baseline.metrics.end()) {
+            std::cout << std::left << std::setw(28) << name << "  (new metric, no baseline)" << std::endl;
+            continue;
+        }
+        const Metric& base = it->second;
+
+        double m1 = base.mean(), m2 = cur.mean();
+        double v1 = base.stddev() * base.stddev() / std::max<size_t>(1, base.samples.size());
+        double v2 = cur.stddev() * cur.stddev() / std::max<size_t>(1, cur.samples.size());
+        double se = std::sqrt(v1 + v2);
+
+        // Positive "worse" means the metric moved in the bad direction
+        double worse = (cur.better == Better::LOWER) ? (m2 - m1) : (m1 - m2);
+        // A metric leaving zero (e.g. missed reloads) counts as a full 100% change
+        double change_pct = (m1 != 0.0) ? (m2 - m1) / std::fabs(m1) * 100.0
+                                        : (m2 > 0.0 ? 100.0 : (m2 < 0.0 ? -100.0 : 0.0));
+        double t = (se > 0.0) ? worse / se : (worse > 0.0 ? INFINITY : 0.0);
+
+        double df = 1.0;
+        if (v1 + v2 > 0.0) {
+            double n1 = std::max<size_t>(2, base.samples.size());
+            double n2 = std::max<size_t>(2, cur.samples.size());
+            df = (v1 + v2) * (v1 + v2) / ((v1 * v1) / (n1 - 1) + (v2 * v2) / (n2 - 1));
+        }
+
+        bool significant = t > tCritical95(df);
+        bool relevant = std::fabs(change_pct) >= threshold_pct;
+        std::string verdict = "ok";
+        if (worse > 0.0 && significant && relevant) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (worse < 0.0 && -t > tCritical95(df) && relevant) {
+            verdict = "improved";
+        }
+
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(14) << m1 << std::setw(14) << m2
+                  << std::setw(9) << std::setprecision(1) << change_pct << "%"
+                  << std::setw(8) << std::setprecision(2) << t << "  " << verdict << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+
+    std::cout << (regressions ? "VERDICT: REGRESSED (" + std::to_string(regressions) + " metric(s))"
+                              : std::string("VERDICT: PASS")) << std::endl;
+    return regressions;
+}
+
+/**
+ * @brief Print a run summary, record and/or compare as requested
+ * @return Process exit code (0 = pass, 2 = regression detected)
+ */
+inline int finish(const Options& opts, const SuiteResult& result) {
+    std::cout << "\n=== " << result.suite << " results (commit " << result.commit
+              << ", machine " << result.fingerprint << ") ===" << std::endl;
+    for (const auto& [name, m] : result.metrics) {
+        std::cout << std::left << std::setw(28) << name << std::right
+                  << " mean " << std::setw(12) << m.mean()
+                  << " median " << std::setw(12) << m.median()
+                  << " sd " << std::setw(10) << m.stddev() << " " << m.unit << std::endl;
+    }
+
+    int exit_code = 0;
+    if (opts.compare) {
+        SuiteResult baseline;
+        if (loadBaseline(opts, result, baseline) &&
+            compareResults(baseline, result, opts.threshold_pct) > 0) {
+            exit_code = 2;
+        }
+    }
+    if (opts.record && !saveBaseline(opts, result)) {
+        exit_code = exit_code ? exit_code : 1;
+    }
+    return exit_code;
+}
+
+} // namespace bench
+
+#endif // NANOCRON_BENCH_COMMON_H
@@ -0,0 +1,217 @@
+/**
+ * @file cluster_bench.cpp
+ * @brief Consistent-hash sharding and rebalance benchmark for cluster mode
+ *
+ * Assigns generated job IDs to N members with HashRing, then simulates a
+ * member joining and a member leaving and reports:
+ *
+ *   - lookup_ns            owner lookup per job ID
+ *   - ring_build_ms        HashRing::setMembers for N members
+ *   - shard_imbalance_pct  largest shard vs the ideal jobs/N
+ *   - moved_join_pct       jobs that changed owner when member N+1 joined
+ *   - moved_leave_pct      jobs that changed owner when a member left
+ *   - rebalance_sync_ms    CronScheduler::syncJobs of one node's new shard
+ *   - burst_dispatch_ms    all jobs due in the same second, from start() until
+ *                          every callback ran (one scheduler shard)
+ *   - burst_dispatch_sharded_ms  the same with --shards scheduler shards
+ *
+ * With consistent hashing moved_join_pct stays close to 100/(N+1) and
+ * moved_leave_pct close to 100/N; a modulo partition would move almost
+ * everything. The binary exits with status 3 if either exceeds twice the
+ * ideal, independently of baseline comparison.
+ *
+ * Build (from tester/):
+ *   g++ -O2 -std=c++17 -pthread -I../components cluster_bench.cpp \
+ *       ../components/HashRing.cpp ../components/CronScheduler.cpp ../components/JobMatrix.cpp \
+ *       ../components/CronExpression.cpp ../components/MaskBatch.cpp ../components/WorkerPool.cpp \
+ *       ../components/JobExecutor.cpp ../components/ExecutableResolver.cpp ../components/StartLag.cpp ../components/BundleRunner.cpp ../components/EventBus.cpp ../components/ProcessRunner.cpp ../components/UserAccounts.cpp ../components/Quotas.cpp \
+ *       ../components/AgentPool.cpp ../components/AgentProtocol.cpp ../components/PluginRunner.cpp \
+ *       ../components/AllocTracker.cpp ../components/Logger.cpp -ldl -o cluster_bench
+ */
+
+#include "bench_common.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "../components/CronExpression.h"
+#include "../components/CronScheduler.h"
+#include "../components/HashRing.h"
+#include "../components/Logger.h"
+
+namespace {
+
+std::vector<std::string> memberNames(int count) {
+    std::vector<std::string> names;
+    for (int i = 0; i < count; ++i) {
+        names.push_back("node" + std::to_string(i));
+    }
+    return names;
+}
+
+/**
+ * @brief Owner of every job for a member list
+ */
+std::vector<std::string> assign(const HashRing& ring, const std::vector<std::string>& ids) {
+    std::vector<std::string> owners;
+    owners.reserve(ids.size());
+    for (const auto& id : ids) {
+        owners.push_back(ring.owner(id));
+    }
+    return owners;
+}
+
+double movedPct(const std::vector<std::string>& before, const std::vector<std::string>& after) {
+    size_t moved = 0;
+    for (size_t i = 0; i < before.size(); ++i) {
+        if (before[i] != after[i]) moved++;
+    }
+    return 100.0 * moved / before.size();
+}
+
+/**
+ * @brief Time to dispatch one burst of jobs all due at the current minute
+ */
+double burstDispatchMs(int jobs, size_t shards, size_t threads) {
+    CronScheduler scheduler;
+    scheduler.useShards(shards);
+    scheduler.useWorkerPool(threads);
+
+    std::atomic<int> done{0};
+    CronMask every_minute;
+    std::string error;
+    CronExpression::parse("* * * * *", every_minute, error);
+    std::time_t now = std::time(nullptr);
+    std::time_t due = now - now % 60;
+    for (int i = 0; i < jobs; ++i) {
+        std::string id = "burst-" + std::to_string(i);
+        scheduler.addJob(id, every_minute, [&done](const ScheduledRun&) { done++; });
+        scheduler.setNextFireTime(id, due);
+    }
+
+    double ms = bench::timeMs([&] {
+        scheduler.start();
+        while (done.load() < jobs) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+    scheduler.stop();
+    return ms;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    opts.samples = 5;
+    int jobs = 100000;
+    int nodes = 4;
+    int vnodes = 128;
+    int shards = static_cast<int>(std::min(8u, std::max(2u, std::thread::hardware_concurrency())));
+
+    bool ok = bench::parseOptions(argc, argv, opts, [&](const std::string& arg, const std::string& next) {
+        if (arg == "--jobs" && !next.empty()) { jobs = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--nodes" && !next.empty()) { nodes = std::max(2, std::stoi(next)); return true; }
+        if (arg == "--vnodes" && !next.empty()) { vnodes = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--shards" && !next.empty()) { shards = std::max(1, std::stoi(next)); return true; }
+        return false;
+    });
+    if (!ok) return 1;
+
+    bench::SuiteResult result = bench::newSuite("cluster", opts);
+    std::cout << "=== nanoCron cluster sharding benchmark ===" << std::endl;
+    std::cout << "Machine: " << result.machine << std::endl;
+    std::cout << "Jobs: " << jobs << "  Members: " << nodes << "  Virtual nodes: " << vnodes
+              << "  Scheduler shards: " << shards << std::endl;
+
+    std::vector<std::string> ids;
+    ids.reserve(jobs);
+    for (int i = 0; i < jobs; ++i) {
+        ids.push_back("job-" + std::to_string(i));
+    }
+
+    auto base = std::make_shared<std::vector<CronJob>>(jobs);
+    for (int i = 0; i < jobs; ++i) {
+        CronJob& job = (*base)[i];
+        job.id = ids[i];
+        job.description = "Cluster job " + std::to_string(i);
+        job.command = "true";
+        std::string error;
+        CronExpression::parse(std::to_string(i % 60) + " * * * *", job.mask, error);
+    }
+
+    std::vector<std::string> members = memberNames(nodes);
+    std::vector<std::string> joined = memberNames(nodes + 1);
+    std::vector<std::string> left(members.begin() + 1, members.end());
+
+    auto& lookup = result.metric("lookup_ns", "ns");
+    auto& build = result.metric("ring_build_ms", "ms");
+    auto& imbalance = result.metric("shard_imbalance_pct", "%");
+    auto& moved_join = result.metric("moved_join_pct", "%");
+    auto& moved_leave = result.metric("moved_leave_pct", "%");
+    auto& sync = result.metric("rebalance_sync_ms", "ms");
+    auto& burst = result.metric("burst_dispatch_ms", "ms");
+    auto& burst_sharded = result.metric("burst_dispatch_sharded_ms", "ms");
+
+    Logger logger("/dev/null");
+    logger.setSilentMode(true);
+
+    for (int s = 0; s < opts.samples; ++s) {
+        HashRing ring(vnodes);
+        build.samples.push_back(bench::timeMs([&] { ring.setMembers(members); }));
+
+        std::vector<std::string> before;
+        double ms = bench::timeMs([&] { before = assign(ring, ids); });
+        lookup.samples.push_back(ms * 1e6 / jobs);
+
+        std::map<std::string, size_t> shard_sizes;
+        for (const auto& owner : before) shard_sizes[owner]++;
+        size_t largest = 0;
+        for (const auto& entry : shard_sizes) largest = std::max(largest, entry.second);
+        imbalance.samples.push_back(100.0 * (largest * nodes / static_cast<double>(jobs) - 1.0));
+
+        HashRing grown(vnodes);
+        grown.setMembers(joined);
+        std::vector<std::string> after_join = assign(grown, ids);
+        moved_join.samples.push_back(movedPct(before, after_join));
+
+        HashRing shrunk(vnodes);
+        shrunk.setMembers(left);
+        moved_leave.samples.push_back(movedPct(before, assign(shrunk, ids)));
+
+        // node0's scheduler before and after the join: only moved jobs are touched
+        auto shardOf = [&](const std::vector<std::string>& owners) {
+            auto shard = std::make_shared<std::vector<CronJob>>();
+            for (int i = 0; i < jobs; ++i) {
+                if (owners[i] == "node0") shard->push_back((*base)[i]);
+            }
+            return shard;
+        };
+        CronScheduler scheduler;
+        scheduler.syncJobs(shardOf(before), logger);
+        auto next_shard = shardOf(after_join);
+        SchedulerSyncStats stats;
+        sync.samples.push_back(bench::timeMs([&] { stats = scheduler.syncJobs(next_shard, logger); }));
+        if (s == 0) {
+            std::cout << "node0 rebalance on join: " << stats.removed << " removed, "
+                      << stats.updated << " kept" << std::endl;
+        }
+
+        // Same pool size both ways: only the scheduling side differs
+        size_t threads = static_cast<size_t>(shards) * 2;
+        burst.samples.push_back(burstDispatchMs(jobs, 1, threads));
+        burst_sharded.samples.push_back(burstDispatchMs(jobs, static_cast<size_t>(shards), threads));
+    }
+
+    int exit_code = bench::finish(opts, result);
+
+    double ideal_join = 100.0 / (nodes + 1);
+    double ideal_leave = 100.0 / nodes;
+    if (moved_join.mean() > 2 * ideal_join || moved_leave.mean() > 2 * ideal_leave) {
+        std::cerr << "Rebalance moved too many jobs (ideal join " << ideal_join
+                  << "%, leave " << ideal_leave << "%)" << std::endl;
+        return 3;
+    }
+    return exit_code;
+}
@@ -0,0 +1,252 @@
+/**
+ * @file ha_failover_harness.cpp
+ * @brief Failover time and exactly-once check for the HA leader lease
+ *
+ * Starts N real nanoCron daemons on this machine, all pointing at the same
+ * lease file, each with its own config.env (--config) and log. Every
+ * daemon has the same "* * * * *" probe job, which appends
+ * "<epoch minute> <node>" to a shared output file. Each trial SIGKILLs the
+ * current leader one second before a minute boundary, so the boundary
+ * passes without any leader and the new one has to catch the run up from
+ * the persisted execution state. The killed node is restarted as a
+ * standby afterwards.
+ *
+ *   - failover_ms      leader killed -> another node holds a valid lease
+ *   - recovery_ms      leader killed -> the missed run has been executed
+ *   - duplicate_runs   extra executions of any minute over the whole run
+ *   - lost_runs        monitored minutes without any execution
+ *
+ * Each trial takes about a minute. duplicate_runs and lost_runs must be 0;
+ * the binary exits with status 3 otherwise, independently of baselines.
+ *
+ * Build (from tester/, after building the daemon):
+ *   g++ -O2 -std=c++17 -pthread -I../components ha_failover_harness.cpp \
+ *       ../components/LeaderLease.cpp ../components/Logger.cpp -o ha_failover_harness
+ *
+ * Run:
+ *   ./ha_failover_harness --daemon /usr/local/bin/nanoCron --nodes 3 --ttl 3 --trials 3
+ */
+
+#include "bench_common.h"
+
+#include <csignal>
+#include <thread>
+#include <sys/wait.h>
+
+#include "../components/LeaderLease.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct Node {
+    std::string name;
+    fs::path config;
+    pid_t pid = -1;
+};
+
+void writeFile(const fs::path& path, const std::string& content) {
+    std::ofstream out(path, std::ios::trunc);
+    out << content;
+}
+
+pid_t spawnDaemon(const std::string& daemon, const Node& node) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(daemon.c_str(), daemon.c_str(), "--config", node.config.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    return pid;
+}
+
+void sleepMs(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+/**
+ * @brief Holder of a lease that is valid right now ("" if none)
+ */
+std::string currentLeader(const fs::path& lease) {
+    LeaseRecord record;
+    if (!LeaderLease::readRecord(lease.string(), record) || record.expires_ms <= LeaderLease::nowMs()) {
+        return "";
+    }
+    return record.holder;
+}
+
+/**
+ * @brief Executions per epoch minute found in the shared output file
+ */
+std::map<long, int> runsPerMinute(const fs::path& output) {
+    std::map<long, int> counts;
+    std::ifstream in(output);
+    long minute;
+    std::string node;
+    while (in >> minute >> node) {
+        counts[minute]++;
+    }
+    return counts;
+}
+
+long epochMinute() {
+    return static_cast<long>(std::time(nullptr) / 60);
+}
+
+/**
+ * @brief Sleep until `offset_ms` after the start of the given epoch minute
+ */
+void sleepUntilMinute(long minute, int offset_ms) {
+    int64_t target = static_cast<int64_t>(minute) * 60000 + offset_ms;
+    int64_t now = LeaderLease::nowMs();
+    if (target > now) {
+        sleepMs(static_cast<int>(target - now));
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    std::string daemon = "/usr/local/bin/nanoCron";
+    int nodes = 3;
+    int ttl = 3;
+    int trials = 3;
+
+    bool ok = bench::parseOptions(argc, argv, opts, [&](const std::string& arg, const std::string& next) {
+        if (arg == "--daemon" && !next.empty()) { daemon = next; return true; }
+        if (arg == "--nodes" && !next.empty()) { nodes = std::max(2, std::stoi(next)); return true; }
+        if (arg == "--ttl" && !next.empty()) { ttl = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--trials" && !next.empty()) { trials = std::max(1, std::stoi(next)); return true; }
+        return false;
+    });
+    if (!ok) return 1;
+    if (access(daemon.c_str(), X_OK) != 0) {
+        std::cerr << "Daemon binary not found: " << daemon << " (use --daemon PATH)" << std::endl;
+        return 1;
+    }
+
+    bench::SuiteResult result = bench::newSuite("ha", opts);
+    std::cout << "=== nanoCron HA failover harness ===" << std::endl;
+    std::cout << "Machine: " << result.machine << std::endl;
+    std::cout << "Nodes: " << nodes << "  Lease TTL: " << ttl << "s  Trials: " << trials << std::endl;
+
+    fs::path dir = fs::temp_directory_path() / ("nanocron_ha_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    fs::path lease = dir / "leader.lease";
+    fs::path output = dir / "runs.txt";
+
+    std::vector<Node> cluster(nodes);
+    for (int i = 0; i < nodes; ++i) {
+        Node& node = cluster[i];
+        node.name = "node" + std::to_string(i);
+        fs::path home = dir / node.name;
+        fs::create_directories(home / "logs");
+        node.config = home / "config.env";
+        writeFile(home / "jobs.json",
+                  "{\"jobs\":[{\"id\":\"ha-probe\",\"description\":\"HA probe\","
+                  "\"command\":\"echo \\\"$(( $(date +%s) / 60 )) " + node.name + "\\\" >> " + output.string() + "\","
+                  "\"schedule\":\"* * * * *\"}]}");
+        writeFile(node.config,
+                  "WORKER_THREADS=1\n"
+                  "ORIGINAL_JOBS_JSON_PATH=" + (home / "jobs.json").string() + "\n"
+                  "ORIGINAL_CRON_LOG_PATH=" + (home / "logs" / "cron.log").string() + "\n"
+                  "HA_LEASE_PATH=" + lease.string() + "\n"
+                  "HA_NODE_ID=" + node.name + "\n"
+                  "HA_LEASE_TTL=" + std::to_string(ttl) + "\n");
+        node.pid = spawnDaemon(daemon, node);
+    }
+
+    // Wait for the first election
+    for (int waited = 0; currentLeader(lease).empty(); waited += 50) {
+        if (waited > 30000) {
+            std::cerr << "No leader elected within 30s, see logs in " << dir << std::endl;
+            return 1;
+        }
+        sleepMs(50);
+    }
+    long first_minute = epochMinute() + 1;   // First fully monitored minute
+    long last_minute = first_minute;
+
+    auto& failover = result.metric("failover_ms", "ms");
+    auto& recovery = result.metric("recovery_ms", "ms");
+
+    for (int t = 0; t < trials; ++t) {
+        // Kill the leader one second before the next minute boundary
+        long boundary = epochMinute() + 1;
+        sleepUntilMinute(boundary, -1000);
+        std::string leader = currentLeader(lease);
+        auto victim = std::find_if(cluster.begin(), cluster.end(), [&](const Node& n) { return n.name == leader; });
+        if (victim == cluster.end()) {
+            std::cerr << "Trial " << t << ": no valid leader before the kill" << std::endl;
+            continue;
+        }
+
+        auto killed_at = std::chrono::steady_clock::now();
+        kill(victim->pid, SIGKILL);
+        waitpid(victim->pid, nullptr, 0);
+
+        std::string successor;
+        while ((successor = currentLeader(lease)).empty() || successor == leader) {
+            sleepMs(5);
+        }
+        double failover_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - killed_at).count();
+        failover.samples.push_back(failover_ms);
+
+        victim->pid = spawnDaemon(daemon, *victim);   // Back as a standby
+
+        double recovery_ms = -1.0;
+        while (std::chrono::steady_clock::now() - killed_at < std::chrono::seconds(ttl * 4 + 10)) {
+            if (runsPerMinute(output).count(boundary)) {
+                recovery_ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - killed_at).count();
+                break;
+            }
+            sleepMs(20);
+        }
+        if (recovery_ms >= 0) {
+            recovery.samples.push_back(recovery_ms);
+        }
+        std::cout << "Trial " << t << ": killed " << leader << ", " << successor << " took over in "
+                  << failover_ms << " ms, missed run executed after "
+                  << (recovery_ms >= 0 ? std::to_string(recovery_ms) + " ms" : std::string("NEVER")) << std::endl;
+        last_minute = boundary;
+    }
+
+    // Let the minute after the last kill run as well, then stop everything
+    last_minute += 1;
+    sleepUntilMinute(last_minute, 5000);
+    for (auto& node : cluster) {
+        kill(node.pid, SIGTERM);
+    }
+    for (auto& node : cluster) {
+        waitpid(node.pid, nullptr, 0);
+    }
+
+    std::map<long, int> counts = runsPerMinute(output);
+    int duplicates = 0;
+    int lost = 0;
+    for (long minute = first_minute; minute <= last_minute; ++minute) {
+        int runs = counts.count(minute) ? counts[minute] : 0;
+        if (runs == 0) {
+            lost++;
+            std::cout << "Minute " << minute << ": LOST" << std::endl;
+        } else if (runs > 1) {
+            duplicates += runs - 1;
+            std::cout << "Minute " << minute << ": " << runs << " runs" << std::endl;
+        }
+    }
+    std::cout << "Monitored minutes: " << (last_minute - first_minute + 1)
+              << "  duplicate runs: " << duplicates << "  lost runs: " << lost << std::endl;
+    result.metric("duplicate_runs", "runs").samples.push_back(duplicates);
+    result.metric("lost_runs", "runs").samples.push_back(lost);
+
+    int exit_code = bench::finish(opts, result);
+    if (duplicates > 0 || lost > 0) {
+        std::cerr << "Exactly-once violated, logs kept in " << dir << std::endl;
+        return 3;
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return exit_code;
+}
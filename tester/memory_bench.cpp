@@ -0,0 +1,192 @@
+/**
+ * @file memory_bench.cpp
+ * @brief Memory footprint and allocation-per-tick benchmark
+ *
+ * Must be built with -DNANOCRON_ALLOC_TRACKING so AllocTracker replaces the
+ * global operator new/delete. For each configuration size it loads a
+ * generated jobs.json through ConfigWatcher and reports, per subsystem:
+ *
+ *   - config_bytes_per_job      live bytes of the published job snapshot
+ *   - config_allocs_per_job     allocations made to build it
+ *   - scheduler_bytes_per_job   live bytes of the CronScheduler entries
+ *   - logger_live_bytes         live logger buffers after a burst of lines
+ *   - executor_live_bytes       bytes still held after running a job
+ *   - allocs_per_tick           heap allocations in a steady-state tick
+ *
+ * The steady-state tick is exactly what the daemon loop does every pass:
+ * pop the due runs from CronScheduler and reschedule them. The hard
+ * target is ZERO allocations per tick; the binary exits with status 3 if
+ * any tick allocates, independently of baseline comparison.
+ *
+ * Build (from tester/):
+ *   g++ -O2 -std=c++17 -pthread -DNANOCRON_ALLOC_TRACKING -I../components memory_bench.cpp \
+ *       ../components/AllocTracker.cpp ../components/ConfigWatcher.cpp \
+ *       ../components/JobConfig.cpp ../components/JobMatrix.cpp ../components/CronExpression.cpp ../components/MaskBatch.cpp \
+ *       ../components/CronScheduler.cpp ../components/WorkerPool.cpp \
+ *       ../components/JobExecutor.cpp ../components/ExecutableResolver.cpp ../components/StartLag.cpp ../components/BundleRunner.cpp ../components/EventBus.cpp ../components/ProcessRunner.cpp ../components/UserAccounts.cpp ../components/Quotas.cpp \
+ *       ../components/AgentPool.cpp ../components/AgentProtocol.cpp ../components/PluginRunner.cpp \
+ *       ../components/Logger.cpp -ldl -o memory_bench
+ */
+
+#include "bench_common.h"
+
+#include <memory>
+
+#include "../components/AllocTracker.h"
+#include "../components/ConfigWatcher.h"
+#include "../components/CronScheduler.h"
+#include "../components/CronTypes.h"
+#include "../components/JobExecutor.h"
+#include "../components/Logger.h"
+
+#ifndef NANOCRON_ALLOC_TRACKING
+#error "memory_bench must be built with -DNANOCRON_ALLOC_TRACKING"
+#endif
+
+namespace {
+
+/**
+ * @brief Write a generated config straight to disk (no giant DOM for 1M jobs)
+ */
+void writeConfig(const std::filesystem::path& path, int jobs) {
+    std::ofstream out(path, std::ios::trunc);
+    out << "{\"jobs\":[";
+    for (int i = 0; i < jobs; ++i) {
+        if (i) out << ",";
+        out << "{\"description\":\"Memory job " << i << "\","
+            << "\"command\":\"/usr/local/bin/memory_job_" << i << " --arg\","
+            << "\"schedule\":{\"minute\":\"" << (i % 60) << "\",\"hour\":\"" << (i % 3 ? "*" : "4")
+            << "\",\"day_of_month\":\"*\",\"month\":\"*\",\"day_of_week\":\"*\"}}";
+    }
+    out << "]}";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    opts.samples = 1;
+    std::vector<int> sizes = {1000, 10000, 100000};
+    int ticks = 1000;
+
+    bool ok = bench::parseOptions(argc, argv, opts, [&](const std::string& arg, const std::string& next) {
+        if (arg == "--sizes" && !next.empty()) { sizes = bench::parseList(next); return true; }
+        if (arg == "--ticks" && !next.empty()) { ticks = std::max(1, std::stoi(next)); return true; }
+        return false;
+    });
+    if (!ok) return 1;
+
+    bench::SuiteResult result = bench::newSuite("memory", opts);
+    std::cout << "=== nanoCron memory footprint benchmark ===" << std::endl;
+    std::cout << "Machine: " << result.machine << std::endl;
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                                ("nanocron_memory_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+
+    std::ofstream devnull("/dev/null");
+    std::streambuf* saved_cerr = std::cerr.rdbuf(devnull.rdbuf());
+
+    uint64_t worst_tick_allocs = 0;
+
+    for (int size : sizes) {
+        const std::string key = ".n" + std::to_string(size);
+        std::filesystem::path config = dir / ("jobs_" + std::to_string(size) + ".json");
+        writeConfig(config, size);
+
+        auto logger = std::make_unique<Logger>((dir / ("memory_" + std::to_string(size) + ".log")).string());
+        logger->setSilentMode(true);
+
+        // --- Config snapshot ------------------------------------------------
+        AllocCounters config_before = AllocTracker::counters(AllocTag::CONFIG);
+        auto watcher = std::make_unique<ConfigWatcher>(config.string(), *logger);
+        AllocCounters config_after = AllocTracker::counters(AllocTag::CONFIG);
+        auto jobs = watcher->getJobs();
+        if (!jobs || jobs->empty()) {
+            std::cerr.rdbuf(saved_cerr);
+            std::cerr << "Error: no jobs loaded for size " << size << std::endl;
+            return 1;
+        }
+        double config_bytes = static_cast<double>(config_after.live_bytes - config_before.live_bytes);
+        double config_allocs = static_cast<double>(config_after.allocations - config_before.allocations);
+
+        // --- Scheduler state: every job registered ------------------------
+        auto scheduler = std::make_unique<CronScheduler>();
+        AllocCounters sched_before = AllocTracker::counters(AllocTag::SCHEDULER);
+        scheduler->syncJobs(jobs, *logger);
+        AllocCounters sched_after = AllocTracker::counters(AllocTag::SCHEDULER);
+        double sched_bytes = static_cast<double>(sched_after.live_bytes - sched_before.live_bytes);
+
+        // --- Steady-state ticks: one per minute, runs collected not executed
+        std::vector<ScheduledRun> due;
+        {
+            AllocScope scope(AllocTag::SCHEDULER);
+            due.reserve(jobs->size());
+        }
+        std::time_t tick_time = scheduler->nextWakeTime();
+
+        // Warm-up tick (first-use initialisation does not count)
+        scheduler->collectDue(tick_time, due);
+
+        AllocCounters tick_before = AllocTracker::total();
+        auto tick_start = std::chrono::steady_clock::now();
+        for (int t = 1; t <= ticks; ++t) {
+            scheduler->collectDue(tick_time + 60 * t, due);
+        }
+        due.clear();
+        double tick_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - tick_start).count() / ticks;
+        AllocCounters tick_after = AllocTracker::total();
+        uint64_t tick_allocs = tick_after.allocations - tick_before.allocations;
+        worst_tick_allocs = std::max(worst_tick_allocs, tick_allocs);
+
+        // --- Logger buffers --------------------------------------------------
+        for (int i = 0; i < 1000; ++i) {
+            logger->info("Memory benchmark line " + std::to_string(i), "bench");
+        }
+        double logger_bytes = static_cast<double>(AllocTracker::counters(AllocTag::LOGGER).live_bytes);
+
+        // --- Executor records ------------------------------------------------
+        AllocCounters exec_before = AllocTracker::counters(AllocTag::EXECUTOR);
+        CronJob noop = jobs->front();
+        noop.command = "true";
+        JobExecutor::executeJob(noop, *logger);
+        AllocCounters exec_after = AllocTracker::counters(AllocTag::EXECUTOR);
+        double exec_bytes = static_cast<double>(exec_after.live_bytes - exec_before.live_bytes);
+
+        result.metric("config_bytes_per_job" + key, "B/job").samples.push_back(config_bytes / size);
+        result.metric("config_allocs_per_job" + key, "allocs/job").samples.push_back(config_allocs / size);
+        result.metric("scheduler_bytes_per_job" + key, "B/job").samples.push_back(sched_bytes / size);
+        result.metric("logger_live_bytes" + key, "B").samples.push_back(logger_bytes);
+        result.metric("executor_live_bytes" + key, "B").samples.push_back(exec_bytes);
+        result.metric("allocs_per_tick" + key, "allocs").samples.push_back(static_cast<double>(tick_allocs) / ticks);
+        result.metric("tick_us" + key, "us").samples.push_back(tick_us);
+
+        std::cout << "jobs " << std::setw(8) << size
+                  << " | config " << std::setw(7) << std::setprecision(5) << config_bytes / size << " B/job"
+                  << " (" << config_allocs / size << " allocs/job)"
+                  << " | scheduler " << sched_bytes / size << " B/job"
+                  << " | tick " << tick_us << " us, " << tick_allocs << " allocs in " << ticks << " ticks"
+                  << std::endl;
+        std::cout << "  " << AllocTracker::report() << std::endl;
+
+        scheduler.reset();
+        jobs.reset();
+        watcher.reset();
+        logger.reset();
+        std::filesystem::remove(config);
+    }
+
+    std::cerr.rdbuf(saved_cerr);
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+
+    int exit_code = bench::finish(opts, result);
+    if (worst_tick_allocs > 0) {
+        std::cout << "ZERO-ALLOCATION TARGET: FAILED (" << worst_tick_allocs
+                  << " allocations during steady-state ticks)" << std::endl;
+        return exit_code ? exit_code : 3;
+    }
+    std::cout << "ZERO-ALLOCATION TARGET: PASS (0 allocations per steady-state tick)" << std::endl;
+    return exit_code;
+}
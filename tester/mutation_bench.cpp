@@ -0,0 +1,170 @@
+/**
+ * @file mutation_bench.cpp
+ * @brief Live job mutation cost versus a full jobs.json rewrite and reload
+ *
+ * Loads N generated jobs into a JobStore and a CronScheduler, then applies
+ * batches of B changes (a third added, a third updated, a third removed)
+ * both ways and reports:
+ *
+ *   - apply_batch_ms    JobStore::apply + CronScheduler::applyJobs (control socket path)
+ *   - full_reload_ms    validate + parse the whole file + syncJobs (file rewrite path)
+ *   - persist_ms        ConfigPersister patching the batch into the file (off the hot path)
+ *
+ * apply_batch_ms should not grow with N; full_reload_ms does.
+ *
+ * Build (from tester/):
+ *   g++ -O2 -std=c++17 -pthread -I../components mutation_bench.cpp \
+ *       ../components/JobStore.cpp ../components/ConfigPersister.cpp \
+ *       ../components/CronScheduler.cpp ../components/CronExpression.cpp ../components/MaskBatch.cpp ../components/WorkerPool.cpp \
+ *       ../components/JobExecutor.cpp ../components/ExecutableResolver.cpp ../components/StartLag.cpp ../components/BundleRunner.cpp ../components/EventBus.cpp ../components/ProcessRunner.cpp ../components/UserAccounts.cpp ../components/Quotas.cpp \
+ *       ../components/AgentPool.cpp ../components/AgentProtocol.cpp ../components/PluginRunner.cpp \
+ *       ../components/JobConfig.cpp ../components/JobMatrix.cpp ../components/AllocTracker.cpp ../components/Logger.cpp -ldl -o mutation_bench
+ */
+
+#include "bench_common.h"
+
+#include <fstream>
+#include <memory>
+
+#include "../components/ConfigPersister.h"
+#include "../components/CronScheduler.h"
+#include "../components/JobConfig.h"
+#include "../components/JobStore.h"
+#include "../components/Logger.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+nlohmann::json jobEntry(const std::string& id, int minute, const std::string& tag) {
+    return {
+        {"id", id},
+        {"description", "Tenant job " + id + tag},
+        {"command", "/usr/local/bin/tenant_job " + id},
+        {"schedule", std::to_string(minute % 60) + " * * * *"}
+    };
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    opts.samples = 10;
+    int jobs = 100000;
+    int batch = 300;
+
+    bool ok = bench::parseOptions(argc, argv, opts, [&](const std::string& arg, const std::string& next) {
+        if (arg == "--jobs" && !next.empty()) { jobs = std::max(3, std::stoi(next)); return true; }
+        if (arg == "--batch" && !next.empty()) { batch = std::max(3, std::stoi(next)); return true; }
+        return false;
+    });
+    if (!ok) return 1;
+
+    bench::SuiteResult result = bench::newSuite("mutation", opts);
+    std::cout << "=== nanoCron live job mutation benchmark ===" << std::endl;
+    std::cout << "Machine: " << result.machine << std::endl;
+    std::cout << "Jobs: " << jobs << "  Batch: " << batch << std::endl;
+
+    fs::path dir = fs::temp_directory_path() / ("nanocron_mutation_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    std::string path = (dir / "jobs.json").string();
+
+    nlohmann::json doc;
+    doc["jobs"] = nlohmann::json::array();
+    for (int i = 0; i < jobs; ++i) {
+        doc["jobs"].push_back(jobEntry("job-" + std::to_string(i), i, ""));
+    }
+    std::string content = doc.dump(2);
+    std::ofstream(path) << content;
+
+    Logger logger("/dev/null");
+    logger.setSilentMode(true);
+    auto loaded = std::make_shared<const std::vector<CronJob>>(JobConfig::parseJobsFromJson(content));
+    JobStore store;
+    store.reset(loaded);
+    CronScheduler scheduler;
+    scheduler.syncJobs(loaded, logger);
+
+    auto& apply = result.metric("apply_batch_ms", "ms");
+    auto& reload = result.metric("full_reload_ms", "ms");
+    auto& persist = result.metric("persist_ms", "ms");
+
+    int next_id = jobs;
+    int failures = 0;
+    for (int s = 0; s < opts.samples; ++s) {
+        // Add fresh IDs, update and remove the oldest live ones
+        nlohmann::json list = {{"jobs", nlohmann::json::array()}};
+        JobMutation mutation;
+        std::vector<std::pair<std::string, nlohmann::json>> changes;
+        int third = batch / 3;
+        int first_live = s * third;   // Jobs [0, first_live) were removed by earlier samples
+        for (int i = 0; i < third; ++i) {
+            std::string id = "job-" + std::to_string(next_id++);
+            nlohmann::json entry = jobEntry(id, i, "");
+            list["jobs"].push_back(entry);
+            changes.emplace_back(id, std::move(entry));
+        }
+        for (int i = 0; i < third; ++i) {
+            std::string id = "job-" + std::to_string(first_live + third + i);
+            nlohmann::json entry = jobEntry(id, i + 7, " v" + std::to_string(s));
+            list["jobs"].push_back(entry);
+            changes.emplace_back(id, std::move(entry));
+        }
+        for (int i = 0; i < third; ++i) {
+            std::string id = "job-" + std::to_string(first_live + i);
+            mutation.remove.push_back(id);
+            changes.emplace_back(id, nullptr);
+        }
+
+        std::string error;
+        std::vector<std::shared_ptr<const CronJob>> upserted;
+        apply.samples.push_back(bench::timeMs([&] {
+            std::vector<CronJob> parsed = JobConfig::parseJobsFromJson(nlohmann::json(list));
+            mutation.add.assign(parsed.begin(), parsed.begin() + third);
+            mutation.update.assign(parsed.begin() + third, parsed.end());
+            std::vector<std::string> removals = mutation.remove;
+            if (!store.apply(std::move(mutation), upserted, error)) {
+                failures++;
+                return;
+            }
+            scheduler.applyJobs(upserted, removals, logger);
+        }));
+
+        ConfigPersister persister(path, logger);
+        persister.start();
+        persist.samples.push_back(bench::timeMs([&] {
+            for (auto& change : changes) {
+                persister.enqueue(change.first, std::move(change.second), 0);
+            }
+            persister.stop();   // Writes at once instead of waiting COALESCE_MS
+        }));
+        if (persister.writes() != 1) {
+            failures++;
+        }
+
+        // The same change made by rewriting the file: reparse and resync everything
+        std::ifstream file(path);
+        std::string rewritten((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        CronScheduler full;
+        full.syncJobs(loaded, logger);
+        reload.samples.push_back(bench::timeMs([&] {
+            if (!JobConfig::validateJobsJson(rewritten, error)) {
+                failures++;
+                return;
+            }
+            auto snapshot = std::make_shared<const std::vector<CronJob>>(JobConfig::parseJobsFromJson(rewritten));
+            full.syncJobs(snapshot, logger);
+        }));
+        if (store.size() != static_cast<size_t>(jobs)) {
+            failures++;
+        }
+    }
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    if (failures > 0) {
+        std::cerr << failures << " mutation batches failed" << std::endl;
+        return 1;
+    }
+    return bench::finish(opts, result);
+}
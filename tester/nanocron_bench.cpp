@@ -0,0 +1,272 @@
+/**
+ * @file nanocron_bench.cpp
+ * @brief Core regression benchmark for the nanoCron daemon components
+ *
+ * Unlike nanocron_test_runner (a parsing-only comparison with system cron),
+ * this benchmark links the real daemon components and measures the paths
+ * that matter at runtime:
+ *
+ *   - parse_time_ms        JobConfig::parseJobsFromJson on a generated config
+ *   - tick_cost_us         one scheduler pass over every loaded job
+ *   - batch_tick_us        the same minute matched with MaskBatch (SIMD kernel)
+ *   - sparse_next_fire_us  CronExpression::nextFireTime of schedules firing
+ *                          rarely or never (February 29th, 31st of short months)
+ *   - spawn_latency_ms     JobExecutor::executeJob of a no-op command (direct exec, cached PATH)
+ *   - spawn_shell_ms       the same command through /bin/sh (no resolver)
+ *   - bundle_per_job_ms    JobExecutor::executeBundle of 100 no-op commands, per command
+ *   - plugin_latency_ms    JobExecutor::executeJob of an in-process plugin job
+ *                          (only with --plugin PATH, e.g. heartbeat_plugin.so)
+ *   - logger_throughput    Logger lines written per second
+ *   - memory_footprint_kb  heap bytes held by the loaded job vector
+ *
+ * Results can be recorded as a JSON baseline (keyed by commit and machine
+ * fingerprint) and compared against a previous baseline; see bench_common.h.
+ *
+ * Build (from tester/):
+ *   g++ -O2 -std=c++17 -pthread -I../components nanocron_bench.cpp \
+ *       ../components/JobConfig.cpp ../components/JobMatrix.cpp ../components/CronEngine.cpp \
+ *       ../components/CronExpression.cpp ../components/MaskBatch.cpp ../components/JobExecutor.cpp ../components/ExecutableResolver.cpp ../components/StartLag.cpp \
+ *       ../components/BundleRunner.cpp ../components/EventBus.cpp ../components/ProcessRunner.cpp ../components/UserAccounts.cpp ../components/Quotas.cpp ../components/AgentPool.cpp \
+ *       ../components/AgentProtocol.cpp ../components/PluginRunner.cpp ../components/CronScheduler.cpp ../components/WorkerPool.cpp \
+ *       ../components/Logger.cpp -ldl -o nanocron_bench
+ */
+
+#include "bench_common.h"
+
+#include <malloc.h>
+#include <map>
+#include <memory>
+
+#include "../components/CronTypes.h"
+#include "../components/CronEngine.h"
+#include "../components/CronExpression.h"
+#include "../components/ExecutableResolver.h"
+#include "../components/JobConfig.h"
+#include "../components/JobExecutor.h"
+#include "../components/MaskBatch.h"
+#include "../components/Logger.h"
+
+namespace {
+
+/**
+ * @brief Generate a jobs.json document with a realistic mix of schedules
+ */
+std::string generateJobsJson(int count) {
+    static const char* minutes[] = {"0", "*", "15", "30", "45"};
+    static const char* hours[] = {"*", "3", "12", "*", "22"};
+    static const char* weekdays[] = {"*", "1-5", "*", "0,6", "3"};
+
+    nlohmann::json root;
+    root["jobs"] = nlohmann::json::array();
+    for (int i = 0; i < count; ++i) {
+        nlohmann::json job;
+        job["description"] = "Benchmark job " + std::to_string(i);
+        job["command"] = "/usr/local/bin/bench_job_" + std::to_string(i) + " --flag";
+        job["schedule"] = {
+            {"minute", minutes[i % 5]},
+            {"hour", hours[(i / 5) % 5]},
+            {"day_of_month", "*"},
+            {"month", "*"},
+            {"day_of_week", weekdays[(i / 25) % 5]}
+        };
+        root["jobs"].push_back(std::move(job));
+    }
+    return root.dump();
+}
+
+/**
+ * @brief Heap bytes currently in use according to the allocator
+ */
+size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return static_cast<size_t>(mallinfo().uordblks);
+#endif
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    int job_count = 1000;
+    int log_lines = 20000;
+    std::string plugin_path;
+
+    bool ok = bench::parseOptions(argc, argv, opts, [&](const std::string& arg, const std::string& next) {
+        if (arg == "--jobs" && !next.empty()) { job_count = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--log-lines" && !next.empty()) { log_lines = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--plugin" && !next.empty()) { plugin_path = next; return true; }
+        return false;
+    });
+    if (!ok) return 1;
+
+    bench::SuiteResult result = bench::newSuite("core", opts);
+    std::cout << "=== nanoCron core benchmark ===" << std::endl;
+    std::cout << "Machine: " << result.machine << std::endl;
+    std::cout << "Jobs: " << job_count << "  Samples: " << opts.samples << std::endl;
+
+    const std::string config = generateJobsJson(job_count);
+
+    // Scratch area for logger output, removed at the end
+    std::filesystem::path scratch = std::filesystem::temp_directory_path() /
+                                    ("nanocron_bench_" + std::to_string(getpid()));
+    std::filesystem::create_directories(scratch);
+
+    // --- Parse time -------------------------------------------------------
+    bench::Metric& parse = result.metric("parse_time_ms", "ms");
+    std::vector<CronJob> jobs;
+    for (int i = 0; i < opts.samples; ++i) {
+        parse.samples.push_back(bench::timeMs([&] { jobs = JobConfig::parseJobsFromJson(config); }));
+    }
+    if (jobs.empty()) {
+        std::cerr << "Error: generated configuration produced no jobs" << std::endl;
+        return 1;
+    }
+
+    // --- Tick cost --------------------------------------------------------
+    bench::Metric& tick = result.metric("tick_cost_us", "us");
+    std::map<std::string, std::pair<int, int>> last_exec;
+    for (size_t i = 0; i < jobs.size(); i += 2) {
+        last_exec[jobs[i].command] = {3, 0};
+    }
+    std::tm local_time = {};
+    local_time.tm_year = 125; local_time.tm_mon = 5; local_time.tm_mday = 11;
+    local_time.tm_wday = 3; local_time.tm_hour = 3; local_time.tm_min = 0;
+
+    volatile size_t due_total = 0;
+    for (int i = 0; i < opts.samples; ++i) {
+        const int passes = 50;
+        double ms = bench::timeMs([&] {
+            for (int p = 0; p < passes; ++p) {
+                size_t due = 0;
+                for (const auto& job : jobs) {
+                    if (CronEngine::shouldRunJob(job, local_time, last_exec)) ++due;
+                }
+                due_total = due_total + due;
+            }
+        });
+        tick.samples.push_back(ms * 1000.0 / passes);
+    }
+
+    bench::Metric& batch_tick = result.metric("batch_tick_us", "us");
+    MaskBatch batch;
+    for (const auto& job : jobs) {
+        batch.add(job.mask);
+    }
+    std::vector<uint32_t> batch_due;
+    batch_due.reserve(jobs.size());
+    for (int i = 0; i < opts.samples; ++i) {
+        const int passes = 50;
+        double ms = bench::timeMs([&] {
+            for (int p = 0; p < passes; ++p) {
+                due_total = due_total + batch.due(local_time, batch_due);
+            }
+        });
+        batch_tick.samples.push_back(ms * 1000.0 / passes);
+    }
+    std::cout << "Batch matching kernel: " << MaskBatch::backend() << std::endl;
+
+    // --- Next fire time of sparse schedules --------------------------------
+    bench::Metric& sparse = result.metric("sparse_next_fire_us", "us");
+    const char* sparse_expressions[] = {
+        "0 0 29 2 *", "0 0 29 2 */2", "0 0 30 2 *", "0 12 31 4,6,9,11 *", "59 23 31 12 *"
+    };
+    std::vector<CronMask> sparse_masks;
+    for (const char* expression : sparse_expressions) {
+        CronMask mask;
+        std::string error;
+        CronExpression::parse(expression, mask, error);
+        sparse_masks.push_back(mask);
+    }
+    volatile std::time_t fire_sum = 0;
+    const std::time_t sparse_from = 1735689600;   // 2025-01-01 00:00 UTC
+    for (int i = 0; i < opts.samples; ++i) {
+        const int passes = 200;
+        double ms = bench::timeMs([&] {
+            for (int p = 0; p < passes; ++p) {
+                for (const auto& mask : sparse_masks) {
+                    fire_sum = fire_sum + CronExpression::nextFireTime(mask, sparse_from + p * 3600);
+                }
+            }
+        });
+        sparse.samples.push_back(ms * 1000.0 / (passes * sparse_masks.size()));
+    }
+
+    // --- Memory footprint of the loaded configuration ---------------------
+    bench::Metric& memory = result.metric("memory_footprint_kb", "KB");
+    for (int i = 0; i < opts.samples; ++i) {
+        jobs.clear();
+        jobs.shrink_to_fit();
+        size_t before = heapInUse();
+        jobs = JobConfig::parseJobsFromJson(config);
+        size_t after = heapInUse();
+        memory.samples.push_back(after > before ? (after - before) / 1024.0 : 0.0);
+    }
+
+    // --- Logger throughput ------------------------------------------------
+    bench::Metric& throughput = result.metric("logger_throughput_lps", "lines/s", bench::Better::HIGHER);
+    for (int i = 0; i < opts.samples; ++i) {
+        std::filesystem::path log_path = scratch / ("throughput_" + std::to_string(i) + ".log");
+        Logger logger(log_path.string());
+        logger.setSilentMode(true);
+        double ms = bench::timeMs([&] {
+            for (int line = 0; line < log_lines; ++line) {
+                logger.info("Benchmark log line " + std::to_string(line), "bench");
+            }
+        });
+        throughput.samples.push_back(log_lines / (ms / 1000.0));
+    }
+
+    // --- Spawn latency ----------------------------------------------------
+    bench::Metric& spawn = result.metric("spawn_latency_ms", "ms");
+    {
+        Logger logger((scratch / "spawn.log").string());
+        logger.setSilentMode(true);
+        CronJob noop = jobs.front();
+        noop.command = "true";
+        noop.description = "spawn-benchmark";
+        ExecutableResolver resolver(logger);
+        resolver.start();
+        JobExecutor::setResolver(&resolver);
+        for (int i = 0; i < opts.samples; ++i) {
+            spawn.samples.push_back(bench::timeMs([&] { JobExecutor::executeJob(noop, logger); }));
+        }
+        JobExecutor::setResolver(nullptr);
+        
+        bench::Metric& shell = result.metric("spawn_shell_ms", "ms");
+        for (int i = 0; i < opts.samples; ++i) {
+            shell.samples.push_back(bench::timeMs([&] { JobExecutor::executeJob(noop, logger); }));
+        }
+        
+        // The same commands bundled: one shell for all of them
+        bench::Metric& bundle = result.metric("bundle_per_job_ms", "ms");
+        noop.bundle = "benchmark";
+        std::vector<CronJob> bundled(100, noop);
+        for (int i = 0; i < opts.samples; ++i) {
+            double ms = bench::timeMs([&] { JobExecutor::executeBundle(noop.bundle, bundled, logger); });
+            bundle.samples.push_back(ms / bundled.size());
+        }
+    }
+
+    // --- Plugin latency (same work without fork/exec) ---------------------
+    if (!plugin_path.empty()) {
+        bench::Metric& plugin = result.metric("plugin_latency_ms", "ms");
+        Logger logger((scratch / "plugin.log").string());
+        logger.setSilentMode(true);
+        CronJob job = jobs.front();
+        job.type = JobType::PLUGIN;
+        job.plugin_path = std::filesystem::absolute(plugin_path).string();
+        job.plugin_arg = (scratch / "heartbeat").string();
+        job.description = "plugin-benchmark";
+        JobExecutor::executeJob(job, logger);   // dlopen happens once, outside the samples
+        for (int i = 0; i < opts.samples; ++i) {
+            plugin.samples.push_back(bench::timeMs([&] { JobExecutor::executeJob(job, logger); }));
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(scratch, ec);
+
+    return bench::finish(opts, result);
+}
@@ -0,0 +1,254 @@
+/**
+ * @file reload_bench.cpp
+ * @brief Config reload latency and churn benchmark for ConfigWatcher
+ *
+ * Rewrites generated jobs.json files of several sizes at increasing rates,
+ * either in place (truncate + write, what most editors and scripts do) or
+ * via atomic rename (write temp file + rename over the target), while a
+ * simulated scheduler thread keeps ticking. For every scenario it reports:
+ *
+ *   - latency_ms       file change completed -> new snapshot published
+ *   - reloads_per_change  snapshots published per file change
+ *   - failed_reloads   reload attempts rejected (e.g. half-written file)
+ *   - missed_changes   changes never observed by the watcher
+ *   - cpu_per_reload_ms   watcher CPU time per reload attempt
+ *   - tick_p99_us / tick_max_us   scheduler tick duration during churn
+ *
+ * Metric keys are suffixed with ".<mode>.n<jobs>.i<interval_ms>" so they can
+ * be stored and compared with the shared baseline tooling (bench_common.h).
+ *
+ * Build (from tester/):
+ *   g++ -O2 -std=c++17 -pthread -I../components reload_bench.cpp \
+ *       ../components/ConfigWatcher.cpp ../components/EventBus.cpp ../components/JobConfig.cpp ../components/JobMatrix.cpp \
+ *       ../components/CronEngine.cpp ../components/CronExpression.cpp \
+ *       ../components/Logger.cpp -o reload_bench
+ */
+
+#include "bench_common.h"
+
+#include <atomic>
+#include <thread>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "../components/ConfigWatcher.h"
+#include "../components/CronEngine.h"
+#include "../components/CronTypes.h"
+#include "../components/Logger.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Generate a config whose first job carries a revision marker
+ */
+std::string generateConfig(int jobs, int revision) {
+    nlohmann::json root;
+    root["jobs"] = nlohmann::json::array();
+    for (int i = 0; i < jobs; ++i) {
+        nlohmann::json job;
+        job["description"] = (i == 0) ? "rev " + std::to_string(revision) : "Reload job " + std::to_string(i);
+        job["command"] = "/usr/local/bin/reload_job_" + std::to_string(i);
+        job["schedule"] = {
+            {"minute", std::to_string(i % 60)}, {"hour", "*"},
+            {"day_of_month", "*"}, {"month", "*"}, {"day_of_week", "*"}
+        };
+        root["jobs"].push_back(std::move(job));
+    }
+    return root.dump(2);
+}
+
+void writeInPlace(const std::filesystem::path& path, const std::string& content) {
+    std::ofstream out(path, std::ios::trunc);
+    out << content;
+}
+
+void writeAtomic(const std::filesystem::path& path, const std::string& content) {
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << content;
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+double threadCpuMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+double processCpuMs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t idx = static_cast<size_t>(p * (values.size() - 1));
+    return values[idx];
+}
+
+struct Scenario {
+    std::string mode;   // "inplace" or "rename"
+    int jobs;
+    int interval_ms;
+};
+
+/**
+ * @brief Run one churn scenario and append its samples to the suite
+ */
+void runScenario(const Scenario& sc, int changes, const std::filesystem::path& dir, bench::SuiteResult& result) {
+    const std::string key = "." + sc.mode + ".n" + std::to_string(sc.jobs) + ".i" + std::to_string(sc.interval_ms);
+    std::filesystem::path config = dir / ("jobs_" + sc.mode + "_" + std::to_string(sc.jobs) + ".json");
+    writeInPlace(config, generateConfig(sc.jobs, 0));
+
+    Logger logger((dir / "reload_bench.log").string());
+    logger.setSilentMode(true);
+    ConfigWatcher watcher(config.string(), logger);
+    if (!watcher.startWatching()) {
+        std::cerr << "Error: cannot watch " << config << std::endl;
+        return;
+    }
+
+    // Simulated scheduler: same work as one daemon loop pass, every 5 ms
+    std::atomic<bool> ticking{true};
+    std::vector<double> ticks;
+    double tick_thread_cpu = 0.0;
+    std::thread ticker([&] {
+        std::map<std::string, std::pair<int, int>> last_exec;
+        std::tm local_time = {};
+        local_time.tm_hour = 12; local_time.tm_min = 30; local_time.tm_wday = 3;
+        double cpu_start = threadCpuMs();
+        while (ticking.load()) {
+            auto start = Clock::now();
+            auto jobs = watcher.getJobs();
+            size_t due = 0;
+            for (const auto& job : *jobs) {
+                if (CronEngine::shouldRunJob(job, local_time, last_exec)) ++due;
+            }
+            ticks.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        tick_thread_cpu = threadCpuMs() - cpu_start;
+    });
+
+    bench::Metric& latency = result.metric("latency_ms" + key, "ms");
+    int missed = 0;
+    const ReloadStats before = watcher.getReloadStats();
+    const double cpu_before = processCpuMs();
+    const double writer_cpu_before = threadCpuMs();
+
+    for (int rev = 1; rev <= changes; ++rev) {
+        const std::string content = generateConfig(sc.jobs, rev);
+        auto deadline = Clock::now() + std::chrono::milliseconds(sc.interval_ms);
+
+        if (sc.mode == "rename") {
+            writeAtomic(config, content);
+        } else {
+            writeInPlace(config, content);
+        }
+        auto written = Clock::now();
+
+        // Wait for the snapshot carrying this revision, up to the next write
+        const std::string marker = "rev " + std::to_string(rev);
+        bool seen = false;
+        auto give_up = std::max(deadline, written + std::chrono::milliseconds(1000));
+        while (Clock::now() < give_up) {
+            auto jobs = watcher.getJobs();
+            if (!jobs->empty() && jobs->front().description == marker) {
+                latency.samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - written).count());
+                seen = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        if (!seen) ++missed;
+        std::this_thread::sleep_until(std::max(deadline, Clock::now()));
+    }
+
+    // Let trailing events settle before reading counters
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    const double writer_cpu = threadCpuMs() - writer_cpu_before;
+    ticking.store(false);
+    ticker.join();
+    const double cpu_total = processCpuMs() - cpu_before;
+    const ReloadStats after = watcher.getReloadStats();
+    watcher.stopWatching();
+
+    const double attempts = static_cast<double>(after.attempts - before.attempts);
+    const double published = static_cast<double>(after.generation - before.generation);
+    const double watcher_cpu = std::max(0.0, cpu_total - tick_thread_cpu - writer_cpu);
+
+    result.metric("reloads_per_change" + key, "reloads").samples.push_back(published / changes);
+    result.metric("failed_reloads" + key, "reloads").samples.push_back(static_cast<double>(after.failures - before.failures));
+    result.metric("missed_changes" + key, "changes").samples.push_back(missed);
+    result.metric("cpu_per_reload_ms" + key, "ms").samples.push_back(attempts > 0 ? watcher_cpu / attempts : 0.0);
+    result.metric("tick_p99_us" + key, "us").samples.push_back(percentile(ticks, 0.99));
+    result.metric("tick_max_us" + key, "us").samples.push_back(percentile(ticks, 1.0));
+
+    std::cout << std::left << std::setw(8) << sc.mode << std::right
+              << " jobs " << std::setw(6) << sc.jobs
+              << " every " << std::setw(5) << sc.interval_ms << " ms"
+              << " | latency p50 " << std::setw(8) << std::setprecision(4) << percentile(latency.samples, 0.5) << " ms"
+              << " | reloads/change " << std::setw(5) << published / changes
+              << " | failed " << (after.failures - before.failures)
+              << " | missed " << missed
+              << " | tick p99 " << percentile(ticks, 0.99) << " us" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    opts.samples = 1;   // Each scenario is one sample; repeat with --repeat
+    std::vector<int> sizes = {10, 1000, 10000};
+    std::vector<int> intervals = {1000, 250, 100};
+    std::vector<std::string> modes = {"inplace", "rename"};
+    int changes = 6;
+    int repeat = 1;
+
+    bool ok = bench::parseOptions(argc, argv, opts, [&](const std::string& arg, const std::string& next) {
+        if (arg == "--sizes" && !next.empty()) { sizes = bench::parseList(next); return true; }
+        if (arg == "--intervals" && !next.empty()) { intervals = bench::parseList(next); return true; }
+        if (arg == "--changes" && !next.empty()) { changes = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--repeat" && !next.empty()) { repeat = std::max(1, std::stoi(next)); return true; }
+        if (arg == "--mode" && !next.empty()) { modes = {next}; return true; }
+        return false;
+    });
+    if (!ok) return 1;
+
+    bench::SuiteResult result = bench::newSuite("reload", opts);
+    std::cout << "=== nanoCron config reload benchmark ===" << std::endl;
+    std::cout << "Machine: " << result.machine << std::endl;
+    std::cout << "Changes per scenario: " << changes << "  Repeats: " << repeat << std::endl;
+
+    std::filesystem::path dir = std::filesystem::temp_directory_path() /
+                                ("nanocron_reload_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+
+    // ConfigWatcher/JobConfig report rejected files on stderr; keep the table readable
+    std::ofstream devnull("/dev/null");
+    std::streambuf* saved_cerr = std::cerr.rdbuf(devnull.rdbuf());
+
+    for (int r = 0; r < repeat; ++r) {
+        for (const auto& mode : modes) {
+            for (int jobs : sizes) {
+                for (int interval : intervals) {
+                    runScenario({mode, jobs, interval}, changes, dir, result);
+                }
+            }
+        }
+    }
+
+    std::cerr.rdbuf(saved_cerr);
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+
+    return bench::finish(opts, result);
+}
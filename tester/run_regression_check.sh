@@ -0,0 +1,194 @@
+#!/bin/bash
+
+# nanoCron performance regression check
+# Builds the benchmark binaries against the current components, compares the
+# results with the latest stored baseline for this machine and records a new
+# baseline for the current commit.
+#
+# Usage: ./run_regression_check.sh [--no-record] [--compare FILE] [--samples N] [--threshold PCT]
+# Exit code: 0 = pass, 2 = statistically significant regression (or an
+#            allocating steady-state tick), 1 = error
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+COMPONENTS="${SCRIPT_DIR}/../components"
+BUILD_DIR="${SCRIPT_DIR}/bench_build"
+BASELINE_DIR="${BASELINE_DIR:-${SCRIPT_DIR}/baselines}"
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m'
+
+RECORD="--record"
+COMPARE_ARGS=(--compare)
+EXTRA_ARGS=()
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        --no-record) RECORD="" ;;
+        --compare)   COMPARE_ARGS=(--compare "$2"); shift ;;
+        --samples|--threshold) EXTRA_ARGS+=("$1" "$2"); shift ;;
+        *) echo -e "${RED}Unknown option: $1${NC}"; exit 1 ;;
+    esac
+    shift
+done
+
+mkdir -p "${BUILD_DIR}"
+
+# Commit id of the tree under test (dirty trees are marked by the benchmarks)
+COMMIT="$(cd "${SCRIPT_DIR}" && git rev-parse --short=12 HEAD 2>/dev/null || echo unknown)"
+if ! (cd "${SCRIPT_DIR}" && git diff --quiet HEAD -- 2>/dev/null); then
+    COMMIT="${COMMIT}-dirty"
+fi
+
+echo -e "${BLUE}=== nanoCron regression check (commit ${COMMIT}) ===${NC}"
+
+echo -e "${YELLOW}Compiling core benchmark and example plugin...${NC}"
+g++ -O2 -std=c++17 -pthread -I"${COMPONENTS}" \
+    "${SCRIPT_DIR}/nanocron_bench.cpp" \
+    "${COMPONENTS}/JobConfig.cpp" \
+    "${COMPONENTS}/JobMatrix.cpp" \
+    "${COMPONENTS}/CronEngine.cpp" \
+    "${COMPONENTS}/CronExpression.cpp" \
+    "${COMPONENTS}/MaskBatch.cpp" \
+    "${COMPONENTS}/JobExecutor.cpp" \
+    "${COMPONENTS}/BundleRunner.cpp" \
+    "${COMPONENTS}/EventBus.cpp" \
+    "${COMPONENTS}/ExecutableResolver.cpp" \
+    "${COMPONENTS}/StartLag.cpp" \
+    "${COMPONENTS}/ProcessRunner.cpp" \
+    "${COMPONENTS}/UserAccounts.cpp" \
+    "${COMPONENTS}/Quotas.cpp" \
+    "${COMPONENTS}/AgentPool.cpp" \
+    "${COMPONENTS}/AgentProtocol.cpp" \
+    "${COMPONENTS}/PluginRunner.cpp" \
+    "${COMPONENTS}/CronScheduler.cpp" \
+    "${COMPONENTS}/WorkerPool.cpp" \
+    "${COMPONENTS}/Logger.cpp" \
+    -ldl -o "${BUILD_DIR}/nanocron_bench"
+g++ -O2 -shared -fPIC -I"${COMPONENTS}" \
+    "${SCRIPT_DIR}/test_exe_file/heartbeat_plugin.cpp" \
+    -o "${BUILD_DIR}/heartbeat_plugin.so"
+
+echo -e "${YELLOW}Compiling config reload benchmark...${NC}"
+g++ -O2 -std=c++17 -pthread -I"${COMPONENTS}" \
+    "${SCRIPT_DIR}/reload_bench.cpp" \
+    "${COMPONENTS}/ConfigWatcher.cpp" \
+    "${COMPONENTS}/EventBus.cpp" \
+    "${COMPONENTS}/JobConfig.cpp" \
+    "${COMPONENTS}/JobMatrix.cpp" \
+    "${COMPONENTS}/CronEngine.cpp" \
+    "${COMPONENTS}/CronExpression.cpp" \
+    "${COMPONENTS}/Logger.cpp" \
+    -o "${BUILD_DIR}/reload_bench"
+
+echo -e "${YELLOW}Compiling memory footprint benchmark (allocation tracking)...${NC}"
+g++ -O2 -std=c++17 -pthread -DNANOCRON_ALLOC_TRACKING -I"${COMPONENTS}" \
+    "${SCRIPT_DIR}/memory_bench.cpp" \
+    "${COMPONENTS}/AllocTracker.cpp" \
+    "${COMPONENTS}/ConfigWatcher.cpp" \
+    "${COMPONENTS}/JobConfig.cpp" \
+    "${COMPONENTS}/JobMatrix.cpp" \
+    "${COMPONENTS}/CronExpression.cpp" \
+    "${COMPONENTS}/MaskBatch.cpp" \
+    "${COMPONENTS}/CronScheduler.cpp" \
+    "${COMPONENTS}/WorkerPool.cpp" \
+    "${COMPONENTS}/JobExecutor.cpp" \
+    "${COMPONENTS}/BundleRunner.cpp" \
+    "${COMPONENTS}/EventBus.cpp" \
+    "${COMPONENTS}/ExecutableResolver.cpp" \
+    "${COMPONENTS}/StartLag.cpp" \
+    "${COMPONENTS}/ProcessRunner.cpp" \
+    "${COMPONENTS}/UserAccounts.cpp" \
+    "${COMPONENTS}/Quotas.cpp" \
+    "${COMPONENTS}/AgentPool.cpp" \
+    "${COMPONENTS}/AgentProtocol.cpp" \
+    "${COMPONENTS}/PluginRunner.cpp" \
+    "${COMPONENTS}/Logger.cpp" \
+    -ldl -o "${BUILD_DIR}/memory_bench"
+
+echo -e "${YELLOW}Compiling cluster sharding benchmark...${NC}"
+g++ -O2 -std=c++17 -pthread -I"${COMPONENTS}" \
+    "${SCRIPT_DIR}/cluster_bench.cpp" \
+    "${COMPONENTS}/HashRing.cpp" \
+    "${COMPONENTS}/CronScheduler.cpp" \
+    "${COMPONENTS}/JobMatrix.cpp" \
+    "${COMPONENTS}/CronExpression.cpp" \
+    "${COMPONENTS}/MaskBatch.cpp" \
+    "${COMPONENTS}/WorkerPool.cpp" \
+    "${COMPONENTS}/JobExecutor.cpp" \
+    "${COMPONENTS}/BundleRunner.cpp" \
+    "${COMPONENTS}/EventBus.cpp" \
+    "${COMPONENTS}/ExecutableResolver.cpp" \
+    "${COMPONENTS}/StartLag.cpp" \
+    "${COMPONENTS}/ProcessRunner.cpp" \
+    "${COMPONENTS}/UserAccounts.cpp" \
+    "${COMPONENTS}/Quotas.cpp" \
+    "${COMPONENTS}/AgentPool.cpp" \
+    "${COMPONENTS}/AgentProtocol.cpp" \
+    "${COMPONENTS}/PluginRunner.cpp" \
+    "${COMPONENTS}/AllocTracker.cpp" \
+    "${COMPONENTS}/Logger.cpp" \
+    -ldl -o "${BUILD_DIR}/cluster_bench"
+
+echo -e "${YELLOW}Compiling live job mutation benchmark...${NC}"
+g++ -O2 -std=c++17 -pthread -I"${COMPONENTS}" \
+    "${SCRIPT_DIR}/mutation_bench.cpp" \
+    "${COMPONENTS}/JobStore.cpp" \
+    "${COMPONENTS}/ConfigPersister.cpp" \
+    "${COMPONENTS}/CronScheduler.cpp" \
+    "${COMPONENTS}/CronExpression.cpp" \
+    "${COMPONENTS}/MaskBatch.cpp" \
+    "${COMPONENTS}/WorkerPool.cpp" \
+    "${COMPONENTS}/JobExecutor.cpp" \
+    "${COMPONENTS}/BundleRunner.cpp" \
+    "${COMPONENTS}/EventBus.cpp" \
+    "${COMPONENTS}/ExecutableResolver.cpp" \
+    "${COMPONENTS}/StartLag.cpp" \
+    "${COMPONENTS}/ProcessRunner.cpp" \
+    "${COMPONENTS}/UserAccounts.cpp" \
+    "${COMPONENTS}/Quotas.cpp" \
+    "${COMPONENTS}/AgentPool.cpp" \
+    "${COMPONENTS}/AgentProtocol.cpp" \
+    "${COMPONENTS}/PluginRunner.cpp" \
+    "${COMPONENTS}/JobConfig.cpp" \
+    "${COMPONENTS}/JobMatrix.cpp" \
+    "${COMPONENTS}/AllocTracker.cpp" \
+    "${COMPONENTS}/Logger.cpp" \
+    -ldl -o "${BUILD_DIR}/mutation_bench"
+
+STATUS=0
+run_suite() {
+    local binary="$1"
+    shift
+    set +e
+    (cd "${SCRIPT_DIR}" && "${binary}" --commit "${COMMIT}" --baseline-dir "${BASELINE_DIR}" \
+        "${COMPARE_ARGS[@]}" ${RECORD} "${EXTRA_ARGS[@]}" "$@")
+    local rc=$?
+    set -e
+    if [ $rc -eq 2 ] || [ $rc -eq 3 ]; then
+        # 2 = baseline regression, 3 = hard target missed (allocating tick, rebalance too large)
+        STATUS=2
+    elif [ $rc -ne 0 ] && [ $STATUS -eq 0 ]; then
+        STATUS=1
+    fi
+}
+
+run_suite "${BUILD_DIR}/nanocron_bench" --plugin "${BUILD_DIR}/heartbeat_plugin.so"
+# Each reload scenario yields one sample per repeat; three give the t-test something to work with
+run_suite "${BUILD_DIR}/reload_bench" --repeat 3
+run_suite "${BUILD_DIR}/memory_bench"
+run_suite "${BUILD_DIR}/cluster_bench"
+run_suite "${BUILD_DIR}/mutation_bench"
+
+if [ $STATUS -eq 0 ]; then
+    echo -e "${GREEN}Performance verdict: PASS${NC}"
+elif [ $STATUS -eq 2 ]; then
+    echo -e "${RED}Performance verdict: REGRESSION DETECTED${NC}"
+else
+    echo -e "${RED}Performance check failed to run${NC}"
+fi
+exit $STATUS
@@ -0,0 +1,61 @@
+/**
+ * @file heartbeat_plugin.cpp
+ * @brief Example nanoCron plugin: touch a heartbeat file in-process
+ *
+ * plugin_arg is the heartbeat file path. An optional ";hold=N" suffix keeps
+ * the plugin busy for N milliseconds while polling the cancellation token,
+ * which is handy to exercise timeouts.
+ *
+ * Build (from tester/test_exe_file/):
+ *   g++ -O2 -shared -fPIC -I../../components heartbeat_plugin.cpp -o heartbeat_plugin.so
+ *
+ * jobs.json entry:
+ *   { "description": "Heartbeat", "type": "plugin",
+ *     "plugin": "/path/to/heartbeat_plugin.so", "plugin_arg": "/tmp/nanocron.heartbeat",
+ *     "schedule": "* * * * *" }
+ */
+
+#include "nanocron_plugin.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+extern "C" uint32_t nanocron_plugin_abi_version(void) {
+    return NANOCRON_PLUGIN_ABI_VERSION;
+}
+
+extern "C" int nanocron_job_run(nanocron_job_ctx* ctx) {
+    std::string arg = ctx->argument ? ctx->argument : "";
+    std::string path = arg;
+    long hold_ms = 0;
+
+    size_t sep = arg.find(";hold=");
+    if (sep != std::string::npos) {
+        path = arg.substr(0, sep);
+        hold_ms = std::strtol(arg.c_str() + sep + 6, nullptr, 10);
+    }
+    if (path.empty()) {
+        ctx->log(ctx, NANOCRON_LOG_ERROR, "heartbeat_plugin: plugin_arg must be a file path");
+        return NANOCRON_JOB_FAILED;
+    }
+
+    for (long waited = 0; waited < hold_ms; waited += 10) {
+        if (ctx->is_cancelled(ctx)) {
+            return NANOCRON_JOB_CANCELLED;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        ctx->log(ctx, NANOCRON_LOG_ERROR, "heartbeat_plugin: cannot open heartbeat file");
+        return NANOCRON_JOB_FAILED;
+    }
+    std::fprintf(file, "%s %lld\n", ctx->job_id, static_cast<long long>(ctx->scheduled_time));
+    std::fclose(file);
+    return NANOCRON_JOB_OK;
+}